@@ -1128,10 +1128,63 @@ void RawModel::updateOperatorsConcurrently(int windowIndex)
 //    QFuture<QPair<int,RowVectorXd> > future = QtConcurrent::mapped(m_listTmpChData.begin(),m_listTmpChData.end(),applyOps);
     //**************************************************************************************************************************************************************************
 
-    QFuture<void > future = QtConcurrent::map(m_listTmpChData,[this](QPair<int,RowVectorXd>& chdata) {
-        return applyOperatorsConcurrently(chdata);
+    //Channels which are only filtered by the same time-domain FIR filter are streamed through one overlap-save filter,
+    //all other channels apply their operators one by one
+    QMap<FilterOperator*, QList<QPair<int,RowVectorXd>*> > mapFirGroups;
+    QList<QPair<int,RowVectorXd>*> listOtherChData;
+
+    for(qint32 i=0; i < m_listTmpChData.size(); ++i) {
+        QPair<int,RowVectorXd>* pChData = &m_listTmpChData[i];
+        QList<QSharedPointer<MNEOperator> > ops = m_assignedOperators.values(pChData->first);
+
+        FilterOperator* pFilter = Q_NULLPTR;
+        if(ops.size() == 1 && ops.first()->m_OperatorType == MNEOperator::FILTER) {
+            pFilter = ops.first().staticCast<FilterOperator>().data();
+
+            //Cosine filters are designed in the frequency domain and are only defined for circular convolution
+            int iOffset = pFilter->m_iFFTlength/4 - pFilter->m_iFilterOrder/2;
+            if(pFilter->m_designMethod != FilterOperator::Tschebyscheff
+               || iOffset < 0
+               || iOffset + pChData->second.cols() + pFilter->m_dCoeffA.cols() - 1 > pFilter->m_iFFTlength) {
+                pFilter = Q_NULLPTR;
+            }
+        }
+
+        if(pFilter) {
+            mapFirGroups[pFilter].append(pChData);
+        } else {
+            listOtherChData.append(pChData);
+        }
+    }
+
+    QFuture<void > future = QtConcurrent::map(listOtherChData,[this](QPair<int,RowVectorXd>* pChData) {
+        return applyOperatorsConcurrently(*pChData);
     });
 
+    QMapIterator<FilterOperator*, QList<QPair<int,RowVectorXd>*> > itFirGroups(mapFirGroups);
+    while(itFirGroups.hasNext()) {
+        itFirGroups.next();
+        const FilterOperator* pFilter = itFirGroups.key();
+        const QList<QPair<int,RowVectorXd>*>& listChData = itFirGroups.value();
+
+        //Append zeros to flush the filter, which yields the full linear convolution
+        int iDataLength = listChData.first()->second.cols();
+        MatrixXd matData = MatrixXd::Zero(listChData.size(), iDataLength + pFilter->m_dCoeffA.cols() - 1);
+        for(qint32 i=0; i < listChData.size(); ++i) {
+            matData.row(i).head(iDataLength) = listChData.at(i)->second;
+        }
+
+        OverlapSaveFilter firFilter(pFilter->m_dCoeffA, matData.rows());
+        firFilter.filter(matData);
+
+        //Same layout as FilterOperator::applyFFTFilter, i.e. zero padded to the FFT length
+        int iOffset = pFilter->m_iFFTlength/4 - pFilter->m_iFilterOrder/2;
+        for(qint32 i=0; i < listChData.size(); ++i) {
+            listChData.at(i)->second = RowVectorXd::Zero(pFilter->m_iFFTlength);
+            listChData.at(i)->second.segment(iOffset, matData.cols()) = matData.row(i);
+        }
+    }
+
     //Wait for thread to be finished processig the data, then insert data
     future.waitForFinished();
 
@@ -109,6 +109,7 @@
 #include <fiff/fiff_io.h>
 #include <mne/mne.h>
 #include <utils/filterTools/parksmcclellan.h>
+#include <utils/filterTools/overlapsavefilter.h>
 
 
 //*************************************************************************************************************
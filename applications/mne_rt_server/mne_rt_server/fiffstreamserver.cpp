@@ -43,6 +43,9 @@
 
 #include "mne_rt_server.h"
 
+#include <fiff/fiff_stream.h>
+#include <fiff/fiff_constants.h>
+
 
 //*************************************************************************************************************
 //=============================================================================================================
@@ -373,10 +376,19 @@ void FiffStreamServer::forwardMeasInfo(qint32 ID, const FiffInfo& p_fiffInfo)
 
 
 //*************************************************************************************************************
-//ToDo increase preformance --> try inline
 void FiffStreamServer::forwardRawBuffer(QSharedPointer<Eigen::MatrixXf> m_pMatRawData)
 {
-    emit remitRawBuffer(m_pMatRawData);
+    if(m_qClientList.isEmpty())
+        return;
+
+    //
+    // Encode the raw buffer only once for all clients
+    //
+    QByteArray t_blockRawBuffer;
+    FiffStream t_FiffStreamOut(&t_blockRawBuffer, QIODevice::WriteOnly);
+    t_FiffStreamOut.write_float(FIFF_DATA_BUFFER, m_pMatRawData->data(), m_pMatRawData->rows()*m_pMatRawData->cols());
+
+    emit remitRawBuffer(t_blockRawBuffer);
 }
 
 
@@ -52,6 +52,7 @@
 
 #include <QStringList>
 #include <QTcpServer>
+#include <QByteArray>
 
 
 //*************************************************************************************************************
@@ -123,6 +124,14 @@ public:
 
 //public slots: --> in Qt 5 not anymore declared as slot
     void forwardMeasInfo(qint32 ID, const FiffInfo& p_fiffInfo);
+
+    //=========================================================================================================
+    /**
+    * Encodes a raw buffer once into a FIFF_DATA_BUFFER tag and hands the encoded tag to all clients. The tag is
+    * implicitly shared, the clients queue it without copying.
+    *
+    * @param[in] m_pMatRawData  The raw buffer.
+    */
     void forwardRawBuffer(QSharedPointer<Eigen::MatrixXf> m_pMatRawData);
 
 signals:
@@ -132,7 +141,7 @@ signals:
     void stopMeasFiffStreamClient(qint32 ID);
 
     void remitMeasInfo(qint32 ID, const FIFFLIB::FiffInfo& p_fiffInfo);
-    void remitRawBuffer(QSharedPointer<Eigen::MatrixXf>);
+    void remitRawBuffer(const QByteArray& p_blockRawBuffer);
 
     void closeFiffStreamServer();
 
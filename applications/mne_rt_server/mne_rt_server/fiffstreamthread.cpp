@@ -82,6 +82,10 @@ FiffStreamThread::FiffStreamThread(qint32 id, int socketDescriptor, QObject *par
 , m_iDataClientId(id)
 , m_sDataClientAlias(QString(""))
 , m_iSocketDescriptor(socketDescriptor)
+, m_iNumQueuedRawBuffers(0)
+, m_iMaxQueuedRawBuffers(50)
+, m_iMaxBytesToWrite(1024*1024)
+, m_iNumDroppedRawBuffers(0)
 , m_bIsSendingRawBuffer(false)
 , m_bIsRunning(false)
 {
@@ -110,12 +114,12 @@ void FiffStreamThread::startMeas(qint32 ID)
     {
         qDebug() << "Activate raw buffer sending.";
 
-        m_qMutex.lock();
         // ToDo send start meas
-        FiffStream t_FiffStreamOut(&m_qSendBlock, QIODevice::WriteOnly);
+        QByteArray t_blockCmd;
+        FiffStream t_FiffStreamOut(&t_blockCmd, QIODevice::WriteOnly);
         t_FiffStreamOut.start_block(FIFFB_RAW_DATA);
+        enqueue(t_blockCmd);
         m_bIsSendingRawBuffer = true;
-        m_qMutex.unlock();
     }
 }
 
@@ -129,11 +133,11 @@ void FiffStreamThread::stopMeas(qint32 ID)
     {
         qDebug() << "stop raw buffer sending.";
 
-        m_qMutex.lock();
-        FiffStream t_FiffStreamOut(&m_qSendBlock, QIODevice::WriteOnly);
-        t_FiffStreamOut.end_block(FIFFB_RAW_DATA);
         m_bIsSendingRawBuffer = false;
-        m_qMutex.unlock();
+        QByteArray t_blockCmd;
+        FiffStream t_FiffStreamOut(&t_blockCmd, QIODevice::WriteOnly);
+        t_FiffStreamOut.end_block(FIFFB_RAW_DATA);
+        enqueue(t_blockCmd);
     }
 }
 
@@ -178,19 +182,12 @@ void FiffStreamThread::parseCommand(FiffTag::SPtr p_pTag)
 
 //*************************************************************************************************************
 
-void FiffStreamThread::sendRawBuffer(QSharedPointer<Eigen::MatrixXf> m_pMatRawData)
+void FiffStreamThread::sendRawBuffer(const QByteArray& p_blockRawBuffer)
 {
     if(m_bIsSendingRawBuffer)
     {
 //        qDebug() << "Send RawBuffer to client";
-
-        m_qMutex.lock();
-
-        FiffStream t_FiffStreamOut(&m_qSendBlock, QIODevice::WriteOnly);
-        t_FiffStreamOut.write_float(FIFF_DATA_BUFFER,m_pMatRawData->data(),m_pMatRawData->rows()*m_pMatRawData->cols());
-
-        m_qMutex.unlock();
-
+        enqueue(p_blockRawBuffer, true);
     }
 //    else
 //    {
@@ -219,15 +216,52 @@ void FiffStreamThread::sendRawBuffer(QSharedPointer<Eigen::MatrixXf> m_pMatRawDa
 //}
 
 
+//*************************************************************************************************************
+
+void FiffStreamThread::enqueue(const QByteArray& p_blockData, bool p_bIsRawBuffer)
+{
+    SendBlock t_sendBlock;
+    t_sendBlock.data = p_blockData;
+    t_sendBlock.bIsRawBuffer = p_bIsRawBuffer;
+
+    QMutexLocker t_locker(&m_qMutex);
+
+    if(p_bIsRawBuffer)
+    {
+        //
+        // Drop the oldest waiting raw buffer if the client can not keep up; measurement info and block tags are kept
+        //
+        if(m_iNumQueuedRawBuffers >= m_iMaxQueuedRawBuffers)
+        {
+            for(int i = 0; i < m_qSendQueue.size(); ++i)
+            {
+                if(m_qSendQueue[i].bIsRawBuffer)
+                {
+                    m_qSendQueue.removeAt(i);
+                    --m_iNumQueuedRawBuffers;
+                    break;
+                }
+            }
+
+            if(m_iNumDroppedRawBuffers % 1000 == 0)
+                printf("FiffStreamClient (ID %d): client is too slow, dropped %lld raw buffer(s)\r\n\n", m_iDataClientId, m_iNumDroppedRawBuffers + 1);
+            ++m_iNumDroppedRawBuffers;
+        }
+        ++m_iNumQueuedRawBuffers;
+    }
+
+    m_qSendQueue.append(t_sendBlock);
+}
+
+
 //*************************************************************************************************************
 
 void FiffStreamThread::sendMeasurementInfo(qint32 ID, const FiffInfo& p_fiffInfo)
 {
     if(ID == m_iDataClientId)
     {
-        m_qMutex.lock();
-
-        FiffStream t_FiffStreamOut(&m_qSendBlock, QIODevice::WriteOnly);
+        QByteArray t_blockInfo;
+        FiffStream t_FiffStreamOut(&t_blockInfo, QIODevice::WriteOnly);
 
 //        qint32 init_info[2];
 //        init_info[0] = FIFF_MNE_RT_CLIENT_ID;
@@ -238,7 +272,7 @@ void FiffStreamThread::sendMeasurementInfo(qint32 ID, const FiffInfo& p_fiffInfo
 //FiffStream::start_writing_raw
 
         p_fiffInfo.writeToStream(&t_FiffStreamOut);
-        m_qMutex.unlock();
+        enqueue(t_blockInfo);
 
 //        qDebug() << "MeasInfo Blocksize: " << m_qSendBlock.size();
     }
@@ -249,9 +283,11 @@ void FiffStreamThread::sendMeasurementInfo(qint32 ID, const FiffInfo& p_fiffInfo
 
 void FiffStreamThread::writeClientId()
 {
-    FiffStream t_FiffStreamOut(&m_qSendBlock, QIODevice::WriteOnly);
+    QByteArray t_blockId;
+    FiffStream t_FiffStreamOut(&t_blockId, QIODevice::WriteOnly);
 
     t_FiffStreamOut.write_int(FIFF_MNE_RT_CLIENT_ID, &m_iDataClientId);
+    enqueue(t_blockId);
 }
 
 
@@ -328,29 +364,27 @@ void FiffStreamThread::run()
     while(t_qTcpSocket.state() != QAbstractSocket::UnconnectedState && m_bIsRunning)
     {
         //
-        // Write available data
+        // Write available data: Move the queued blocks to the socket as long as its write buffer is not filled up,
+        // otherwise they stay in the queue, where raw buffers may be dropped. The mutex is never held while writing.
         //
+        QList<SendBlock> t_qSendBlocks;
+        qint64 t_iBytesToWrite = t_qTcpSocket.bytesToWrite();
         m_qMutex.lock();
-        qint32 t_iBlockSize = m_qSendBlock.size();
-//        qDebug() << "data available" << t_iBlockSize;
-        if(t_iBlockSize > 0)
+        while(!m_qSendQueue.isEmpty() && t_iBytesToWrite < m_iMaxBytesToWrite)
         {
-            qint32 t_iBytesWritten = t_qTcpSocket.write(m_qSendBlock);
-//            qDebug() << ++i<< "[wrote bytes] " << t_iBytesWritten;
-            t_qTcpSocket.waitForBytesWritten();
-            if(t_iBytesWritten == t_iBlockSize)
-            {
-                m_qSendBlock.clear();
-            }
-            else
-            {
-                //we have to store bytes which were not written to the socket, due to writing limit
-                //m_qSendBlock = m_qSendBlock.mid(t_iBytesWritten, t_iBlockSize-t_iBytesWritten);
-                m_qSendBlock.remove(0,t_iBytesWritten); //higher performance then mid
-            }
+            t_qSendBlocks.append(m_qSendQueue.takeFirst());
+            t_iBytesToWrite += t_qSendBlocks.last().data.size();
+            if(t_qSendBlocks.last().bIsRawBuffer)
+                --m_iNumQueuedRawBuffers;
         }
         m_qMutex.unlock();
 
+        for(int i = 0; i < t_qSendBlocks.size(); ++i)
+            t_qTcpSocket.write(t_qSendBlocks[i].data);
+
+        if(t_qTcpSocket.bytesToWrite() > 0)
+            t_qTcpSocket.flush();
+
         //
         // Read: Wait 10ms for incomming tag header, read and continue
         //
@@ -54,6 +54,8 @@
 #include <QTcpSocket>
 #include <QMutex>
 #include <QSharedPointer>
+#include <QByteArray>
+#include <QList>
 
 
 //*************************************************************************************************************
@@ -98,6 +100,17 @@ public:
 
     void writeClientId();
 
+    //=========================================================================================================
+    /**
+    * Queues an encoded raw buffer for sending, if raw buffer sending is active. The raw buffer is encoded once by
+    * the FiffStreamServer and shared by all clients. If the client can not keep up and already
+    * m_iMaxQueuedRawBuffers raw buffers are waiting, the oldest waiting raw buffer is dropped. This function never
+    * blocks on the client's socket.
+    *
+    * @param[in] p_blockRawBuffer   The FIFF_DATA_BUFFER tag.
+    */
+    void sendRawBuffer(const QByteArray& p_blockRawBuffer);
+
 //    void sendData(QTcpSocket& p_qTcpSocket);
 
 signals:
@@ -109,20 +122,41 @@ private:
 
     int m_iSocketDescriptor;
 
-    QMutex m_qMutex;
-    QByteArray m_qSendBlock;
+    //=========================================================================================================
+    /**
+    * A block of encoded tags which waits for being written to the socket.
+    */
+    struct SendBlock {
+        QByteArray  data;           /**< The encoded tags, raw buffers share their data with the other clients.*/
+        bool        bIsRawBuffer;   /**< Whether the block is a raw buffer, which may be dropped.*/
+    };
+
+    QMutex m_qMutex;                        /**< Guards the send queue.*/
+    QList<SendBlock> m_qSendQueue;          /**< Blocks which wait for being written to the socket.*/
+    qint32 m_iNumQueuedRawBuffers;          /**< Number of raw buffers in the send queue.*/
+    qint32 m_iMaxQueuedRawBuffers;          /**< Number of queued raw buffers from which on the oldest is dropped.*/
+    qint64 m_iMaxBytesToWrite;              /**< Number of bytes in the socket's write buffer from which on the queue is held back.*/
+    qint64 m_iNumDroppedRawBuffers;         /**< Number of raw buffers dropped for this client.*/
 
     bool m_bIsSendingRawBuffer;
 
     bool m_bIsRunning;
 
+    //=========================================================================================================
+    /**
+    * Appends a block to the send queue.
+    *
+    * @param[in] p_blockData        The encoded tags.
+    * @param[in] p_bIsRawBuffer     Whether the block is a raw buffer, which may be dropped.
+    */
+    void enqueue(const QByteArray& p_blockData, bool p_bIsRawBuffer = false);
+
     void startMeas(qint32 ID);
 
     void stopMeas(qint32 ID);
 
     void sendMeasurementInfo(qint32 ID, const FiffInfo& p_fiffInfo);
 
-    void sendRawBuffer(QSharedPointer<Eigen::MatrixXf> m_pMatRawData);
     //void readToBuffer1();
 //    void readProc(QTcpSocket& p_qTcpSocket);
 };
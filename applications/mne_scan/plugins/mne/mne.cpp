@@ -399,7 +399,7 @@ void MNE::updateRTMSA(SCMEASLIB::Measurement::SPtr pMeasurement)
     if(pRTMSA && m_bReceiveData) {
         //Check if buffer initialized
         if(!m_pMatrixDataBuffer) {
-            m_pMatrixDataBuffer = CircularMatrixBuffer<double>::SPtr(new CircularMatrixBuffer<double>(64, pRTMSA->getNumChannels(), pRTMSA->getMultiSampleArray()[0].cols()));
+            m_pMatrixDataBuffer = LockFreeCircularMatrixBuffer<double>::SPtr(new LockFreeCircularMatrixBuffer<double>(64, pRTMSA->getNumChannels(), pRTMSA->getMultiSampleArray()[0].cols()));
         }
 
         //Fiff Information of the RTMSA
@@ -537,6 +537,25 @@ void MNE::onTriggerTypeChanged(const QString& triggerType)
 }
 
 
+//*************************************************************************************************************
+
+void MNE::updateSourceEstimate(MNESourceEstimate& sourceEstimate,
+                               MatrixXd& matSourceData,
+                               float tmin,
+                               float tstep)
+{
+    if(sourceEstimate.isEmpty()
+       || sourceEstimate.data.rows() != matSourceData.rows()
+       || sourceEstimate.data.cols() != matSourceData.cols()
+       || sourceEstimate.tmin != tmin
+       || sourceEstimate.tstep != tstep) {
+        sourceEstimate = MNESourceEstimate(matSourceData, m_pMinimumNorm->getVertices(), tmin, tstep);
+    } else {
+        sourceEstimate.data.swap(matSourceData);
+    }
+}
+
+
 //*************************************************************************************************************
 
 void MNE::run()
@@ -616,6 +635,8 @@ void MNE::run()
     MatrixXd data;
     qint32 j;
     float tmin, tstep;
+    MatrixXd matSourceData;
+    bool bInverseApplied;
     MNESourceEstimate sourceEstimate;
     FiffEvoked t_fiffEvoked;
 
@@ -626,7 +647,7 @@ void MNE::run()
             //qDebug()<<"MNE::run - Processing RTMSA data";
 
             if(m_pMinimumNorm && ((skip_count % m_iDownSample) == 0)) {
-                rawSegment = m_pMatrixDataBuffer->pop();
+                m_pMatrixDataBuffer->pop(rawSegment);
 
                 //Pick the same channels as in the inverse operator
                 m_qMutex.lock();
@@ -640,13 +661,16 @@ void MNE::run()
                 tstep = 1.0f / m_pFiffInfoInput->sfreq;
 
                 //TODO: Add picking here. See evoked part as input.
-                sourceEstimate = m_pMinimumNorm->calculateInverse(data,
-                                                                  tmin,
-                                                                  tstep);
+                //The result buffer is reused from block to block
+                bInverseApplied = m_pMinimumNorm->applyInverse(data, matSourceData);
+
+                if(bInverseApplied) {
+                    updateSourceEstimate(sourceEstimate, matSourceData, tmin, tstep);
+                }
 
                 m_qMutex.unlock();
 
-                if(!sourceEstimate.isEmpty()) {
+                if(bInverseApplied) {
                     m_pRTSEOutput->data()->setValue(sourceEstimate);
                 }
             } else {
@@ -668,11 +692,33 @@ void MNE::run()
                 t_fiffEvoked = m_qVecFiffEvoked.takeFirst();
                 //qDebug()<<"MNE::run - t_fiffEvoked.data.rows()"<<t_fiffEvoked.data.rows();
 
-                sourceEstimate = m_pMinimumNorm->calculateInverse(t_fiffEvoked);
+                if(m_invOp.check_ch_names(t_fiffEvoked.info)) {
+                    //The inverse depends on the number of averages
+                    m_pMinimumNorm->doInverseSetup(t_fiffEvoked.nave, false);
+
+                    //Pick the same channels as in the inverse operator
+                    data.resize(m_invOp.noise_cov->names.size(), t_fiffEvoked.data.cols());
+
+                    for(j = 0; j < m_invOp.noise_cov->names.size(); ++j) {
+                        data.row(j) = t_fiffEvoked.data.row(t_fiffEvoked.info.ch_names.indexOf(m_invOp.noise_cov->names.at(j)));
+                    }
+
+                    tmin = t_fiffEvoked.times[0];
+                    tstep = 1.0f / t_fiffEvoked.info.sfreq;
+
+                    bInverseApplied = m_pMinimumNorm->applyInverse(data, matSourceData);
+                } else {
+                    qWarning("MNE::run - Channel name check failed.");
+                    bInverseApplied = false;
+                }
+
+                if(bInverseApplied) {
+                    updateSourceEstimate(sourceEstimate, matSourceData, tmin, tstep);
+                }
 
                 m_qMutex.unlock();
 
-                if(!sourceEstimate.isEmpty()) {
+                if(bInverseApplied) {
                     m_pRTSEOutput->data()->setValue(sourceEstimate);
                 }
             } else {
@@ -46,7 +46,7 @@
 
 #include <scShared/Interfaces/IAlgorithm.h>
 
-#include <utils/generics/circularmatrixbuffer.h>
+#include <utils/generics/lockfreecircularmatrixbuffer.h>
 
 #include <fiff/fiff_evoked.h>
 
@@ -75,6 +75,7 @@ namespace DISPLIB {
 namespace MNELIB {
     class MNEForwardSolution;
     class MNEInverseOperator;
+    class MNESourceEstimate;
 }
 
 namespace FIFFLIB {
@@ -224,11 +225,27 @@ protected:
 
     virtual void run();
 
+    //=========================================================================================================
+    /**
+    * Moves the result of MinimumNorm::applyInverse into the source estimate. The buffers are swapped, so the
+    * result buffer is reused for the next block. The estimate is only rebuilt if its time axis changed.
+    * Has to be called with m_qMutex locked.
+    *
+    * @param [in, out] sourceEstimate   The source estimate to update.
+    * @param [in, out] matSourceData    The result of applyInverse, holds the previous data afterwards.
+    * @param [in] tmin                  The time of the first sample.
+    * @param [in] tstep                 The time between two samples.
+    */
+    void updateSourceEstimate(MNELIB::MNESourceEstimate& sourceEstimate,
+                              Eigen::MatrixXd& matSourceData,
+                              float tmin,
+                              float tstep);
+
     QSharedPointer<SCSHAREDLIB::PluginInputData<SCMEASLIB::RealTimeMultiSampleArray> >      m_pRTMSAInput;              /**< The RealTimeMultiSampleArray input.*/
     QSharedPointer<SCSHAREDLIB::PluginInputData<SCMEASLIB::RealTimeEvokedSet> >             m_pRTESInput;               /**< The RealTimeEvoked input.*/
     QSharedPointer<SCSHAREDLIB::PluginInputData<SCMEASLIB::RealTimeCov> >                   m_pRTCInput;                /**< The RealTimeCov input.*/
     QSharedPointer<SCSHAREDLIB::PluginOutputData<SCMEASLIB::RealTimeSourceEstimate> >       m_pRTSEOutput;              /**< The RealTimeSourceEstimate output.*/
-    QSharedPointer<IOBUFFER::CircularMatrixBuffer<double> >                                 m_pMatrixDataBuffer;        /**< Holds incoming RealTimeMultiSampleArray data.*/
+    QSharedPointer<IOBUFFER::LockFreeCircularMatrixBuffer<double> >                         m_pMatrixDataBuffer;        /**< Holds incoming RealTimeMultiSampleArray data.*/
     QSharedPointer<INVERSELIB::MinimumNorm>                                                 m_pMinimumNorm;             /**< Minimum Norm Estimation. */
     QSharedPointer<RTPROCESSINGLIB::RtInvOp>                                                m_pRtInvOp;                 /**< Real-time inverse operator. */
     QSharedPointer<MNELIB::MNEForwardSolution>                                              m_pFwd;                     /**< Forward solution. */
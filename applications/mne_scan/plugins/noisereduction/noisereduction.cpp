@@ -88,7 +88,7 @@ NoiseReduction::NoiseReduction()
 : m_bIsRunning(false)
 , m_pNoiseReductionInput(NULL)
 , m_pNoiseReductionOutput(NULL)
-, m_pNoiseReductionBuffer(CircularMatrixBuffer<double>::SPtr())
+, m_pNoiseReductionBuffer(LockFreeCircularMatrixBuffer<double>::SPtr())
 , m_iMaxFilterTapSize(0)
 , m_bSpharaActive(false)
 , m_bFilterActivated(false)
@@ -191,7 +191,7 @@ void NoiseReduction::init()
             this, &NoiseReduction::setSpharaOptions);
 
     if(!m_pNoiseReductionBuffer.isNull()) {
-        m_pNoiseReductionBuffer = CircularMatrixBuffer<double>::SPtr();
+        m_pNoiseReductionBuffer = LockFreeCircularMatrixBuffer<double>::SPtr();
     }
 }
 
@@ -270,7 +270,7 @@ void NoiseReduction::update(SCMEASLIB::Measurement::SPtr pMeasurement)
     if(m_pRTMSA) {
         //Check if buffer initialized
         if(!m_pNoiseReductionBuffer) {
-            m_pNoiseReductionBuffer = CircularMatrixBuffer<double>::SPtr(new CircularMatrixBuffer<double>(64, m_pRTMSA->getNumChannels(), m_pRTMSA->getMultiSampleArray()[0].cols()));
+            m_pNoiseReductionBuffer = LockFreeCircularMatrixBuffer<double>::SPtr(new LockFreeCircularMatrixBuffer<double>(64, m_pRTMSA->getNumChannels(), m_pRTMSA->getMultiSampleArray()[0].cols()));
         }
 
         //Fiff information
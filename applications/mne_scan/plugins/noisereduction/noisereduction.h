@@ -44,7 +44,7 @@
 
 #include "noisereduction_global.h"
 
-#include <utils/generics/circularmatrixbuffer.h>
+#include <utils/generics/lockfreecircularmatrixbuffer.h>
 #include <utils/filterTools/filterdata.h>
 #include <fiff/fiff_proj.h>
 
@@ -282,7 +282,7 @@ private:
 
     QSharedPointer<FIFFLIB::FiffInfo>                               m_pFiffInfo;                /**< Fiff measurement info.*/
 
-    IOBUFFER::CircularMatrixBuffer<double>::SPtr                    m_pNoiseReductionBuffer;    /**< Holds incoming data.*/
+    IOBUFFER::LockFreeCircularMatrixBuffer<double>::SPtr            m_pNoiseReductionBuffer;    /**< Holds incoming data.*/
 
     QSharedPointer<RTPROCESSINGLIB::RtFilter>                       m_pRtFilter;                /**< Real time filter object. */
 
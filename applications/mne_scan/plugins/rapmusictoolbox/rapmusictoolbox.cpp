@@ -326,7 +326,6 @@ void RapMusicToolbox::run()
     m_bProcessData = true;
     m_qMutex.unlock();
 
-    qint32 skip_count = 0;
     while(true)
     {
         {
@@ -341,7 +340,7 @@ void RapMusicToolbox::run()
 
         if(t_evokedSize > 0)
         {
-            if(m_pPwlRapMusic && ((skip_count % 10) == 0))
+            if(m_pPwlRapMusic)
             {
                 m_qMutex.lock();
                 FiffEvoked t_fiffEvoked = m_qVecFiffEvoked[0].evoked.first();
@@ -360,7 +359,6 @@ void RapMusicToolbox::run()
                 m_qVecFiffEvoked.pop_front();
                 m_qMutex.unlock();
             }
-            ++skip_count;
         }
     }
 }
@@ -102,7 +102,16 @@ QList<Network> Connectivity::calculate(ConnectivitySettings& connectivitySetting
     QList<Network> results;
     QElapsedTimer timer;
 
-    int iNTrials = connectivitySettings.getTrialData().size();
+    int iNTrials = connectivitySettings.size();
+
+    // Compute the spectral quantities needed by the requested metrics in one pass over all trials
+    int iSpectralContent = connectivitySettings.getSpectralContent();
+
+    if(iSpectralContent != 0) {
+        timer.restart();
+        connectivitySettings.computeSpectralCache(iSpectralContent);
+        qDebug() << "Connectivity::calculateMultiMethods - Calculated spectral cache for" << iNTrials << "trials in" << timer.elapsed() << "msecs.";
+    }
 
     if(lMethods.contains("WPLI")) {
         timer.restart();
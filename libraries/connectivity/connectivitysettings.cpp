@@ -44,6 +44,7 @@
 #include <mne/mne_forwardsolution.h>
 #include <fs/surfaceset.h>
 #include <fiff/fiff_info.h>
+#include <utils/spectral.h>
 
 
 //*************************************************************************************************************
@@ -54,6 +55,8 @@
 #include <QCommandLineParser>
 #include <QElapsedTimer>
 #include <QDebug>
+#include <QThreadStorage>
+#include <QtConcurrent>
 
 
 //*************************************************************************************************************
@@ -61,6 +64,8 @@
 // Eigen INCLUDES
 //=============================================================================================================
 
+#include <unsupported/Eigen/FFT>
+
 
 //*************************************************************************************************************
 //=============================================================================================================
@@ -71,6 +76,7 @@ using namespace CONNECTIVITYLIB;
 using namespace MNELIB;
 using namespace Eigen;
 using namespace FIFFLIB;
+using namespace UTILSLIB;
 
 
 //*************************************************************************************************************
@@ -78,6 +84,60 @@ using namespace FIFFLIB;
 // DEFINE GLOBAL METHODS
 //=============================================================================================================
 
+namespace {
+
+QThreadStorage<FFT<double>*> threadFFT;     /**< One FFT object per worker thread, so its plans are reused across trials. */
+
+FFT<double>& localFFT()
+{
+    if(!threadFFT.hasLocalData()) {
+        FFT<double>* pFFT = new FFT<double>;
+        pFFT->SetFlag(pFFT->HalfSpectrum);
+        threadFFT.setLocalData(pFFT);
+    }
+
+    return *threadFFT.localData();
+}
+
+qint64 spectraBytes(const ConnectivitySettings::IntermediateTrialData& trialData)
+{
+    qint64 iBytes = 0;
+
+    for(int i = 0; i < trialData.vecTapSpectra.size(); ++i) {
+        iBytes += trialData.vecTapSpectra.at(i).size() * sizeof(std::complex<double>);
+    }
+
+    return iBytes;
+}
+
+template<typename T, typename Func>
+void deriveFromCsd(const QVector<QPair<int,MatrixXcd> >& vecPairCsd,
+                   QVector<QPair<int,T> >& vecPairDerived,
+                   QVector<QPair<int,T> >& vecPairDerivedSum,
+                   QMutex& mutex,
+                   Func derive)
+{
+    vecPairDerived.clear();
+
+    for (int i = 0; i < vecPairCsd.size(); ++i) {
+        vecPairDerived.append(QPair<int,T>(i,derive(vecPairCsd.at(i).second)));
+    }
+
+    mutex.lock();
+
+    if(vecPairDerivedSum.isEmpty()) {
+        vecPairDerivedSum = vecPairDerived;
+    } else {
+        for (int j = 0; j < vecPairDerivedSum.size(); ++j) {
+            vecPairDerivedSum[j].second += vecPairDerived.at(j).second;
+        }
+    }
+
+    mutex.unlock();
+}
+
+} // anonymous namespace
+
 
 //*************************************************************************************************************
 //=============================================================================================================
@@ -88,6 +148,12 @@ ConnectivitySettings::ConnectivitySettings()
 : m_fFreqResolution(1.0f)
 , m_fSFreq(1000.0f)
 , m_sWindowType("hanning")
+, m_frequencyBand(QPair<float,float>(0.0f,-1.0f))
+, m_iSpectraMemoryBudget(-1)
+, m_bStreamingMode(false)
+, m_iNumberReducedTrials(0)
+, m_iNumberNodes(0)
+, m_iNumberSamples(0)
 {
     m_iNfft = int(m_fSFreq/m_fFreqResolution);
     qRegisterMetaType<CONNECTIVITYLIB::ConnectivitySettings>("CONNECTIVITYLIB::ConnectivitySettings");
@@ -122,6 +188,9 @@ void ConnectivitySettings::clearIntermediateData() {
     m_intermediateSumData.vecPairCsdImagSignSum.clear();
     m_intermediateSumData.vecPairCsdImagAbsSum.clear();
     m_intermediateSumData.vecPairCsdImagSqrdSum.clear();
+
+    // Reduced trials only live in the sum data
+    m_iNumberReducedTrials = 0;
 }
 
 
@@ -130,7 +199,15 @@ void ConnectivitySettings::clearIntermediateData() {
 void ConnectivitySettings::append(const QList<MatrixXd>& matInputData)
 {
     for(int i = 0; i < matInputData.size(); ++i) {
-        this->append(matInputData.at(i));
+        ConnectivitySettings::IntermediateTrialData tempData;
+        tempData.matData = matInputData.at(i);
+
+        m_trialData.append(tempData);
+    }
+
+    // Reduce the whole batch at once, so the trials are processed in parallel
+    if(m_bStreamingMode) {
+        reduceTrials();
     }
 }
 
@@ -143,6 +220,10 @@ void ConnectivitySettings::append(const MatrixXd& matInputData)
     tempData.matData = matInputData;
 
     m_trialData.append(tempData);
+
+    if(m_bStreamingMode) {
+        reduceTrials();
+    }
 }
 
 
@@ -150,6 +231,12 @@ void ConnectivitySettings::append(const MatrixXd& matInputData)
 
 void ConnectivitySettings::append(const ConnectivitySettings::IntermediateTrialData& inputData)
 {
+    // Intermediate data of the trial was not summed up by this object, only its data is reduced in streaming mode
+    if(m_bStreamingMode) {
+        append(inputData.matData);
+        return;
+    }
+
     m_trialData.append(inputData);
 }
 
@@ -166,7 +253,7 @@ const ConnectivitySettings::IntermediateTrialData& ConnectivitySettings::at(int
 
 int ConnectivitySettings::size() const
 {
-    return m_trialData.size();
+    return m_trialData.size() + m_iNumberReducedTrials;
 }
 
 
@@ -174,7 +261,49 @@ int ConnectivitySettings::size() const
 
 bool ConnectivitySettings::isEmpty() const
 {
-    return m_trialData.isEmpty();
+    return m_trialData.isEmpty() && m_iNumberReducedTrials == 0;
+}
+
+
+//*******************************************************************************************************
+
+void ConnectivitySettings::setStreamingMode(bool bStreamingMode)
+{
+    clearAllData();
+
+    m_bStreamingMode = bStreamingMode;
+}
+
+
+//*******************************************************************************************************
+
+bool ConnectivitySettings::isStreamingMode() const
+{
+    return m_bStreamingMode;
+}
+
+
+//*******************************************************************************************************
+
+int ConnectivitySettings::getNumberNodes() const
+{
+    if(!m_trialData.isEmpty()) {
+        return m_trialData.first().matData.rows();
+    }
+
+    return m_iNumberReducedTrials > 0 ? m_iNumberNodes : 0;
+}
+
+
+//*******************************************************************************************************
+
+int ConnectivitySettings::getNumberSamples() const
+{
+    if(!m_trialData.isEmpty()) {
+        return m_trialData.first().matData.cols();
+    }
+
+    return m_iNumberReducedTrials > 0 ? m_iNumberSamples : 0;
 }
 
 
@@ -186,6 +315,11 @@ void ConnectivitySettings::removeFirst(int iAmount)
 //    qint64 iTime = 0;
 //    timer.start();
 
+    if(m_bStreamingMode) {
+        qDebug() << "ConnectivitySettings::removeFirst - Reduced trials can not be removed in streaming mode. Returning.";
+        return;
+    }
+
     if(m_trialData.isEmpty()) {
         qDebug() << "ConnectivitySettings::removeFirst - No elements to delete. Returning.";
         return;
@@ -238,6 +372,11 @@ void ConnectivitySettings::removeLast(int iAmount)
 //    qint64 iTime = 0;
 //    timer.start();
 
+    if(m_bStreamingMode) {
+        qDebug() << "ConnectivitySettings::removeLast - Reduced trials can not be removed in streaming mode. Returning.";
+        return;
+    }
+
     if(m_trialData.isEmpty()) {
         qDebug() << "ConnectivitySettings::removeLast - No elements to delete. Returning.";
         return;
@@ -287,6 +426,11 @@ void ConnectivitySettings::removeLast(int iAmount)
 
 void ConnectivitySettings::setConnectivityMethods(const QStringList& sConnectivityMethods)
 {
+    // The reduced trials only hold the sums needed by the previous methods
+    if(m_bStreamingMode && m_sConnectivityMethods != sConnectivityMethods) {
+        clearIntermediateData();
+    }
+
     m_sConnectivityMethods = sConnectivityMethods;
 }
 
@@ -355,6 +499,7 @@ void ConnectivitySettings::setWindowType(const QString& sWindowType)
     clearIntermediateData();
 
     m_sWindowType = sWindowType;
+    m_tapers = QPair<MatrixXd, VectorXd>();
 }
 
 
@@ -366,6 +511,61 @@ const QString& ConnectivitySettings::getWindowType() const
 }
 
 
+//*******************************************************************************************************
+
+void ConnectivitySettings::setFrequencyBand(float fLowerFreq, float fUpperFreq)
+{
+    if(fUpperFreq >= 0.0f && fUpperFreq < fLowerFreq) {
+        qDebug() << "ConnectivitySettings::setFrequencyBand - Upper frequency is smaller than lower frequency. Returning.";
+        return;
+    }
+
+    // Clear all intermediate data since the CSD and PSD only hold the frequency bins of the band
+    clearIntermediateData();
+
+    m_frequencyBand = QPair<float,float>(fLowerFreq, fUpperFreq);
+}
+
+
+//*******************************************************************************************************
+
+const QPair<float,float>& ConnectivitySettings::getFrequencyBand() const
+{
+    return m_frequencyBand;
+}
+
+
+//*******************************************************************************************************
+
+QPair<int,int> ConnectivitySettings::getFrequencyBins() const
+{
+    // Check that iNfft >= signal length, the trials might already be reduced in streaming mode
+    int iNfft = m_iNfft;
+    int iNumberSamples = getNumberSamples();
+    if(iNumberSamples > 0 && iNfft > iNumberSamples) {
+        iNfft = iNumberSamples;
+    }
+
+    int iNFreqs = int(floor(iNfft / 2.0)) + 1;
+    int iLowerBin = 0;
+    int iUpperBin = iNFreqs - 1;
+
+    if(m_fSFreq > 0.0f) {
+        double dScaleFactor = iNfft / m_fSFreq;
+
+        if(m_frequencyBand.first > 0.0f) {
+            iLowerBin = qBound(0, int(floor(m_frequencyBand.first * dScaleFactor)), iNFreqs - 1);
+        }
+
+        if(m_frequencyBand.second >= 0.0f) {
+            iUpperBin = qBound(iLowerBin, int(ceil(m_frequencyBand.second * dScaleFactor)), iNFreqs - 1);
+        }
+    }
+
+    return QPair<int,int>(iLowerBin, iUpperBin);
+}
+
+
 //*******************************************************************************************************
 
 void ConnectivitySettings::setNodePositions(const FiffInfo& fiffInfo,
@@ -444,9 +644,341 @@ QList<ConnectivitySettings::IntermediateTrialData>& ConnectivitySettings::getTri
 }
 
 
+//*******************************************************************************************************
+
+const QList<ConnectivitySettings::IntermediateTrialData>& ConnectivitySettings::getTrialData() const
+{
+    return m_trialData;
+}
+
+
 //*******************************************************************************************************
 
 ConnectivitySettings::IntermediateSumData& ConnectivitySettings::getIntermediateSumData()
 {
     return m_intermediateSumData;
 }
+
+
+//*******************************************************************************************************
+
+void ConnectivitySettings::computeSpectralCache(int iContent)
+{
+    // Nothing to do if there are no trials or all trials were already reduced in streaming mode
+    if(m_trialData.isEmpty()) {
+        return;
+    }
+
+    #ifdef EIGEN_FFTW_DEFAULT
+        fftw_make_planner_thread_safe();
+    #endif
+
+    // Check that iNfft >= signal length
+    int iSignalLength = m_trialData.first().matData.cols();
+    int iNfft = m_iNfft;
+    if(iNfft > iSignalLength) {
+        iNfft = iSignalLength;
+    }
+
+    // Generate tapers once for all trials and metrics
+    if(m_tapers.first.cols() != iSignalLength) {
+        m_tapers = Spectral::generateTapers(iSignalLength, m_sWindowType);
+    }
+
+    // The PSD is read from the CSD diagonal, all other quantities are derived from the CSD
+    if(iContent & ~TaperedSpectra) {
+        iContent |= CrossSpectralDensity;
+    }
+
+    QPair<int,int> freqBins = getFrequencyBins();
+
+    QMutex mutex;
+
+    // Spectra which were not requested themselves are only needed for the CSD of their own trial. Enforce the
+    // memory budget while the trials are processed, so the peak memory stays bounded during the pass.
+    bool bApplyBudget = m_iSpectraMemoryBudget >= 0 && !(iContent & TaperedSpectra);
+    qint64 iSpectraBytes = 0;
+
+    if(bApplyBudget) {
+        for(int i = 0; i < m_trialData.size(); ++i) {
+            iSpectraBytes += spectraBytes(m_trialData.at(i));
+        }
+    }
+
+    std::function<void(IntermediateTrialData&)> computeLambda = [&](IntermediateTrialData& inputData) {
+        qint64 iBytesBefore = bApplyBudget ? spectraBytes(inputData) : 0;
+
+        computeTrialSpectra(inputData,
+                            m_intermediateSumData,
+                            mutex,
+                            iContent,
+                            iNfft,
+                            freqBins,
+                            m_tapers);
+
+        if(bApplyBudget) {
+            qint64 iBytesAfter = spectraBytes(inputData);
+
+            QMutexLocker locker(&mutex);
+            iSpectraBytes += iBytesAfter - iBytesBefore;
+
+            // The CSD of this trial was already added to the sum data, its spectra can be freed right away
+            if(iSpectraBytes > m_iSpectraMemoryBudget) {
+                iSpectraBytes -= iBytesAfter;
+                inputData.vecTapSpectra.clear();
+            }
+        }
+    };
+
+    QFuture<void> result = QtConcurrent::map(m_trialData,
+                                             computeLambda);
+    result.waitForFinished();
+}
+
+
+//*******************************************************************************************************
+
+int ConnectivitySettings::getSpectralContent() const
+{
+    int iContent = 0;
+
+    if(m_sConnectivityMethods.contains("XCOR")) {
+        iContent |= TaperedSpectra;
+    }
+
+    if(m_sConnectivityMethods.contains("COH") || m_sConnectivityMethods.contains("IMAGCOH")) {
+        iContent |= PowerSpectralDensity;
+    }
+
+    if(m_sConnectivityMethods.contains("PLV")) {
+        iContent |= NormalizedCsd;
+    }
+
+    if(m_sConnectivityMethods.contains("PLI") || m_sConnectivityMethods.contains("USPLI")) {
+        iContent |= ImagSignCsd;
+    }
+
+    if(m_sConnectivityMethods.contains("WPLI") || m_sConnectivityMethods.contains("DSWPLI")) {
+        iContent |= ImagAbsCsd;
+    }
+
+    if(m_sConnectivityMethods.contains("DSWPLI")) {
+        iContent |= ImagSqrdCsd;
+    }
+
+    return iContent;
+}
+
+
+//*******************************************************************************************************
+
+void ConnectivitySettings::reduceTrials()
+{
+    if(m_trialData.isEmpty()) {
+        return;
+    }
+
+    if(m_iNumberReducedTrials > 0 &&
+       (m_trialData.first().matData.rows() != m_iNumberNodes || m_trialData.first().matData.cols() != m_iNumberSamples)) {
+        qDebug() << "ConnectivitySettings::reduceTrials - Trial dimensions do not match the reduced trials. Dropping trials.";
+        m_trialData.clear();
+        return;
+    }
+
+    m_iNumberNodes = m_trialData.first().matData.rows();
+    m_iNumberSamples = m_trialData.first().matData.cols();
+
+    computeSpectralCache(getSpectralContent());
+
+    m_iNumberReducedTrials += m_trialData.size();
+    m_trialData.clear();
+}
+
+
+//*******************************************************************************************************
+
+void ConnectivitySettings::applySpectraMemoryBudget()
+{
+    if(m_iSpectraMemoryBudget < 0) {
+        return;
+    }
+
+    qint64 iBytes = 0;
+
+    for(int i = 0; i < m_trialData.size(); ++i) {
+        iBytes += spectraBytes(m_trialData.at(i));
+    }
+
+    // Evict the oldest trials first, the newest are the most likely to be needed again
+    for(int i = 0; i < m_trialData.size() && iBytes > m_iSpectraMemoryBudget; ++i) {
+        iBytes -= spectraBytes(m_trialData.at(i));
+        m_trialData[i].vecTapSpectra.clear();
+    }
+}
+
+
+//*******************************************************************************************************
+
+void ConnectivitySettings::setSpectraMemoryBudget(qint64 iBytes)
+{
+    m_iSpectraMemoryBudget = iBytes;
+}
+
+
+//*******************************************************************************************************
+
+qint64 ConnectivitySettings::getSpectraMemoryBudget() const
+{
+    return m_iSpectraMemoryBudget;
+}
+
+
+//*******************************************************************************************************
+
+void ConnectivitySettings::computeTrialSpectra(IntermediateTrialData& inputData,
+                                               IntermediateSumData& sumData,
+                                               QMutex& mutex,
+                                               int iContent,
+                                               int iNfft,
+                                               const QPair<int,int>& freqBins,
+                                               const QPair<MatrixXd, VectorXd>& tapers)
+{
+    int iNRows = inputData.matData.rows();
+    int iNFreqs = int(floor(iNfft / 2.0)) + 1;
+    int iNBins = freqBins.second - freqBins.first + 1;
+    int iNTapers = tapers.first.rows();
+
+    bool bComputeCsd = (iContent & CrossSpectralDensity) && inputData.vecPairCsd.size() != iNRows;
+    bool bComputePsd = (iContent & PowerSpectralDensity) && (inputData.matPsd.rows() != iNRows || inputData.matPsd.cols() != iNBins);
+    bool bComputeNormalized = (iContent & NormalizedCsd) && inputData.vecPairCsdNormalized.size() != iNRows;
+    bool bComputeImagSign = (iContent & ImagSignCsd) && inputData.vecPairCsdImagSign.size() != iNRows;
+    bool bComputeImagAbs = (iContent & ImagAbsCsd) && inputData.vecPairCsdImagAbs.size() != iNRows;
+    bool bComputeImagSqrd = (iContent & ImagSqrdCsd) && inputData.vecPairCsdImagSqrd.size() != iNRows;
+
+    if(!bComputeCsd && !bComputePsd && !bComputeNormalized && !bComputeImagSign && !bComputeImagAbs && !bComputeImagSqrd
+       && !(iContent & TaperedSpectra)) {
+        return;
+    }
+
+    int i,j;
+
+    // Calculate tapered spectra if not available already
+    // This code was copied and changed modified Utils/Spectra since we do not want to call the function due to time loss.
+    if((bComputeCsd || (iContent & TaperedSpectra)) && inputData.vecTapSpectra.size() != iNRows) {
+        inputData.vecTapSpectra.clear();
+
+        RowVectorXd vecInputFFT, rowData;
+        RowVectorXcd vecTmpFreq;
+
+        MatrixXcd matTapSpectrum(iNTapers, iNFreqs);
+
+        FFT<double>& fft = localFFT();
+
+        for (i = 0; i < iNRows; ++i) {
+            // Substract mean
+            rowData.array() = inputData.matData.row(i).array() - inputData.matData.row(i).mean();
+
+            // Calculate tapered spectra
+            for(j = 0; j < iNTapers; j++) {
+                vecInputFFT = rowData.cwiseProduct(tapers.first.row(j));
+                // FFT for freq domain returning the half spectrum and multiply taper weights
+                fft.fwd(vecTmpFreq, vecInputFFT, iNfft);
+                matTapSpectrum.row(j) = vecTmpFreq * tapers.second(j);
+            }
+
+            inputData.vecTapSpectra.append(matTapSpectrum);
+        }
+    }
+
+    // Compute CSD for the frequency band. For each frequency bin the tapered spectra of all rows form a
+    // iNRows x iNTapers matrix, whose Hermitian rank update yields the CSD of all pairs at once (average over
+    // tapers if necessary). Only the rows j >= i of pair i are stored.
+    if(bComputeCsd) {
+        inputData.vecPairCsd.clear();
+
+        for (i = 0; i < iNRows; ++i) {
+            inputData.vecPairCsd.append(QPair<int,MatrixXcd>(i,MatrixXcd(iNRows - i, iNBins)));
+        }
+
+        double denomCSD = sqrt(tapers.second.cwiseAbs2().sum()) * sqrt(tapers.second.cwiseAbs2().sum()) / 2.0;
+
+        MatrixXcd matSpectra(iNRows, iNTapers);
+        MatrixXcd matCsd(iNRows, iNRows);
+        double dScale;
+        int iBin;
+
+        for (int k = 0; k < iNBins; ++k) {
+            iBin = freqBins.first + k;
+
+            for (i = 0; i < iNRows; ++i) {
+                matSpectra.row(i) = inputData.vecTapSpectra.at(i).col(iBin).transpose();
+            }
+
+            // Divide first and last element by 2 due to half spectrum
+            dScale = 1.0 / denomCSD;
+            if(iBin == 0 || (iNfft % 2 == 0 && iBin == iNFreqs - 1)) {
+                dScale /= 2.0;
+            }
+
+            // The lower triangle holds conj(CSD(i,j)) at (j,i), so each pair reads a contiguous column
+            matCsd.setZero();
+            matCsd.selfadjointView<Lower>().rankUpdate(matSpectra, dScale);
+
+            for (i = 0; i < iNRows; ++i) {
+                inputData.vecPairCsd[i].second.col(k) = matCsd.col(i).tail(iNRows - i).conjugate();
+            }
+        }
+
+        mutex.lock();
+
+        if(sumData.vecPairCsdSum.isEmpty()) {
+            sumData.vecPairCsdSum = inputData.vecPairCsd;
+        } else {
+            for (j = 0; j < sumData.vecPairCsdSum.size(); ++j) {
+                sumData.vecPairCsdSum[j].second += inputData.vecPairCsd.at(j).second;
+            }
+        }
+
+        mutex.unlock();
+    }
+
+    // Compute PSD. The PSD equals the real valued CSD diagonal, so the tapered spectra are not needed here.
+    if(bComputePsd) {
+        inputData.matPsd = MatrixXd(iNRows, iNBins);
+
+        for (i = 0; i < iNRows; ++i) {
+            inputData.matPsd.row(i) = inputData.vecPairCsd.at(i).second.row(0).real();
+        }
+
+        mutex.lock();
+
+        if(sumData.matPsdSum.rows() == 0 || sumData.matPsdSum.cols() == 0) {
+            sumData.matPsdSum = inputData.matPsd;
+        } else {
+            sumData.matPsdSum += inputData.matPsd;
+        }
+
+        mutex.unlock();
+    }
+
+    // Compute the metric specific quantities derived from the CSD
+    if(bComputeNormalized) {
+        deriveFromCsd(inputData.vecPairCsd, inputData.vecPairCsdNormalized, sumData.vecPairCsdNormalizedSum, mutex,
+                      [](const MatrixXcd& matCsd) -> MatrixXcd { return matCsd.cwiseQuotient(matCsd.cwiseAbs()); });
+    }
+
+    if(bComputeImagSign) {
+        deriveFromCsd(inputData.vecPairCsd, inputData.vecPairCsdImagSign, sumData.vecPairCsdImagSignSum, mutex,
+                      [](const MatrixXcd& matCsd) -> MatrixXd { return matCsd.imag().cwiseSign(); });
+    }
+
+    if(bComputeImagAbs) {
+        deriveFromCsd(inputData.vecPairCsd, inputData.vecPairCsdImagAbs, sumData.vecPairCsdImagAbsSum, mutex,
+                      [](const MatrixXcd& matCsd) -> MatrixXd { return matCsd.imag().cwiseAbs(); });
+    }
+
+    if(bComputeImagSqrd) {
+        deriveFromCsd(inputData.vecPairCsd, inputData.vecPairCsdImagSqrd, sumData.vecPairCsdImagSqrdSum, mutex,
+                      [](const MatrixXcd& matCsd) -> MatrixXd { return matCsd.imag().array().square(); });
+    }
+}
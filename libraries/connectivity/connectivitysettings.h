@@ -53,6 +53,8 @@
 #include <QSharedPointer>
 #include <QStringList>
 #include <QVector>
+#include <QPair>
+#include <QMutex>
 
 
 //*************************************************************************************************************
@@ -108,6 +110,10 @@ public:
     typedef QSharedPointer<ConnectivitySettings> SPtr;            /**< Shared pointer type for ConnectivitySettings. */
     typedef QSharedPointer<const ConnectivitySettings> ConstSPtr; /**< Const shared pointer type for ConnectivitySettings. */
 
+    /**
+    * The intermediate data of a single trial. The CSD based members are stored packed: the matrix of pair i holds
+    * the rows j >= i (row j-i) and the frequency bins of the frequency band only.
+    */
     struct IntermediateTrialData {
         Eigen::MatrixXd     matData;
         Eigen::MatrixXd     matPsd;
@@ -128,6 +134,19 @@ public:
         QVector<QPair<int,Eigen::MatrixXd> >    vecPairCsdImagSqrdSum;
     };
 
+    /**
+    * The spectral quantities which can be requested from the spectral cache. Values can be combined bitwise.
+    */
+    enum SpectralContent {
+        TaperedSpectra          = 0x1,      /**< The tapered spectra of each trial. */
+        CrossSpectralDensity    = 0x2,      /**< The CSD of each trial, summed up in the intermediate sum data. */
+        PowerSpectralDensity    = 0x4,      /**< The PSD of each trial, summed up in the intermediate sum data. Implies the CSD. */
+        NormalizedCsd           = 0x8,      /**< The CSD normalized by its magnitude. Implies the CSD. */
+        ImagSignCsd             = 0x10,     /**< The sign of the imaginary CSD part. Implies the CSD. */
+        ImagAbsCsd              = 0x20,     /**< The magnitude of the imaginary CSD part. Implies the CSD. */
+        ImagSqrdCsd             = 0x40      /**< The squared imaginary CSD part. Implies the CSD. */
+    };
+
     //=========================================================================================================
     /**
     * Constructs a ConnectivitySettings object.
@@ -146,10 +165,46 @@ public:
 
     const IntermediateTrialData& at(int i) const;
 
+    //=========================================================================================================
+    /**
+    * Returns the number of trials. In streaming mode this includes the trials which were already reduced.
+    *
+    * @return The number of trials.
+    */
     int size() const;
 
     bool isEmpty() const;
 
+    //=========================================================================================================
+    /**
+    * Enables or disables the streaming mode. In streaming mode every appended trial is immediately reduced into
+    * the intermediate sum data of the set connectivity methods, and its data and intermediate data is freed. The
+    * peak memory then does not depend on the number of trials. The connectivity methods and spectral parameters
+    * must be set before appending trials; changing them discards the reduced trials. Trials cannot be removed
+    * again and the correlation based methods (COR, XCOR) are not supported. All data is cleared.
+    *
+    * @param[in] bStreamingMode     Whether to reduce trials as they are appended.
+    */
+    void setStreamingMode(bool bStreamingMode);
+
+    bool isStreamingMode() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the number of nodes (data rows) of the trials.
+    *
+    * @return The number of nodes.
+    */
+    int getNumberNodes() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the number of samples (data columns) of the trials.
+    *
+    * @return The number of samples.
+    */
+    int getNumberSamples() const;
+
     void removeFirst(int iAmount = 1);
 
     void removeLast(int iAmount = 1);
@@ -170,6 +225,25 @@ public:
 
     const QString& getWindowType() const;
 
+    //=========================================================================================================
+    /**
+    * Restricts the CSD and PSD computation to a frequency band. All intermediate data is cleared.
+    *
+    * @param[in] fLowerFreq     The lower band edge in Hz.
+    * @param[in] fUpperFreq     The upper band edge in Hz. A negative value means up to the Nyquist frequency.
+    */
+    void setFrequencyBand(float fLowerFreq, float fUpperFreq);
+
+    const QPair<float,float>& getFrequencyBand() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the first and last (inclusive) frequency bin of the frequency band for the current FFT length.
+    *
+    * @return The first and last frequency bin.
+    */
+    QPair<int,int> getFrequencyBins() const;
+
     void setNodePositions(const FIFFLIB::FiffInfo& fiffInfo,
                           const Eigen::RowVectorXi& picks);
 
@@ -182,21 +256,95 @@ public:
 
     QList<IntermediateTrialData>& getTrialData();
 
+    const QList<IntermediateTrialData>& getTrialData() const;
+
     IntermediateSumData& getIntermediateSumData();
 
+    //=========================================================================================================
+    /**
+    * Computes the requested spectral quantities for all trials which do not hold them yet. The tapered spectra
+    * of a trial are computed once and shared by all metrics. Newly computed CSD and PSD matrices are added to
+    * the intermediate sum data. If the tapered spectra are not requested themselves, the spectra memory budget
+    * is applied while the trials are processed and spectra are freed as soon as their CSD was computed.
+    *
+    * @param[in] iContent   The requested content, a bitwise combination of SpectralContent values.
+    */
+    void computeSpectralCache(int iContent);
+
+    //=========================================================================================================
+    /**
+    * Returns the spectral content needed by the set connectivity methods.
+    *
+    * @return The needed content, a bitwise combination of SpectralContent values.
+    */
+    int getSpectralContent() const;
+
+    //=========================================================================================================
+    /**
+    * Frees the tapered spectra of the oldest trials until the memory held by all tapered spectra fits into
+    * the spectra memory budget. Evicted spectra are recomputed on demand. Gets called by the cross correlation
+    * once it consumed the spectra.
+    */
+    void applySpectraMemoryBudget();
+
+    //=========================================================================================================
+    /**
+    * Sets the memory budget for the cached tapered spectra.
+    *
+    * @param[in] iBytes     The budget in bytes. A negative value keeps all spectra.
+    */
+    void setSpectraMemoryBudget(qint64 iBytes);
+
+    qint64 getSpectraMemoryBudget() const;
+
 protected:
+    //=========================================================================================================
+    /**
+    * Reduces all held trials into the intermediate sum data and frees them. Used in streaming mode.
+    */
+    void reduceTrials();
+
+    //=========================================================================================================
+    /**
+    * Computes the requested spectral quantities for a single trial. This function gets called in parallel.
+    *
+    * @param[in] inputData          The trial data.
+    * @param[out]sumData            The intermediate sum data the new CSD and PSD matrices are added to.
+    * @param[in] mutex              The mutex used to safely access sumData.
+    * @param[in] iContent           The requested content, a bitwise combination of SpectralContent values.
+    * @param[in] iNfft              The FFT length.
+    * @param[in] freqBins           The first and last frequency bin of the frequency band.
+    * @param[in] tapers             The taper information.
+    */
+    static void computeTrialSpectra(IntermediateTrialData& inputData,
+                                    IntermediateSumData& sumData,
+                                    QMutex& mutex,
+                                    int iContent,
+                                    int iNfft,
+                                    const QPair<int,int>& freqBins,
+                                    const QPair<Eigen::MatrixXd, Eigen::VectorXd>& tapers);
+
     QStringList                     m_sConnectivityMethods;         /**< The connectivity methods. */
     QString                         m_sWindowType;                  /**< The window type used to compute tapered spectra. */
 
     float                           m_fSFreq;                       /**< The sampling frequency. */
     int                             m_iNfft;                        /**< The FFT length. Gets automatically calculated if the sFreq or spectrum resolution change. */
     float                           m_fFreqResolution;              /**< The spectrum's resolution. */
+    QPair<float,float>              m_frequencyBand;                /**< The lower and upper frequency edge the CSD and PSD are computed for. */
 
     Eigen::MatrixX3f                m_matNodePositions;             /**< The node position in 3D space. */
 
     IntermediateSumData             m_intermediateSumData;          /**< The intermediate sum data holds data calculated over all trials as a whole. */
     QList<IntermediateTrialData>    m_trialData;                    /**< The trial data holds the actual and intermediate data calcualted for each trial. */
 
+    QPair<Eigen::MatrixXd, Eigen::VectorXd> m_tapers;               /**< The tapers shared by all trials. Regenerated if the signal length or window type changes. */
+    qint64                          m_iSpectraMemoryBudget;         /**< The memory budget in bytes for the cached tapered spectra. Negative values disable eviction. */
+
+    bool                            m_bStreamingMode;               /**< Whether trials are reduced and freed as soon as they are appended. */
+    int                             m_iNumberReducedTrials;         /**< The number of trials which were reduced and freed in streaming mode. */
+    int                             m_iNumberNodes;                 /**< The number of nodes of the reduced trials. */
+    int                             m_iNumberSamples;               /**< The number of samples of the reduced trials. */
+
 };
 
 
@@ -107,14 +107,15 @@ Network Coherence::calculate(ConnectivitySettings& connectivitySettings)
     }
 
     finalNetwork.setSamplingFrequency(connectivitySettings.getSamplingFrequency());
-    finalNetwork.setNumberSamples(connectivitySettings.getTrialData().first().matData.cols());
+    finalNetwork.setNumberSamples(connectivitySettings.getNumberSamples());
+    finalNetwork.setFrequencyBinOffset(connectivitySettings.getFrequencyBins().first);
 
 //    iTime = timer.elapsed();
 //    qDebug() << "Coherence::coherence timer - Empty network creation:" << iTime;
 //    timer.restart();
 
     //Create nodes
-    int rows = connectivitySettings.at(0).matData.rows();
+    int rows = connectivitySettings.getNumberNodes();
     RowVectorXf rowVert = RowVectorXf::Zero(3);
 
     for(int i = 0; i < rows; ++i) {
@@ -48,8 +48,6 @@
 #include "network/networkedge.h"
 #include "network/network.h"
 
-#include <utils/spectral.h>
-
 
 //*************************************************************************************************************
 //=============================================================================================================
@@ -65,8 +63,6 @@
 // Eigen INCLUDES
 //=============================================================================================================
 
-#include <unsupported/Eigen/FFT>
-
 
 //*************************************************************************************************************
 //=============================================================================================================
@@ -75,7 +71,6 @@
 
 using namespace CONNECTIVITYLIB;
 using namespace Eigen;
-using namespace UTILSLIB;
 
 
 //*************************************************************************************************************
@@ -108,46 +103,11 @@ void Coherency::calculateReal(Network& finalNetwork,
         return;
     }
 
-    #ifdef EIGEN_FFTW_DEFAULT
-        fftw_make_planner_thread_safe();
-    #endif
-
-    // Check that iNfft >= signal length
-    int iSignalLength = connectivitySettings.at(0).matData.cols();
-    int iNfft = connectivitySettings.getNumberFFT();
-    if(iNfft > iSignalLength) {
-        iNfft = iSignalLength;
-    }
-
-    // Generate tapers
-    QPair<MatrixXd, VectorXd> tapers = Spectral::generateTapers(iSignalLength, connectivitySettings.getWindowType());
+    // Compute the PSD/CSD for each trial once, they are shared by all metrics
+    connectivitySettings.computeSpectralCache(ConnectivitySettings::PowerSpectralDensity);
 
-    // Initialize vecPsdAvg and vecCsdAvg
-    int iNRows = connectivitySettings.at(0).matData.rows();
-    int iNFreqs = int(floor(iNfft / 2.0)) + 1;
-
-    // Compute PSD/CSD for each trial
     QMutex mutex;
 
-    std::function<void(ConnectivitySettings::IntermediateTrialData&)> computeLambda = [&](ConnectivitySettings::IntermediateTrialData& inputData) {
-        compute(inputData,
-                connectivitySettings.getIntermediateSumData().matPsdSum,
-                connectivitySettings.getIntermediateSumData().vecPairCsdSum,
-                mutex,
-                iNRows,
-                iNFreqs,
-                iNfft,
-                tapers);
-    };
-
-//    iTime = timer.elapsed();
-//    qDebug() << "Coherency::computeCoherencyReal timer - Preparation:" << iTime;
-//    timer.restart();
-
-    QFuture<void> result = QtConcurrent::map(connectivitySettings.getTrialData(),
-                                             computeLambda);
-    result.waitForFinished();
-
 //    iTime = timer.elapsed();
 //    qDebug() << "Coherency::computeCoherencyReal timer - PSD/CSD computation:" << iTime;
 //    timer.restart();
@@ -184,46 +144,11 @@ void Coherency::calculateImag(Network& finalNetwork,
         return;
     }
 
-    #ifdef EIGEN_FFTW_DEFAULT
-        fftw_make_planner_thread_safe();
-    #endif
-
-    // Check that iNfft >= signal length
-    int iSignalLength = connectivitySettings.at(0).matData.cols();
-    int iNfft = connectivitySettings.getNumberFFT();
-    if(iNfft > iSignalLength) {
-        iNfft = iSignalLength;
-    }
+    // Compute the PSD/CSD for each trial once, they are shared by all metrics
+    connectivitySettings.computeSpectralCache(ConnectivitySettings::PowerSpectralDensity);
 
-    // Generate tapers
-    QPair<MatrixXd, VectorXd> tapers = Spectral::generateTapers(iSignalLength, connectivitySettings.getWindowType());
-
-    // Initialize vecPsdAvg and vecCsdAvg
-    int iNRows = connectivitySettings.at(0).matData.rows();
-    int iNFreqs = int(floor(iNfft / 2.0)) + 1;
-
-    // Compute PSD/CSD for each trial
     QMutex mutex;
 
-    std::function<void(ConnectivitySettings::IntermediateTrialData&)> computeLambda = [&](ConnectivitySettings::IntermediateTrialData& inputData) {
-        compute(inputData,
-                connectivitySettings.getIntermediateSumData().matPsdSum,
-                connectivitySettings.getIntermediateSumData().vecPairCsdSum,
-                mutex,
-                iNRows,
-                iNFreqs,
-                iNfft,
-                tapers);
-    };
-
-//        iTime = timer.elapsed();
-//        qDebug() << "Coherency::computeCoherencyImag timer - Preparation:" << iTime;
-//        timer.restart();
-
-    QFuture<void> result = QtConcurrent::map(connectivitySettings.getTrialData(),
-                                             computeLambda);
-    result.waitForFinished();
-
 //        iTime = timer.elapsed();
 //        qDebug() << "Coherency::computeCoherencyImag timer - PSD/CSD computation:" << iTime;
 //        timer.restart();
@@ -246,138 +171,6 @@ void Coherency::calculateImag(Network& finalNetwork,
 }
 
 
-//*************************************************************************************************************
-
-void Coherency::compute(ConnectivitySettings::IntermediateTrialData& inputData,
-                        MatrixXd& matPsdSum,
-                        QVector<QPair<int,MatrixXcd> >& vecPairCsdSum,
-                        QMutex& mutex,
-                        int iNRows,
-                        int iNFreqs,
-                        int iNfft,
-                        const QPair<MatrixXd, VectorXd>& tapers)
-{
-//    QElapsedTimer timer;
-//    qint64 iTime = 0;
-//    timer.start();
-
-    if(inputData.vecPairCsd.size() == iNRows &&
-       inputData.matPsd.rows() == iNRows &&
-       inputData.matPsd.cols() == iNFreqs) {
-        //qDebug() << "Coherency::compute - vecPairCsd and matPsd were already computed for this trial.";
-        return;
-    }
-
-    //qDebug() << "Coherency::compute - vecPairCsdSum and matPsdSum are computed for this trial.";
-
-    // Substract mean, compute tapered spectra and PSD
-    // This code was copied and changed modified Utils/Spectra since we do not want to call the function due to time loss.
-    bool bNfftEven = false;
-    if (iNfft % 2 == 0){
-        bNfftEven = true;
-    }
-
-    FFT<double> fft;
-    fft.SetFlag(fft.HalfSpectrum);
-
-    double denomPSD = tapers.second.cwiseAbs2().sum() / 2.0;
-
-    RowVectorXd vecInputFFT, rowData;
-    RowVectorXcd vecTmpFreq;
-
-    MatrixXcd matTapSpectrum(tapers.first.rows(), iNFreqs);
-
-    int i,j;
-
-    inputData.matPsd = MatrixXd(iNRows, iNFreqs);
-
-    for (i = 0; i < iNRows; ++i) {
-        // Substract mean
-        rowData.array() = inputData.matData.row(i).array() - inputData.matData.row(i).mean();
-
-        // Calculate tapered spectra if not available already
-        if(inputData.vecTapSpectra.size() != iNRows) {
-            for(j = 0; j < tapers.first.rows(); j++) {
-                vecInputFFT = rowData.cwiseProduct(tapers.first.row(j));
-                // FFT for freq domain returning the half spectrum and multiply taper weights
-                fft.fwd(vecTmpFreq, vecInputFFT, iNfft);
-                matTapSpectrum.row(j) = vecTmpFreq * tapers.second(j);
-            }
-
-            inputData.vecTapSpectra.append(matTapSpectrum);
-        }
-
-        // Compute PSD (average over tapers if necessary).
-        inputData.matPsd.row(i) = inputData.vecTapSpectra.at(i).cwiseAbs2().colwise().sum() / denomPSD;
-
-        // Divide first and last element by 2 due to half spectrum
-        inputData.matPsd.row(i)(0) /= 2.0;
-        if(bNfftEven) {
-            inputData.matPsd.row(i).tail(1) /= 2.0;
-        }
-    }
-
-    mutex.lock();
-
-    if(matPsdSum.rows() == 0 || matPsdSum.cols() == 0) {
-        matPsdSum = inputData.matPsd;
-    } else {
-        matPsdSum += inputData.matPsd;
-    }
-
-    mutex.unlock();
-
-//    iTime = timer.elapsed();
-//    qDebug() << QThread::currentThreadId() << "Coherency::compute timer - compute - Tapered spectra and PSD (summing):" << iTime;
-//    timer.restart();
-
-    // Compute CSD
-    MatrixXcd matCsd = MatrixXcd(iNRows, iNFreqs);
-
-    if(inputData.vecPairCsd.size() != iNRows) {
-        inputData.vecPairCsd.clear();
-
-        double denomCSD = sqrt(tapers.second.cwiseAbs2().sum()) * sqrt(tapers.second.cwiseAbs2().sum()) / 2.0;
-
-        bool bNfftEven = false;
-        if (iNfft % 2 == 0){
-            bNfftEven = true;
-        }
-
-        for (i = 0; i < iNRows; ++i) {
-            for (j = i; j < iNRows; ++j) {
-                // Compute CSD (average over tapers if necessary)
-                matCsd.row(j) = inputData.vecTapSpectra.at(i).cwiseProduct(inputData.vecTapSpectra.at(j).conjugate()).colwise().sum() / denomCSD;
-
-                // Divide first and last element by 2 due to half spectrum
-                matCsd.row(j)(0) /= 2.0;
-                if(bNfftEven) {
-                    matCsd.row(j).tail(1) /= 2.0;
-                }
-            }
-
-            inputData.vecPairCsd.append(QPair<int,MatrixXcd>(i,matCsd));
-        }
-
-        mutex.lock();
-
-        if(vecPairCsdSum.isEmpty()) {
-            vecPairCsdSum = inputData.vecPairCsd;
-        } else {
-            for (j = 0; j < vecPairCsdSum.size(); ++j) {
-                vecPairCsdSum[j].second += inputData.vecPairCsd.at(j).second;
-            }
-        }
-
-        mutex.unlock();
-    }
-
-//    iTime = timer.elapsed();
-//    qDebug() << QThread::currentThreadId() << "Coherency::compute timer - compute - CSD summing:" << iTime;
-//    timer.restart();
-}
-
-
 //*************************************************************************************************************
 
 void Coherency::computePSDCSDReal(QMutex& mutex,
@@ -385,11 +178,12 @@ void Coherency::computePSDCSDReal(QMutex& mutex,
                                   const QPair<int,MatrixXcd>& pairInput,
                                   const MatrixXd& matPsdSum)
 {
-    MatrixXd matPSDtmp(matPsdSum.rows(), matPsdSum.cols());
+    // The CSD of pair i holds the rows j >= i only
+    MatrixXd matPSDtmp(pairInput.second.rows(), matPsdSum.cols());
     RowVectorXd rowPsdSum = matPsdSum.row(pairInput.first);
 
     for(int j = 0; j < matPSDtmp.rows(); ++j) {
-        matPSDtmp.row(j) = rowPsdSum.cwiseProduct(matPsdSum.row(j));
+        matPSDtmp.row(j) = rowPsdSum.cwiseProduct(matPsdSum.row(pairInput.first + j));
     }
 
     // Average. Note that the number of trials cancel each other out.
@@ -400,8 +194,8 @@ void Coherency::computePSDCSDReal(QMutex& mutex,
     int j;
     int i = pairInput.first;
 
-    for(j = i; j < matCohy.rows(); ++j) {
-        matWeight = matCohy.row(j).cwiseAbs().transpose();
+    for(j = i; j < i + matCohy.rows(); ++j) {
+        matWeight = matCohy.row(j-i).cwiseAbs().transpose();
         pEdge = QSharedPointer<NetworkEdge>(new NetworkEdge(i, j, matWeight));
 
         mutex.lock();
@@ -420,11 +214,12 @@ void Coherency::computePSDCSDImag(QMutex& mutex,
                                   const QPair<int,MatrixXcd>& pairInput,
                                   const MatrixXd& matPsdSum)
 {
-    MatrixXd matPSDtmp(matPsdSum.rows(), matPsdSum.cols());
+    // The CSD of pair i holds the rows j >= i only
+    MatrixXd matPSDtmp(pairInput.second.rows(), matPsdSum.cols());
     RowVectorXd rowPsdSum = matPsdSum.row(pairInput.first);
 
     for(int j = 0; j < matPSDtmp.rows(); ++j) {
-        matPSDtmp.row(j) = rowPsdSum.cwiseProduct(matPsdSum.row(j));
+        matPSDtmp.row(j) = rowPsdSum.cwiseProduct(matPsdSum.row(pairInput.first + j));
     }
 
     MatrixXcd matCohy = pairInput.second.cwiseQuotient(matPSDtmp.cwiseSqrt());
@@ -434,8 +229,8 @@ void Coherency::computePSDCSDImag(QMutex& mutex,
     int j;
     int i = pairInput.first;
 
-    for(j = i; j < matCohy.rows(); ++j) {
-        matWeight = matCohy.row(j).imag().transpose();
+    for(j = i; j < i + matCohy.rows(); ++j) {
+        matWeight = matCohy.row(j-i).imag().transpose();
         pEdge = QSharedPointer<NetworkEdge>(new NetworkEdge(i, j, matWeight));
 
         mutex.lock();
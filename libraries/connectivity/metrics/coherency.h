@@ -131,28 +131,6 @@ public:
                               ConnectivitySettings &connectivitySettings);
 
 private:
-    //=========================================================================================================
-    /**
-    * Computes the coherency values. This function gets called in parallel.
-    *
-    * @param[in]    inputData           The input data.
-    * @param[out]   matPsdSum           The sum of all PSD matrices for each trial.
-    * @param[out]   vecPairCsdSum       The sum of all CSD matrices for each trial.
-    * @param[in]    mutex               The mutex used to safely access matPsdSum and vecPairCsdSum.
-    * @param[in]    iNRows              The number of rows.
-    * @param[in]    iNFreqs             The number of frequenciy bins.
-    * @param[in]    iNfft               The FFT length.
-    * @param[in]    tapers              The taper information.
-    */
-    static void compute(ConnectivitySettings::IntermediateTrialData& inputData,
-                        Eigen::MatrixXd& matPsdSum,
-                        QVector<QPair<int,Eigen::MatrixXcd> >& vecPairCsdSum,
-                        QMutex& mutex,
-                        int iNRows,
-                        int iNFreqs,
-                        int iNfft,
-                        const QPair<Eigen::MatrixXd, Eigen::VectorXd>& tapers);
-
     //=========================================================================================================
     /**
     * Computes the PSD and CSD. This function gets called in parallel.
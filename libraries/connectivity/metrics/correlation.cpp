@@ -94,7 +94,8 @@ Network Correlation::calculate(ConnectivitySettings& connectivitySettings)
 {
     Network finalNetwork("COR");
 
-    if(connectivitySettings.isEmpty()) {
+    // The trial data is needed here, which is not kept in streaming mode
+    if(connectivitySettings.getTrialData().isEmpty()) {
         qDebug() << "Correlation::calculate - Input data is empty";
         return finalNetwork;
     }   
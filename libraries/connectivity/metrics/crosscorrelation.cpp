@@ -100,7 +100,8 @@ Network CrossCorrelation::calculate(ConnectivitySettings& connectivitySettings)
 
     Network finalNetwork("XCOR");
 
-    if(connectivitySettings.isEmpty()) {
+    // The trial data is needed here, which is not kept in streaming mode
+    if(connectivitySettings.getTrialData().isEmpty()) {
         qDebug() << "CrossCorrelation::calculate - Input data is empty";
         return finalNetwork;
     }
@@ -133,6 +134,9 @@ Network CrossCorrelation::calculate(ConnectivitySettings& connectivitySettings)
 
     QPair<MatrixXd, VectorXd> tapers = Spectral::generateTapers(iSignalLength, connectivitySettings.getWindowType());
 
+    // Compute the tapered spectra of all trials once, they are shared by all metrics
+    connectivitySettings.computeSpectralCache(ConnectivitySettings::TaperedSpectra);
+
     // Compute the cross correlation in parallel
     QMutex mutex;
     MatrixXd matDist;
@@ -150,6 +154,9 @@ Network CrossCorrelation::calculate(ConnectivitySettings& connectivitySettings)
                                                 computeLambda);
     resultMat.waitForFinished();
 
+    // The cross correlation is the last consumer of the tapered spectra, free the ones exceeding the memory budget
+    connectivitySettings.applySpectraMemoryBudget();
+
     matDist /= connectivitySettings.size();
 
     //Add edges to network
@@ -185,8 +192,8 @@ void CrossCorrelation::compute(ConnectivitySettings::IntermediateTrialData& inpu
 //    qint64 iTime = 0;
 //    timer.start();
 
-    // Calculate tapered spectra if not available already
-    RowVectorXd vecInputFFT, rowData;
+    // The tapered spectra are provided by the spectral cache of the connectivity settings
+    RowVectorXd vecInputFFT;
     RowVectorXcd vecResultFreq;
 
     FFT<double> fft;
@@ -195,32 +202,6 @@ void CrossCorrelation::compute(ConnectivitySettings::IntermediateTrialData& inpu
     int i, j;
     int iNRows = inputData.matData.rows();
 
-    // Calculate tapered spectra if not available already
-    // This code was copied and changed modified Utils/Spectra since we do not want to call the function due to time loss.
-    if(inputData.vecTapSpectra.isEmpty()) {
-        int iNFreqs = int(floor(iNfft / 2.0)) + 1;
-        MatrixXcd matTapSpectrum(tapers.first.rows(), iNFreqs);
-
-        for (i = 0; i < iNRows; ++i) {
-            // Substract mean
-            rowData.array() = inputData.matData.row(i).array() - inputData.matData.row(i).mean();
-
-            // Calculate tapered spectra
-            for(j = 0; j < tapers.first.rows(); j++) {
-                vecInputFFT = rowData.cwiseProduct(tapers.first.row(j));
-                // FFT for freq domain returning the half spectrum and multiply taper weights
-                fft.fwd(vecResultFreq, vecInputFFT, iNfft);
-                matTapSpectrum.row(j) = vecResultFreq * tapers.second(j);
-            }
-
-            inputData.vecTapSpectra.append(matTapSpectrum);
-        }
-    }
-
-//    iTime = timer.elapsed();
-//    qDebug() << QThread::currentThreadId() << "CrossCorrelation::compute timer - Tapered spectra:" << iTime;
-//    timer.restart();
-
     // Perform multiplication and transform back to time domain to find max XCOR coefficient
     // Note that the result in time domain is mirrored around the center of the data (compared to Matlab)
     MatrixXd matDistTrial = MatrixXd::Zero(iNRows, iNRows);
@@ -103,10 +103,11 @@ Network ImagCoherence::calculate(ConnectivitySettings& connectivitySettings)
     }
 
     finalNetwork.setSamplingFrequency(connectivitySettings.getSamplingFrequency());
-    finalNetwork.setNumberSamples(connectivitySettings.getTrialData().first().matData.cols());
+    finalNetwork.setNumberSamples(connectivitySettings.getNumberSamples());
+    finalNetwork.setFrequencyBinOffset(connectivitySettings.getFrequencyBins().first);
 
     //Create nodes
-    int rows = connectivitySettings.at(0).matData.rows();
+    int rows = connectivitySettings.getNumberNodes();
     RowVectorXf rowVert = RowVectorXf::Zero(3);
 
     for(int i = 0; i < rows; ++i) {
@@ -121,28 +121,6 @@ public:
     static Network calculate(ConnectivitySettings &connectivitySettings);
 
 protected:
-    //=========================================================================================================
-    /**
-    * Computes the PLV values. This function gets called in parallel.
-    *
-    * @param[in] inputData                  The input data.
-    * @param[out]vecPairCsdSum              The sum of all CSD matrices for each trial.
-    * @param[out]vecPairCsdNormalizedSum    The sum of all normalized CSD matrices for each trial.
-    * @param[in] mutex                      The mutex used to safely access vecPairCsdSum.
-    * @param[in] iNRows                     The number of rows.
-    * @param[in] iNFreqs                    The number of frequenciy bins.
-    * @param[in] iNfft                      The FFT length.
-    * @param[in] tapers                     The taper information.
-    */
-    static void compute(ConnectivitySettings::IntermediateTrialData& inputData,
-                        QVector<QPair<int,Eigen::MatrixXcd> >& vecPairCsdSum,
-                        QVector<QPair<int,Eigen::MatrixXcd> >& vecPairCsdNormalizedSum,
-                        QMutex& mutex,
-                        int iNRows,
-                        int iNFreqs,
-                        int iNfft,
-                        const QPair<Eigen::MatrixXd, Eigen::VectorXd>& tapers);
-
     //=========================================================================================================
     /**
     * Reduces the PLV computation to a final result.
@@ -121,28 +121,6 @@ public:
     static Network calculate(ConnectivitySettings& connectivitySettings);
 
 protected:
-    //=========================================================================================================
-    /**
-    * Computes the PLI values. This function gets called in parallel.
-    *
-    * @param[in] inputData              The input data.
-    * @param[out]vecPairCsdSum          The sum of all CSD matrices for each trial.
-    * @param[out]vecPairCsdImagSignSum  The sum of all imag sign CSD matrices for each trial.
-    * @param[in] mutex                  The mutex used to safely access vecPairCsdSum.
-    * @param[in] iNRows                 The number of rows.
-    * @param[in] iNFreqs                The number of frequenciy bins.
-    * @param[in] iNfft                  The FFT length.
-    * @param[in] tapers                 The taper information.
-    */
-    static void compute(ConnectivitySettings::IntermediateTrialData& inputData,
-                        QVector<QPair<int,Eigen::MatrixXcd> >& vecPairCsdSum,
-                        QVector<QPair<int,Eigen::MatrixXd> >& vecPairCsdImagSignSum,
-                        QMutex& mutex,
-                        int iNRows,
-                        int iNFreqs,
-                        int iNfft,
-                        const QPair<Eigen::MatrixXd, Eigen::VectorXd>& tapers);
-
     //=========================================================================================================
     /**
     * Reduces the USPLI computation to a final result.
@@ -92,6 +92,7 @@ Network::Network(const QString& sConnectivityMethod,
 , m_dThreshold(dThreshold)
 , m_fSFreq(0.0f)
 , m_iNumberSamples(0)
+, m_iFrequencyBinOffset(0)
 {
     qRegisterMetaType<CONNECTIVITYLIB::Network>("CONNECTIVITYLIB::Network");
     qRegisterMetaType<CONNECTIVITYLIB::Network::SPtr>("CONNECTIVITYLIB::Network::SPtr");
@@ -405,8 +406,8 @@ void Network::setFrequencyRange(float fLowerFreq, float fUpperFreq)
     m_minMaxFrequency.first = fLowerFreq;
     m_minMaxFrequency.second = fUpperFreq;
 
-    int iLowerBin = fLowerFreq * dScaleFactor;
-    int iUpperBin = fUpperFreq * dScaleFactor;
+    int iLowerBin = qMax(0, int(fLowerFreq * dScaleFactor) - m_iFrequencyBinOffset);
+    int iUpperBin = qMax(0, int(fUpperFreq * dScaleFactor) - m_iFrequencyBinOffset);
 
     // Update the min max values
     m_minMaxFullWeights = QPair<double,double>(std::numeric_limits<double>::max(),0.0);
@@ -540,3 +541,19 @@ void Network::setNumberSamples(int iNumberSamples)
 {
     m_iNumberSamples = iNumberSamples;
 }
+
+
+//*************************************************************************************************************
+
+int Network::getFrequencyBinOffset() const
+{
+    return m_iFrequencyBinOffset;
+}
+
+
+//*************************************************************************************************************
+
+void Network::setFrequencyBinOffset(int iFrequencyBinOffset)
+{
+    m_iFrequencyBinOffset = iFrequencyBinOffset;
+}
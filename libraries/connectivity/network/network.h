@@ -381,6 +381,23 @@ public:
     */
     void setNumberSamples(int iNumberSamples);
 
+    //=========================================================================================================
+    /**
+    * Get the frequency bin the first row of the edge weights corresponds to.
+    *
+    * @return The frequency bin offset.
+    */
+    int getFrequencyBinOffset() const;
+
+    //=========================================================================================================
+    /**
+    * Set the frequency bin the first row of the edge weights corresponds to. This is non zero if the weights
+    * were only computed for a frequency band.
+    *
+    * @param[in] iFrequencyBinOffset        The new frequency bin offset.
+    */
+    void setFrequencyBinOffset(int iFrequencyBinOffset);
+
 protected:
     QList<QSharedPointer<NetworkEdge> >     m_lFullEdges;               /**< List with all edges of the network.*/
     QList<QSharedPointer<NetworkEdge> >     m_lThresholdedEdges;        /**< List with all the active (thresholded) edges of the network.*/
@@ -398,6 +415,7 @@ protected:
     double                                  m_dThreshold;               /**< The current value which was used to threshold the edge weigths.*/
     float                                   m_fSFreq;                   /**< The sampling frequency used to collect the data which this network is based on.*/
     int                                     m_iNumberSamples;           /**< The number of colelcted data samples, e.g., in time to generate this network  data with.*/
+    int                                     m_iFrequencyBinOffset;      /**< The frequency bin the first row of the edge weights corresponds to.*/
 
     VisualizationInfo                       m_visualizationInfo;        /**< The current visualization info used to plot the network later on.*/
 };
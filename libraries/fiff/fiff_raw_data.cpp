@@ -42,6 +42,22 @@
 #include "fiff_tag.h"
 #include "fiff_stream.h"
 #include "cstdlib"
+#include "cstring"
+#include <algorithm>
+#include <functional>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Qt INCLUDES
+//=============================================================================================================
+
+#include <QMap>
+#include <QtConcurrent>
+#include <QtEndian>
+#include <QThread>
+#include <QVector>
+
 
 //*************************************************************************************************************
 //=============================================================================================================
@@ -51,13 +67,91 @@
 using namespace FIFFLIB;
 
 
+//*************************************************************************************************************
+//=============================================================================================================
+// STATIC DEFINITIONS
+//=============================================================================================================
+
+//=============================================================================================================
+/**
+* Converts a big endian integer sample of a mapped raw buffer to double.
+*/
+template<typename T>
+struct BigEndianToDouble
+{
+    typedef double result_type;
+
+    inline double operator()(const T& value) const
+    {
+        return (double)qFromBigEndian<T>(value);
+    }
+};
+
+
+//=============================================================================================================
+/**
+* Converts a big endian float sample of a mapped raw buffer, reinterpreted as quint32, to double.
+*/
+struct BigEndianFloatToDouble
+{
+    typedef double result_type;
+
+    inline double operator()(const quint32& value) const
+    {
+        quint32 swapped = qFromBigEndian<quint32>(value);
+        float sample;
+        memcpy(&sample, &swapped, sizeof(float));
+        return (double)sample;
+    }
+};
+
+
+//=============================================================================================================
+/**
+* Decodes the picked samples of a mapped raw buffer and applies calibration, compensation and projection
+* straight into data. The raw samples are accessed through an Eigen::Map over the mapped pages.
+*/
+template<typename T, typename Converter>
+static void decodeMappedBuffer(const uchar* pBuffer,
+                               qint32 nchan,
+                               qint32 nsamp,
+                               const SparseMatrix<double>& cal,
+                               const SparseMatrix<double>& mult,
+                               const RowVectorXi& sel,
+                               fiff_int_t first_pick,
+                               fiff_int_t picksamp,
+                               MatrixXd& data,
+                               qint32 dest)
+{
+    Map<const Matrix<T, Dynamic, Dynamic> > matRaw(reinterpret_cast<const T*>(pBuffer), nchan, nsamp);
+
+    if (mult.cols() == 0)
+    {
+        if (sel.size() == 0)
+        {
+            data.middleCols(dest, picksamp).noalias() = cal * matRaw.middleCols(first_pick, picksamp).unaryExpr(Converter());
+        }
+        else
+        {
+            for(qint32 r = 0; r < sel.size(); ++r)
+                data.row(r).segment(dest, picksamp) = cal.coeff(r,r) * matRaw.row(sel[r]).segment(first_pick, picksamp).unaryExpr(Converter());
+        }
+    }
+    else
+    {
+        data.middleCols(dest, picksamp).noalias() = mult * matRaw.middleCols(first_pick, picksamp).unaryExpr(Converter());
+    }
+}
+
+
 //*************************************************************************************************************
 //=============================================================================================================
 // DEFINE MEMBER METHODS
 //=============================================================================================================
 
 FiffRawData::FiffRawData()
-: first_samp(-1)
+: m_pReadCache(new ReadCache())
+, first_samp(-1)
 , last_samp(-1)
 {
 
@@ -67,7 +161,8 @@ FiffRawData::FiffRawData()
 //*************************************************************************************************************
 
 FiffRawData::FiffRawData(QIODevice &p_IODevice)
-: first_samp(-1)
+: m_pReadCache(new ReadCache())
+, first_samp(-1)
 , last_samp(-1)
 {
     //setup FiffRawData object
@@ -83,7 +178,8 @@ FiffRawData::FiffRawData(QIODevice &p_IODevice)
 //*************************************************************************************************************
 
 FiffRawData::FiffRawData(const FiffRawData &p_FiffRawData)
-: file(p_FiffRawData.file)
+: m_pReadCache(new ReadCache())
+, file(p_FiffRawData.file)
 , info(p_FiffRawData.info)
 , first_samp(p_FiffRawData.first_samp)
 , last_samp(p_FiffRawData.last_samp)
@@ -115,6 +211,7 @@ void FiffRawData::clear()
     rawdir.clear();
     proj = MatrixXd();
     comp.clear();
+    m_pReadCache = QSharedPointer<ReadCache>(new ReadCache());
 }
 
 
@@ -127,11 +224,24 @@ bool FiffRawData::read_raw_segment(MatrixXd& data,
                                    const RowVectorXi& sel,
                                    bool do_debug) const
 {
-    bool projAvailable = true;
+    SparseMatrix<double> multSegment;
+
+    return read_raw_segment(data, times, multSegment, from, to, sel, do_debug);
+}
+
+
+//*************************************************************************************************************
 
+bool FiffRawData::read_raw_segment(MatrixXd& data,
+                                   MatrixXd& times,
+                                   SparseMatrix<double>& multSegment,
+                                   fiff_int_t from,
+                                   fiff_int_t to,
+                                   const RowVectorXi& sel,
+                                   bool do_debug) const
+{
     if (this->proj.size() == 0) {
         qDebug() << "FiffRawData::read_raw_segment - No projectors setup. Consider calling MNE::setup_compensators.";
-        projAvailable = false;
     }
 
     if(from == -1)
@@ -157,93 +267,19 @@ bool FiffRawData::read_raw_segment(MatrixXd& data,
     //
     qint32 nchan = this->info.nchan;
     qint32 dest  = 0;//1;
-    qint32 i, k, r;
-
-    typedef Eigen::Triplet<double> T;
-    std::vector<T> tripletList;
-    tripletList.reserve(nchan);
-    for(i = 0; i < nchan; ++i)
-        tripletList.push_back(T(i, i, this->cals[i]));
-
-    SparseMatrix<double> cal(nchan, nchan);
-    cal.setFromTriplets(tripletList.begin(), tripletList.end());
-//    cal.makeCompressed();
+    qint32 i, k;
 
-    MatrixXd mult_full;
-    //
     if (sel.size() == 0)
-    {
         data = MatrixXd(nchan, to-from+1);
-//            data->setZero();
-        if (projAvailable || this->comp.kind != -1)
-        {
-            if (!projAvailable)
-                mult_full = this->comp.data->data*cal;
-            else if (this->comp.kind == -1)
-                mult_full = this->proj*cal;
-            else
-                mult_full = this->proj*this->comp.data->data*cal;
-        }
-    }
     else
-    {
         data = MatrixXd(sel.size(),to-from+1);
-//            data->setZero();
-
-        MatrixXd selVect(sel.size(), nchan);
-
-        selVect.setZero();
-
-        if (!projAvailable && this->comp.kind == -1)
-        {
-            tripletList.clear();
-            tripletList.reserve(sel.size());
-            for(i = 0; i < sel.size(); ++i)
-                tripletList.push_back(T(i, i, this->cals[sel[i]]));
-            cal = SparseMatrix<double>(sel.size(), sel.size());
-            cal.setFromTriplets(tripletList.begin(), tripletList.end());
-        }
-        else
-        {
-            if (!projAvailable)
-            {
-                qDebug() << "This has to be debugged! #1";
-                for( i = 0; i  < sel.size(); ++i)
-                    selVect.row(i) = this->comp.data->data.block(sel[i],0,1,nchan);
-                mult_full = selVect*cal;
-            }
-            else if (this->comp.kind == -1)
-            {
-                for( i = 0; i  < sel.size(); ++i)
-                    selVect.row(i) = this->proj.block(sel[i],0,1,nchan);
-
-                mult_full = selVect*cal;
-            }
-            else
-            {
-                qDebug() << "This has to be debugged! #3";
-                for( i = 0; i  < sel.size(); ++i)
-                    selVect.row(i) = this->proj.block(sel[i],0,1,nchan);
-
-                mult_full = selVect*this->comp.data->data*cal;
-            }
-        }
-    }
 
     //
-    // Make mult sparse
+    //  The calibration, compensation and projection operator is only rebuilt if proj, comp or cals changed
     //
-    tripletList.clear();
-    tripletList.reserve(mult_full.rows()*mult_full.cols());
-    for(i = 0; i < mult_full.rows(); ++i)
-        for(k = 0; k < mult_full.cols(); ++k)
-            if(mult_full(i,k) != 0)
-                tripletList.push_back(T(i, k, mult_full(i,k)));
-
-    SparseMatrix<double> mult(mult_full.rows(),mult_full.cols());
-    if(tripletList.size() > 0)
-        mult.setFromTriplets(tripletList.begin(), tripletList.end());
-//    mult.makeCompressed();
+    QSharedPointer<const ReadOperator> pReadOp = get_read_operator(sel);
+    const SparseMatrix<double>& cal = pReadOp->cal;
+    const SparseMatrix<double>& mult = pReadOp->mult;
 
     //
 
@@ -265,103 +301,12 @@ bool FiffRawData::read_raw_segment(MatrixXd& data,
     fiff_int_t first_pick, last_pick, picksamp;
     for(k = 0; k < this->rawdir.size(); ++k)
     {
-        FiffRawDir thisRawDir = this->rawdir[k];
+        const FiffRawDir& thisRawDir = this->rawdir[k];
         //
         //  Do we need this buffer
         //
-        if (thisRawDir.last > from)
+        if (thisRawDir.last >= from)
         {
-            if (thisRawDir.ent->kind == -1)
-            {
-                //
-                //  Take the easy route: skip is translated to zeros
-                //
-                if(do_debug)
-                    printf("S");
-                if (sel.cols() <= 0)
-                    one.resize(nchan,thisRawDir.nsamp);
-                else
-                    one.resize(sel.cols(),thisRawDir.nsamp);
-
-                one.setZero();
-            }
-            else
-            {
-                FiffTag::SPtr t_pTag;
-                fid->read_tag(t_pTag, thisRawDir.ent->pos);
-                //
-                //   Depending on the state of the projection and selection
-                //   we proceed a little bit differently
-                //
-                if (mult.cols() == 0)
-                {
-                    if (sel.cols() == 0)
-                    {
-                        if (t_pTag->type == FIFFT_DAU_PACK16)
-                            one = cal*(Map< MatrixDau16 >( t_pTag->toDauPack16(),nchan, thisRawDir.nsamp)).cast<double>();
-                        else if(t_pTag->type == FIFFT_INT)
-                            one = cal*(Map< MatrixXi >( t_pTag->toInt(),nchan, thisRawDir.nsamp)).cast<double>();
-                        else if(t_pTag->type == FIFFT_FLOAT)
-                            one = cal*(Map< MatrixXf >( t_pTag->toFloat(),nchan, thisRawDir.nsamp)).cast<double>();
-                        else if(t_pTag->type == FIFFT_SHORT)
-                            one = cal*(Map< MatrixShort >( t_pTag->toShort(),nchan, thisRawDir.nsamp)).cast<double>();
-                        else
-                            printf("Data Storage Format not known jet [1]!! Type: %d\n", t_pTag->type);
-                    }
-                    else
-                    {
-
-                        //ToDo find a faster solution for this!! --> make cal and mul sparse like in MATLAB
-                        MatrixXd newData(sel.cols(), thisRawDir.nsamp); //ToDo this can be done much faster, without newData
-
-                        if (t_pTag->type == FIFFT_DAU_PACK16)
-                        {
-                            MatrixXd tmp_data = (Map< MatrixDau16 > ( t_pTag->toDauPack16(),nchan, thisRawDir.nsamp)).cast<double>();
-
-                            for(r = 0; r < sel.size(); ++r)
-                                newData.block(r,0,1,thisRawDir.nsamp) = tmp_data.block(sel[r],0,1,thisRawDir.nsamp);
-                        }
-                        else if(t_pTag->type == FIFFT_INT)
-                        {
-                            MatrixXd tmp_data = (Map< MatrixXi >( t_pTag->toInt(),nchan, thisRawDir.nsamp)).cast<double>();
-
-                            for(r = 0; r < sel.size(); ++r)
-                                newData.block(r,0,1,thisRawDir.nsamp) = tmp_data.block(sel[r],0,1,thisRawDir.nsamp);
-                        }
-                        else if(t_pTag->type == FIFFT_FLOAT)
-                        {
-                            MatrixXd tmp_data = (Map< MatrixXf > ( t_pTag->toFloat(),nchan, thisRawDir.nsamp)).cast<double>();
-
-                            for(r = 0; r < sel.size(); ++r)
-                                newData.block(r,0,1,thisRawDir.nsamp) = tmp_data.block(sel[r],0,1,thisRawDir.nsamp);
-                        }
-                        else if(t_pTag->type == FIFFT_SHORT)
-                        {
-                            MatrixXd tmp_data = (Map< MatrixShort > ( t_pTag->toShort(),nchan, thisRawDir.nsamp)).cast<double>();
-
-                            for(r = 0; r < sel.size(); ++r)
-                                newData.block(r,0,1,thisRawDir.nsamp) = tmp_data.block(sel[r],0,1,thisRawDir.nsamp);
-                        }
-                        else
-                        {
-                            printf("Data Storage Format not known jet [2]!! Type: %d\n", t_pTag->type);
-                        }
-
-                        one = cal*newData;
-                    }
-                }
-                else
-                {
-                    if (t_pTag->type == FIFFT_DAU_PACK16)
-                        one = mult*(Map< MatrixDau16 >( t_pTag->toDauPack16(),nchan, thisRawDir.nsamp)).cast<double>();
-                    else if(t_pTag->type == FIFFT_INT)
-                        one = mult*(Map< MatrixXi >( t_pTag->toInt(),nchan, thisRawDir.nsamp)).cast<double>();
-                    else if(t_pTag->type == FIFFT_FLOAT)
-                        one = mult*(Map< MatrixXf >( t_pTag->toFloat(),nchan, thisRawDir.nsamp)).cast<double>();
-                    else
-                        printf("Data Storage Format not known jet [3]!! Type: %d\n", t_pTag->type);
-                }
-            }
             //
             //  The picking logic is a bit complicated
             //
@@ -420,15 +365,43 @@ bool FiffRawData::read_raw_segment(MatrixXd& data,
                 qDebug() << "picksamp: " << picksamp;
             }
 
-            if (picksamp > 0)
+            if (picksamp <= 0)
+            {
+                //
+                //  Nothing to pick from this buffer
+                //
+            }
+            else if (thisRawDir.ent->kind == -1)
+            {
+                //
+                //  Take the easy route: skip is translated to zeros
+                //
+                if(do_debug)
+                    printf("S");
+
+                data.block(0,dest,data.rows(),picksamp).setZero();
+            }
+            else if (read_mapped_buffer(k, *pReadOp, first_pick, picksamp, data, dest))
+            {
+                //
+                //  Local files are mapped into memory: decoded, calibrated and projected straight into data
+                //
+            }
+            else
             {
+                FiffTag::SPtr t_pTag;
+                fid->read_tag(t_pTag, thisRawDir.ent->pos);
+
+                read_tag_buffer(t_pTag, thisRawDir.nsamp, *pReadOp, one);
+
 //                    for(r = 0; r < data->rows(); ++r)
 //                        for(c = 0; c < picksamp; ++c)
 //                            (*data)(r,dest + c) = one(r,first_pick + c);
                 data.block(0,dest,data.rows(),picksamp) = one.block(0, first_pick, data.rows(), picksamp);
+            }
 
+            if (picksamp > 0)
                 dest += picksamp;
-            }
         }
         //
         //  Done?
@@ -440,6 +413,10 @@ bool FiffRawData::read_raw_segment(MatrixXd& data,
         }
     }
 
+    if(mult.cols()==0)
+        multSegment = cal;
+    else
+        multSegment = mult;
 //        fclose(fid);
 
     times = MatrixXd(1, to-from+1);
@@ -453,357 +430,552 @@ bool FiffRawData::read_raw_segment(MatrixXd& data,
 
 //*************************************************************************************************************
 
-bool FiffRawData::read_raw_segment(MatrixXd& data,
-                                   MatrixXd& times,
-                                   SparseMatrix<double>& multSegment,
-                                   fiff_int_t from,
-                                   fiff_int_t to,
-                                   const RowVectorXi& sel,
-                                   bool do_debug) const
+bool FiffRawData::read_raw_segment_times(MatrixXd& data,
+                                         MatrixXd& times,
+                                         float from,
+                                         float to,
+                                         const RowVectorXi& sel) const
 {
-    bool projAvailable = true;
+    //
+    //   Convert to samples
+    //
+    from = floor(from*this->info.sfreq);
+    to   = ceil(to*this->info.sfreq);
+    //
+    //   Read it
+    //
+    return this->read_raw_segment(data, times, (qint32)from, (qint32)to, sel);
+}
 
-    if (this->proj.size() == 0) {
-        qDebug() << "FiffRawData::read_raw_segment - No projectors setup. Consider calling MNE::setup_compensators.";
-        projAvailable = false;
-    }
 
-    if(from == -1)
-        from = this->first_samp;
-    if(to == -1)
-        to = this->last_samp;
-    //
-    //  Initial checks
+//*************************************************************************************************************
+
+bool FiffRawData::read_raw_segments(QList<MatrixXd>& data,
+                                    const QList<QPair<fiff_int_t,fiff_int_t> >& segments,
+                                    const RowVectorXi& sel) const
+{
     //
-    if(from < this->first_samp)
-        from = this->first_samp;
-    if(to > this->last_samp)
-        to = this->last_samp;
+    //  Part of a segment which is covered by a raw buffer
     //
-    if(from > to)
-    {
-        printf("No data in this range\n");
-        return false;
-    }
-    printf("Reading %d ... %d  =  %9.3f ... %9.3f secs...", from, to, ((float)from)/this->info.sfreq, ((float)to)/this->info.sfreq);
+    struct SegmentPick {
+        qint32 segment;         /**< Index of the segment. */
+        fiff_int_t first_pick;  /**< First sample to pick from the buffer. */
+        fiff_int_t picksamp;    /**< Number of samples to pick. */
+        qint32 dest;            /**< Column of the segment to write to. */
+    };
+
     //
-    //  Initialize the data and calibration vector
+    //  Raw buffer which is needed by one or more segments
     //
-    qint32 nchan = this->info.nchan;
-    qint32 dest  = 0;//1;
-    qint32 i, k, r;
+    struct BufferJob {
+        qint32 k;                   /**< Index of the buffer in rawdir. */
+        fiff_int_t first_pick;      /**< First sample needed by any of the segments. */
+        fiff_int_t last_pick;       /**< Last sample needed by any of the segments. */
+        QList<SegmentPick> picks;   /**< The segment parts taken from this buffer. */
+        FiffTag::SPtr t_pTag;       /**< The buffer, if it could not be taken from the memory mapping. */
+    };
 
-    typedef Eigen::Triplet<double> T;
-    std::vector<T> tripletList;
-    tripletList.reserve(nchan);
-    for(i = 0; i < nchan; ++i)
-        tripletList.push_back(T(i, i, this->cals[i]));
+    data.clear();
 
-    SparseMatrix<double> cal(nchan, nchan);
-    cal.setFromTriplets(tripletList.begin(), tripletList.end());
-//    cal.makeCompressed();
+    bool bOk = true;
+    qint32 nrows = sel.size() == 0 ? this->info.nchan : sel.size();
 
-    MatrixXd mult_full;
     //
-    if (sel.size() == 0)
+    //  Sort the requested segments by their first sample
+    //
+    QList<qint32> order;
+    for(qint32 i = 0; i < segments.size(); ++i)
+        order.append(i);
+
+    std::sort(order.begin(), order.end(), [&segments](qint32 a, qint32 b) {
+        return segments[a].first < segments[b].first;
+    });
+
+    //
+    //  Coalesce: collect for each raw buffer all segment parts it covers, each buffer is read only once
+    //
+    QVector<MatrixXd> matSegments(segments.size());
+    QList<BufferJob> jobs;
+    QMap<qint32,qint32> mapJobIndex;
+
+    qint32 kStart = 0;
+    for(qint32 i = 0; i < order.size(); ++i)
     {
-        data = MatrixXd(nchan, to-from+1);
-//            data->setZero();
-        if (projAvailable || this->comp.kind != -1)
+        qint32 idx = order[i];
+        fiff_int_t from = segments[idx].first;
+        fiff_int_t to = segments[idx].second;
+
+        if(from < this->first_samp)
+            from = this->first_samp;
+        if(to > this->last_samp)
+            to = this->last_samp;
+
+        if(from > to)
         {
-            if (!projAvailable)
-                mult_full = this->comp.data->data*cal;
-            else if (this->comp.kind == -1)
-                mult_full = this->proj*cal;
-            else
-                mult_full = this->proj*this->comp.data->data*cal;
+            printf("No data in this range\n");
+            bOk = false;
+            continue;
         }
-    }
-    else
-    {
-        data = MatrixXd(sel.size(),to-from+1);
-//            data->setZero();
 
-        MatrixXd selVect(sel.size(), nchan);
+        matSegments[idx].resize(nrows, to-from+1);
 
-        selVect.setZero();
+        //
+        //  Segments are sorted, so the first buffer needed can only move forward
+        //
+        while(kStart < this->rawdir.size() && this->rawdir[kStart].last < from)
+            ++kStart;
 
-        if (!projAvailable && this->comp.kind == -1)
+        qint32 dest = 0;
+        for(qint32 k = kStart; k < this->rawdir.size() && this->rawdir[k].first <= to; ++k)
         {
-            tripletList.clear();
-            tripletList.reserve(sel.size());
-            for(i = 0; i < sel.size(); ++i)
-                tripletList.push_back(T(i, i, this->cals[sel[i]]));
-            cal = SparseMatrix<double>(sel.size(), sel.size());
-            cal.setFromTriplets(tripletList.begin(), tripletList.end());
+            const FiffRawDir& thisRawDir = this->rawdir[k];
+
+            SegmentPick pick;
+            pick.segment = idx;
+            pick.first_pick = qMax(from, thisRawDir.first) - thisRawDir.first;
+            pick.picksamp = qMin(to, thisRawDir.last) - thisRawDir.first - pick.first_pick + 1;
+            pick.dest = dest;
+
+            if(pick.picksamp <= 0)
+                continue;
+
+            if(!mapJobIndex.contains(k))
+            {
+                BufferJob job;
+                job.k = k;
+                job.first_pick = pick.first_pick;
+                job.last_pick = pick.first_pick + pick.picksamp - 1;
+                mapJobIndex.insert(k, jobs.size());
+                jobs.append(job);
+            }
+
+            BufferJob& job = jobs[mapJobIndex[k]];
+            job.first_pick = qMin(job.first_pick, pick.first_pick);
+            job.last_pick = qMax(job.last_pick, pick.first_pick + pick.picksamp - 1);
+            job.picks.append(pick);
+
+            dest += pick.picksamp;
         }
-        else
-        {
-            if (!projAvailable)
+    }
+
+    if(!jobs.isEmpty())
+    {
+        printf("Reading %d segments from %d raw buffers...", segments.size(), jobs.size());
+
+        QSharedPointer<const ReadOperator> pReadOp = get_read_operator(sel);
+
+        MatrixXd* pSegments = matSegments.data();
+
+        std::function<void(BufferJob&)> decodeLambda = [&](BufferJob& job) {
+            const FiffRawDir& thisRawDir = this->rawdir[job.k];
+            fiff_int_t picksamp = job.last_pick - job.first_pick + 1;
+            fiff_int_t offset = job.first_pick;
+
+            MatrixXd one;
+            if(thisRawDir.ent->kind == -1)
             {
-                qDebug() << "This has to be debugged! #1";
-                for( i = 0; i  < sel.size(); ++i)
-                    selVect.row(i) = this->comp.data->data.block(sel[i],0,1,nchan);
-                mult_full = selVect*cal;
+                one = MatrixXd::Zero(nrows, picksamp);
             }
-            else if (this->comp.kind == -1)
+            else if(job.t_pTag)
             {
-                for( i = 0; i  < sel.size(); ++i)
-                    selVect.row(i) = this->proj.block(sel[i],0,1,nchan);
-
-                mult_full = selVect*cal;
+                read_tag_buffer(job.t_pTag, thisRawDir.nsamp, *pReadOp, one);
+                job.t_pTag.clear();
+                offset = 0;
             }
             else
             {
-                qDebug() << "This has to be debugged! #3";
-                for( i = 0; i  < sel.size(); ++i)
-                    selVect.row(i) = this->proj.block(sel[i],0,1,nchan);
+                one.resize(nrows, picksamp);
+                read_mapped_buffer(job.k, *pReadOp, job.first_pick, picksamp, one, 0);
+            }
+
+            for(qint32 p = 0; p < job.picks.size(); ++p)
+            {
+                const SegmentPick& pick = job.picks[p];
+                pSegments[pick.segment].middleCols(pick.dest, pick.picksamp) = one.middleCols(pick.first_pick - offset, pick.picksamp);
+            }
+        };
+
+        //
+        //  The jobs are processed in chunks, so that only the tags of one chunk are held at a time
+        //
+        qint32 iChunkSize = 2 * qMax(1, QThread::idealThreadCount());
 
-                mult_full = selVect*this->comp.data->data*cal;
+        for(qint32 iChunkStart = 0; iChunkStart < jobs.size(); iChunkStart += iChunkSize)
+        {
+            qint32 iChunkEnd = qMin(iChunkStart + iChunkSize, jobs.size());
+
+            //
+            //  Buffers which can not be taken from the memory mapping are read sequentially in file order
+            //
+            for(qint32 j = iChunkStart; j < iChunkEnd; ++j)
+            {
+                BufferJob& job = jobs[j];
+                const FiffRawDir& thisRawDir = this->rawdir[job.k];
+
+                if(thisRawDir.ent->kind == -1 || map_raw_buffer(job.k))
+                    continue;
+
+                if (!this->file->device()->isOpen())
+                {
+                    if (!this->file->device()->open(QIODevice::ReadOnly))
+                    {
+                        printf("Cannot open file %s",this->info.filename.toUtf8().constData());
+                    }
+                }
+
+                this->file->read_tag(job.t_pTag, thisRawDir.ent->pos);
             }
+
+            //
+            //  Decode, calibrate and project the buffers of the chunk in parallel, each one is scattered to all
+            //  its segments
+            //
+            QtConcurrent::blockingMap(jobs.begin() + iChunkStart, jobs.begin() + iChunkEnd, decodeLambda);
         }
+
+        printf(" [done]\n");
     }
 
-    //
-    // Make mult sparse
-    //
-    tripletList.clear();
-    tripletList.reserve(mult_full.rows()*mult_full.cols());
-    for(i = 0; i < mult_full.rows(); ++i)
-        for(k = 0; k < mult_full.cols(); ++k)
-            if(mult_full(i,k) != 0)
-                tripletList.push_back(T(i, k, mult_full(i,k)));
+    for(qint32 i = 0; i < matSegments.size(); ++i)
+    {
+        data.append(MatrixXd());
+        data.last().swap(matSegments[i]);
+    }
 
-    SparseMatrix<double> mult(mult_full.rows(),mult_full.cols());
-    if(tripletList.size() > 0)
-        mult.setFromTriplets(tripletList.begin(), tripletList.end());
-//    mult.makeCompressed();
+    return bOk;
+}
 
-    //
 
-    FiffStream::SPtr fid;
-    if (!this->file->device()->isOpen())
+//*************************************************************************************************************
+
+void FiffRawData::clear_read_operators() const
+{
+    QMutexLocker locker(&m_pReadCache->mutex);
+
+    m_pReadCache->ops.clear();
+}
+
+
+//*************************************************************************************************************
+
+qint32 FiffRawData::read_operator_version() const
+{
+    QMutexLocker locker(&m_pReadCache->mutex);
+
+    return m_pReadCache->version;
+}
+
+
+//*************************************************************************************************************
+
+const uchar* FiffRawData::map_raw_buffer(qint32 k) const
+{
+    if (k < 0 || k >= this->rawdir.size() || !this->file || this->rawdir[k].ent->kind == -1)
+        return Q_NULLPTR;
+
+    QMutexLocker locker(&m_pReadCache->mutex);
+
+    ReadCache& cache = *m_pReadCache;
+
+    //
+    //  Set up the mapping once per file, using an own file handle so that closing file does not unmap it
+    //
+    if (cache.pMappedDevice != this->file->device())
     {
-        if (!this->file->device()->open(QIODevice::ReadOnly))
+        cache.pMappedDevice = this->file->device();
+        cache.pMappedFile.clear();
+        cache.pMapped = Q_NULLPTR;
+        cache.iMappedSize = 0;
+
+        QFile* pFile = qobject_cast<QFile*>(this->file->device());
+        if (pFile && !pFile->fileName().isEmpty())
         {
-            printf("Cannot open file %s",this->info.filename.toUtf8().constData());
+            QSharedPointer<QFile> pMappedFile(new QFile(pFile->fileName()));
+            if (pMappedFile->open(QIODevice::ReadOnly))
+            {
+                qint64 iSize = pMappedFile->size();
+                const uchar* pMapped = iSize > 0 ? pMappedFile->map(0, iSize) : Q_NULLPTR;
+                if (pMapped)
+                {
+                    cache.pMappedFile = pMappedFile;
+                    cache.pMapped = pMapped;
+                    cache.iMappedSize = iSize;
+                }
+            }
         }
-        fid = this->file;
     }
+
+    if (!cache.pMapped)
+        return Q_NULLPTR;
+
+    //
+    //  Only buffers of the expected size and of a known data type can be used straight from the mapping
+    //
+    const FiffDirEntry::SPtr& ent = this->rawdir[k].ent;
+    qint64 pos = (qint64)ent->pos + FIFFC_DATA_OFFSET;
+
+    qint64 sampleSize;
+    if (ent->type == FIFFT_DAU_PACK16 || ent->type == FIFFT_SHORT)
+        sampleSize = sizeof(qint16);
+    else if (ent->type == FIFFT_INT || ent->type == FIFFT_FLOAT)
+        sampleSize = sizeof(qint32);
     else
-    {
-        fid = this->file;
-    }
+        return Q_NULLPTR;
 
-    MatrixXd one;
-    fiff_int_t first_pick, last_pick, picksamp;
-    for(k = 0; k < this->rawdir.size(); ++k)
+    if ((qint64)ent->size != (qint64)this->info.nchan*this->rawdir[k].nsamp*sampleSize)
+        return Q_NULLPTR;
+
+    if (ent->pos < 0 || pos + ent->size > cache.iMappedSize)
+        return Q_NULLPTR;
+
+    return cache.pMapped + pos;
+}
+
+
+//*************************************************************************************************************
+
+bool FiffRawData::read_mapped_buffer(qint32 k,
+                                     const ReadOperator& readOp,
+                                     fiff_int_t first_pick,
+                                     fiff_int_t picksamp,
+                                     MatrixXd& data,
+                                     qint32 dest) const
+{
+    const uchar* pBuffer = map_raw_buffer(k);
+
+    if (!pBuffer)
+        return false;
+
+    const FiffRawDir& thisRawDir = this->rawdir[k];
+    qint32 nchan = this->info.nchan;
+    qint32 nsamp = thisRawDir.nsamp;
+    fiff_int_t type = thisRawDir.ent->type;
+
+    if (type == FIFFT_DAU_PACK16 || type == FIFFT_SHORT)
+        decodeMappedBuffer<qint16, BigEndianToDouble<qint16> >(pBuffer, nchan, nsamp, readOp.cal, readOp.mult, readOp.sel, first_pick, picksamp, data, dest);
+    else if (type == FIFFT_INT)
+        decodeMappedBuffer<qint32, BigEndianToDouble<qint32> >(pBuffer, nchan, nsamp, readOp.cal, readOp.mult, readOp.sel, first_pick, picksamp, data, dest);
+    else
+        decodeMappedBuffer<quint32, BigEndianFloatToDouble>(pBuffer, nchan, nsamp, readOp.cal, readOp.mult, readOp.sel, first_pick, picksamp, data, dest);
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+void FiffRawData::read_tag_buffer(const FiffTag::SPtr& t_pTag,
+                                  fiff_int_t nsamp,
+                                  const ReadOperator& readOp,
+                                  MatrixXd& one) const
+{
+    qint32 nchan = this->info.nchan;
+    qint32 r;
+
+    const RowVectorXi& sel = readOp.sel;
+    const SparseMatrix<double>& cal = readOp.cal;
+    const SparseMatrix<double>& mult = readOp.mult;
+
+    //
+    //   Depending on the state of the projection and selection
+    //   we proceed a little bit differently
+    //
+    if (mult.cols() == 0)
     {
-        FiffRawDir thisRawDir = this->rawdir[k];
-        //
-        //  Do we need this buffer
-        //
-        if (thisRawDir.last > from)
+        if (sel.cols() == 0)
         {
-            if (thisRawDir.ent->kind == -1)
+            if (t_pTag->type == FIFFT_DAU_PACK16)
+                one = cal*(Map< MatrixDau16 >( t_pTag->toDauPack16(),nchan, nsamp)).cast<double>();
+            else if(t_pTag->type == FIFFT_INT)
+                one = cal*(Map< MatrixXi >( t_pTag->toInt(),nchan, nsamp)).cast<double>();
+            else if(t_pTag->type == FIFFT_FLOAT)
+                one = cal*(Map< MatrixXf >( t_pTag->toFloat(),nchan, nsamp)).cast<double>();
+            else if(t_pTag->type == FIFFT_SHORT)
+                one = cal*(Map< MatrixShort >( t_pTag->toShort(),nchan, nsamp)).cast<double>();
+            else
+                printf("Data Storage Format not known jet [1]!! Type: %d\n", t_pTag->type);
+        }
+        else
+        {
+
+            //ToDo find a faster solution for this!! --> make cal and mul sparse like in MATLAB
+            MatrixXd newData(sel.cols(), nsamp); //ToDo this can be done much faster, without newData
+
+            if (t_pTag->type == FIFFT_DAU_PACK16)
             {
-                //
-                //  Take the easy route: skip is translated to zeros
-                //
-                if(do_debug)
-                    printf("S");
-                if (sel.cols() <= 0)
-                    one.resize(nchan,thisRawDir.nsamp);
-                else
-                    one.resize(sel.cols(),thisRawDir.nsamp);
+                MatrixXd tmp_data = (Map< MatrixDau16 > ( t_pTag->toDauPack16(),nchan, nsamp)).cast<double>();
 
-                one.setZero();
+                for(r = 0; r < sel.size(); ++r)
+                    newData.block(r,0,1,nsamp) = tmp_data.block(sel[r],0,1,nsamp);
             }
-            else
+            else if(t_pTag->type == FIFFT_INT)
             {
-                FiffTag::SPtr t_pTag;
-                fid->read_tag(t_pTag, thisRawDir.ent->pos);
-                //
-                //   Depending on the state of the projection and selection
-                //   we proceed a little bit differently
-                //
-                if (mult.cols() == 0)
-                {
-                    if (sel.cols() == 0)
-                    {
-                        if (t_pTag->type == FIFFT_DAU_PACK16)
-                            one = cal*(Map< MatrixDau16 >( t_pTag->toDauPack16(),nchan, thisRawDir.nsamp)).cast<double>();
-                        else if(t_pTag->type == FIFFT_INT)
-                            one = cal*(Map< MatrixXi >( t_pTag->toInt(),nchan, thisRawDir.nsamp)).cast<double>();
-                        else if(t_pTag->type == FIFFT_FLOAT)
-                            one = cal*(Map< MatrixXf >( t_pTag->toFloat(),nchan, thisRawDir.nsamp)).cast<double>();
-                        else if(t_pTag->type == FIFFT_SHORT)
-                            one = cal*(Map< MatrixShort >( t_pTag->toShort(),nchan, thisRawDir.nsamp)).cast<double>();
-                        else
-                            printf("Data Storage Format not known jet [1]!! Type: %d\n", t_pTag->type);
-                    }
-                    else
-                    {
+                MatrixXd tmp_data = (Map< MatrixXi >( t_pTag->toInt(),nchan, nsamp)).cast<double>();
 
-                        //ToDo find a faster solution for this!! --> make cal and mul sparse like in MATLAB
-                        MatrixXd newData(sel.cols(), thisRawDir.nsamp); //ToDo this can be done much faster, without newData
-
-                        if (t_pTag->type == FIFFT_DAU_PACK16)
-                        {
-                            MatrixXd tmp_data = (Map< MatrixDau16 > ( t_pTag->toDauPack16(),nchan, thisRawDir.nsamp)).cast<double>();
-
-                            for(r = 0; r < sel.size(); ++r)
-                                newData.block(r,0,1,thisRawDir.nsamp) = tmp_data.block(sel[r],0,1,thisRawDir.nsamp);
-                        }
-                        else if(t_pTag->type == FIFFT_INT)
-                        {
-                            MatrixXd tmp_data = (Map< MatrixXi >( t_pTag->toInt(),nchan, thisRawDir.nsamp)).cast<double>();
-
-                            for(r = 0; r < sel.size(); ++r)
-                                newData.block(r,0,1,thisRawDir.nsamp) = tmp_data.block(sel[r],0,1,thisRawDir.nsamp);
-                        }
-                        else if(t_pTag->type == FIFFT_FLOAT)
-                        {
-                            MatrixXd tmp_data = (Map< MatrixXf > ( t_pTag->toFloat(),nchan, thisRawDir.nsamp)).cast<double>();
-
-                            for(r = 0; r < sel.size(); ++r)
-                                newData.block(r,0,1,thisRawDir.nsamp) = tmp_data.block(sel[r],0,1,thisRawDir.nsamp);
-                        }
-                        else if(t_pTag->type == FIFFT_SHORT)
-                        {
-                            MatrixXd tmp_data = (Map< MatrixShort > ( t_pTag->toShort(),nchan, thisRawDir.nsamp)).cast<double>();
-
-                            for(r = 0; r < sel.size(); ++r)
-                                newData.block(r,0,1,thisRawDir.nsamp) = tmp_data.block(sel[r],0,1,thisRawDir.nsamp);
-                        }
-                        else
-                        {
-                            printf("Data Storage Format not known jet [2]!! Type: %d\n", t_pTag->type);
-                        }
-
-                        one = cal*newData;
-                    }
-                }
-                else
-                {
-                    if (t_pTag->type == FIFFT_DAU_PACK16)
-                        one = mult*(Map< MatrixDau16 >( t_pTag->toDauPack16(),nchan, thisRawDir.nsamp)).cast<double>();
-                    else if(t_pTag->type == FIFFT_INT)
-                        one = mult*(Map< MatrixXi >( t_pTag->toInt(),nchan, thisRawDir.nsamp)).cast<double>();
-                    else if(t_pTag->type == FIFFT_FLOAT)
-                        one = mult*(Map< MatrixXf >( t_pTag->toFloat(),nchan, thisRawDir.nsamp)).cast<double>();
-                    else
-                        printf("Data Storage Format not known jet [3]!! Type: %d\n", t_pTag->type);
-                }
+                for(r = 0; r < sel.size(); ++r)
+                    newData.block(r,0,1,nsamp) = tmp_data.block(sel[r],0,1,nsamp);
             }
-            //
-            //  The picking logic is a bit complicated
-            //
-            if (to >= thisRawDir.last && from <= thisRawDir.first)
+            else if(t_pTag->type == FIFFT_FLOAT)
             {
-                //
-                //  We need the whole buffer
-                //
-                first_pick = 0;//1;
-                last_pick  = thisRawDir.nsamp - 1;
-                if (do_debug)
-                    printf("W");
+                MatrixXd tmp_data = (Map< MatrixXf > ( t_pTag->toFloat(),nchan, nsamp)).cast<double>();
+
+                for(r = 0; r < sel.size(); ++r)
+                    newData.block(r,0,1,nsamp) = tmp_data.block(sel[r],0,1,nsamp);
             }
-            else if (from > thisRawDir.first)
+            else if(t_pTag->type == FIFFT_SHORT)
             {
-                first_pick = from - thisRawDir.first;// + 1;
-                if(to < thisRawDir.last)
-                {
-                    //
-                    //  Something from the middle
-                    //
-//                    qDebug() << "This needs to be debugged!";
-                    last_pick = thisRawDir.nsamp + to - thisRawDir.last - 1;//is this alright?
-                    if (do_debug)
-                        printf("M");
-                }
-                else
-                {
-                    //
-                    //  From the middle to the end
-                    //
-                    last_pick = thisRawDir.nsamp - 1;
-                    if (do_debug)
-                        printf("E");
-                }
+                MatrixXd tmp_data = (Map< MatrixShort > ( t_pTag->toShort(),nchan, nsamp)).cast<double>();
+
+                for(r = 0; r < sel.size(); ++r)
+                    newData.block(r,0,1,nsamp) = tmp_data.block(sel[r],0,1,nsamp);
             }
             else
             {
-                //
-                //  From the beginning to the middle
-                //
-                first_pick = 0;//1;
-                last_pick  = to - thisRawDir.first;// + 1;
-                if (do_debug)
-                    printf("B");
+                printf("Data Storage Format not known jet [2]!! Type: %d\n", t_pTag->type);
             }
-            //
-            //  Now we are ready to pick
-            //
-            picksamp = last_pick - first_pick + 1;
 
-            if(do_debug)
-            {
-                qDebug() << "first_pick: " << first_pick;
-                qDebug() << "last_pick: " << last_pick;
-                qDebug() << "picksamp: " << picksamp;
-            }
+            one = cal*newData;
+        }
+    }
+    else
+    {
+        if (t_pTag->type == FIFFT_DAU_PACK16)
+            one = mult*(Map< MatrixDau16 >( t_pTag->toDauPack16(),nchan, nsamp)).cast<double>();
+        else if(t_pTag->type == FIFFT_INT)
+            one = mult*(Map< MatrixXi >( t_pTag->toInt(),nchan, nsamp)).cast<double>();
+        else if(t_pTag->type == FIFFT_FLOAT)
+            one = mult*(Map< MatrixXf >( t_pTag->toFloat(),nchan, nsamp)).cast<double>();
+        else
+            printf("Data Storage Format not known jet [3]!! Type: %d\n", t_pTag->type);
+    }
+}
 
-            if (picksamp > 0)
-            {
-//                    for(r = 0; r < data->rows(); ++r)
-//                        for(c = 0; c < picksamp; ++c)
-//                            (*data)(r,dest + c) = one(r,first_pick + c);
-                data.block(0,dest,data.rows(),picksamp) = one.block(0, first_pick, data.rows(), picksamp);
 
-                dest += picksamp;
+//*************************************************************************************************************
+
+QSharedPointer<const FiffRawData::ReadOperator> FiffRawData::get_read_operator(const RowVectorXi& sel) const
+{
+    QMutexLocker locker(&m_pReadCache->mutex);
+
+    ReadCache& cache = *m_pReadCache;
+
+    //
+    //  Invalidate the cache if proj, comp or cals changed since the operators were built
+    //
+    const MatrixXd& compData = this->comp.data->data;
+
+    bool projChanged = cache.proj.rows() != this->proj.rows() || cache.proj.cols() != this->proj.cols() || cache.proj != this->proj;
+    bool compChanged = cache.compKind != this->comp.kind
+            || cache.compData.rows() != compData.rows() || cache.compData.cols() != compData.cols() || cache.compData != compData;
+    bool calsChanged = cache.cals.size() != this->cals.size() || cache.cals != this->cals;
+
+    if(projChanged || compChanged || calsChanged) {
+        cache.ops.clear();
+        cache.proj = this->proj;
+        cache.compKind = this->comp.kind;
+        cache.compData = compData;
+        cache.cals = this->cals;
+        ++cache.version;
+    } else {
+        for(qint32 i = 0; i < cache.ops.size(); ++i) {
+            const RowVectorXi& cachedSel = cache.ops[i]->sel;
+            if(cachedSel.size() == sel.size() && cachedSel == sel) {
+                return cache.ops[i];
             }
         }
-        //
-        //  Done?
-        //
-        if (thisRawDir.last >= to)
+    }
+
+    //
+    //  Build the operator for this selection
+    //
+    bool projAvailable = this->proj.size() != 0;
+
+    qint32 nchan = this->info.nchan;
+    qint32 i, k;
+
+    QSharedPointer<ReadOperator> pReadOp(new ReadOperator());
+    pReadOp->sel = sel;
+
+    typedef Eigen::Triplet<double> T;
+    std::vector<T> tripletList;
+    tripletList.reserve(nchan);
+    for(i = 0; i < nchan; ++i)
+        tripletList.push_back(T(i, i, this->cals[i]));
+
+    SparseMatrix<double>& cal = pReadOp->cal;
+    cal = SparseMatrix<double>(nchan, nchan);
+    cal.setFromTriplets(tripletList.begin(), tripletList.end());
+
+    MatrixXd mult_full;
+    //
+    if (sel.size() == 0)
+    {
+        if (projAvailable || this->comp.kind != -1)
         {
-            printf(" [done]\n");
-            break;
+            if (!projAvailable)
+                mult_full = compData*cal;
+            else if (this->comp.kind == -1)
+                mult_full = this->proj*cal;
+            else
+                mult_full = this->proj*compData*cal;
         }
     }
-
-    if(mult.cols()==0)
-        multSegment = cal;
     else
-        multSegment = mult;
-//        fclose(fid);
-
-    times = MatrixXd(1, to-from+1);
+    {
+        MatrixXd selVect(sel.size(), nchan);
 
-    for (i = 0; i < times.cols(); ++i)
-        times(0, i) = ((float)(from+i)) / this->info.sfreq;
+        selVect.setZero();
 
-    return true;
-}
+        if (!projAvailable && this->comp.kind == -1)
+        {
+            tripletList.clear();
+            tripletList.reserve(sel.size());
+            for(i = 0; i < sel.size(); ++i)
+                tripletList.push_back(T(i, i, this->cals[sel[i]]));
+            cal = SparseMatrix<double>(sel.size(), sel.size());
+            cal.setFromTriplets(tripletList.begin(), tripletList.end());
+        }
+        else
+        {
+            if (!projAvailable)
+            {
+                for( i = 0; i  < sel.size(); ++i)
+                    selVect.row(i) = compData.block(sel[i],0,1,nchan);
+                mult_full = selVect*cal;
+            }
+            else if (this->comp.kind == -1)
+            {
+                for( i = 0; i  < sel.size(); ++i)
+                    selVect.row(i) = this->proj.block(sel[i],0,1,nchan);
 
+                mult_full = selVect*cal;
+            }
+            else
+            {
+                for( i = 0; i  < sel.size(); ++i)
+                    selVect.row(i) = this->proj.block(sel[i],0,1,nchan);
 
-//*************************************************************************************************************
+                mult_full = selVect*compData*cal;
+            }
+        }
+    }
 
-bool FiffRawData::read_raw_segment_times(MatrixXd& data,
-                                         MatrixXd& times,
-                                         float from,
-                                         float to,
-                                         const RowVectorXi& sel) const
-{
-    //
-    //   Convert to samples
     //
-    from = floor(from*this->info.sfreq);
-    to   = ceil(to*this->info.sfreq);
-    //
-    //   Read it
+    // Make mult sparse
     //
-    return this->read_raw_segment(data, times, (qint32)from, (qint32)to, sel);
+    tripletList.clear();
+    tripletList.reserve(mult_full.rows()*mult_full.cols());
+    for(i = 0; i < mult_full.rows(); ++i)
+        for(k = 0; k < mult_full.cols(); ++k)
+            if(mult_full(i,k) != 0)
+                tripletList.push_back(T(i, k, mult_full(i,k)));
+
+    SparseMatrix<double>& mult = pReadOp->mult;
+    mult = SparseMatrix<double>(mult_full.rows(),mult_full.cols());
+    if(tripletList.size() > 0)
+        mult.setFromTriplets(tripletList.begin(), tripletList.end());
+
+    cache.ops.append(pReadOp);
+
+    return pReadOp;
 }
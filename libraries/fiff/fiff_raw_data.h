@@ -61,7 +61,10 @@
 // Qt INCLUDES
 //=============================================================================================================
 
+#include <QFile>
 #include <QList>
+#include <QMutex>
+#include <QPair>
 #include <QSharedPointer>
 
 
@@ -104,7 +107,8 @@ public:
 
     //=========================================================================================================
     /**
-    * Copy constructor.
+    * Copy constructor. The copy starts with an empty read cache, so that changing proj, comp or cals of one of
+    * the objects does not affect the operators of the other one.
     *
     * @param[in] p_FiffRawData  FIFF raw measurement which should be copied
     */
@@ -205,6 +209,135 @@ public:
                                 float to,
                                 const RowVectorXi& sel = defaultRowVectorXi) const;
 
+    //=========================================================================================================
+    /**
+    * Reads several raw data segments at once, e.g., the epochs around a list of events. The segments are sorted,
+    * each raw buffer which is needed by one or more segments is read only once and the buffers are decoded,
+    * calibrated and projected in parallel. Buffers which are not memory mapped are read and decoded in chunks of
+    * a few buffers per thread, so that the memory used for the read tags does not grow with the number of
+    * segments.
+    *
+    * @param[out] data      returns the data matrices (channels x samples) in the order of the requested segments.
+    *                       The matrix of a segment without any data in range is empty.
+    * @param[in] segments   first and last sample of each segment
+    * @param[in] sel        channel selection vector (optional)
+    *
+    * @return true if all segments were read, false otherwise
+    */
+    bool read_raw_segments(QList<MatrixXd>& data,
+                           const QList<QPair<fiff_int_t,fiff_int_t> >& segments,
+                           const RowVectorXi& sel = defaultRowVectorXi) const;
+
+    //=========================================================================================================
+    /**
+    * Drops all cached read operators (calibration, compensation and projection). The cache is invalidated
+    * automatically when proj, comp or cals change, so this only needs to be called to release memory.
+    */
+    void clear_read_operators() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the version of the cached read operators. The version is incremented each time a change of
+    * proj, comp or cals is detected and the cached operators are discarded.
+    *
+    * @return the current read operator version
+    */
+    qint32 read_operator_version() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the samples of the raw buffer k of rawdir as they are stored in the memory mapped file, i.e., nchan x
+    * nsamp in column major order with big endian byte order and the data type given by rawdir[k].ent->type
+    * (FIFFT_DAU_PACK16, FIFFT_SHORT, FIFFT_INT or FIFFT_FLOAT). The pointer stays valid as long as this raw data
+    * or one of its copies exists. Only local files can be mapped.
+    *
+    * @param[in] k          index of the buffer in rawdir
+    *
+    * @return pointer to the mapped samples, NULL if the file can not be mapped, the buffer is a skip or of another type
+    */
+    const uchar* map_raw_buffer(qint32 k) const;
+
+private:
+    //=========================================================================================================
+    /**
+    * The operators which are applied to a raw buffer of a specific channel selection during reading.
+    */
+    struct ReadOperator {
+        RowVectorXi sel;                /**< Channel selection the operator was built for. */
+        SparseMatrix<double> cal;       /**< Calibration operator. */
+        SparseMatrix<double> mult;      /**< Combined projection, compensation and calibration operator. Empty if neither proj nor comp are set. */
+    };
+
+    //=========================================================================================================
+    /**
+    * Cached state for reading raw buffers: the read operators, together with the proj, comp and cals they were
+    * built from, and the memory mapping of the raw data file.
+    */
+    struct ReadCache {
+        ReadCache() : version(0), compKind(-1), pMappedDevice(Q_NULLPTR), pMapped(Q_NULLPTR), iMappedSize(0) {}
+
+        QMutex mutex;                                   /**< Guards the cache against concurrent read_raw_segment calls. */
+        qint32 version;                                 /**< Incremented each time the read operators are invalidated. */
+        MatrixXd proj;                                  /**< proj the cached operators were built with. */
+        fiff_int_t compKind;                            /**< comp.kind the cached operators were built with. */
+        MatrixXd compData;                              /**< comp.data->data the cached operators were built with. */
+        RowVectorXd cals;                               /**< cals the cached operators were built with. */
+        QList<QSharedPointer<const ReadOperator> > ops; /**< Cached operators, one per channel selection. */
+
+        QIODevice* pMappedDevice;                       /**< The device of file the mapping was set up for. */
+        QSharedPointer<QFile> pMappedFile;              /**< Own handle of the mapped file, keeps the mapping valid independent of file. */
+        const uchar* pMapped;                           /**< Beginning of the mapped file, NULL if the file can not be mapped. */
+        qint64 iMappedSize;                             /**< Size of the mapping in bytes. */
+    };
+
+    //=========================================================================================================
+    /**
+    * Returns the read operator for the given channel selection. The operator is taken from the cache if
+    * proj, comp and cals did not change since it was built, otherwise it is (re)computed and cached.
+    *
+    * @param[in] sel        channel selection vector
+    *
+    * @return the read operator
+    */
+    QSharedPointer<const ReadOperator> get_read_operator(const RowVectorXi& sel) const;
+
+    //=========================================================================================================
+    /**
+    * Reads samples of the raw buffer k from the memory mapped file and applies calibration, compensation and
+    * projection straight into data, without allocating a tag or an intermediate buffer.
+    *
+    * @param[in] k          index of the buffer in rawdir
+    * @param[in] readOp     the read operator to apply
+    * @param[in] first_pick first sample of the buffer to pick
+    * @param[in] picksamp   number of samples to pick
+    * @param[out] data      the data matrix to write to
+    * @param[in] dest       column of data to start writing at
+    *
+    * @return true if the buffer was read from the mapping, false if the regular tag reading has to be used
+    */
+    bool read_mapped_buffer(qint32 k,
+                            const ReadOperator& readOp,
+                            fiff_int_t first_pick,
+                            fiff_int_t picksamp,
+                            MatrixXd& data,
+                            qint32 dest) const;
+
+    //=========================================================================================================
+    /**
+    * Applies calibration, compensation and projection to a raw buffer which was read as a tag.
+    *
+    * @param[in] t_pTag     the tag holding the raw buffer
+    * @param[in] nsamp      number of samples in the buffer
+    * @param[in] readOp     the read operator to apply
+    * @param[out] one       returns the calibrated and projected buffer (channels x nsamp)
+    */
+    void read_tag_buffer(const QSharedPointer<FiffTag>& t_pTag,
+                         fiff_int_t nsamp,
+                         const ReadOperator& readOp,
+                         MatrixXd& one) const;
+
+    QSharedPointer<ReadCache> m_pReadCache;     /**< Cached read operators and file mapping. */
+
 public:
     FiffStream::SPtr file;      /**< replaces fid */
     FiffInfo info;              /**< Fiff measurement information */
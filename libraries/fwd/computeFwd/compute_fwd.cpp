@@ -1967,6 +1967,8 @@ void ComputeFwd::calculateFwd() const
 
             if (!eeg_model->fwd_setup_eeg_sphere_model(settings->eeg_sphere_rad,settings->use_equiv_eeg,3))
                 goto out;
+            if (settings->use_eeg_table && !settings->use_equiv_eeg && !eeg_model->fwd_eeg_setup_pot_table())
+                goto out;
 
             printf("Using EEG sphere model \"%s\" with scalp radius %7.1f mm\n",
                    settings->eeg_model_name.toUtf8().constData(),1000*settings->eeg_sphere_rad);
@@ -2167,6 +2169,7 @@ void ComputeFwd::calculateFwd() const
             qCritical("Cannot use a homogeneous model in EEG calculations.");
             goto out;
         }
+        bem_model->use_solution_cache = settings->use_bem_cache;
         printf("\nLoading the solution matrix...\n");
         if (FwdBemModel::fwd_bem_load_recompute_solution(settings->bemname.toUtf8().data(),FWD_BEM_UNKNOWN,FALSE,bem_model) == FAIL)
             goto out;
@@ -113,7 +113,9 @@ void ComputeFwdSettings::initMembers()
     eeg_sphere_rad = 0.09f;   
     scale_eeg_pos = false;    
     use_equiv_eeg = true;     
+    use_eeg_table = false;
     use_threads = true;       
+    use_bem_cache = true;
 
 }
 
@@ -136,11 +138,13 @@ void ComputeFwdSettings::usage(char *name)
     fprintf(stderr,"\t--notrans         head and MRI coordinate systems are identical.\n");
     fprintf(stderr,"\t--meas name       take MEG sensor and EEG electrode locations from here\n");
     fprintf(stderr,"\t--bem  name       BEM model name\n");
+    fprintf(stderr,"\t--nobemcache      do not look up or store computed BEM solutions next to the BEM model\n");
     fprintf(stderr,"\t--origin x:y:z/mm use a sphere model with this origin (head coordinates/mm)\n");
     fprintf(stderr,"\t--eegscalp        scale the electrode locations to the surface of the scalp when using a sphere model\n");
     fprintf(stderr,"\t--eegmodels name  read EEG sphere model specifications from here.\n");
     fprintf(stderr,"\t--eegmodel  name  name of the EEG sphere model to use (default : Default)\n");
     fprintf(stderr,"\t--eegrad rad/mm   radius of the scalp surface to use in EEG sphere model (default : %7.1f mm)\n",1000*eeg_sphere_rad);
+    fprintf(stderr,"\t--eegtable        interpolate the EEG sphere model series from a table when the equivalent source approach is not used\n");
     fprintf(stderr,"\t--mindist dist/mm minimum allowable distance of the sources from the inner skull surface.\n");
     fprintf(stderr,"\t--mindistout name Output the omitted source space points here.\n");
     fprintf(stderr,"\t--includeall      Omit all source space checks\n");
@@ -326,10 +330,18 @@ bool ComputeFwdSettings::check_args (int *argc,char **argv)
             }
             eeg_model_name = QString(argv[k+1]);
         }
+        else if (strcmp(argv[k],"--nobemcache") == 0) {
+            found         = 1;
+            use_bem_cache = false;
+        }
         else if (strcmp(argv[k],"--eegscalp") == 0) {
             found         = 1;
             scale_eeg_pos = true;
         }
+        else if (strcmp(argv[k],"--eegtable") == 0) {
+            found         = 1;
+            use_eeg_table = true;
+        }
         else if (strcmp(argv[k],"--mindist") == 0) {
             found = 2;
             if (k == *argc - 1) {
@@ -145,7 +145,9 @@ public:
     float eeg_sphere_rad;   	/**< Scalp radius to use in EEG sphere model */
     bool scale_eeg_pos;     	/**< Scale the electrode locations to scalp in the sphere model */
     bool use_equiv_eeg;      	/**< Use the equivalent source approach for the EEG sphere model */
+    bool use_eeg_table;      	/**< Interpolate the EEG sphere model series from a table (without the equivalent source approach) */
     bool use_threads;        	/**< Parallelize? */
+    bool use_bem_cache;      	/**< Look up and store computed BEM solutions next to the BEM model (default, turned off by --nobemcache) */
 
 private:
     void initMembers();
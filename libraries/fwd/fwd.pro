@@ -93,6 +93,7 @@ SOURCES += \
     fwd_eeg_sphere_layer.cpp \
     fwd_eeg_sphere_model.cpp \
     fwd_eeg_sphere_model_set.cpp \
+    fwd_eeg_sphere_pot_table.cpp \
     fwd_thread_arg.cpp
 
 HEADERS +=\
@@ -107,6 +108,7 @@ HEADERS +=\
     fwd_eeg_sphere_layer.h \
     fwd_eeg_sphere_model.h \
     fwd_eeg_sphere_model_set.h \
+    fwd_eeg_sphere_pot_table.h \
     fwd_thread_arg.h \
     fwd_types.h
 
@@ -52,9 +52,13 @@
 
 #include <fiff/fiff_stream.h>
 
+#include <QCryptographicHash>
+#include <QDataStream>
 #include <QFile>
 #include <QList>
 #include <QThread>
+#include <QThreadPool>
+#include <QAtomicInt>
 #include <QtConcurrent>
 
 #define _USE_MATH_DEFINES
@@ -214,18 +218,137 @@ void fromFloatEigenMatrix_40(const Eigen::MatrixXf& from_mat, float **& to_mat)
 
 float **mne_lu_invert_40(float **mat,int dim)
 /*
-      * Invert a matrix using the LU decomposition from
-      * LAPACK
+      * Invert a matrix in place using a blocked LU decomposition with
+      * partial pivoting. The matrix has to be allocated with mne_cmatrix_40,
+      * i.e. contiguously, so that it can be factorized without copying.
+      * The inverse is formed from the factors in the same storage as in
+      * LAPACK getri: U is inverted first, then inv(A) P^T L = inv(U) is
+      * solved for column blocks from right to left, so that only one
+      * panel of L needs extra storage. The block updates run in parallel
+      * if OpenMP is enabled.
       */
 {
-    Eigen::MatrixXf eigen_mat = toFloatEigenMatrix_40(mat, dim, dim);
-    Eigen::MatrixXf eigen_mat_inv = eigen_mat.inverse();
-    fromFloatEigenMatrix_40(eigen_mat_inv, mat);
+    typedef Eigen::Matrix<float,Eigen::Dynamic,Eigen::Dynamic,Eigen::RowMajor> RowMatrixXf;
+
+    const int nb = 64;  /* Column block size */
+    int j,jb;
+
+    Eigen::Map<RowMatrixXf> eigen_mat(mat[0], dim, dim);
+    Eigen::PartialPivLU<Eigen::Ref<RowMatrixXf> > lu(eigen_mat);
+    /*
+     * inv(U): inv(U)(0:j,j:j+jb) = -inv(U)(0:j,0:j) U(0:j,j:j+jb) inv(U)(j:j+jb,j:j+jb)
+     */
+    for (j = 0; j < dim; j += nb) {
+        jb = qMin(nb,dim-j);
+        if (j > 0) {
+            eigen_mat.block(0,j,j,jb) = eigen_mat.topLeftCorner(j,j).triangularView<Eigen::Upper>() * eigen_mat.block(0,j,j,jb);
+            eigen_mat.block(j,j,jb,jb).triangularView<Eigen::Upper>().solveInPlace<Eigen::OnTheRight>(eigen_mat.block(0,j,j,jb));
+            eigen_mat.block(0,j,j,jb) *= -1.0f;
+        }
+        RowMatrixXf diag_inv = eigen_mat.block(j,j,jb,jb).triangularView<Eigen::Upper>().solve(RowMatrixXf::Identity(jb,jb));
+        eigen_mat.block(j,j,jb,jb).triangularView<Eigen::Upper>() = diag_inv;
+    }
+    /*
+     * inv(U) inv(L): the panel of L below the diagonal block is moved out before its columns are overwritten
+     */
+    RowMatrixXf l_panel;
+    for (j = ((dim-1)/nb)*nb; j >= 0; j -= nb) {
+        jb = qMin(nb,dim-j);
+        l_panel = eigen_mat.block(j,j,dim-j,jb).triangularView<Eigen::StrictlyLower>();
+        eigen_mat.block(j,j,dim-j,jb).triangularView<Eigen::StrictlyLower>().setZero();
+        if (j+jb < dim)
+            eigen_mat.middleCols(j,jb).noalias() -= eigen_mat.rightCols(dim-j-jb) * l_panel.bottomRows(dim-j-jb);
+        l_panel.topRows(jb).triangularView<Eigen::UnitLower>().solveInPlace<Eigen::OnTheRight>(eigen_mat.middleCols(j,jb));
+    }
+    /*
+     * Undo the row interchanges of the factorization as column interchanges, in place
+     */
+    eigen_mat.applyOnTheRight(lu.permutationP());
     return mat;
 }
 
 
+namespace {
+
+const int BEM_ROWS_PER_BLOCK = 32;  /* Number of collocation matrix rows assembled in one job */
+
+/*
+ * Split the rows of a collocation matrix into blocks, which are assembled concurrently
+ */
+QVector<QPair<int,int> > make_row_blocks(int nrow)
+{
+    QVector<QPair<int,int> > blocks;
+    for (int j = 0; j < nrow; j += BEM_ROWS_PER_BLOCK)
+        blocks.append(QPair<int,int>(j,qMin(j+BEM_ROWS_PER_BLOCK,nrow)));
+    return blocks;
+}
+
+/*
+ * The triangle corners of a surface with the coordinates in separate arrays,
+ * so that the solid angles seen from one point can be computed in vectorized form
+ */
+struct TriangleCorners {
+    Eigen::ArrayXd r1[3];
+    Eigen::ArrayXd r2[3];
+    Eigen::ArrayXd r3[3];
+};
+
+void make_triangle_corners(MNELIB::MneSurfaceOld* surf, TriangleCorners& corners)
+{
+    for (int c = 0; c < 3; c++) {
+        corners.r1[c].resize(surf->ntri);
+        corners.r2[c].resize(surf->ntri);
+        corners.r3[c].resize(surf->ntri);
+    }
+    for (int k = 0; k < surf->ntri; k++) {
+        for (int c = 0; c < 3; c++) {
+            corners.r1[c](k) = surf->tris[k].r1[c];
+            corners.r2[c](k) = surf->tris[k].r2[c];
+            corners.r3[c](k) = surf->tris[k].r3[c];
+        }
+    }
+}
+
+/*
+ * The solid angles of all triangles seen from one point, i.e.,
+ * MneSurfaceOrVolume::solid_angle for a whole surface at once
+ */
+struct SolidAngleWorkspace {
+    Eigen::ArrayXd v1[3];
+    Eigen::ArrayXd v2[3];
+    Eigen::ArrayXd v3[3];
+    Eigen::ArrayXd l1,l2,l3;
+    Eigen::ArrayXd triple;
+    Eigen::ArrayXd s;
+};
+
+void solid_angle_row(const float *from, const TriangleCorners& corners, SolidAngleWorkspace& w, float *res)
+{
+    int c,k;
+
+    for (c = 0; c < 3; c++) {
+        w.v1[c] = corners.r1[c] - (double)from[c];
+        w.v2[c] = corners.r2[c] - (double)from[c];
+        w.v3[c] = corners.r3[c] - (double)from[c];
+    }
+    w.triple = (w.v1[Y_40]*w.v2[Z_40] - w.v2[Y_40]*w.v1[Z_40])*w.v3[X_40]
+            - (w.v1[X_40]*w.v2[Z_40] - w.v2[X_40]*w.v1[Z_40])*w.v3[Y_40]
+            + (w.v1[X_40]*w.v2[Y_40] - w.v2[X_40]*w.v1[Y_40])*w.v3[Z_40];
+
+    w.l1 = (w.v1[X_40].square() + w.v1[Y_40].square() + w.v1[Z_40].square()).sqrt();
+    w.l2 = (w.v2[X_40].square() + w.v2[Y_40].square() + w.v2[Z_40].square()).sqrt();
+    w.l3 = (w.v3[X_40].square() + w.v3[Y_40].square() + w.v3[Z_40].square()).sqrt();
+
+    w.s = w.l1*w.l2*w.l3
+            + (w.v1[X_40]*w.v2[X_40] + w.v1[Y_40]*w.v2[Y_40] + w.v1[Z_40]*w.v2[Z_40])*w.l3
+            + (w.v1[X_40]*w.v3[X_40] + w.v1[Y_40]*w.v3[Y_40] + w.v1[Z_40]*w.v3[Z_40])*w.l2
+            + (w.v2[X_40]*w.v3[X_40] + w.v2[Y_40]*w.v3[Y_40] + w.v2[Z_40]*w.v3[Z_40])*w.l1;
+
+    for (k = 0; k < w.s.size(); k++)
+        res[k] = 2.0*atan2(w.triple(k),w.s(k));
+}
 
+}
 
 
 
@@ -445,6 +568,7 @@ FwdBemModel::FwdBemModel()
 ,v0         (NULL)
 ,use_ip_approach(false)
 ,ip_approach_limit(FWD_BEM_IP_APPROACH_LIMIT)
+,use_solution_cache(true)
 {
 
 }
@@ -1087,10 +1211,7 @@ float **FwdBemModel::fwd_bem_lin_pot_coeff(const QList<MneSurfaceOld*>& surfs)
     float **sub_mat = NULL;
     int   np1,np2,ntri,np_tot,np_max;
     float **nodes;
-    MneTriangle*   tri;
-    double omega[3];
-    double *row = NULL;
-    int    j,k,p,q,c;
+    int    j,k,p,q;
     int    joff,koff;
     MneSurfaceOld* surf1;
     MneSurfaceOld* surf2;
@@ -1105,7 +1226,6 @@ float **FwdBemModel::fwd_bem_lin_pot_coeff(const QList<MneSurfaceOld*>& surfs)
     for (j = 0; j < np_tot; j++)
         for (k = 0; k < np_tot; k++)
             mat[j][k] = 0.0;
-    row        = MALLOC_40(np_max,double);
     sub_mat = MALLOC_40(np_max,float *);
     for (p = 0, joff = 0; p < surfs.size(); p++, joff = joff + np1) {
         surf1 = surfs[p];
@@ -1119,27 +1239,36 @@ float **FwdBemModel::fwd_bem_lin_pot_coeff(const QList<MneSurfaceOld*>& surfs)
             fprintf(stderr,"\t\t%s (%d) -> %s (%d) ... ",
                     fwd_bem_explain_surface(surf1->id).toUtf8().constData(),np1,
                     fwd_bem_explain_surface(surf2->id).toUtf8().constData(),np2);
-
-            for (j = 0; j < np1; j++) {
-                for (k = 0; k < np2; k++)
-                    row[k] = 0.0;
-                for (k = 0, tri = surf2->tris; k < ntri; k++,tri++) {
-                    /*
-               * No contribution from a triangle that
-               * this vertex belongs to
-               */
-                    if (p == q && (tri->vert[0] == j || tri->vert[1] == j || tri->vert[2] == j))
-                        continue;
-                    /*
-               * Otherwise do the hard job
-               */
-                    lin_pot_coeff (nodes[j],tri,omega);
-                    for (c = 0; c < 3; c++)
-                        row[tri->vert[c]] = row[tri->vert[c]] - omega[c];
+            /*
+             * The rows are computed concurrently in blocks
+             */
+            QVector<QPair<int,int> > blocks = make_row_blocks(np1);
+            QtConcurrent::blockingMap(blocks,[&](const QPair<int,int>& block) {
+                Eigen::VectorXd row(np2);
+                double omega[3];
+                MneTriangle* tri;
+                int jj,kk,c;
+
+                for (jj = block.first; jj < block.second; jj++) {
+                    row.setZero();
+                    for (kk = 0, tri = surf2->tris; kk < ntri; kk++,tri++) {
+                        /*
+                         * No contribution from a triangle that
+                         * this vertex belongs to
+                         */
+                        if (p == q && (tri->vert[0] == jj || tri->vert[1] == jj || tri->vert[2] == jj))
+                            continue;
+                        /*
+                         * Otherwise do the hard job
+                         */
+                        lin_pot_coeff (nodes[jj],tri,omega);
+                        for (c = 0; c < 3; c++)
+                            row[tri->vert[c]] = row[tri->vert[c]] - omega[c];
+                    }
+                    for (kk = 0; kk < np2; kk++)
+                        mat[jj+joff][kk+koff] = row[kk];
                 }
-                for (k = 0; k < np2; k++)
-                    mat[j+joff][k+koff] = row[k];
-            }
+            });
             if (p == q) {
                 for (j = 0; j < np1; j++)
                     sub_mat[j] = mat[j+joff]+koff;
@@ -1148,7 +1277,6 @@ float **FwdBemModel::fwd_bem_lin_pot_coeff(const QList<MneSurfaceOld*>& surfs)
             fprintf(stderr,"[done]\n");
         }
     }
-    FREE_40(row);
     FREE_40(sub_mat);
     return(mat);
 }
@@ -1395,12 +1523,10 @@ float **FwdBemModel::fwd_bem_solid_angles(const QList<MneSurfaceOld*>& surfs)
 {
     MneSurfaceOld* surf1;
     MneSurfaceOld* surf2;
-    MneTriangle* tri;
     int ntri1,ntri2,ntri_tot;
-    int j,k,p,q;
+    int j,p,q;
     int joff,koff;
     float **solids;
-    float result;
     float **sub_solids = NULL;
     float desired;
 
@@ -1416,14 +1542,20 @@ float **FwdBemModel::fwd_bem_solid_angles(const QList<MneSurfaceOld*>& surfs)
             surf2 = surfs[q];
             ntri2 = surf2->ntri;
             fprintf(stderr,"\t\t%s (%d) -> %s (%d) ... ",fwd_bem_explain_surface(surf1->id).toUtf8().constData(),ntri1,fwd_bem_explain_surface(surf2->id).toUtf8().constData(),ntri2);
-            for (j = 0; j < ntri1; j++)
-                for (k = 0, tri = surf2->tris; k < ntri2; k++, tri++) {
-                    if (p == q && j == k)
-                        result = 0.0;
-                    else
-                        result = MneSurfaceOrVolume::solid_angle (surf1->tris[j].cent,tri);
-                    solids[j+joff][k+koff] = result;
+            /*
+             * The rows are computed concurrently in blocks
+             */
+            TriangleCorners corners;
+            make_triangle_corners(surf2,corners);
+            QVector<QPair<int,int> > blocks = make_row_blocks(ntri1);
+            QtConcurrent::blockingMap(blocks,[&](const QPair<int,int>& block) {
+                SolidAngleWorkspace w;
+                for (int jj = block.first; jj < block.second; jj++) {
+                    solid_angle_row(surf1->tris[jj].cent,corners,w,solids[jj+joff]+koff);
+                    if (p == q)
+                        solids[jj+joff][jj+koff] = 0.0;
                 }
+            });
             for (j = 0; j < ntri1; j++)
                 sub_solids[j] = solids[j+joff]+koff;
             fprintf(stderr,"[done]\n");
@@ -1537,6 +1669,7 @@ int FwdBemModel::fwd_bem_load_recompute_solution(const QString& name, int bem_me
 */
 {
     int solres;
+    QString cache_name;
 
     if (!m) {
         printf ("No model specified for fwd_bem_load_recompute_solution");
@@ -1560,7 +1693,104 @@ int FwdBemModel::fwd_bem_load_recompute_solution(const QString& name, int bem_me
     }
     if (bem_method == FWD_BEM_UNKNOWN)
         bem_method = FWD_BEM_LINEAR_COLL;
-    return fwd_bem_compute_solution(m,bem_method);
+    /*
+     * A solution computed earlier for the same geometry, conductivities and method
+     */
+    if (m->use_solution_cache) {
+        cache_name = fwd_bem_solution_cache_name(name,m,bem_method);
+        if (!force_recompute && QFile::exists(cache_name)) {
+            solres = fwd_bem_load_solution(cache_name,bem_method,m);
+            if (solres == TRUE) {
+                fprintf(stderr,"\nLoaded cached %s BEM solution from %s\n",fwd_bem_explain_method(m->bem_method).toUtf8().constData(),cache_name.toUtf8().constData());
+                return OK;
+            }
+            fprintf(stderr,"\nIgnoring unreadable cached BEM solution %s\n",cache_name.toUtf8().constData());
+        }
+    }
+    if (fwd_bem_compute_solution(m,bem_method) == FAIL)
+        return FAIL;
+    if (m->use_solution_cache) {
+        if (fwd_bem_save_solution(cache_name,m) == OK)
+            fprintf(stderr,"\nCached the BEM solution in %s\n",cache_name.toUtf8().constData());
+        else
+            fprintf(stderr,"\nCould not cache the BEM solution in %s\n",cache_name.toUtf8().constData());
+    }
+    return OK;
+}
+
+
+//*************************************************************************************************************
+
+QString FwdBemModel::fwd_bem_solution_cache_key(FwdBemModel *m, int bem_method)
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setByteOrder(QDataStream::LittleEndian);
+    stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+    stream << (qint32)bem_method;
+    stream << (qint32)m->nsurf;
+    for (int k = 0; k < m->nsurf; k++) {
+        MneSurfaceOld* surf = m->surfs[k];
+        stream << (qint32)surf->id << m->sigma[k];
+        stream << (qint32)surf->np << (qint32)surf->ntri;
+        for (int j = 0; j < surf->np; j++)
+            stream << surf->rr[j][X_40] << surf->rr[j][Y_40] << surf->rr[j][Z_40];
+        for (int j = 0; j < surf->ntri; j++)
+            stream << (qint32)surf->tris[j].vert[0] << (qint32)surf->tris[j].vert[1] << (qint32)surf->tris[j].vert[2];
+    }
+    /*
+     * The isolated problem approach modifies the solution
+     */
+    stream << (qint32)m->use_ip_approach << m->ip_approach_limit;
+
+    return QString(QCryptographicHash::hash(data, QCryptographicHash::Sha1).toHex());
+}
+
+
+//*************************************************************************************************************
+
+QString FwdBemModel::fwd_bem_solution_cache_name(const QString& name, FwdBemModel *m, int bem_method)
+{
+    QString base = strip_from(strip_from(strip_from(name,".fif"),"-sol"),"-bem");
+
+    return QString("%1-%2%3").arg(base).arg(fwd_bem_solution_cache_key(m,bem_method)).arg(BEM_SOL_SUFFIX);
+}
+
+
+//*************************************************************************************************************
+
+int FwdBemModel::fwd_bem_save_solution(const QString& name, FwdBemModel *m)
+{
+    if (!m || !m->solution) {
+        printf("No solution to save in fwd_bem_save_solution");
+        return FAIL;
+    }
+    int approx = (m->bem_method == FWD_BEM_LINEAR_COLL) ? FIFFV_BEM_APPROX_LINEAR : FIFFV_BEM_APPROX_CONST;
+    /*
+     * Write to a temporary file first so that concurrent runs never read a partial solution
+     */
+    QString tmp_name = QString("%1.%2.tmp").arg(name).arg(QCoreApplication::applicationPid());
+    QFile file(tmp_name);
+    FiffStream::SPtr stream = FiffStream::start_file(file);
+    if (!stream) {
+        QFile::remove(tmp_name);
+        return FAIL;
+    }
+
+    stream->start_block(FIFFB_BEM);
+    stream->write_int(FIFF_BEM_APPROX,&approx);
+    stream->write_float_matrix(FIFF_BEM_POT_SOLUTION,Eigen::Map<Eigen::Matrix<float,Eigen::Dynamic,Eigen::Dynamic,Eigen::RowMajor> >(m->solution[0],m->nsol,m->nsol));
+    stream->end_block(FIFFB_BEM);
+    stream->end_file();
+    file.close();
+
+    QFile::remove(name);
+    if (!QFile::rename(tmp_name,name)) {
+        QFile::remove(tmp_name);
+        return FAIL;
+    }
+    return OK;
 }
 
 
@@ -2513,6 +2743,65 @@ float **FwdBemModel::fwd_bem_lin_field_coeff(FwdBemModel *m, FwdCoilSet *coils,
 }
 
 
+namespace {
+
+const int BEM_DIPOLES_PER_BATCH = 32;   /* Number of source locations in one batched field computation */
+
+/*
+ * Gather the coil integration points and the potential solution points into
+ * separate coordinate arrays for fwd_bem_field_batch
+ */
+void make_batch_field_data(FwdBemModel* m, FwdCoilSet* coils, FwdBemSolution* csol)
+{
+    int c,k,p,s,npoint;
+
+    csol->coil_start.resize(coils->ncoil+1);
+    for (k = 0, npoint = 0; k < coils->ncoil; k++) {
+        csol->coil_start[k] = npoint;
+        npoint += coils->coils[k]->np;
+    }
+    csol->coil_start[coils->ncoil] = npoint;
+    for (c = 0; c < 3; c++) {
+        csol->coil_rmag[c].resize(npoint);
+        csol->coil_cosmag[c].resize(npoint);
+    }
+    csol->coil_w.resize(npoint);
+    for (k = 0, npoint = 0; k < coils->ncoil; k++) {
+        FwdCoil* coil = coils->coils[k];
+        for (p = 0; p < coil->np; p++, npoint++) {
+            for (c = 0; c < 3; c++) {
+                csol->coil_rmag[c](npoint)   = coil->rmag[p][c];
+                csol->coil_cosmag[c](npoint) = coil->cosmag[p][c];
+            }
+            csol->coil_w(npoint) = coil->w[p];
+        }
+    }
+
+    for (c = 0; c < 3; c++)
+        csol->sol_rr[c].resize(m->nsol);
+    csol->sol_mult.resize(m->nsol);
+    for (s = 0, p = 0; s < m->nsurf; s++) {
+        MNELIB::MneSurfaceOld* surf = m->surfs[s];
+        if (m->bem_method == FWD_BEM_CONSTANT_COLL) {
+            for (k = 0; k < surf->ntri; k++, p++) {
+                for (c = 0; c < 3; c++)
+                    csol->sol_rr[c](p) = surf->tris[k].cent[c];
+                csol->sol_mult(p) = m->source_mult[s];
+            }
+        }
+        else {
+            for (k = 0; k < surf->np; k++, p++) {
+                for (c = 0; c < 3; c++)
+                    csol->sol_rr[c](p) = surf->rr[k][c];
+                csol->sol_mult(p) = m->source_mult[s];
+            }
+        }
+    }
+}
+
+}
+
+
 //*************************************************************************************************************
 
 int FwdBemModel::fwd_bem_specify_coils(FwdBemModel *m, FwdCoilSet *coils)
@@ -2548,7 +2837,14 @@ int FwdBemModel::fwd_bem_specify_coils(FwdBemModel *m, FwdCoilSet *coils)
 
     csol->ncoil     = coils->ncoil;
     csol->np        = m->nsol;
-    csol->solution  = mne_mat_mat_mult_40(sol,m->solution,coils->ncoil,m->nsol,m->nsol);//TODO: Suspicion, that this is slow - use Eigen
+    csol->solution  = ALLOC_CMATRIX_40(coils->ncoil,m->nsol);
+    {
+        typedef Eigen::Matrix<float,Eigen::Dynamic,Eigen::Dynamic,Eigen::RowMajor> RowMatrixXf;
+
+        Eigen::Map<RowMatrixXf>(csol->solution[0],coils->ncoil,m->nsol).noalias() =
+                Eigen::Map<RowMatrixXf>(sol[0],coils->ncoil,m->nsol)*Eigen::Map<RowMatrixXf>(m->solution[0],m->nsol,m->nsol);
+    }
+    make_batch_field_data(m,coils,csol);
 
     FREE_CMATRIX_40(sol);
     return OK;
@@ -2924,6 +3220,106 @@ int FwdBemModel::fwd_bem_field(float *rd, float *Q, FwdCoilSet *coils, float *B,
 }
 
 
+//*************************************************************************************************************
+
+int FwdBemModel::fwd_bem_field_batch(const MatrixXf &rd, const MatrixXf &Q, FwdCoilSet *coils, MatrixXf &B, void *client)
+/*
+     * This version calculates the magnetic field of a block of dipoles in a set of coils
+     * Call fwd_bem_specify_coils first to establish the coil-specific
+     * solution matrix
+     */
+{
+    FwdBemModel* m = (FwdBemModel*)client;
+    FwdBemSolution* sol = (FwdBemSolution*)coils->user_data;
+    int   ndip = rd.cols();
+    int   c,j,k;
+    float my_rd[3],my_Q[3];
+
+    if (!m) {
+        printf("No BEM model specified to fwd_bem_field_batch");
+        return FAIL;
+    }
+    if (!sol || !sol->solution || sol->ncoil != coils->ncoil || sol->coil_start.size() != coils->ncoil+1) {
+        printf("No appropriate coil-specific data available in fwd_bem_field_batch");
+        return FAIL;
+    }
+    if (m->bem_method != FWD_BEM_CONSTANT_COLL && m->bem_method != FWD_BEM_LINEAR_COLL) {
+        printf("Unknown BEM method : %d",m->bem_method);
+        return FAIL;
+    }
+    /*
+       * Infinite-medium potentials at the solution points,
+       * the dipole location and orientation must be transformed
+       */
+    MatrixXf v0(sol->np,ndip);
+    ArrayXf  diff[3],diff2;
+
+    for (j = 0; j < ndip; j++) {
+        for (c = 0; c < 3; c++) {
+            my_rd[c] = rd(c,j);
+            my_Q[c]  = Q(c,j);
+        }
+        if (m->head_mri_t) {
+            FiffCoordTransOld::fiff_coord_trans(my_rd,m->head_mri_t,FIFFV_MOVE);
+            FiffCoordTransOld::fiff_coord_trans(my_Q,m->head_mri_t,FIFFV_NO_MOVE);
+        }
+        for (c = 0; c < 3; c++)
+            diff[c] = sol->sol_rr[c] - my_rd[c];
+        diff2 = diff[X_40].square() + diff[Y_40].square() + diff[Z_40].square();
+        v0.col(j) = (sol->sol_mult*(my_Q[X_40]*diff[X_40] + my_Q[Y_40]*diff[Y_40] + my_Q[Z_40]*diff[Z_40])
+                     /(float(4.0*M_PI)*diff2*diff2.sqrt())).matrix();
+    }
+    /*
+       * Volume current contribution
+       */
+    typedef Eigen::Matrix<float,Eigen::Dynamic,Eigen::Dynamic,Eigen::RowMajor> RowMatrixXf;
+
+    B.noalias() = Map<RowMatrixXf>(sol->solution[0],sol->ncoil,sol->np)*v0;
+    /*
+       * Primary current contribution
+       * (can be calculated in the coil/dipole coordinates)
+       */
+    ArrayXf field;
+
+    for (j = 0; j < ndip; j++) {
+        for (c = 0; c < 3; c++)
+            diff[c] = sol->coil_rmag[c] - rd(c,j);
+        diff2 = diff[X_40].square() + diff[Y_40].square() + diff[Z_40].square();
+        field = sol->coil_w*((Q(Y_40,j)*diff[Z_40] - Q(Z_40,j)*diff[Y_40])*sol->coil_cosmag[X_40]
+                             + (Q(Z_40,j)*diff[X_40] - Q(X_40,j)*diff[Z_40])*sol->coil_cosmag[Y_40]
+                             + (Q(X_40,j)*diff[Y_40] - Q(Y_40,j)*diff[X_40])*sol->coil_cosmag[Z_40])
+                /(diff2*diff2.sqrt());
+        for (k = 0; k < coils->ncoil; k++)
+            B(k,j) += field.segment(sol->coil_start[k],sol->coil_start[k+1]-sol->coil_start[k]).sum();
+    }
+    /*
+       * Scale correctly
+       */
+    B *= (float)MAG_FACTOR;
+    return OK;
+}
+
+
+//*************************************************************************************************************
+
+int FwdBemModel::fwd_bem_field_vec(float *rd, FwdCoilSet *coils, float **B, void *client)
+/*
+     * Calculate the magnetic field of three orthogonal dipoles
+     */
+{
+    Matrix3f rds;
+    MatrixXf res;
+    int      k;
+
+    rds.colwise() = Vector3f(rd[X_40],rd[Y_40],rd[Z_40]);
+    if (fwd_bem_field_batch(rds,Matrix3f::Identity(),coils,res,client) == FAIL)
+        return FAIL;
+    for (k = 0; k < 3; k++)
+        Map<VectorXf>(B[k],coils->ncoil) = res.col(k);
+    return OK;
+}
+
+
 //*************************************************************************************************************
 
 int FwdBemModel::fwd_bem_field_grad(float *rd, float Q[], FwdCoilSet *coils, float Bval[], float xgrad[], float ygrad[], float zgrad[], void *client)  /* Client data to be passed to some foward modelling routines */
@@ -2962,20 +3358,52 @@ int FwdBemModel::fwd_bem_field_grad(float *rd, float Q[], FwdCoilSet *coils, flo
 
 void *FwdBemModel::meg_eeg_fwd_one_source_space(void *arg)
 /*
-* Compute the MEG or EEG forward solution for one source space
-* and possibly for only one source component
+* Compute the MEG or EEG forward solution for one source space,
+* or a range of its vertices, and possibly for only one source component
 */
 {
     FwdThreadArg* a = (FwdThreadArg*)arg;
     MneSourceSpaceOld* s = a->s;
     int            j,p,q;
+    int            jfirst = a->first;
+    int            jlast  = (a->last < 0) ? s->np : a->last;
     float          *xyz[3];
 
     p = a->off;
     q = 3*a->off;
-    if (a->fixed_ori) {					  /* The normal source component only */
+    if (a->batch_field_pot && !(a->field_pot_grad && a->res_grad) && (a->fixed_ori || a->comp < 0)) {
+        /*
+         * Compute blocks of source points at once
+         */
+        int      ncomp = a->fixed_ori ? 1 : 3;
+        int      ndip,k;
+        MatrixXf rd(3,ncomp*BEM_DIPOLES_PER_BATCH);
+        MatrixXf Q(3,ncomp*BEM_DIPOLES_PER_BATCH);
+        MatrixXf B;
+
+        for (j = jfirst; j < jlast; ) {
+            for (ndip = 0; j < jlast && ndip < ncomp*BEM_DIPOLES_PER_BATCH; j++) {
+                if (!s->inuse[j])
+                    continue;
+                for (k = 0; k < ncomp; k++, ndip++) {
+                    rd.col(ndip) = Map<Vector3f>(s->rr[j]);
+                    if (a->fixed_ori)
+                        Q.col(ndip) = Map<Vector3f>(s->nn[j]);
+                    else
+                        Q.col(ndip) = Vector3f::Unit(k);
+                }
+            }
+            if (ndip == 0)
+                break;
+            if (a->batch_field_pot(rd.leftCols(ndip),Q.leftCols(ndip),a->coils_els,B,a->client) != OK)
+                goto bad;
+            for (k = 0; k < ndip; k++)
+                Map<VectorXf>(a->res[p++],B.rows()) = B.col(k);
+        }
+    }
+    else if (a->fixed_ori) {				  /* The normal source component only */
         if (a->field_pot_grad && a->res_grad) {                   /* Gradient requested? */
-            for (j = 0; j < s->np; j++)
+            for (j = jfirst; j < jlast; j++)
                 if (s->inuse[j]) {
                     if (a->field_pot_grad(s->rr[j],s->nn[j],a->coils_els,a->res[p],
                                           a->res_grad[q],a->res_grad[q+1],a->res_grad[q+2],
@@ -2986,7 +3414,7 @@ void *FwdBemModel::meg_eeg_fwd_one_source_space(void *arg)
                 }
         }
         else {
-            for (j = 0; j < s->np; j++)
+            for (j = jfirst; j < jlast; j++)
                 if (s->inuse[j])
                     if (a->field_pot(s->rr[j],s->nn[j],a->coils_els,a->res[p++],a->client) != OK)
                         goto bad;
@@ -2994,7 +3422,7 @@ void *FwdBemModel::meg_eeg_fwd_one_source_space(void *arg)
     }
     else {						  /* All source components */
         if (a->field_pot_grad && a->res_grad) {               /* Gradient requested? */
-            for (j = 0; j < s->np; j++) {
+            for (j = jfirst; j < jlast; j++) {
                 if (s->inuse[j]) {
                     if (a->comp < 0) {				  /* Compute all components */
                         if (a->field_pot_grad(s->rr[j],Qx,a->coils_els,a->res[p],
@@ -3044,7 +3472,7 @@ void *FwdBemModel::meg_eeg_fwd_one_source_space(void *arg)
             }
         }
         else {
-            for (j = 0; j < s->np; j++) {
+            for (j = jfirst; j < jlast; j++) {
                 if (s->inuse[j]) {
                     if (a->vec_field_pot) {
                         xyz[0] = a->res[p++];
@@ -3093,6 +3521,85 @@ bad : {
 }
 
 
+//*************************************************************************************************************
+
+int FwdBemModel::meg_eeg_fwd_chunked(FwdThreadArg *one_arg, MneSourceSpaceOld **spaces, int nspace, int nthread, bool meg, bool bem_model)
+/*
+* Compute the forward solution with dynamic scheduling of source point chunks
+*/
+{
+    QVector<FwdThreadArg> chunks;
+    QList<FwdThreadArg*>  args;
+    QAtomicInt            next_chunk(0);
+    QAtomicInt            stat(OK);
+    int                   nsource,chunk_size,nuse;
+    int                   j,k,off;
+
+    for (k = 0, nsource = 0; k < nspace; k++)
+        nsource += spaces[k]->nuse;
+    /*
+     * Several chunks per thread balance the load, the chunks should still
+     * be large enough to amortize taking them
+     */
+    chunk_size = qBound(1,nsource/(8*qMax(1,nthread)),256);
+    for (k = 0, off = 0; k < nspace; k++) {
+        FwdThreadArg chunk;
+        chunk.s     = spaces[k];
+        chunk.first = 0;
+        chunk.off   = off;
+        for (j = 0, nuse = 0; j < spaces[k]->np; j++) {
+            if (!spaces[k]->inuse[j])
+                continue;
+            if (nuse == chunk_size) {
+                chunk.last = j;
+                chunks.append(chunk);
+                chunk.first = j;
+                chunk.off   = off;
+                nuse = 0;
+            }
+            nuse++;
+            off = one_arg->fixed_ori ? off + 1 : off + 3;
+        }
+        if (nuse > 0) {
+            chunk.last = spaces[k]->np;
+            chunks.append(chunk);
+        }
+    }
+    nthread = qMax(1,qMin(nthread,chunks.size()));
+    fprintf(stderr,"%d threads. I will compute %d chunks of up to %d source points.\n",
+            nthread,chunks.size(),chunk_size);
+    /*
+     * We need copies to allocate separate workspace for each thread
+     */
+    for (k = 0; k < nthread; k++)
+        args.append(meg ? FwdThreadArg::create_meg_multi_thread_duplicate(one_arg,bem_model)
+                        : FwdThreadArg::create_eeg_multi_thread_duplicate(one_arg,bem_model));
+    /*
+     * Each thread takes the next chunk until all are done
+     */
+    QtConcurrent::blockingMap(args,[&](FwdThreadArg* a) {
+        int c;
+        while (stat.loadAcquire() == OK && (c = next_chunk.fetchAndAddOrdered(1)) < chunks.size()) {
+            const FwdThreadArg& chunk = chunks.at(c);
+            a->s     = chunk.s;
+            a->first = chunk.first;
+            a->last  = chunk.last;
+            a->off   = chunk.off;
+            meg_eeg_fwd_one_source_space(a);
+            if (a->stat != OK)
+                stat.storeRelease(FAIL);
+        }
+    });
+    for (k = 0; k < args.size(); k++) {
+        if (meg)
+            FwdThreadArg::free_meg_multi_thread_duplicate(args[k],bem_model);
+        else
+            FwdThreadArg::free_eeg_multi_thread_duplicate(args[k],bem_model);
+    }
+    return stat.loadAcquire();
+}
+
+
 //*************************************************************************************************************
 
 int FwdBemModel::compute_forward_meg(MneSourceSpaceOld **spaces, int nspace, FwdCoilSet *coils, FwdCoilSet *comp_coils, MneCTFCompDataSet *comp_data, bool fixed_ori, FwdBemModel *bem_model, Vector3f *r0, bool use_threads, MneNamedMatrix **resp, MneNamedMatrix **resp_grad)
@@ -3110,11 +3617,11 @@ int FwdBemModel::compute_forward_meg(MneSourceSpaceOld **spaces, int nspace, Fwd
                                              * for one dipole orientation */
     int                 nmeg = coils->ncoil;/* Number of channels */
     int                 nsource;            /* Total number of sources */
-    int                 k,p,q,off;
+    int                 k,off;
     QStringList         names;              /* Channel names */
     void                *client;
     FwdThreadArg*       one_arg = NULL;
-    int                 nproc = QThread::idealThreadCount();
+    int                 nproc = QThreadPool::globalInstance()->maxThreadCount();
     QStringList         emptyList;
 
     if (bem_model) {
@@ -3147,6 +3654,7 @@ int FwdBemModel::compute_forward_meg(MneSourceSpaceOld **spaces, int nspace, Fwd
                 goto bad;
             fprintf(stderr,"[done]\n");
         }
+        comp->batch_field = FwdBemModel::fwd_bem_field_batch;
         field      = FwdCompData::fwd_comp_field;
         vec_field  = NULL;
         field_grad = FwdCompData::fwd_comp_field_grad;
@@ -3210,59 +3718,15 @@ int FwdBemModel::compute_forward_meg(MneSourceSpaceOld **spaces, int nspace, Fwd
     one_arg->field_pot      = field;
     one_arg->vec_field_pot  = vec_field;
     one_arg->field_pot_grad = field_grad;
+    one_arg->batch_field_pot = comp->batch_field ? FwdCompData::fwd_comp_field_batch : NULL;
 
     if (nproc < 2)
         use_threads = false;
 
     if (use_threads) {
-        int            nthread  = (fixed_ori || vec_field || nproc < 6) ? nspace : 3*nspace;
-        QList <FwdThreadArg*> args; //fwdThreadArg   *args    = MALLOC_40(nthread,fwdThreadArg);
-        int            stat;
-        /*
-        * We need copies to allocate separate workspace for each thread
-        */
-        if (fixed_ori || vec_field || nproc < 6) {
-            for (k = 0, off = 0; k < nthread; k++) {
-                FwdThreadArg* t_arg = FwdThreadArg::create_meg_multi_thread_duplicate(one_arg,bem_model != NULL);
-                t_arg->s   = spaces[k];
-                t_arg->off = off;
-                off = fixed_ori ? off + spaces[k]->nuse : off + 3*spaces[k]->nuse;
-                args.append(t_arg);
-            }
-            fprintf(stderr,"%d processors. I will use one thread for each of the %d source spaces.\n",
-                    nproc,nspace);
-        }
-        else {
-            for (k = 0, off = 0, q = 0; k < nspace; k++) {
-                for (p = 0; p < 3; p++,q++) {
-                    FwdThreadArg* t_arg = FwdThreadArg::create_meg_multi_thread_duplicate(one_arg,bem_model != NULL);
-                    t_arg->s    = spaces[k];
-                    t_arg->off  = off;
-                    t_arg->comp = p;
-                    args.append(t_arg);
-                }
-                off = fixed_ori ? off + spaces[k]->nuse : off + 3*spaces[k]->nuse;
-            }
-            fprintf(stderr,"%d processors. I will use %d threads : %d source spaces x 3 source components.\n",
-                    nproc,nthread,nspace);
-        }
         fprintf(stderr,"Computing MEG at %d source locations (%s orientations)...",
                 nsource,fixed_ori ? "fixed" : "free");
-        /*
-        * Ready to start the threads & Wait for them to complete
-        */
-        QtConcurrent::blockingMap(args, meg_eeg_fwd_one_source_space);
-        /*
-        * Check the results
-        */
-        for (k = 0, stat = OK; k < nthread; k++)
-            if (args[k]->stat != OK) {
-                stat = FAIL;
-                break;
-            }
-        for (k = 0; k < args.size(); k++)//nthread == args.size()
-            FwdThreadArg::free_meg_multi_thread_duplicate(args[k],bem_model != NULL);
-        if (stat != OK)
+        if (meg_eeg_fwd_chunked(one_arg,spaces,nspace,nproc,true,bem_model != NULL) != OK)
             goto bad;
     }
     else {
@@ -3323,11 +3787,11 @@ int FwdBemModel::compute_forward_eeg(MneSourceSpaceOld **spaces, int nspace, Fwd
                                              * for one dipole orientation */
     int             nsource;                /* Total number of sources */
     int             neeg = els->ncoil;      /* Number of channels */
-    int             k,p,q,off;
+    int             k,off;
     QStringList     names;                  /* Channel names */
     void            *client;
     FwdThreadArg*   one_arg = NULL;
-    int             nproc = QThread::idealThreadCount();
+    int             nproc = QThreadPool::globalInstance()->maxThreadCount();
     QStringList     emptyList;
     /*
        * Count the sources
@@ -3399,52 +3863,9 @@ int FwdBemModel::compute_forward_eeg(MneSourceSpaceOld **spaces, int nspace, Fwd
         use_threads = false;
 
     if (use_threads) {
-        int            nthread  = (fixed_ori || vec_pot || nproc < 6) ? nspace : 3*nspace;
-        QList <FwdThreadArg*> args; //FwdThreadArg*   *args    = MALLOC_40(nthread,FwdThreadArg*);
-        int            stat;
-        /*
-        * We need copies to allocate separate workspace for each thread
-        */
-        if (fixed_ori || vec_pot || nproc < 6) {
-            for (k = 0, off = 0; k < nthread; k++) {
-                FwdThreadArg* t_arg = FwdThreadArg::create_eeg_multi_thread_duplicate(one_arg,bem_model != NULL);
-                t_arg->s   = spaces[k];
-                t_arg->off = off;
-                off = fixed_ori ? off + spaces[k]->nuse : off + 3*spaces[k]->nuse;
-                args.append(t_arg);
-            }
-            printf("%d processors. I will use one thread for each of the %d source spaces.\n",nproc,nspace);
-        }
-        else {
-            for (k = 0, off = 0, q = 0; k < nspace; k++) {
-                for (p = 0; p < 3; p++,q++) {
-                    FwdThreadArg* t_arg = FwdThreadArg::create_eeg_multi_thread_duplicate(one_arg,bem_model != NULL);
-                    t_arg->s    = spaces[k];
-                    t_arg->off  = off;
-                    t_arg->comp = p;
-                    args.append(t_arg);
-                }
-                off = fixed_ori ? off + spaces[k]->nuse : off + 3*spaces[k]->nuse;
-            }
-            printf("%d processors. I will use %d threads : %d source spaces x 3 source components.\n",nproc,nthread,nspace);
-        }
         printf("Computing EEG at %d source locations (%s orientations)...",
                 nsource,fixed_ori ? "fixed" : "free");
-        /*
-        * Ready to start the threads & Wait for them to complete
-        */
-        QtConcurrent::blockingMap(args, meg_eeg_fwd_one_source_space);
-        /*
-        * Check the results
-        */
-        for (k = 0, stat = OK; k < nthread; k++)
-            if (args[k]->stat != OK) {
-                stat = FAIL;
-                break;
-            }
-        for (k = 0; k < args.size(); k++)//nthread == args.size()
-            FwdThreadArg::free_eeg_multi_thread_duplicate(args[k],bem_model != NULL);
-        if (stat != OK)
+        if (meg_eeg_fwd_chunked(one_arg,spaces,nspace,nproc,false,bem_model != NULL) != OK)
             goto bad;
     }
     else {
@@ -106,6 +106,7 @@ namespace FWDLIB
 //=============================================================================================================
 
 class FwdEegSphereModel;
+class FwdThreadArg;
 
 
 //=============================================================================================================
@@ -261,6 +262,28 @@ public:
                                         int         force_recompute,
                                         FwdBemModel* m);
 
+    //============================= BEM solution cache =============================
+
+    /*
+     * Content hash of everything the solution depends on:
+     * the surfaces, the conductivities, the method, and the isolated problem approach
+     */
+    static QString fwd_bem_solution_cache_key(FwdBemModel* m,
+                                              int         bem_method);
+
+    /*
+     * Name of the cached solution next to the model file
+     */
+    static QString fwd_bem_solution_cache_name(const QString& name,
+                                               FwdBemModel* m,
+                                               int         bem_method);
+
+    /*
+     * Write the solution attached to the model so that fwd_bem_load_solution can read it
+     */
+    static int fwd_bem_save_solution(const QString& name,
+                                     FwdBemModel* m);
+
     //============================= fwd_bem_pot.c =============================
 
     static float fwd_bem_inf_field(float *rd,      /* Dipole position */
@@ -442,6 +465,42 @@ public:
                       float       *B,       /* Result */
                       void        *client);
 
+    //=========================================================================================================
+    /**
+    * Calculates the magnetic field of a block of dipoles in a set of coils. The infinite-medium terms are
+    * evaluated over all coil integration points and solution points at once and the volume current
+    * contribution is a single matrix product. Call fwd_bem_specify_coils first.
+    *
+    * @param[in] rd         The dipole positions (3 x ndip).
+    * @param[in] Q          The dipole moments (3 x ndip).
+    * @param[in] coils      The coil definitions.
+    * @param[out] B         The fields (ncoil x ndip).
+    * @param[in] client     The BEM model.
+    *
+    * @return OK on success, FAIL otherwise.
+    */
+    static int fwd_bem_field_batch(const Eigen::MatrixXf& rd,
+                                   const Eigen::MatrixXf& Q,
+                                   FwdCoilSet*  coils,
+                                   Eigen::MatrixXf& B,
+                                   void        *client);
+
+    //=========================================================================================================
+    /**
+    * Calculates the magnetic field of three orthogonal dipoles with fwd_bem_field_batch.
+    *
+    * @param[in] rd         The dipole position.
+    * @param[in] coils      The coil definitions.
+    * @param[out] B         The fields of the x, y, and z dipoles (3 x ncoil).
+    * @param[in] client     The BEM model.
+    *
+    * @return OK on success, FAIL otherwise.
+    */
+    static int fwd_bem_field_vec(float       *rd,
+                                 FwdCoilSet*  coils,
+                                 float       **B,
+                                 void        *client);
+
     static int fwd_bem_field_grad(float        *rd,      /* The dipole location */
                    float        Q[],      /* The dipole components (xyz) */
                    FwdCoilSet*  coils,    /* The coil definitions */
@@ -455,6 +514,17 @@ public:
 
     static void *meg_eeg_fwd_one_source_space(void *arg);
 
+    /*
+     * Compute the forward solution in parallel. The source spaces are split into chunks of source points,
+     * which the threads take one after another. Each thread works on its own duplicate of one_arg.
+     */
+    static int meg_eeg_fwd_chunked(FwdThreadArg* one_arg,                /* Template for the thread arguments */
+                                   MNELIB::MneSourceSpaceOld* *spaces,   /* Source spaces */
+                                   int          nspace,                  /* How many? */
+                                   int          nthread,                 /* Number of threads to use */
+                                   bool         meg,                     /* MEG or EEG thread arguments? */
+                                   bool         bem_model);              /* Is the client data a BEM model? */
+
     // TODO check if this is the correct class or move
     static int compute_forward_meg( MNELIB::MneSourceSpaceOld*    *spaces,     /* Source spaces */
                                     int                 nspace,      /* How many? */
@@ -539,6 +609,8 @@ public:
     float      ip_approach_limit;   /* Controls whether we need to use the isolated problem approach */
     bool       use_ip_approach;     /* Do we need it */
 
+    bool       use_solution_cache;  /* Look up and store computed solutions in the cache next to the model (on by default) */
+
 // ### OLD STRUCT ###
 //typedef struct {
 //    char       *surf_name;              /* Name of the file where surfaces were loaded from */
@@ -107,6 +107,16 @@ public:
     int   ncoil;                        /* Number of sensors */
     int   np;                           /* Number of potential solution points */
 
+    /*
+     * Batched field computation data, one array per coordinate (see FwdBemModel::fwd_bem_field_batch)
+     */
+    Eigen::ArrayXf  coil_rmag[3];       /* The integration points of all coils */
+    Eigen::ArrayXf  coil_cosmag[3];     /* The corresponding direction cosines */
+    Eigen::ArrayXf  coil_w;             /* The corresponding weights */
+    Eigen::VectorXi coil_start;         /* Index of the first integration point of each coil (ncoil+1 entries) */
+    Eigen::ArrayXf  sol_rr[3];          /* The potential solution points in MRI coordinates */
+    Eigen::ArrayXf  sol_mult;           /* Multipliers of the infinite-medium potentials at the solution points */
+
 // ### OLD STRUCT ###
 //typedef struct {                        /* Space to store a solution matrix */
 //    float **solution;                   /* The solution matrix */
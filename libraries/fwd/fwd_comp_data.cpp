@@ -144,6 +144,7 @@ FwdCompData::FwdCompData()
 ,field      (NULL)
 ,vec_field  (NULL)
 ,field_grad (NULL)
+,batch_field(NULL)
 ,client     (NULL)
 ,client_free(NULL)
 ,set        (NULL)
@@ -370,6 +371,47 @@ int FwdCompData::fwd_comp_field_vec(float *rd, FwdCoilSet *coils, float **res, v
 }
 
 
+//*************************************************************************************************************
+
+int FwdCompData::fwd_comp_field_batch(const MatrixXf &rd, const MatrixXf &Q, FwdCoilSet *coils, MatrixXf &res, void *client)
+/*
+          * Calculate the compensated field of a block of dipoles
+          */
+{
+    FwdCompData* comp = (FwdCompData*)client;
+    MatrixXf     comp_res;
+    int k;
+
+    if (!comp->batch_field) {
+        printf("Field computation function is missing in fwd_comp_field_batch");
+        return FAIL;
+    }
+    /*
+       * First compute the field in the primary set of coils
+       */
+    if (comp->batch_field(rd,Q,coils,res,comp->client) == FAIL)
+        return FAIL;
+    /*
+       * Compensation needed?
+       */
+    if (!comp->comp_coils || comp->comp_coils->ncoil <= 0 || !comp->set || !comp->set->current)
+        return OK;
+    /*
+       * Compute the field at the compensation sensors
+       */
+    if (comp->batch_field(rd,Q,comp->comp_coils,comp_res,comp->client) == FAIL)
+        return FAIL;
+    /*
+       * Compute the compensated field of each dipole
+       */
+    for (k = 0; k < res.cols(); k++) {
+        if (MneCTFCompDataSet::mne_apply_ctf_comp(comp->set,TRUE,res.col(k).data(),coils->ncoil,comp_res.col(k).data(),comp->comp_coils->ncoil) == FAIL)
+            return FAIL;
+    }
+    return OK;
+}
+
+
 //*************************************************************************************************************
 
 int FwdCompData::fwd_comp_field_grad(float *rd, float *Q, FwdCoilSet* coils, float *res, float *xgrad, float *ygrad, float *zgrad, void *client)
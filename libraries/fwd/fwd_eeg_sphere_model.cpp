@@ -253,6 +253,9 @@ FwdEegSphereModel::FwdEegSphereModel()
 //*************************************************************************************************************
 
 FwdEegSphereModel::FwdEegSphereModel(const FwdEegSphereModel& p_FwdEegSphereModel)
+: nterms  (0)
+, nfit    (0)
+, scale_pos (0)
 {
     int k;
 
@@ -279,6 +282,7 @@ FwdEegSphereModel::FwdEegSphereModel(const FwdEegSphereModel& p_FwdEegSphereMode
         }
     }
     this->scale_pos = p_FwdEegSphereModel.scale_pos;
+    this->pot_table = p_FwdEegSphereModel.pot_table;
 }
 
 
@@ -577,8 +581,8 @@ int FwdEegSphereModel::fwd_eeg_multi_spherepot(float *rd, float *Q, float **el,
     FwdEegSphereModel* m = (FwdEegSphereModel*)client;
     float  my_rd[3],pos[3];
     int    k,p;
-    float  pos2,rd_len,pos_len;
-    double beta,cos_gamma,Vr,Vt;
+    float  pos2,rd_len;
+    double Vr,Vt;
     float  vec1[3],vec2[3],v1,v2;
     float  cos_beta,Qr,Qt,Q2,c;
     float  pi4_inv = 0.25/M_PI;
@@ -626,28 +630,58 @@ int FwdEegSphereModel::fwd_eeg_multi_spherepot(float *rd, float *Q, float **el,
         cos_beta = 0.0;
         Qr = Qt = 0.0;
     }
-    for (k = 0; k < neeg; k++) {
-        for (p = 0; p < 3; p++)
-            pos[p] = el[k][p] - m->r0[p];
+    /*
+       * Calculate the two ingredients for the final result for all electrodes.
+       * The work arrays of the model keep their size, so that nothing is allocated for the same electrodes.
+       */
+    MatrixXf& elpos     = m->work_elpos;
+    ArrayXf&  el_len    = m->work_pos_len;
+    ArrayXf&  beta      = m->work_beta;
+    ArrayXf&  cos_gamma = m->work_cos_gamma;
+    ArrayXd&  Vr_all    = m->work_Vr;
+    ArrayXd&  Vt_all    = m->work_Vt;
+    elpos.resize(3,neeg);
+    Vr_all.resize(neeg);
+    Vt_all.resize(neeg);
+    for (k = 0; k < neeg; k++)
+        elpos.col(k) = Map<const Vector3f>(el[k]) - m->r0;
+    el_len = elpos.colwise().norm().transpose().array();
+    /*
+     * Should the positions be scaled or not?
+     */
+    if (m->scale_pos) {
+        for (k = 0; k < neeg; k++)
+            elpos.col(k) *= m->layers[m->nlayer()-1].rad/el_len[k];
+        el_len = elpos.colwise().norm().transpose().array();
+    }
+    cos_gamma = (elpos.array().colwise()*Map<const Array3f>(rd)).colwise().sum().transpose()/(rd_len*el_len);
+    beta = rd_len/el_len;
+    if (m->pot_table) {
         /*
-         * Should the position be scaled or not?
+         * Interpolate from the table, the series is needed only outside of it
          */
-        if (m->scale_pos) {
-            pos_len = m->layers[m->nlayer()-1].rad/VEC_LEN_1(pos);
-#ifdef DEBUG
-            printf("%10.4f %10.4f %10.4f %10.4f\n",pos_len,1000*pos[0],1000*pos[1],1000*pos[2]);
-#endif
-            for (p = 0; p < 3; p++)
-                pos[p] = pos_len*pos[p];
+        ArrayXf& Vr_table = m->work_Vr_table;
+        ArrayXf& Vt_table = m->work_Vt_table;
+        m->pot_table->interpolate(beta,cos_gamma,Vr_table,Vt_table);
+        for (k = 0; k < neeg; k++) {
+            if (beta[k] <= m->pot_table->betaMax()) {
+                Vr_all[k] = Vr_table[k];
+                Vt_all[k] = Vt_table[k];
+            }
+            else
+                calc_pot_components(beta[k],cos_gamma[k],&Vr_all[k],&Vt_all[k],m->fn,m->nterms);
         }
+    }
+    else {
+        for (k = 0; k < neeg; k++)
+            calc_pot_components(beta[k],cos_gamma[k],&Vr_all[k],&Vt_all[k],m->fn,m->nterms);
+    }
+    for (k = 0; k < neeg; k++) {
+        for (p = 0; p < 3; p++)
+            pos[p] = elpos(p,k);
         pos2 = VEC_DOT_1(pos,pos);
-        pos_len = sqrt(pos2);
-        /*
-         * Calculate the two ingredients for the final result
-         */
-        cos_gamma = VEC_DOT_1(pos,rd)/(rd_len*pos_len);
-        beta = rd_len/pos_len;
-        calc_pot_components(beta,cos_gamma,&Vr,&Vt,m->fn,m->nterms);
+        Vr = Vr_all[k];
+        Vt = Vt_all[k];
         /*
          * Then compute the combined result
          */
@@ -678,6 +712,31 @@ int FwdEegSphereModel::fwd_eeg_multi_spherepot(float *rd, float *Q, float **el,
 }
 
 
+//*************************************************************************************************************
+
+bool FwdEegSphereModel::fwd_eeg_setup_pot_table(int nbeta, int nangle)
+{
+    int k;
+
+    if (this->nlayer() == 0) {
+        qWarning("FwdEegSphereModel::fwd_eeg_setup_pot_table - No layers defined in the sphere model");
+        return false;
+    }
+    if (this->fn.size() == 0 || this->nterms != MAXTERMS) {
+        this->fn.resize(MAXTERMS);
+        this->nterms = MAXTERMS;
+        for (k = 0; k < MAXTERMS; k++)
+            this->fn[k] = (2*k+3)*this->fwd_eeg_get_multi_sphere_model_coeff(k+1);
+    }
+    /*
+     * Dipoles are inside the innermost sphere and the electrodes are on the scalp
+     */
+    this->pot_table = FwdEegSpherePotTable::ConstSPtr(new FwdEegSpherePotTable(this->fn,this->layers[0].rel_rad,nbeta,nangle));
+    fprintf(stderr,"Tabulated the EEG sphere model series (%d x %d)\n",nbeta,nangle);
+    return true;
+}
+
+
 //*************************************************************************************************************
 // fwd_multi_spherepot.c
 int FwdEegSphereModel::fwd_eeg_multi_spherepot_coil1(float *rd, float *Q, FwdCoilSet *els, float *Vval, void *client)           /* Client data will be the sphere model definition */
@@ -44,6 +44,7 @@
 #include "fwd_global.h"
 #include "fwd_eeg_sphere_layer.h"
 #include "fwd_coil_set.h"
+#include "fwd_eeg_sphere_pot_table.h"
 
 
 //*************************************************************************************************************
@@ -202,6 +203,20 @@ public:
 
 
 
+    //=========================================================================================================
+    /**
+    * Tabulates the series expansion used by fwd_eeg_multi_spherepot over the radius ratio and the angle
+    * between the source and field points. Afterwards fwd_eeg_multi_spherepot interpolates the table instead
+    * of summing the series for every dipole-electrode pair. The table is shared by copies of the model and
+    * is read-only, so the model can be used by several threads.
+    *
+    * @param[in] nbeta      Number of grid intervals in the radius ratio.
+    * @param[in] nangle     Number of grid intervals in the angle.
+    *
+    * @return true if succeeded, false otherwise.
+    */
+    bool fwd_eeg_setup_pot_table(int nbeta = 256, int nangle = 1024);
+
     static int fwd_eeg_multi_spherepot_coil1(float *rd,    /* Dipole position */
                       float      *Q,                /* Dipole moment */
                       FwdCoilSet* els,              /* Electrode positions */
@@ -388,6 +403,18 @@ public:
     int             nfit;           /**< How many? */
     int             scale_pos;      /**< Scale the positions to the surface of the sphere? */
 
+    FwdEegSpherePotTable::ConstSPtr pot_table;  /**< Interpolation table of the series expansion (optional) */
+
+    // Work arrays of fwd_eeg_multi_spherepot, reused from call to call. They are not copied, threads use copies of the model.
+    Eigen::MatrixXf work_elpos;     /**< Electrode positions in sphere coordinates */
+    Eigen::ArrayXf  work_pos_len;   /**< Distances of the electrodes from the origin */
+    Eigen::ArrayXf  work_beta;      /**< Radius ratios */
+    Eigen::ArrayXf  work_cos_gamma; /**< Cosines of the angles between the dipole and the electrodes */
+    Eigen::ArrayXf  work_Vr_table;  /**< Interpolated radial components */
+    Eigen::ArrayXf  work_Vt_table;  /**< Interpolated tangential components */
+    Eigen::ArrayXd  work_Vr;        /**< Radial components */
+    Eigen::ArrayXd  work_Vt;        /**< Tangential components */
+
 // ### OLD STRUCT ###
 //    typedef struct {
 //      char  *name;                /* Textual identifier */
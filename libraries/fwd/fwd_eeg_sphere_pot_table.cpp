@@ -0,0 +1,181 @@
+//=============================================================================================================
+/**
+* @file     fwd_eeg_sphere_pot_table.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     October, 2018
+*
+* @section  LICENSE
+*
+* Copyright (C) 2018, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    FwdEegSpherePotTable class definition.
+*
+*/
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "fwd_eeg_sphere_pot_table.h"
+#include "fwd_eeg_sphere_model.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Qt INCLUDES
+//=============================================================================================================
+
+#include <QVector>
+#include <QtConcurrent>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STL INCLUDES
+//=============================================================================================================
+
+#include <cmath>
+
+
+#define EPS      1e-10
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace Eigen;
+using namespace FWDLIB;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+FwdEegSpherePotTable::FwdEegSpherePotTable(const VectorXd &fn, float max_beta, int n_beta, int n_angle)
+: beta_max(max_beta)
+, nbeta(qMax(n_beta,1))
+, nangle(qMax(n_angle,1))
+{
+    vr.resize(nangle+1,nbeta+1);
+    vt.resize(nangle+1,nbeta+1);
+
+    QVector<int> columns(nbeta+1);
+    for (int i = 0; i <= nbeta; i++)
+        columns[i] = i;
+    /*
+     * The grid is uniform in 1-sqrt(1-beta/beta_max) and sin(gamma/2)
+     */
+    QtConcurrent::blockingMap(columns, [&](int i) {
+        double u = 1.0 - (double)i/nbeta;
+        double beta = beta_max*(1.0 - u*u);
+        double s,Vr,Vt_sin;
+
+        for (int j = 0; j <= nangle; j++) {
+            s = (double)j/nangle;
+            calc_pot_components_sin(fn,beta,1.0-2.0*s*s,&Vr,&Vt_sin);
+            vr(j,i) = Vr;
+            vt(j,i) = Vt_sin;
+        }
+    });
+}
+
+
+//*************************************************************************************************************
+
+FwdEegSpherePotTable::~FwdEegSpherePotTable()
+{
+}
+
+
+//*************************************************************************************************************
+
+void FwdEegSpherePotTable::interpolate(const ArrayXf &beta, const ArrayXf &cos_gamma, ArrayXf &Vr, ArrayXf &Vt) const
+{
+    float   fb,fa,u,v,sin_gamma;
+    int     i,j,k;
+
+    if (Vr.size() != beta.size())
+        Vr.resize(beta.size());
+    if (Vt.size() != beta.size())
+        Vt.resize(beta.size());
+    /*
+     * Fractional grid coordinates of each point, then gather and interpolate.
+     * Nothing is allocated, this is called for every source.
+     */
+    for (k = 0; k < beta.size(); k++) {
+        fb = (1.0f - std::sqrt(qMax(0.0f,1.0f - beta[k]/beta_max)))*nbeta;
+        fa = qMin(std::sqrt(qMax(0.0f,(1.0f - cos_gamma[k])*0.5f)),1.0f)*nangle;
+        i  = qMin((int)fb,nbeta-1);
+        j  = qMin((int)fa,nangle-1);
+        u  = fb - i;
+        v  = fa - j;
+        sin_gamma = std::sqrt(qMax(0.0f,1.0f - cos_gamma[k]*cos_gamma[k]));
+        Vr[k] = (1.0f-u)*((1.0f-v)*vr(j,i)   + v*vr(j+1,i))
+                + u*((1.0f-v)*vr(j,i+1) + v*vr(j+1,i+1));
+        Vt[k] = ((1.0f-u)*((1.0f-v)*vt(j,i)   + v*vt(j+1,i))
+                + u*((1.0f-v)*vt(j,i+1) + v*vt(j+1,i+1)))*sin_gamma;
+    }
+}
+
+
+//*************************************************************************************************************
+
+void FwdEegSpherePotTable::calc_pot_components_sin(const VectorXd &fn, double beta, double cos_gamma, double *Vr, double *Vt_sin)
+{
+    double p0,p01,p1,p11;
+    double betan,multn,pole,polen;
+    double sin_gamma = sqrt(qMax(0.0,1.0-cos_gamma*cos_gamma));
+    int    n;
+
+    *Vr = *Vt_sin = 0.0;
+    betan = 1.0;
+    pole  = (cos_gamma > 0.0) ? 1.0 : -1.0;
+    polen = 1.0;
+    p0 = p01 = p1 = p11 = 0.0;
+    for (n = 1; n <= fn.size(); n++) {
+        if (betan < EPS)
+            break;
+        FwdEegSphereModel::next_legen(n,cos_gamma,&p0,&p01,&p1,&p11);
+        multn = betan*fn[n-1];
+        *Vr = *Vr + multn*p0;
+        if (sin_gamma > 0.0)
+            *Vt_sin = *Vt_sin + multn*p1/n;
+        else {
+            /*
+             * The limit at the poles: P1(n)/sin(gamma) -> (+-1)^(n+1)*n*(n+1)/2
+             */
+            *Vt_sin = *Vt_sin + polen*multn*(n+1)/2.0;
+            polen = pole*polen;
+        }
+        betan = beta*betan;
+    }
+    if (sin_gamma > 0.0)
+        *Vt_sin = *Vt_sin/sin_gamma;
+    return;
+}
@@ -0,0 +1,167 @@
+//=============================================================================================================
+/**
+* @file     fwd_eeg_sphere_pot_table.h
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     October, 2018
+*
+* @section  LICENSE
+*
+* Copyright (C) 2018, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    FwdEegSpherePotTable class declaration.
+*
+*/
+
+#ifndef FWDEEGSPHEREPOTTABLE_H
+#define FWDEEGSPHEREPOTTABLE_H
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "fwd_global.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Qt INCLUDES
+//=============================================================================================================
+
+#include <QSharedPointer>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE NAMESPACE FWDLIB
+//=============================================================================================================
+
+namespace FWDLIB
+{
+
+
+//=============================================================================================================
+/**
+* Tabulates the series expansion of the multilayer sphere model potential (see
+* FwdEegSphereModel::calc_pot_components) on a grid of the radius ratio beta = rd/r and the angle gamma
+* between the source and field points. The radial component and the tangential component divided by
+* sin(gamma) are smooth on the grid and are interpolated bilinearly. The grid nodes are denser towards
+* the largest radius ratio and towards gamma = 0, where the series converges slowly.
+*
+* The table is read-only once constructed and can be shared by threads.
+*
+* @brief Interpolation table of the multilayer sphere model potential series
+*/
+class FWDSHARED_EXPORT FwdEegSpherePotTable
+{
+public:
+    typedef QSharedPointer<FwdEegSpherePotTable> SPtr;              /**< Shared pointer type for FwdEegSpherePotTable. */
+    typedef QSharedPointer<const FwdEegSpherePotTable> ConstSPtr;   /**< Const shared pointer type for FwdEegSpherePotTable. */
+
+    //=========================================================================================================
+    /**
+    * Constructs the table by evaluating the series at all grid nodes.
+    *
+    * @param[in] fn         The series coefficients (see FwdEegSphereModel::fn).
+    * @param[in] max_beta   The largest radius ratio covered by the table.
+    * @param[in] n_beta     Number of grid intervals in the radius ratio.
+    * @param[in] n_angle    Number of grid intervals in the angle.
+    */
+    FwdEegSpherePotTable(const Eigen::VectorXd& fn, float max_beta, int n_beta = 256, int n_angle = 1024);
+
+    //=========================================================================================================
+    /**
+    * Destroys the table.
+    */
+    ~FwdEegSpherePotTable();
+
+    //=========================================================================================================
+    /**
+    * Interpolates the potential components for a set of source-field point pairs.
+    * Radius ratios above beta_max are clamped to it, such entries have to be computed with the series.
+    *
+    * @param[in] beta       The radius ratios rd/r.
+    * @param[in] cos_gamma  The cosines of the angles between the source and field points.
+    * @param[out] Vr        The potential components for the radial dipole.
+    * @param[out] Vt        The potential components for the tangential dipole.
+    */
+    void interpolate(const Eigen::ArrayXf& beta,
+                     const Eigen::ArrayXf& cos_gamma,
+                     Eigen::ArrayXf& Vr,
+                     Eigen::ArrayXf& Vt) const;
+
+    //=========================================================================================================
+    /**
+    * Returns the largest radius ratio covered by the table
+    *
+    * @return the largest radius ratio.
+    */
+    inline float betaMax() const;
+
+private:
+    //=========================================================================================================
+    /**
+    * Evaluates the series for the radial component and the tangential component divided by sin(gamma).
+    *
+    * @param[in] fn         The series coefficients.
+    * @param[in] beta       The radius ratio.
+    * @param[in] cos_gamma  The cosine of the angle between the source and field points.
+    * @param[out] Vr        The radial component.
+    * @param[out] Vt_sin    The tangential component divided by sin(gamma).
+    */
+    static void calc_pot_components_sin(const Eigen::VectorXd& fn,
+                                        double beta,
+                                        double cos_gamma,
+                                        double *Vr,
+                                        double *Vt_sin);
+
+    float   beta_max;       /**< The largest radius ratio */
+    int     nbeta;          /**< Number of grid intervals in the radius ratio */
+    int     nangle;         /**< Number of grid intervals in the angle */
+    Eigen::MatrixXf vr;     /**< Radial component at the grid nodes (nangle+1 x nbeta+1) */
+    Eigen::MatrixXf vt;     /**< Tangential component divided by sin(gamma) at the grid nodes (nangle+1 x nbeta+1) */
+};
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INLINE DEFINITIONS
+//=============================================================================================================
+
+inline float FwdEegSpherePotTable::betaMax() const
+{
+    return beta_max;
+}
+
+} // NAMESPACE FWDLIB
+
+#endif // FWDEEGSPHEREPOTTABLE_H
@@ -42,6 +42,7 @@
 #include <mne/c/mne_source_space_old.h>
 #include "fwd_coil_set.h"
 #include "fwd_bem_model.h"
+#include "fwd_eeg_sphere_model.h"
 #include "fwd_comp_data.h"
 
 
@@ -100,9 +101,12 @@ FwdThreadArg::FwdThreadArg()
 ,field_pot     (NULL)
 ,vec_field_pot (NULL)
 ,field_pot_grad(NULL)
+,batch_field_pot(NULL)
 ,coils_els     (NULL)
 ,client        (NULL)
 ,s             (NULL)
+,first         (0)
+,last          (-1)
 ,fixed_ori     (FALSE)
 ,stat          (FAIL)
 ,comp          (-1)
@@ -138,6 +142,12 @@ FwdThreadArg *FwdThreadArg::create_eeg_multi_thread_duplicate(FwdThreadArg *one,
         new_bem->v0 = NULL;
         res->client = new_bem;
     }
+    else {
+        /*
+         * The sphere model holds the work arrays of the potential computation
+         */
+        res->client = new FwdEegSphereModel(*(FwdEegSphereModel*)res->client);
+    }
     return res;
 }
 
@@ -151,6 +161,8 @@ void FwdThreadArg::free_eeg_multi_thread_duplicate(FwdThreadArg *one, bool bem_m
         FREE_80(bem->v0);
         FREE_80(bem);
     }
+    else
+        delete (FwdEegSphereModel*) one->client;
     one->client = NULL;
     if(one)
         delete one;
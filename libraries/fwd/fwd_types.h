@@ -12,6 +12,8 @@
 
 #include <mne/c/mne_ctf_comp_data_set.h>
 
+#include <Eigen/Core>
+
 
 typedef void (*fwdUserFreeFunc)(void *);  /* General purpose */
 
@@ -22,6 +24,11 @@ typedef int (*fwdFieldFunc)(float *rd,float *Q,FWDLIB::FwdCoilSet* coils,float *
 typedef int (*fwdVecFieldFunc)(float *rd,FWDLIB::FwdCoilSet* coils,float **res,void *client);
 typedef int (*fwdFieldGradFunc)(float *rd,float *Q,FWDLIB::FwdCoilSet* coils, float *res,
                                 float *xgrad, float *ygrad, float *zgrad, void *client);
+/*
+ * Field computation for a block of dipoles: rd and Q are 3 x ndip, res is ncoil x ndip
+ */
+typedef int (*fwdBatchFieldFunc)(const Eigen::MatrixXf& rd,const Eigen::MatrixXf& Q,FWDLIB::FwdCoilSet* coils,
+                                 Eigen::MatrixXf& res,void *client);
 
 
 
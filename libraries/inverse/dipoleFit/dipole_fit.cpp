@@ -6,6 +6,11 @@
 
 #include <string.h>
 
+#include <QtConcurrent>
+#include <QThreadPool>
+#include <QAtomicInt>
+#include <QVector>
+
 
 
 using namespace INVERSELIB;
@@ -54,6 +59,8 @@ using namespace FWDLIB;
 
 #define SEG_LEN 10.0
 
+#define FIT_BATCH 1000          /* How many time points are picked before they are fitted in parallel */
+
 
 #define EPS_VALUES 0.05
 
@@ -597,6 +604,55 @@ int mne_get_values_from_data_ch (float time,      /* Interesting time point */
 
 
 
+//*************************************************************************************************************
+
+static void fit_dipole_batch(DipoleFitData* fit, GuessData* guess, const QVector<float>& times, float **B, int verbose, ECDSet& set)
+/*
+ * Fit dipoles to a batch of picked data vectors concurrently.
+ * The time points are independent, each thread works on its own duplicate of the fitting data
+ * and the results are appended to the set in time order.
+ */
+{
+    int                   ntime   = times.size();
+    int                   nthread = qMax(1,qMin(QThreadPool::globalInstance()->maxThreadCount(),ntime));
+    int                   report_interval = 10;
+    QVector<ECD>          dips(ntime);
+    QVector<int>          ok(ntime,FALSE);
+    QList<DipoleFitData*> fits;
+    QAtomicInt            next_time(0);
+    ECD                   *dipp = dips.data();
+    int                   *okp  = ok.data();
+    int                   k;
+
+    if (ntime == 0)
+        return;
+    for (k = 0; k < nthread; k++)
+        fits.append(DipoleFitData::create_thread_duplicate(fit));
+    QtConcurrent::blockingMap(fits,[&](DipoleFitData* f) {
+        int t;
+        while ((t = next_time.fetchAndAddOrdered(1)) < ntime)
+            okp[t] = DipoleFitData::fit_one(f,guess,times[t],B[t],verbose,dipp[t]);
+    });
+    for (k = 0; k < nthread; k++)
+        DipoleFitData::free_thread_duplicate(fits[k]);
+
+    for (k = 0; k < ntime; k++) {
+        if (!okp[k])
+            printf("t = %7.1f ms : %s\n",1000*times[k],"error (tbd: catch)");
+        else {
+            set.addEcd(dipp[k]);
+            if (verbose)
+                dipp[k].print(stdout);
+            else {
+                if (set.size() % report_interval == 0)
+                    fprintf(stderr,"%d..",set.size());
+            }
+        }
+    }
+    return;
+}
+
+
 //*************************************************************************************************************
 //=============================================================================================================
 // DEFINE MEMBER METHODS
@@ -702,7 +758,8 @@ ECDSet DipoleFit::calculateFit() const
     printf("\n---- Computing the forward solution for the guesses...\n\n");
     if ((guess = new GuessData( settings->guessname,
                                 settings->guess_surfname,
-                                settings->guess_mindist, settings->guess_exclude, settings->guess_grid, fit_data)) == NULL)
+                                settings->guess_mindist, settings->guess_exclude, settings->guess_grid, fit_data,
+                                settings->guess_coarse_grid)) == NULL)
         goto out;
 
     fprintf (stderr,"\n---- Fitting : %7.1f ... %7.1f ms (step: %6.1f ms integ: %6.1f ms)\n\n",
@@ -710,7 +767,7 @@ ECDSet DipoleFit::calculateFit() const
 
 
     if (raw) {
-        if (fit_dipoles_raw(settings->measname,raw,sel,fit_data,guess,settings->tmin,settings->tmax,settings->tstep,settings->integ,settings->verbose) == FAIL)
+        if (fit_dipoles_raw(settings->measname,raw,sel,fit_data,guess,settings->tmin,settings->tmax,settings->tstep,settings->integ,settings->verbose,set) == FAIL)
             goto out;
     }
     else {
@@ -730,12 +787,11 @@ out : {
 
 int DipoleFit::fit_dipoles( const QString& dataname, MneMeasData* data, DipoleFitData* fit, GuessData* guess, float tmin, float tmax, float tstep, float integ, int verbose, ECDSet& p_set)
 {
-    float *one = MALLOC(data->nchan,float);
+    float **one = ALLOC_CMATRIX(FIT_BATCH,data->nchan);
     float time;
+    QVector<float> times;
     ECDSet set;
-    ECD   dip;
     int   s;
-    int   report_interval = 10;
 
     set.dataname = dataname;
 
@@ -745,26 +801,23 @@ int DipoleFit::fit_dipoles( const QString& dataname, MneMeasData* data, DipoleFi
      * Pick the data point
      */
         if (mne_get_values_from_data(time,integ,data->current->data,data->current->np,data->nchan,data->current->tmin,
-                                     1.0/data->current->tstep,FALSE,one) == FAIL) {
+                                     1.0/data->current->tstep,FALSE,one[times.size()]) == FAIL) {
             fprintf(stderr,"Cannot pick time: %7.1f ms\n",1000*time);
             continue;
         }
-
-        if (!DipoleFitData::fit_one(fit,guess,time,one,verbose,dip))
-            printf("t = %7.1f ms : %s\n",1000*time,"error (tbd: catch)");
-        else {
-            set.addEcd(dip);
-            if (verbose)
-                dip.print(stdout);
-            else {
-                if (set.size() % report_interval == 0)
-                    fprintf(stderr,"%d..",set.size());
-            }
+        times.append(time);
+        /*
+     * Fit a full batch
+     */
+        if (times.size() == FIT_BATCH) {
+            fit_dipole_batch(fit,guess,times,one,verbose,set);
+            times.clear();
         }
     }
+    fit_dipole_batch(fit,guess,times,one,verbose,set);
     if (!verbose)
         fprintf(stderr,"[done]\n");
-    FREE(one);
+    FREE_CMATRIX(one);
     p_set = set;
     return OK;
 }
@@ -774,7 +827,7 @@ int DipoleFit::fit_dipoles( const QString& dataname, MneMeasData* data, DipoleFi
 
 int DipoleFit::fit_dipoles_raw(const QString& dataname, MneRawData* raw, mneChSelection sel, DipoleFitData* fit, GuessData* guess, float tmin, float tmax, float tstep, float integ, int verbose, ECDSet& p_set)
 {
-    float *one    = MALLOC(sel->nchan,float);
+    float **one   = ALLOC_CMATRIX(FIT_BATCH,sel->nchan);
     float sfreq   = raw->info->sfreq;
     float myinteg = integ > 0.0 ? 2*integ : 0.1;
     int   overlap = ceil(myinteg*sfreq);
@@ -785,9 +838,8 @@ int DipoleFit::fit_dipoles_raw(const QString& dataname, MneRawData* raw, mneChSe
     int   s,picks;
     float time,stime;
     float **data  = ALLOC_CMATRIX(sel->nchan,length);
-    ECD    dip;
+    QVector<float> times;
     ECDSet set;
-    int    report_interval = 10;
 
     set.dataname = dataname;
 
@@ -810,35 +862,30 @@ int DipoleFit::fit_dipoles_raw(const QString& dataname, MneRawData* raw, mneChSe
         /*
      * Get the values
      */
-        if (mne_get_values_from_data_ch (time,integ,data,length,sel->nchan,stime,sfreq,FALSE,one) == FAIL) {
+        if (mne_get_values_from_data_ch (time,integ,data,length,sel->nchan,stime,sfreq,FALSE,one[times.size()]) == FAIL) {
             fprintf(stderr,"Cannot pick time: %8.3f s\n",time);
             continue;
         }
+        times.append(time);
         /*
-     * Fit
+     * Fit a full batch, the picked values are copies and do not depend on the current segment
      */
-        if (!DipoleFitData::fit_one(fit,guess,time,one,verbose,dip))
-            qWarning() << "Error";
-        else {
-            set.addEcd(dip);
-            if (verbose)
-                dip.print(stdout);
-            else {
-                if (set.size() % report_interval == 0)
-                    fprintf(stderr,"%d..",set.size());
-            }
+        if (times.size() == FIT_BATCH) {
+            fit_dipole_batch(fit,guess,times,one,verbose,set);
+            times.clear();
         }
     }
+    fit_dipole_batch(fit,guess,times,one,verbose,set);
     if (!verbose)
         fprintf(stderr,"[done]\n");
     FREE_CMATRIX(data);
-    FREE(one);
+    FREE_CMATRIX(one);
     p_set = set;
     return OK;
 
 bad : {
         FREE_CMATRIX(data);
-        FREE(one);
+        FREE_CMATRIX(one);
         return FAIL;
     }
 }
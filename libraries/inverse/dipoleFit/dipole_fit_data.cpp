@@ -14,6 +14,7 @@
 #include <mne/c/mne_surface_old.h>
 
 #include <fwd/fwd_comp_data.h>
+#include <mne/c/mne_ctf_comp_data_set.h>
 
 #include <Eigen/Dense>
 
@@ -21,6 +22,10 @@
 #include <QFile>
 #include <QCoreApplication>
 #include <QDebug>
+#include <QVector>
+#include <QPair>
+
+#include <algorithm>
 
 
 
@@ -3838,6 +3843,158 @@ DipoleFitData::~DipoleFitData()
 }
 
 
+//*************************************************************************************************************
+
+static dipoleFitFuncs dup_dipole_fit_funcs(dipoleFitFuncs f, DipoleFitData* orig, DipoleFitData* dup)
+/*
+ * Duplicate the forward calculation functions for a thread duplicate of the fitting data.
+ * The compensation data and the forward models carry workspaces and must be private,
+ * the coil definitions and the solution matrices are shared.
+ */
+{
+    dipoleFitFuncs res;
+    FwdCompData*   orig_comp;
+    FwdCompData*   comp;
+
+    if (!f)
+        return NULL;
+    res  = new_dipole_fit_funcs();
+    *res = *f;
+    if (f->meg_client) {
+        orig_comp = (FwdCompData*)f->meg_client;
+        comp      = new FwdCompData;
+        *comp          = *orig_comp;
+        comp->work     = NULL;
+        comp->vec_work = NULL;
+        comp->set      = orig_comp->set ? new MneCTFCompDataSet(*(orig_comp->set)) : NULL;
+        if (orig_comp->client == orig->bem_model)
+            comp->client = dup->bem_model;
+        res->meg_client = comp;
+    }
+    if (f->eeg_client == orig->bem_model)
+        res->eeg_client = dup->bem_model;
+    else if (f->eeg_client == orig->eeg_model)
+        res->eeg_client = dup->eeg_model;
+    res->meg_client_free = NULL;
+    res->eeg_client_free = NULL;
+    return res;
+}
+
+
+//*************************************************************************************************************
+
+static void free_dup_dipole_fit_funcs(dipoleFitFuncs f)
+{
+    FwdCompData* comp;
+
+    if (!f)
+        return;
+    if ((comp = (FwdCompData*)f->meg_client) != NULL) {
+        /*
+         * Only the compensation set and the workspaces belong to the duplicate
+         */
+        comp->comp_coils  = NULL;
+        comp->client      = NULL;
+        comp->client_free = NULL;
+        delete comp;
+    }
+    FREE_3(f);
+    return;
+}
+
+
+//*************************************************************************************************************
+
+DipoleFitData* DipoleFitData::create_thread_duplicate(DipoleFitData* d)
+{
+    DipoleFitData* res = new DipoleFitData;
+
+    res->mri_head_t      = d->mri_head_t;
+    res->meg_head_t      = d->meg_head_t;
+    res->coord_frame     = d->coord_frame;
+    res->chs             = d->chs;
+    res->nmeg            = d->nmeg;
+    res->neeg            = d->neeg;
+    res->ch_names        = d->ch_names;
+    res->pick            = d->pick;
+    res->meg_coils       = d->meg_coils;
+    res->eeg_els         = d->eeg_els;
+    VEC_COPY_3(res->r0,d->r0);
+    res->bemname         = d->bemname;
+    res->fixed_noise     = d->fixed_noise;
+    res->noise_orig      = d->noise_orig;
+    res->noise           = d->noise;
+    res->nave            = d->nave;
+    res->proj            = d->proj;
+    res->column_norm     = d->column_norm;
+    res->fit_mag_dipoles = d->fit_mag_dipoles;
+    /*
+     * The forward models hold workspaces which are filled in during the computations
+     */
+    if (d->eeg_model)
+        res->eeg_model = new FwdEegSphereModel(*d->eeg_model);
+    if (d->bem_model) {
+        res->bem_model     = new FwdBemModel;
+        *res->bem_model    = *d->bem_model;
+        res->bem_model->v0 = NULL;
+    }
+    res->sphere_funcs     = dup_dipole_fit_funcs(d->sphere_funcs,d,res);
+    res->bem_funcs        = dup_dipole_fit_funcs(d->bem_funcs,d,res);
+    res->mag_dipole_funcs = dup_dipole_fit_funcs(d->mag_dipole_funcs,d,res);
+    if (d->funcs == d->bem_funcs)
+        res->funcs = res->bem_funcs;
+    else if (d->funcs == d->mag_dipole_funcs)
+        res->funcs = res->mag_dipole_funcs;
+    else
+        res->funcs = res->sphere_funcs;
+
+    return res;
+}
+
+
+//*************************************************************************************************************
+
+void DipoleFitData::free_thread_duplicate(DipoleFitData* d)
+{
+    FwdBemModel* bem;
+
+    if (!d)
+        return;
+    free_dup_dipole_fit_funcs(d->sphere_funcs);
+    free_dup_dipole_fit_funcs(d->bem_funcs);
+    free_dup_dipole_fit_funcs(d->mag_dipole_funcs);
+    d->sphere_funcs = d->bem_funcs = d->mag_dipole_funcs = d->funcs = NULL;
+
+    if ((bem = d->bem_model) != NULL) {
+        /*
+         * Release everything but the private workspace which goes with the solution
+         */
+        bem->surfs.clear();
+        bem->nsurf       = 0;
+        bem->ntri        = NULL;
+        bem->np          = NULL;
+        bem->sigma       = NULL;
+        bem->gamma       = NULL;
+        bem->source_mult = NULL;
+        bem->field_mult  = NULL;
+        bem->solution    = NULL;
+        bem->head_mri_t  = NULL;
+    }
+    d->mri_head_t = NULL;
+    d->meg_head_t = NULL;
+    d->chs        = NULL;
+    d->pick       = NULL;
+    d->meg_coils  = NULL;
+    d->eeg_els    = NULL;
+    d->noise_orig = NULL;
+    d->noise      = NULL;
+    d->proj       = NULL;
+    d->user       = NULL;
+    d->user_free  = NULL;
+    delete d;
+}
+
+
 //*************************************************************************************************************
 
 int DipoleFitData::setup_forward_model(DipoleFitData *d, MneCTFCompDataSet* comp_data, FwdCoilSet *comp_coils)
@@ -3904,7 +4061,7 @@ int DipoleFitData::setup_forward_model(DipoleFitData *d, MneCTFCompDataSet* comp
            * It works the same way independent of whether or not the compensation is in effect
            */
             comp = FwdCompData::fwd_make_comp_data(comp_data,d->meg_coils,comp_coils,
-                                      FwdBemModel::fwd_bem_field,NULL,NULL,d->bem_model,NULL);
+                                      FwdBemModel::fwd_bem_field,FwdBemModel::fwd_bem_field_vec,NULL,d->bem_model,NULL);
             if (!comp)
                 goto out;
             printf("Compensation setup done.\n");
@@ -3917,7 +4074,7 @@ int DipoleFitData::setup_forward_model(DipoleFitData *d, MneCTFCompDataSet* comp
             printf("[done]\n");
 
             f->meg_field       = FwdCompData::fwd_comp_field;
-            f->meg_vec_field   = NULL;
+            f->meg_vec_field   = FwdCompData::fwd_comp_field_vec;
             f->meg_client      = comp;
             f->meg_client_free = FwdCompData::fwd_free_comp_data;
         }
@@ -4773,9 +4930,29 @@ static float fit_eval(float *rd,int npar,void *user)
 
 
 
+static double guess_goodness(float *B, int nch, double B2, DipoleForward* fwd, float limit)
+/*
+ * Goodness of fit of the best dipole at a guess location
+ */
+{
+    double Bm2,one;
+    int    c,ncomp;
+
+    if (fwd->nch != nch)
+        return -1.0;
+    ncomp = fwd->sing[2]/fwd->sing[0] > limit ? 3 : 2;
+    for (c = 0, Bm2 = 0.0; c < ncomp; c++) {
+        one = mne_dot_vectors_3(fwd->uu[c],B,nch);
+        Bm2 = Bm2 + one*one;
+    }
+    return 1.0 - (B2 - Bm2)/B2;
+}
+
+
 static int find_best_guess(float     *B,         /* The whitened data */
                            int       nch,
                            GuessData* guess,	 /* Guesses */
+                           DipoleFitData* fit,   /* For computing the fields of the fine guesses */
                            float     limit,	 /* Pseudoradial component omission limit */
                            int       *bestp,	 /* Which is the best */
                            float     *goodp)	 /* Best goodness of fit */
@@ -4783,29 +4960,57 @@ static int find_best_guess(float     *B,         /* The whitened data */
  * Thanks to the precomputed SVD everything is really simple
  */
 {
-    int    k,c;
-    double B2,Bm2,this_good,one;
+    int    k,j;
+    double B2,this_good;
     int    best = -1;
     float  good = 0.0;
     DipoleForward* fwd;
-    int    ncomp;
+    QSharedPointer<DipoleForward> fine;
 
     B2 = mne_dot_vectors_3(B,B,nch);
-    for (k = 0; k < guess->nguess; k++) {
-        fwd = guess->guess_fwd[k];
-        if (fwd->nch == nch) {
-            ncomp = fwd->sing[2]/fwd->sing[0] > limit ? 3 : 2;
-            for (c = 0, Bm2 = 0.0; c < ncomp; c++) {
-                one = mne_dot_vectors_3(fwd->uu[c],B,nch);
-                Bm2 = Bm2 + one*one;
-            }
-            this_good = 1.0 - (B2 - Bm2)/B2;
+    if (guess->coarse.isEmpty()) {
+        for (k = 0; k < guess->nguess; k++) {
+            this_good = guess_goodness(B,nch,B2,guess->guess_fwd[k],limit);
             if (this_good > good) {
                 best = k;
                 good = this_good;
             }
         }
     }
+    else {
+        /*
+         * Scan the coarse grid first and keep the best few cells
+         */
+        QVector<QPair<double,int> > cells;
+        QVector<int>                cand;
+
+        for (j = 0; j < guess->coarse.size(); j++) {
+            fwd = guess->guess_fwd[guess->coarse[j]];
+            cells.append(qMakePair(guess_goodness(B,nch,B2,fwd,limit),j));
+        }
+        k = qMin(NCOARSE_CANDIDATE,cells.size());
+        std::partial_sort(cells.begin(),cells.begin()+k,cells.end(),
+                          [](const QPair<double,int>& a, const QPair<double,int>& b) { return a.first > b.first; });
+        /*
+         * Then go through all guesses around them in the original order
+         */
+        for (j = 0; j < k; j++)
+            cand += guess->coarse_near[cells[j].second];
+        std::sort(cand.begin(),cand.end());
+        cand.erase(std::unique(cand.begin(),cand.end()),cand.end());
+        for (j = 0; j < cand.size(); j++) {
+            if ((fwd = guess->guess_fwd[cand[j]]) == NULL) {
+                if ((fine = guess->guess_forward(cand[j],fit)).isNull())
+                    return FAIL;
+                fwd = fine.data();
+            }
+            this_good = guess_goodness(B,nch,B2,fwd,limit);
+            if (this_good > good) {
+                best = cand[j];
+                good = this_good;
+            }
+        }
+    }
     if (best < 0) {
         printf("No reasonable initial guess found.");
         return FAIL;
@@ -5148,7 +5353,7 @@ bool DipoleFitData::fit_one(DipoleFitData* fit,	            /* Precomputed fitti
     /*
    * Get the initial guess
    */
-    if (find_best_guess(B,nchan,guess,limit,&best,&good) < 0)
+    if (find_best_guess(B,nchan,guess,fit,limit,&best,&good) < 0)
         goto bad;
 
 
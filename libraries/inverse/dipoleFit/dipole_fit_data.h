@@ -214,6 +214,26 @@ public:
     */
     static bool fit_one(DipoleFitData* fit, GuessData* guess, float time, float *B, int verbose, ECD& res);
 
+    //=========================================================================================================
+    /**
+    * Create a duplicate of the fitting data which can be used concurrently with the original.
+    * The coil definitions, the noise covariance, the projection and the BEM solution are shared,
+    * the forward calculation functions get private workspaces.
+    *
+    * @param[in] d          The fitting data to duplicate
+    *
+    * @return the duplicate, to be released with free_thread_duplicate.
+    */
+    static DipoleFitData* create_thread_duplicate(DipoleFitData* d);
+
+    //=========================================================================================================
+    /**
+    * Free a duplicate created with create_thread_duplicate without touching the shared data
+    *
+    * @param[in] d          The duplicate to free
+    */
+    static void free_thread_duplicate(DipoleFitData* d);
+
 
 
 //============================= dipole_forward.c
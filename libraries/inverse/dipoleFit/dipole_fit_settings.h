@@ -148,6 +148,7 @@ float guess_rad;       			/**< Radius of spherical guess surface */
     float guess_mindist;       		/**< Minimum allowed distance to the surface */
     float guess_exclude;       		/**< Exclude points closer than this to the origin */
     float guess_grid;       		/**< Grid spacing */
+    float guess_coarse_grid;   		/**< Coarse grid spacing for the hierarchical guess search (0 = scan all guesses) */
 
     QString noisename;                  /**< Noise-covariance matrix */
     float grad_std;        		/**< Standard deviations to be used if noise covariance is not specified */
@@ -47,7 +47,13 @@
 #include <fiff/fiff_stream.h>
 #include <fiff/fiff_tag.h>
 
+#include <math.h>
+#include <algorithm>
+#include <functional>
+
 #include <QFile>
+#include <QHash>
+#include <QMutexLocker>
 
 
 //*************************************************************************************************************
@@ -89,6 +95,10 @@ using namespace INVERSELIB;
 #define Z_16 2
 
 
+#define SQR_16(x) ((x)*(x))
+
+#define CELL_KEY_16(x,y,z) ((((qint64)(x)+1) << 42) | (((qint64)(y)+1) << 21) | ((qint64)(z)+1))
+
 #define VEC_COPY_16(to,from) {\
     (to)[X_16] = (from)[X_16];\
     (to)[Y_16] = (from)[Y_16];\
@@ -211,7 +221,7 @@ GuessData::GuessData()
 
 //*************************************************************************************************************
 
-GuessData::GuessData(const QString &guessname, const QString &guess_surfname, float mindist, float exclude, float grid, DipoleFitData *f)
+GuessData::GuessData(const QString &guessname, const QString &guess_surfname, float mindist, float exclude, float grid, DipoleFitData *f, float coarse_grid)
 {
     MneSourceSpaceOld* *sp = NULL;
     int            nsp = 0;
@@ -219,7 +229,6 @@ GuessData::GuessData(const QString &guessname, const QString &guess_surfname, fl
     int            k,p;
     float          guessrad = 0.080;
     MneSourceSpaceOld* guesses = NULL;
-    dipoleFitFuncs orig;
 
     if (!guessname.isEmpty()) {
         /*
@@ -272,30 +281,16 @@ GuessData::GuessData(const QString &guessname, const QString &guess_surfname, fl
         }
     delete guesses; guesses = NULL;
 
-    fprintf(stderr,"Go through all guess source locations...");
     this->guess_fwd = MALLOC_16(this->nguess,DipoleForward*);
     for (k = 0; k < this->nguess; k++)
         this->guess_fwd[k] = NULL;
+    if (coarse_grid > 0.0 && !this->setup_coarse_grid(coarse_grid))
+        goto bad;
     /*
         * Compute the guesses using the sphere model for speed
         */
-    orig = f->funcs;
-    if (f->fit_mag_dipoles)
-        f->funcs = f->mag_dipole_funcs;
-    else
-        f->funcs = f->sphere_funcs;
-
-    for (k = 0; k < this->nguess; k++) {
-        if ((this->guess_fwd[k] = DipoleFitData::dipole_forward_one(f,this->rr[k],NULL)) == NULL)
-            goto bad;
-#ifdef DEBUG
-        sing = this->guess_fwd[k]->sing;
-        printf("%f %f %f\n",sing[0],sing[1],sing[2]);
-#endif
-    }
-    f->funcs = orig;
-
-    fprintf(stderr,"[done %d sources]\n",p);
+    if (!this->compute_guess_fields(f))
+        goto bad;
 
     return;
 //    return res;
@@ -312,7 +307,7 @@ bad : {
 
 //*************************************************************************************************************
 
-GuessData::GuessData(const QString &guessname, const QString &guess_surfname, float mindist, float exclude, float grid, DipoleFitData *f, char *guess_save_name)
+GuessData::GuessData(const QString &guessname, const QString &guess_surfname, float mindist, float exclude, float grid, DipoleFitData *f, char *guess_save_name, float coarse_grid)
 {
     MneSourceSpaceOld* *sp = NULL;
     int             nsp = 0;
@@ -395,6 +390,8 @@ GuessData::GuessData(const QString &guessname, const QString &guess_surfname, fl
     this->guess_fwd = MALLOC_16(this->nguess,DipoleForward*);
     for (k = 0; k < this->nguess; k++)
         this->guess_fwd[k] = NULL;
+    if (coarse_grid > 0.0 && !this->setup_coarse_grid(coarse_grid))
+        goto bad;
     /*
         * Compute the guesses using the sphere model for speed
         */
@@ -433,6 +430,7 @@ GuessData::~GuessData()
 bool GuessData::compute_guess_fields(DipoleFitData* f)
 {
     dipoleFitFuncs orig = NULL;
+    int            ncompute,k;
 
     if (!f) {
         qCritical("Data missing in compute_guess_fields");
@@ -442,13 +440,21 @@ bool GuessData::compute_guess_fields(DipoleFitData* f)
         qCritical("Noise covariance missing in compute_guess_fields");
         return false;
     }
-    printf("Go through all guess source locations...");
+    /*
+     * With a coarse grid only its representatives are needed now
+     */
+    ncompute = this->coarse.isEmpty() ? this->nguess : this->coarse.size();
+    if (this->coarse.isEmpty())
+        printf("Go through all guess source locations...");
+    else
+        printf("Go through the coarse grid guess source locations...");
     orig = f->funcs;
     if (f->fit_mag_dipoles)
         f->funcs = f->mag_dipole_funcs;
     else
         f->funcs = f->sphere_funcs;
-    for (int k = 0; k < this->nguess; k++) {
+    for (int j = 0; j < ncompute; j++) {
+        k = this->coarse.isEmpty() ? j : this->coarse[j];
         if ((this->guess_fwd[k] = DipoleFitData::dipole_forward_one(f,this->rr[k],this->guess_fwd[k])) == NULL){
             if (orig)
                 f->funcs = orig;
@@ -460,7 +466,122 @@ bool GuessData::compute_guess_fields(DipoleFitData* f)
 #endif
     }
     f->funcs = orig;
-    printf("[done %d sources]\n",this->nguess);
+    printf("[done %d sources]\n",ncompute);
 
     return true;
 }
+
+
+//*************************************************************************************************************
+
+bool GuessData::setup_coarse_grid(float coarse_grid)
+{
+    QHash<qint64,QVector<int> > cells;
+    QHash<qint64,int>           rep;
+    QVector<qint64>             cell_of(this->nguess);
+    float                       rmin[3],dist,best;
+    int                         ix[3],k,c,dx,dy,dz;
+
+    this->coarse.clear();
+    this->coarse_near.clear();
+    this->fine_fwd.clear();
+    if (coarse_grid <= 0.0 || this->nguess <= 0)
+        return true;
+    /*
+     * Assign each guess to a cell of the coarse grid
+     */
+    VEC_COPY_16(rmin,this->rr[0]);
+    for (k = 1; k < this->nguess; k++)
+        for (c = 0; c < 3; c++)
+            rmin[c] = qMin(rmin[c],this->rr[k][c]);
+    for (k = 0; k < this->nguess; k++) {
+        for (c = 0; c < 3; c++)
+            ix[c] = (int)floor((this->rr[k][c]-rmin[c])/coarse_grid);
+        cell_of[k] = CELL_KEY_16(ix[X_16],ix[Y_16],ix[Z_16]);
+        cells[cell_of[k]].append(k);
+        /*
+         * The guess closest to the cell center represents the cell
+         */
+        for (c = 0, dist = 0.0; c < 3; c++)
+            dist += SQR_16(this->rr[k][c] - rmin[c] - (ix[c]+0.5f)*coarse_grid);
+        if (rep.contains(cell_of[k])) {
+            int   r = rep[cell_of[k]];
+            for (c = 0, best = 0.0; c < 3; c++)
+                best += SQR_16(this->rr[r][c] - rmin[c] - (ix[c]+0.5f)*coarse_grid);
+            if (dist < best)
+                rep[cell_of[k]] = k;
+        }
+        else
+            rep[cell_of[k]] = k;
+    }
+    /*
+     * The neighborhood of a cell includes the adjacent cells so that
+     * the optimum is found even if it lies close to a cell boundary
+     */
+    for (k = 0; k < this->nguess; k++) {
+        if (rep[cell_of[k]] != k)
+            continue;
+        for (c = 0; c < 3; c++)
+            ix[c] = (int)floor((this->rr[k][c]-rmin[c])/coarse_grid);
+        QVector<int> nearby;
+        for (dx = -1; dx <= 1; dx++)
+            for (dy = -1; dy <= 1; dy++)
+                for (dz = -1; dz <= 1; dz++) {
+                    qint64 key = CELL_KEY_16(ix[X_16]+dx,ix[Y_16]+dy,ix[Z_16]+dz);
+                    if (cells.contains(key))
+                        nearby += cells[key];
+                }
+        this->coarse.append(k);
+        this->coarse_near.append(nearby);
+    }
+    /*
+     * The cache holds the guesses of the largest neighborhoods which are scanned for one time point
+     */
+    QVector<int> sizes;
+    for (k = 0; k < this->coarse_near.size(); k++)
+        sizes.append(this->coarse_near[k].size());
+    std::sort(sizes.begin(),sizes.end(),std::greater<int>());
+    int max_cost = 0;
+    for (k = 0; k < qMin(NCOARSE_CANDIDATE,sizes.size()); k++)
+        max_cost += sizes[k];
+    this->fine_fwd.setMaxCost(qMax(1,qMin(max_cost,this->nguess-this->coarse.size())));
+    printf("%d guesses grouped into %d coarse grid cells of %6.1f mm, at most %d other fields are cached.\n",
+           this->nguess,this->coarse.size(),1000*coarse_grid,this->fine_fwd.maxCost());
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+QSharedPointer<DipoleForward> GuessData::guess_forward(int k, DipoleFitData* f)
+{
+    QSharedPointer<DipoleForward> fwd;
+    dipoleFitFuncs orig;
+
+    fwd_mutex.lock();
+    if (QSharedPointer<DipoleForward>* cached = this->fine_fwd.object(k))
+        fwd = *cached;
+    fwd_mutex.unlock();
+    if (fwd)
+        return fwd;
+    /*
+     * Compute the field with the same model as the precomputed ones.
+     * Another thread may be working on the same guess, the first result is kept.
+     */
+    orig = f->funcs;
+    if (f->fit_mag_dipoles)
+        f->funcs = f->mag_dipole_funcs;
+    else
+        f->funcs = f->sphere_funcs;
+    fwd = QSharedPointer<DipoleForward>(DipoleFitData::dipole_forward_one(f,this->rr[k],NULL));
+    f->funcs = orig;
+    if (!fwd)
+        return fwd;
+
+    QMutexLocker locker(&fwd_mutex);
+    if (QSharedPointer<DipoleForward>* cached = this->fine_fwd.object(k))
+        fwd = *cached;
+    else
+        this->fine_fwd.insert(k,new QSharedPointer<DipoleForward>(fwd));
+    return fwd;
+}
@@ -59,6 +59,9 @@
 //=============================================================================================================
 
 #include <QSharedPointer>
+#include <QVector>
+#include <QMutex>
+#include <QCache>
 
 
 //*************************************************************************************************************
@@ -77,6 +80,14 @@ namespace INVERSELIB
 class DipoleFitData;
 
 
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINES
+//=============================================================================================================
+
+#define NCOARSE_CANDIDATE 4     /* How many coarse grid cells are refined when looking for the initial guess */
+
+
 //=============================================================================================================
 /**
 * Implements GuessData (Replaces *guessData,guessDataRec struct of MNE-C fit_types.h).
@@ -110,9 +121,16 @@ public:
     * Refactored: make_guess_data (setup.c)
     *
     * @param[in] guessname
+    * @param[in] guess_surfname
+    * @param[in] mindist
+    * @param[in] exclude
+    * @param[in] grid
+    * @param[in] f
+    * @param[in] coarse_grid    Spacing of the coarse search grid, the fields of the other guesses are computed on demand (0 = scan all guesses).
+    *                           This is an approximate search, see setup_coarse_grid.
     *
     */
-    GuessData( const QString& guessname, const QString& guess_surfname, float mindist, float exclude, float grid, DipoleFitData* f);
+    GuessData( const QString& guessname, const QString& guess_surfname, float mindist, float exclude, float grid, DipoleFitData* f, float coarse_grid = 0.0f);
 
     //=========================================================================================================
     /**
@@ -122,7 +140,7 @@ public:
     * @param[in] guessname
     *
     */
-    GuessData( const QString& guessname, const QString& guess_surfname, float mindist, float exclude, float grid, DipoleFitData* f, char *guess_save_name);
+    GuessData( const QString& guessname, const QString& guess_surfname, float mindist, float exclude, float grid, DipoleFitData* f, char *guess_save_name, float coarse_grid = 0.0f);
 
 
 
@@ -144,11 +162,47 @@ public:
     */
     bool compute_guess_fields(DipoleFitData* f);
 
+    //=========================================================================================================
+    /**
+    * Group the guesses into cells of a coarse grid. One guess per cell represents it in the initial scan,
+    * the guesses in the neighborhood of the NCOARSE_CANDIDATE best cells are scanned next. The search is
+    * approximate: if the best guess of the exhaustive scan lies outside of these neighborhoods, another
+    * initial guess is chosen and the fit may end in a different local optimum.
+    * The fields of the representatives are kept. The fields of the other guesses are held in a cache which is
+    * bounded by the largest number of guesses scanned for one time point.
+    *
+    * @param[in] coarse_grid    Spacing of the coarse grid
+    *
+    * @return true when successful
+    */
+    bool setup_coarse_grid(float coarse_grid);
+
+    //=========================================================================================================
+    /**
+    * Return the forward solution of a guess which is not precomputed in guess_fwd and compute it first if it
+    * is not in the cache. The solution stays valid as long as the returned pointer is held, even if it is
+    * dropped from the cache in the meantime.
+    * This may be called from several threads, each with its own fitting data.
+    *
+    * @param[in] k      Index of the guess
+    * @param[in] f      Dipole Fit Data to compute the field with
+    *
+    * @return the forward solution or a null pointer if the computation failed
+    */
+    QSharedPointer<DipoleForward> guess_forward(int k, DipoleFitData* f);
+
 public:
     float          **rr;            /**< These are the guess dipole locations */
-    DipoleForward** guess_fwd;      /**< Forward solutions for the guesses */
+    DipoleForward** guess_fwd;      /**< Forward solutions for the guesses (only the coarse grid representatives if a coarse grid is used) */
     int            nguess;          /**< How many sources */
 
+    QVector<int>           coarse;       /**< Guesses representing the coarse grid cells (empty = scan all guesses) */
+    QVector<QVector<int> > coarse_near;  /**< Guesses within the neighborhood of each coarse grid cell */
+
+private:
+    QMutex         fwd_mutex;       /**< Protects the forward solutions computed on demand */
+    QCache<int,QSharedPointer<DipoleForward> > fine_fwd;  /**< Bounded cache of the forward solutions computed on demand */
+
 // ### OLD STRUCT ###
 //    typedef struct {
 //        float          **rr;                    /**< These are the guess dipole locations */
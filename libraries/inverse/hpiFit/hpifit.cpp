@@ -83,6 +83,23 @@ using namespace FIFFLIB;
 // DEFINE GLOBAL METHODS
 //=============================================================================================================
 
+static MatrixXd pickInnerProjector(const MatrixXd& matProjectors, const QVector<int>& innerind)
+{
+    //Create new projector based on the excluded channels, first exclude the rows then the columns
+    MatrixXd matProjectorsRows(innerind.size(),matProjectors.cols());
+    MatrixXd matProjectorsInnerind(innerind.size(),innerind.size());
+
+    for (int i = 0; i < matProjectorsRows.rows(); ++i) {
+        matProjectorsRows.row(i) = matProjectors.row(innerind.at(i));
+    }
+
+    for (int i = 0; i < matProjectorsInnerind.cols(); ++i) {
+        matProjectorsInnerind.col(i) = matProjectorsRows.col(innerind.at(i));
+    }
+
+    return matProjectorsInnerind;
+}
+
 
 //*************************************************************************************************************
 //=============================================================================================================
@@ -90,6 +107,8 @@ using namespace FIFFLIB;
 //=============================================================================================================
 
 HPIFit::HPIFit()
+: m_bSetupValid(false)
+, m_iNumSamples(0)
 {
 
 }
@@ -121,7 +140,6 @@ void HPIFit::fitHPI(const MatrixXd& t_mat,
 
     struct SensorInfo sensors;
     struct CoilParam coil;
-    int numCh = pFiffInfo->nchan;
     int samF = pFiffInfo->sfreq;
     int samLoc = t_mat.cols(); // minimum samples required to localize numLoc times in a second
 
@@ -155,44 +173,270 @@ void HPIFit::fitHPI(const MatrixXd& t_mat,
     coil.dpfiterror = Eigen::VectorXd::Zero(numCoils);
     coil.dpfitnumitr = Eigen::VectorXd::Zero(numCoils);
 
-    // Generate simulated data
-    Eigen::MatrixXd simsig(samLoc,numCoils*2);
-    Eigen::VectorXd time(samLoc);
+    // Create digitized HPI coil position matrix
+    Eigen::MatrixXd headHPI = Eigen::MatrixXd::Zero(numCoils,3);
 
-    for (int i = 0; i < samLoc; ++i) {
-        time[i] = i*1.0/samF;
+    // check the pFiffInfo->dig information. If dig is empty, set the headHPI is 0;
+    for (int i = 0; i < lHPIPoints.size(); ++i) {
+        headHPI(i,0) = lHPIPoints.at(i).r[0];
+        headHPI(i,1) = lHPIPoints.at(i).r[1];
+        headHPI(i,2) = lHPIPoints.at(i).r[2];
     }
 
-    for(int i = 0; i < numCoils; ++i) {
-        for(int j = 0; j < samLoc; ++j) {
-            simsig(j,i) = sin(2*M_PI*coilfreq[i]*time[j]);
-            simsig(j,i+numCoils) = cos(2*M_PI*coilfreq[i]*time[j]);
-        }
+    // Get the indices of inner layer channels and exclude bad channels.
+    QVector<int> innerind(0);
+    getSensors(pFiffInfo, innerind, sensors);
+
+    //Create new projector based on the excluded channels
+    MatrixXd matProjectorsInnerind = pickInnerProjector(t_matProjectors, innerind);
+
+    //UTILSLIB::IOUtils::write_eigen_matrix(matProjectorsInnerind, "matProjectorsInnerind.txt");
+    //UTILSLIB::IOUtils::write_eigen_matrix(t_matProjectors, "t_matProjectors.txt");
+
+    // Get the data from inner layer channels
+    Eigen::MatrixXd innerdata(innerind.size(), t_mat.cols());
+
+    for(int j = 0; j < innerind.size(); ++j) {
+        innerdata.row(j) << t_mat.row(innerind[j]);
     }
 
-    // Create digitized HPI coil position matrix
-    Eigen::MatrixXd headHPI(numCoils,3);
+    // Calculate topo and select sine or cosine component
+    Eigen::MatrixXd amp = demodulate(innerdata, computeDemodulation(coilfreq, samF, samLoc), numCoils);
 
-    // check the pFiffInfo->dig information. If dig is empty, set the headHPI is 0;
-    if (lHPIPoints.size() > 0) {
-        for (int i = 0; i < lHPIPoints.size(); ++i) {
-            headHPI(i,0) = lHPIPoints.at(i).r[0];
-            headHPI(i,1) = lHPIPoints.at(i).r[1];
-            headHPI(i,2) = lHPIPoints.at(i).r[2];
+    //Find good seed point/starting point for the coil position in 3D space
+    VectorXi chIdcs(numCoils);
+    Eigen::MatrixXd coilPos = getSeedPositions(amp, innerind, pFiffInfo, chIdcs);
+
+    coil.pos = coilPos;
+
+    coil = dipfit(coil, sensors, amp, numCoils, matProjectorsInnerind);
+
+    // Store the final result
+    MatrixXd diffPos = storeResult(coil.pos, headHPI, transDevHead, vGof, fittedPointSet);
+
+    if(bDoDebug) {
+        Eigen::Matrix4d trans = computeTransformation(headHPI, coil.pos);
+
+        MatrixXd temp = coil.pos;
+        temp.conservativeResize(coil.pos.rows(),coil.pos.cols()+1);
+
+        temp.block(0,3,numCoils,1).setOnes();
+        temp.transposeInPlace();
+
+        MatrixXd testPos = trans * temp;
+
+        // DEBUG HPI fitting and write debug results
+        std::cout << std::endl << std::endl << "HPIFit::fitHPI - dpfiterror" << coil.dpfiterror << std::endl << coil.pos << std::endl;
+        std::cout << std::endl << std::endl << "HPIFit::fitHPI - Initial seed point for HPI coils" << std::endl << coil.pos << std::endl;
+        std::cout << std::endl << std::endl << "HPIFit::fitHPI - temp" << std::endl << temp << std::endl;
+        std::cout << std::endl << std::endl << "HPIFit::fitHPI - testPos" << std::endl << testPos << std::endl;
+        std::cout << std::endl << std::endl << "HPIFit::fitHPI - Diff fitted - original" << std::endl << diffPos << std::endl;
+        std::cout << std::endl << std::endl << "HPIFit::fitHPI - dev/head trans" << std::endl << trans << std::endl;
+
+        QString sTimeStamp = QDateTime::currentDateTime().toString("yyMMdd_hhmmss");
+
+        if(!QDir(sHPIResourceDir).exists()) {
+            QDir().mkdir(sHPIResourceDir);
         }
-    } else {
-        for (int i = 0; i < numCoils; ++i) {
-            headHPI(i,0) = 0;
-            headHPI(i,1) = 0;
-            headHPI(i,2) = 0;
+
+        UTILSLIB::IOUtils::write_eigen_matrix(coilPos, QString("%1/%2_coilPosSeed_mat").arg(sHPIResourceDir).arg(sTimeStamp));
+
+        UTILSLIB::IOUtils::write_eigen_matrix(coil.pos, QString("%1/%2_coilPos_mat").arg(sHPIResourceDir).arg(sTimeStamp));
+
+        UTILSLIB::IOUtils::write_eigen_matrix(headHPI, QString("%1/%2_headHPI_mat").arg(sHPIResourceDir).arg(sTimeStamp));
+
+        MatrixXd testPosCut = testPos.transpose();//block(0,0,3,4);
+        UTILSLIB::IOUtils::write_eigen_matrix(testPosCut, QString("%1/%2_testPos_mat").arg(sHPIResourceDir).arg(sTimeStamp));
+
+        MatrixXi idx_mat(chIdcs.rows(),1);
+        idx_mat.col(0) = chIdcs;
+        UTILSLIB::IOUtils::write_eigen_matrix(idx_mat, QString("%1/%2_idx_mat").arg(sHPIResourceDir).arg(sTimeStamp));
+
+        MatrixXd coilFreq_mat(coilfreq.rows(),1);
+        coilFreq_mat.col(0) = coilfreq;
+        UTILSLIB::IOUtils::write_eigen_matrix(coilFreq_mat, QString("%1/%2_coilFreq_mat").arg(sHPIResourceDir).arg(sTimeStamp));
+
+        UTILSLIB::IOUtils::write_eigen_matrix(diffPos, QString("%1/%2_diffPos_mat").arg(sHPIResourceDir).arg(sTimeStamp));
+
+        UTILSLIB::IOUtils::write_eigen_matrix(amp, QString("%1/%2_amp_mat").arg(sHPIResourceDir).arg(sTimeStamp));
+    }
+}
+
+
+//*************************************************************************************************************
+
+void HPIFit::fit(const Eigen::MatrixXd& t_mat,
+                 const Eigen::MatrixXd& t_matProjectors,
+                 FiffCoordTrans& transDevHead,
+                 const QVector<int>& vFreqs,
+                 QVector<double>& vGof,
+                 FiffDigPointSet& fittedPointSet,
+                 FiffInfo::SPtr pFiffInfo)
+{
+    vGof.clear();
+
+    //Check if data was passed
+    if(t_mat.rows() == 0 || t_mat.cols() == 0 || !pFiffInfo) {
+        std::cout<<std::endl<< "HPIFit::fit - No data passed. Returning.";
+        return;
+    }
+
+    if(!updateSetup(t_matProjectors, vFreqs, t_mat.cols(), pFiffInfo)) {
+        return;
+    }
+
+    int numCoils = m_matHeadHPI.rows();
+
+    // Get the data from inner layer channels and demodulate
+    Eigen::MatrixXd innerdata(m_vInnerInd.size(), t_mat.cols());
+
+    for(int j = 0; j < m_vInnerInd.size(); ++j) {
+        innerdata.row(j) = t_mat.row(m_vInnerInd[j]);
+    }
+
+    Eigen::MatrixXd amp = demodulate(innerdata, m_matDemod, numCoils);
+
+    VectorXi chIdcs(numCoils);
+    Eigen::MatrixXd seedPos = getSeedPositions(amp, m_vInnerInd, pFiffInfo, chIdcs);
+
+    if(m_matCoilPos.rows() != numCoils) {
+        m_matCoilPos = seedPos;
+    }
+
+    //Fit all coils concurrently, the sensor geometry and projector are shared and not copied
+    QVector<int> vCoils;
+    for(int i = 0; i < numCoils; ++i) {
+        vCoils.append(i);
+    }
+
+    Eigen::MatrixXd coilPos = m_matCoilPos;
+    const SensorInfo& sensors = m_sensors;
+    const Eigen::MatrixXd& matProjectors = m_matProjectorsInnerind;
+
+    QtConcurrent::blockingMap(vCoils, [&](int i) {
+        Eigen::VectorXd sensorData = amp.col(i);
+
+        // Warm start from the previous position, unless the maximal amplitude gives a better start (coil moved
+        // a lot or the previous fit failed)
+        Eigen::RowVectorXd warmPos = coilPos.row(i);
+        Eigen::RowVectorXd seed = seedPos.row(i);
+
+        DipFitError warmFit = HPIFitData::dipfitLevenbergMarquardt(warmPos, sensorData, sensors, matProjectors, 0);
+        DipFitError seedFit = HPIFitData::dipfitLevenbergMarquardt(seed, sensorData, sensors, matProjectors, 0);
+
+        Eigen::RowVectorXd pos = warmFit.error <= seedFit.error ? warmPos : seed;
+        HPIFitData::dipfitLevenbergMarquardt(pos, sensorData, sensors, matProjectors);
+
+        coilPos.row(i) = pos;
+    });
+
+    m_matCoilPos = coilPos;
+
+    storeResult(m_matCoilPos, m_matHeadHPI, transDevHead, vGof, fittedPointSet);
+}
+
+
+//*************************************************************************************************************
+
+void HPIFit::reset()
+{
+    m_bSetupValid = false;
+    m_pFiffInfo.reset();
+    m_matCoilPos.resize(0,0);
+}
+
+
+//*************************************************************************************************************
+
+bool HPIFit::updateSetup(const Eigen::MatrixXd& t_matProjectors,
+                         const QVector<int>& vFreqs,
+                         int iNumSamples,
+                         FiffInfo::SPtr pFiffInfo)
+{
+    //Get HPI coils from digitizers. The digitizer points can be changed in place (e.g. by loading a new
+    //Polhemus file), so they are read on every call.
+    QList<FiffDigPoint> lHPIPoints;
+
+    for(int i = 0; i < pFiffInfo->dig.size(); ++i) {
+        if(pFiffInfo->dig[i].kind == FIFFV_POINT_HPI) {
+            lHPIPoints.append(pFiffInfo->dig[i]);
         }
     }
 
+    int numCoils = lHPIPoints.size();
+
+    if(vFreqs.size() < numCoils) {
+        std::cout<<std::endl<< "HPIFit::fit - Not enough coil frequencies specified. Returning.";
+        m_bSetupValid = false;
+        return false;
+    }
+
+    Eigen::MatrixXd matHeadHPI(numCoils,3);
+
+    for (int i = 0; i < numCoils; ++i) {
+        matHeadHPI(i,0) = lHPIPoints.at(i).r[0];
+        matHeadHPI(i,1) = lHPIPoints.at(i).r[1];
+        matHeadHPI(i,2) = lHPIPoints.at(i).r[2];
+    }
+
+    if(m_bSetupValid
+            && m_pFiffInfo == pFiffInfo
+            && m_matHeadHPI.rows() == numCoils
+            && m_lBads == pFiffInfo->bads
+            && m_vFreqs == vFreqs
+            && m_iNumSamples == iNumSamples
+            && m_matProjectors.rows() == t_matProjectors.rows()
+            && m_matProjectors.cols() == t_matProjectors.cols()
+            && m_matProjectors == t_matProjectors) {
+        m_matHeadHPI = matHeadHPI;
+        return true;
+    }
+
+    m_bSetupValid = false;
+
+    if(t_matProjectors.rows() != pFiffInfo->nchan || t_matProjectors.cols() != pFiffInfo->nchan) {
+        std::cout<<std::endl<< "HPIFit::fit - Projector does not match the number of channels. Returning.";
+        return false;
+    }
+
+    m_matHeadHPI = matHeadHPI;
+    Eigen::VectorXd coilfreq(numCoils);
+
+    for (int i = 0; i < numCoils; ++i) {
+        coilfreq[i] = vFreqs.at(i);
+    }
+
+    getSensors(pFiffInfo, m_vInnerInd, m_sensors);
+    m_matProjectorsInnerind = pickInnerProjector(t_matProjectors, m_vInnerInd);
+    m_matDemod = computeDemodulation(coilfreq, pFiffInfo->sfreq, iNumSamples);
+
+    //A different number of coils invalidates the warm start
+    if(m_matCoilPos.rows() != numCoils) {
+        m_matCoilPos.resize(0,0);
+    }
+
+    m_pFiffInfo = pFiffInfo;
+    m_lBads = pFiffInfo->bads;
+    m_vFreqs = vFreqs;
+    m_iNumSamples = iNumSamples;
+    m_matProjectors = t_matProjectors;
+    m_bSetupValid = true;
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+void HPIFit::getSensors(FiffInfo::SPtr pFiffInfo,
+                        QVector<int>& innerind,
+                        struct SensorInfo& sensors)
+{
     // Get the indices of inner layer channels and exclude bad channels.
     //TODO: Only supports babymeg and vectorview gradiometeres for hpi fitting.
-    QVector<int> innerind(0);
+    innerind.clear();
 
-    for (int i = 0; i < numCh; ++i) {
+    for (int i = 0; i < pFiffInfo->nchan; ++i) {
         if(pFiffInfo->chs[i].chpos.coil_type == FIFFV_COIL_BABY_MAG ||
                 pFiffInfo->chs[i].chpos.coil_type == FIFFV_COIL_VV_PLANAR_T1 ||
                 pFiffInfo->chs[i].chpos.coil_type == FIFFV_COIL_VV_PLANAR_T2 ||
@@ -204,21 +448,6 @@ void HPIFit::fitHPI(const MatrixXd& t_mat,
         }
     }
 
-    //Create new projector based on the excluded channels, first exclude the rows then the columns
-    MatrixXd matProjectorsRows(innerind.size(),t_matProjectors.cols());
-    MatrixXd matProjectorsInnerind(innerind.size(),innerind.size());
-
-    for (int i = 0; i < matProjectorsRows.rows(); ++i) {
-        matProjectorsRows.row(i) = t_matProjectors.row(innerind.at(i));
-    }
-
-    for (int i = 0; i < matProjectorsInnerind.cols(); ++i) {
-        matProjectorsInnerind.col(i) = matProjectorsRows.col(innerind.at(i));
-    }
-
-    //UTILSLIB::IOUtils::write_eigen_matrix(matProjectorsInnerind, "matProjectorsInnerind.txt");
-    //UTILSLIB::IOUtils::write_eigen_matrix(t_matProjectors, "t_matProjectors.txt");
-
     // Initialize inner layer sensors
     sensors.coilpos = Eigen::MatrixXd::Zero(innerind.size(),3);
     sensors.coilori = Eigen::MatrixXd::Zero(innerind.size(),3);
@@ -232,43 +461,66 @@ void HPIFit::fitHPI(const MatrixXd& t_mat,
         sensors.coilori(i,1) = pFiffInfo->chs[innerind.at(i)].chpos.ez[1];
         sensors.coilori(i,2) = pFiffInfo->chs[innerind.at(i)].chpos.ez[2];
     }
+}
 
-    Eigen::MatrixXd topo(innerind.size(), numCoils*2);
-    Eigen::MatrixXd amp(innerind.size(), numCoils);
-    Eigen::MatrixXd ampC(innerind.size(), numCoils);
 
-    // Get the data from inner layer channels
-    Eigen::MatrixXd innerdata(innerind.size(), t_mat.cols());
+//*************************************************************************************************************
 
-    for(int j = 0; j < innerind.size(); ++j) {
-        innerdata.row(j) << t_mat.row(innerind[j]);
+Eigen::MatrixXd HPIFit::computeDemodulation(const Eigen::VectorXd& coilfreq, double samF, int samLoc)
+{
+    int numCoils = coilfreq.rows();
+
+    // Generate simulated data
+    Eigen::MatrixXd simsig(samLoc,numCoils*2);
+    Eigen::VectorXd time(samLoc);
+
+    for (int i = 0; i < samLoc; ++i) {
+        time[i] = i*1.0/samF;
     }
 
+    for(int i = 0; i < numCoils; ++i) {
+        for(int j = 0; j < samLoc; ++j) {
+            simsig(j,i) = sin(2*M_PI*coilfreq[i]*time[j]);
+            simsig(j,i+numCoils) = cos(2*M_PI*coilfreq[i]*time[j]);
+        }
+    }
+
+    return UTILSLIB::MNEMath::pinv(simsig).transpose();
+}
+
+
+//*************************************************************************************************************
+
+Eigen::MatrixXd HPIFit::demodulate(const Eigen::MatrixXd& innerdata, const Eigen::MatrixXd& matDemod, int numCoils)
+{
     // Calculate topo
-    topo = innerdata * UTILSLIB::MNEMath::pinv(simsig).transpose(); // topo: # of good inner channel x 8
+    Eigen::MatrixXd topo = innerdata * matDemod; // topo: # of good inner channel x 8
 
     // Select sine or cosine component depending on the relative size
-    amp  = topo.leftCols(numCoils); // amp: # of good inner channel x 4
-    ampC = topo.rightCols(numCoils);
+    Eigen::MatrixXd amp  = topo.leftCols(numCoils); // amp: # of good inner channel x 4
+    Eigen::MatrixXd ampC = topo.rightCols(numCoils);
 
     for(int j = 0; j < numCoils; ++j) {
-       float nS = 0.0;
-       float nC = 0.0;
-       for(int i = 0; i < innerind.size(); ++i) {
-           nS += amp(i,j)*amp(i,j);
-           nC += ampC(i,j)*ampC(i,j);
-       }
-
-       if(nC > nS) {
-         for(int i = 0; i < innerind.size(); ++i) {
-           amp(i,j) = ampC(i,j);
-         }
-       }
+        if(ampC.col(j).squaredNorm() > amp.col(j).squaredNorm()) {
+            amp.col(j) = ampC.col(j);
+        }
     }
 
-    //Find good seed point/starting point for the coil position in 3D space
+    return amp;
+}
+
+
+//*************************************************************************************************************
+
+Eigen::MatrixXd HPIFit::getSeedPositions(const Eigen::MatrixXd& amp,
+                                         const QVector<int>& innerind,
+                                         FiffInfo::SPtr pFiffInfo,
+                                         Eigen::VectorXi& chIdcs)
+{
+    int numCoils = amp.cols();
+
     //Find biggest amplitude per pickup coil (sensor) and store corresponding sensor channel index
-    VectorXi chIdcs(numCoils);
+    chIdcs.resize(numCoils);
 
     for (int j = 0; j < numCoils; j++) {
         double maxVal = 0;
@@ -306,12 +558,22 @@ void HPIFit::fitHPI(const MatrixXd& t_mat,
         //std::cout << "HPIFit::fitHPI - Coil " << j << " max value index " << chIdx << std::endl;
     }
 
-    coil.pos = coilPos;
+    return coilPos;
+}
 
-    coil = dipfit(coil, sensors, amp, numCoils, matProjectorsInnerind);
 
-    Eigen::Matrix4d trans = computeTransformation(headHPI, coil.pos);
-    //Eigen::Matrix4d trans = computeTransformation(coil.pos, headHPI);
+//*************************************************************************************************************
+
+Eigen::MatrixXd HPIFit::storeResult(const Eigen::MatrixXd& coilPos,
+                                    const Eigen::MatrixXd& headHPI,
+                                    FiffCoordTrans& transDevHead,
+                                    QVector<double>& vGof,
+                                    FiffDigPointSet& fittedPointSet)
+{
+    int numCoils = coilPos.rows();
+
+    Eigen::Matrix4d trans = computeTransformation(headHPI, coilPos);
+    //Eigen::Matrix4d trans = computeTransformation(coilPos, headHPI);
 
     // Store the final result to fiff info
     // Set final device/head matrix and its inverse to the fiff info
@@ -328,8 +590,8 @@ void HPIFit::fitHPI(const MatrixXd& t_mat,
     transDevHead.invtrans = transDevHead.trans.inverse();
 
     //Calculate GOF
-    MatrixXd temp = coil.pos;
-    temp.conservativeResize(coil.pos.rows(),coil.pos.cols()+1);
+    MatrixXd temp = coilPos;
+    temp.conservativeResize(coilPos.rows(),coilPos.cols()+1);
 
     temp.block(0,3,numCoils,1).setOnes();
     temp.transposeInPlace();
@@ -337,58 +599,24 @@ void HPIFit::fitHPI(const MatrixXd& t_mat,
     MatrixXd testPos = trans * temp;
     MatrixXd diffPos = testPos.block(0,0,3,numCoils) - headHPI.transpose();
 
+    vGof.clear();
     for(int i = 0; i < diffPos.cols(); ++i) {
         vGof.append(diffPos.col(i).norm());
     }
 
     //Generate final fitted points and store in digitizer set
-    for(int i = 0; i < coil.pos.rows(); ++i) {
+    for(int i = 0; i < coilPos.rows(); ++i) {
         FiffDigPoint digPoint;
         digPoint.kind = FIFFV_POINT_EEG;
         digPoint.ident = i;
-        digPoint.r[0] = coil.pos(i,0);
-        digPoint.r[1] = coil.pos(i,1);
-        digPoint.r[2] = coil.pos(i,2);
+        digPoint.r[0] = coilPos(i,0);
+        digPoint.r[1] = coilPos(i,1);
+        digPoint.r[2] = coilPos(i,2);
 
         fittedPointSet << digPoint;
     }
 
-    if(bDoDebug) {
-        // DEBUG HPI fitting and write debug results
-        std::cout << std::endl << std::endl << "HPIFit::fitHPI - dpfiterror" << coil.dpfiterror << std::endl << coil.pos << std::endl;
-        std::cout << std::endl << std::endl << "HPIFit::fitHPI - Initial seed point for HPI coils" << std::endl << coil.pos << std::endl;
-        std::cout << std::endl << std::endl << "HPIFit::fitHPI - temp" << std::endl << temp << std::endl;
-        std::cout << std::endl << std::endl << "HPIFit::fitHPI - testPos" << std::endl << testPos << std::endl;
-        std::cout << std::endl << std::endl << "HPIFit::fitHPI - Diff fitted - original" << std::endl << diffPos << std::endl;
-        std::cout << std::endl << std::endl << "HPIFit::fitHPI - dev/head trans" << std::endl << trans << std::endl;
-
-        QString sTimeStamp = QDateTime::currentDateTime().toString("yyMMdd_hhmmss");
-
-        if(!QDir(sHPIResourceDir).exists()) {
-            QDir().mkdir(sHPIResourceDir);
-        }
-
-        UTILSLIB::IOUtils::write_eigen_matrix(coilPos, QString("%1/%2_coilPosSeed_mat").arg(sHPIResourceDir).arg(sTimeStamp));
-
-        UTILSLIB::IOUtils::write_eigen_matrix(coil.pos, QString("%1/%2_coilPos_mat").arg(sHPIResourceDir).arg(sTimeStamp));
-
-        UTILSLIB::IOUtils::write_eigen_matrix(headHPI, QString("%1/%2_headHPI_mat").arg(sHPIResourceDir).arg(sTimeStamp));
-
-        MatrixXd testPosCut = testPos.transpose();//block(0,0,3,4);
-        UTILSLIB::IOUtils::write_eigen_matrix(testPosCut, QString("%1/%2_testPos_mat").arg(sHPIResourceDir).arg(sTimeStamp));
-
-        MatrixXi idx_mat(chIdcs.rows(),1);
-        idx_mat.col(0) = chIdcs;
-        UTILSLIB::IOUtils::write_eigen_matrix(idx_mat, QString("%1/%2_idx_mat").arg(sHPIResourceDir).arg(sTimeStamp));
-
-        MatrixXd coilFreq_mat(coilfreq.rows(),1);
-        coilFreq_mat.col(0) = coilfreq;
-        UTILSLIB::IOUtils::write_eigen_matrix(coilFreq_mat, QString("%1/%2_coilFreq_mat").arg(sHPIResourceDir).arg(sTimeStamp));
-
-        UTILSLIB::IOUtils::write_eigen_matrix(diffPos, QString("%1/%2_diffPos_mat").arg(sHPIResourceDir).arg(sTimeStamp));
-
-        UTILSLIB::IOUtils::write_eigen_matrix(amp, QString("%1/%2_amp_mat").arg(sHPIResourceDir).arg(sTimeStamp));
-    }
+    return diffPos;
 }
 
 
@@ -42,6 +42,7 @@
 //=============================================================================================================
 
 #include "../inverse_global.h"
+#include "hpifitdata.h"
 
 
 //*************************************************************************************************************
@@ -58,6 +59,8 @@
 //=============================================================================================================
 
 #include <QSharedPointer>
+#include <QStringList>
+#include <QVector>
 
 
 //*************************************************************************************************************
@@ -104,7 +107,9 @@ struct CoilParam {
 
 //=============================================================================================================
 /**
-* HPI Fit algorithms.
+* HPI Fit algorithms. The static fitHPI performs one self-contained fit. For continuous head tracking create an
+* HPIFit object and call fit(): it keeps the sensor geometry, projector and demodulation basis across calls and
+* starts each fit from the previously fitted coil positions.
 *
 * @brief HPI Fit algorithms.
 */
@@ -145,7 +150,126 @@ public:
                         bool bDoDebug = false,
                         const QString& sHPIResourceDir = QString("./HPIFittingDebug"));
 
+    //=========================================================================================================
+    /**
+    * Perform one HPI fit as part of a continuous fit. The sensor geometry, projector and demodulation basis are
+    * only rebuilt if the measurement info, the projector, the coil frequencies, the number of coils or the number
+    * of samples changed. The digitized coil positions are read from the measurement info on every call. Each
+    * coil is fitted with a Levenberg-Marquardt solver which starts from the previously fitted position, unless
+    * the channel with the maximal amplitude gives a better start.
+    *
+    * @param[in] t_mat           Data to estimate the HPI positions from
+    * @param[in] t_matProjectors The projectors to apply. Bad channels are still included.
+    * @param[out] transDevHead   The final dev head transformation matrix
+    * @param[in] vFreqs          The frequencies for each coil.
+    * @param[out] vGof           The goodness of fit in mm for each fitted HPI coil.
+    * @param[out] fittedPointSet The final fitted positions in form of a digitizer set.
+    * @param[in] pFiffInfo       Associated Fiff Information.
+    */
+    void fit(const Eigen::MatrixXd& t_mat,
+             const Eigen::MatrixXd& t_matProjectors,
+             FIFFLIB::FiffCoordTrans &transDevHead,
+             const QVector<int>& vFreqs,
+             QVector<double> &vGof,
+             FIFFLIB::FiffDigPointSet& fittedPointSet,
+             QSharedPointer<FIFFLIB::FiffInfo> pFiffInfo);
+
+    //=========================================================================================================
+    /**
+    * Drops the cached fit setup and the previously fitted coil positions. The next call of fit starts cold.
+    */
+    void reset();
+
 protected:
+    //=========================================================================================================
+    /**
+    * Rebuilds the cached fit setup if any of its inputs changed. The digitized coil positions are always updated.
+    *
+    * @param[in] t_matProjectors The projectors to apply. Bad channels are still included.
+    * @param[in] vFreqs          The frequencies for each coil.
+    * @param[in] iNumSamples     The number of samples per fit.
+    * @param[in] pFiffInfo       Associated Fiff Information.
+    *
+    * @return Returns false if the fit setup could not be created.
+    */
+    bool updateSetup(const Eigen::MatrixXd& t_matProjectors,
+                     const QVector<int>& vFreqs,
+                     int iNumSamples,
+                     QSharedPointer<FIFFLIB::FiffInfo> pFiffInfo);
+
+    //=========================================================================================================
+    /**
+    * Gets the inner layer channels which are not marked as bad and their geometry.
+    * TODO: Only supports babymeg and vectorview gradiometeres for hpi fitting.
+    *
+    * @param[in] pFiffInfo       Associated Fiff Information.
+    * @param[out] innerind       The indices of the inner layer channels.
+    * @param[out] sensors        The sensor information of the inner layer channels.
+    */
+    static void getSensors(QSharedPointer<FIFFLIB::FiffInfo> pFiffInfo,
+                           QVector<int>& innerind,
+                           struct SensorInfo& sensors);
+
+    //=========================================================================================================
+    /**
+    * Computes the demodulation matrix pinv(simsig)^T for the sine and cosine signals of all coils.
+    *
+    * @param[in] coilfreq        The coil frequencies.
+    * @param[in] samF            The sampling frequency.
+    * @param[in] samLoc          The number of samples.
+    *
+    * @return Returns the demodulation matrix (samples x 2*coils).
+    */
+    static Eigen::MatrixXd computeDemodulation(const Eigen::VectorXd& coilfreq, double samF, int samLoc);
+
+    //=========================================================================================================
+    /**
+    * Demodulates the inner layer data and selects the sine or cosine component depending on the relative size.
+    *
+    * @param[in] innerdata       The data of the inner layer channels.
+    * @param[in] matDemod        The demodulation matrix, see computeDemodulation.
+    * @param[in] numCoils        The number of coils.
+    *
+    * @return Returns the coil amplitudes (channels x coils).
+    */
+    static Eigen::MatrixXd demodulate(const Eigen::MatrixXd& innerdata, const Eigen::MatrixXd& matDemod, int numCoils);
+
+    //=========================================================================================================
+    /**
+    * Generates seed points for the coils by projecting the position of the channel with the maximal amplitude
+    * 3cm inwards.
+    *
+    * @param[in] amp             The coil amplitudes.
+    * @param[in] innerind        The indices of the inner layer channels.
+    * @param[in] pFiffInfo       Associated Fiff Information.
+    * @param[out] chIdcs         The channel index with the maximal amplitude per coil.
+    *
+    * @return Returns the seed positions (coils x 3).
+    */
+    static Eigen::MatrixXd getSeedPositions(const Eigen::MatrixXd& amp,
+                                            const QVector<int>& innerind,
+                                            QSharedPointer<FIFFLIB::FiffInfo> pFiffInfo,
+                                            Eigen::VectorXi& chIdcs);
+
+    //=========================================================================================================
+    /**
+    * Computes the dev head transformation, the goodness of fit and the fitted digitizer set from the fitted
+    * coil positions.
+    *
+    * @param[in] coilPos         The fitted coil positions.
+    * @param[in] headHPI         The digitized coil positions.
+    * @param[out] transDevHead   The final dev head transformation matrix
+    * @param[out] vGof           The goodness of fit in mm for each fitted HPI coil.
+    * @param[out] fittedPointSet The final fitted positions in form of a digitizer set.
+    *
+    * @return Returns the difference between the transformed fitted and the digitized positions (3 x coils).
+    */
+    static Eigen::MatrixXd storeResult(const Eigen::MatrixXd& coilPos,
+                                       const Eigen::MatrixXd& headHPI,
+                                       FIFFLIB::FiffCoordTrans &transDevHead,
+                                       QVector<double> &vGof,
+                                       FIFFLIB::FiffDigPointSet& fittedPointSet);
+
     //=========================================================================================================
     /**
     * Fits dipoles for the given coils and a given data set.
@@ -172,6 +296,22 @@ protected:
     static Eigen::Matrix4d computeTransformation(Eigen::MatrixXd NH, Eigen::MatrixXd BT);
 
     static QString         m_sHPIResourceDir;      /**< Hold the resource folder to store the debug information in. */
+
+    // Cached fit setup of the continuous fit
+    bool                m_bSetupValid;              /**< Whether the cached fit setup is valid. */
+    QSharedPointer<FIFFLIB::FiffInfo> m_pFiffInfo;  /**< The measurement info the setup was created for. */
+    QStringList         m_lBads;                    /**< The bad channels the setup was created for. */
+    QVector<int>        m_vFreqs;                   /**< The coil frequencies the setup was created for. */
+    int                 m_iNumSamples;              /**< The number of samples the setup was created for. */
+    Eigen::MatrixXd     m_matProjectors;            /**< The projectors the setup was created for. */
+    QVector<int>        m_vInnerInd;                /**< The indices of the used inner layer channels. */
+    SensorInfo          m_sensors;                  /**< The geometry of the used inner layer channels. */
+    Eigen::MatrixXd     m_matProjectorsInnerind;    /**< The projectors restricted to the used channels. */
+    Eigen::MatrixXd     m_matDemod;                 /**< The demodulation matrix pinv(simsig)^T. */
+    Eigen::MatrixXd     m_matHeadHPI;               /**< The digitized coil positions. */
+
+    // Warm start of the continuous fit
+    Eigen::MatrixXd     m_matCoilPos;               /**< The previously fitted coil positions, empty for a cold start. */
 };
 
 //*************************************************************************************************************
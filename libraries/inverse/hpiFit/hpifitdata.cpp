@@ -50,6 +50,8 @@
 // Eigen INCLUDES
 //=============================================================================================================
 
+#include <Eigen/Dense>
+
 
 //*************************************************************************************************************
 //=============================================================================================================
@@ -113,55 +115,72 @@ void HPIFitData::doDipfitConcurrent()
 
 //*************************************************************************************************************
 
-Eigen::MatrixXd HPIFitData::magnetic_dipole(Eigen::MatrixXd pos, Eigen::MatrixXd pnt, Eigen::MatrixXd ori)
+Eigen::MatrixXd HPIFitData::magnetic_dipole(const Eigen::MatrixXd& pos, const Eigen::MatrixXd& pnt, const Eigen::MatrixXd& ori)
 {
     double u0 = 1e-7;
-    int nchan;
-    Eigen::MatrixXd r, r2, r5, x, y, z, mx, my, mz, Tx, Ty, Tz, lf;
-
-    nchan = pnt.rows();
+    int nchan = pnt.rows();
 
     // Shift the magnetometers so that the dipole is in the origin
-    pnt.array().col(0) -= pos(0);
-    pnt.array().col(1) -= pos(1);
-    pnt.array().col(2) -= pos(2);
+    Eigen::ArrayXd x = pnt.col(0).array() - pos(0);
+    Eigen::ArrayXd y = pnt.col(1).array() - pos(1);
+    Eigen::ArrayXd z = pnt.col(2).array() - pos(2);
 
-    r = pnt.array().square().rowwise().sum().sqrt();
+    Eigen::ArrayXd r2 = x.square() + y.square() + z.square();
+    Eigen::ArrayXd scale = u0 / (4 * M_PI * r2.square() * r2.sqrt()); // u0/(4*pi*r^5)
 
-    r2 = r5 = x = y = z = mx = my = mz = Tx = Ty = Tz = lf = Eigen::MatrixXd::Zero(nchan,3);
+    // lf(:,j) = u0/(4*pi*r^5) * (3 * pnt(:,j) * (pnt . ori) - r^2 * ori(:,j))
+    Eigen::ArrayXd dotRN = x * ori.col(0).array() + y * ori.col(1).array() + z * ori.col(2).array();
 
-    for(int i = 0;i < nchan;i++) {
-        r2.row(i).array().fill(pow(r(i),2));
-        r5.row(i).array().fill(pow(r(i),5));
-    }
-
-    for(int i = 0;i < nchan;i++) {
-        x.row(i).array().fill(pnt(i,0));
-        y.row(i).array().fill(pnt(i,1));
-        z.row(i).array().fill(pnt(i,2));
-    }
+    Eigen::MatrixXd lf(nchan,3);
+    lf.col(0) = scale * (3 * x * dotRN - r2 * ori.col(0).array());
+    lf.col(1) = scale * (3 * y * dotRN - r2 * ori.col(1).array());
+    lf.col(2) = scale * (3 * z * dotRN - r2 * ori.col(2).array());
 
-    mx.col(0).array().fill(1);
-    my.col(1).array().fill(1);
-    mz.col(2).array().fill(1);
-
-    Tx = 3 * x.cwiseProduct(pnt) - mx.cwiseProduct(r2);
-    Ty = 3 * y.cwiseProduct(pnt) - my.cwiseProduct(r2);
-    Tz = 3 * z.cwiseProduct(pnt) - mz.cwiseProduct(r2);
+    return lf;
+}
 
-    for(int i = 0;i < nchan;i++) {
-        lf(i,0) = Tx.row(i).dot(ori.row(i));
-        lf(i,1) = Ty.row(i).dot(ori.row(i));
-        lf(i,2) = Tz.row(i).dot(ori.row(i));
-    }
 
-    for(int i = 0;i < nchan;i++) {
-        for(int j = 0;j < 3;j++) {
-            lf(i,j) = u0 * lf(i,j)/(4 * M_PI * r5(i,j));
-        }
-    }
+//*************************************************************************************************************
 
-    return lf;
+void HPIFitData::magnetic_dipole_jacobian(const Eigen::Vector3d& pos,
+                                          const Eigen::Vector3d& mom,
+                                          const Eigen::MatrixXd& pnt,
+                                          const Eigen::MatrixXd& ori,
+                                          Eigen::MatrixXd& lf,
+                                          Eigen::MatrixXd& jacPos)
+{
+    double c = 1e-7 / (4 * M_PI);
+    int nchan = pnt.rows();
+
+    // R = pnt - pos, field f = c * (3 (m.R)(n.R)/r^5 - (m.n)/r^3)
+    Eigen::ArrayXd x = pnt.col(0).array() - pos(0);
+    Eigen::ArrayXd y = pnt.col(1).array() - pos(1);
+    Eigen::ArrayXd z = pnt.col(2).array() - pos(2);
+
+    Eigen::ArrayXd r2 = x.square() + y.square() + z.square();
+    Eigen::ArrayXd invR5 = 1.0 / (r2.square() * r2.sqrt());
+    Eigen::ArrayXd invR7 = invR5 / r2;
+
+    Eigen::ArrayXd nx = ori.col(0).array();
+    Eigen::ArrayXd ny = ori.col(1).array();
+    Eigen::ArrayXd nz = ori.col(2).array();
+
+    Eigen::ArrayXd dotRN = x * nx + y * ny + z * nz;
+    Eigen::ArrayXd dotRM = x * mom(0) + y * mom(1) + z * mom(2);
+    Eigen::ArrayXd dotMN = nx * mom(0) + ny * mom(1) + nz * mom(2);
+
+    lf.resize(nchan,3);
+    lf.col(0) = c * invR5 * (3 * x * dotRN - r2 * nx);
+    lf.col(1) = c * invR5 * (3 * y * dotRN - r2 * ny);
+    lf.col(2) = c * invR5 * (3 * z * dotRN - r2 * nz);
+
+    // df/dR = c * (3 ((n.R) m + (m.R) n)/r^5 - 15 (m.R)(n.R) R/r^7 + 3 (m.n) R/r^5), df/dpos = -df/dR
+    Eigen::ArrayXd common = 3 * dotMN * invR5 - 15 * dotRM * dotRN * invR7;
+
+    jacPos.resize(nchan,3);
+    jacPos.col(0) = -c * (3 * (dotRN * mom(0) + dotRM * nx) * invR5 + common * x);
+    jacPos.col(1) = -c * (3 * (dotRN * mom(1) + dotRM * ny) * invR5 + common * y);
+    jacPos.col(2) = -c * (3 * (dotRN * mom(2) + dotRM * nz) * invR5 + common * z);
 }
 
 
@@ -207,6 +226,95 @@ DipFitError HPIFitData::dipfitError(const Eigen::MatrixXd& pos, const Eigen::Mat
 }
 
 
+//*************************************************************************************************************
+
+DipFitError HPIFitData::dipfitLevenbergMarquardt(Eigen::RowVectorXd& coilPos,
+                                                 const Eigen::VectorXd& sensorData,
+                                                 const struct SensorInfo& sensors,
+                                                 const Eigen::MatrixXd& matProjectors,
+                                                 int maxIterations)
+{
+    typedef Eigen::Matrix<double, 6, 6> Matrix6d;
+    typedef Eigen::Matrix<double, 6, 1> Vector6d;
+
+    struct DipFitError e;
+
+    // The sensor transformation is part of the model, apply it together with the projector
+    Eigen::MatrixXd matProjTra = matProjectors * sensors.tra;
+
+    Eigen::Vector3d pos = coilPos.transpose();
+    Eigen::Vector3d mom = Eigen::Vector3d::Zero();
+    Eigen::MatrixXd lf, jacPos, lfProj;
+
+    // Linear moment estimate at the start position
+    magnetic_dipole_jacobian(pos, mom, sensors.coilpos, sensors.coilori, lf, jacPos);
+    lfProj = matProjTra * lf;
+    mom = (lfProj.transpose() * lfProj).ldlt().solve(lfProj.transpose() * sensorData);
+
+    Eigen::VectorXd res = sensorData - lfProj * mom;
+    double cost = res.squaredNorm();
+
+    double lambda = 1e-3;
+    int itr = 0;
+
+    Eigen::MatrixXd jac(sensorData.rows(), 6);
+
+    for(itr = 0; itr < maxIterations; ++itr) {
+        // Residual r = data - P * lf(pos) * mom -> dr/dpos = -P * jacPos, dr/dmom = -P * lf
+        magnetic_dipole_jacobian(pos, mom, sensors.coilpos, sensors.coilori, lf, jacPos);
+        jac.leftCols(3) = -matProjTra * jacPos;
+        jac.rightCols(3) = -matProjTra * lf;
+
+        Matrix6d JtJ = jac.transpose() * jac;
+        Vector6d Jtr = jac.transpose() * res;
+        Vector6d diagJtJ = JtJ.diagonal().cwiseMax(1e-12 * JtJ.diagonal().maxCoeff());
+
+        // Increase the damping until the step decreases the residual
+        bool bAccepted = false;
+        double step = 0.0;
+        double costDecrease = 0.0;
+
+        while(!bAccepted && lambda < 1e10) {
+            Matrix6d A = JtJ;
+            A.diagonal() += lambda * diagJtJ;
+            Vector6d delta = -A.ldlt().solve(Jtr);
+
+            Eigen::Vector3d posNew = pos + delta.head(3);
+            Eigen::Vector3d momNew = mom + delta.tail(3);
+
+            Eigen::VectorXd resNew = sensorData - matProjTra * (magnetic_dipole(posNew, sensors.coilpos, sensors.coilori) * momNew);
+            double costNew = resNew.squaredNorm();
+
+            if(costNew < cost) {
+                costDecrease = cost - costNew;
+                step = delta.head(3).norm();
+                pos = posNew;
+                mom = momNew;
+                res = resNew;
+                cost = costNew;
+                lambda = std::max(lambda * 0.1, 1e-12);
+                bAccepted = true;
+            } else {
+                lambda *= 10;
+            }
+        }
+
+        // Converged when no step improves the fit or the position changes less than 1 nm
+        if(!bAccepted || step < 1e-9 || costDecrease <= 1e-12 * cost) {
+            break;
+        }
+    }
+
+    coilPos = pos.transpose();
+
+    e.error = cost / sensorData.squaredNorm();
+    e.moment = mom;
+    e.numIterations = itr;
+
+    return e;
+}
+
+
 //*************************************************************************************************************
 
 bool HPIFitData::compare(HPISortStruct a, HPISortStruct b)
@@ -145,6 +145,26 @@ public:
     */
     void doDipfitConcurrent();
 
+    //=========================================================================================================
+    /**
+    * Fits the position and moment of one coil with a Levenberg-Marquardt solver. The Jacobian is computed
+    * analytically, see magnetic_dipole_jacobian. The moment is fitted jointly with the position against the
+    * projected lead field.
+    *
+    * @param[in, out] coilPos       The start position, returns the fitted position (1 x 3).
+    * @param[in] sensorData         The coil amplitudes of the used channels.
+    * @param[in] sensors            The sensor information.
+    * @param[in] matProjectors      The projectors to apply.
+    * @param[in] maxIterations      The maximum number of iterations.
+    *
+    * @return Returns the relative residual error, the fitted moment and the number of iterations.
+    */
+    static DipFitError dipfitLevenbergMarquardt(Eigen::RowVectorXd& coilPos,
+                                                const Eigen::VectorXd& sensorData,
+                                                const struct SensorInfo& sensors,
+                                                const Eigen::MatrixXd& matProjectors,
+                                                int maxIterations = 100);
+
     Eigen::RowVectorXd  coilPos;
     Eigen::RowVectorXd  sensorData;
     DipFitError         errorInfo;
@@ -157,7 +177,26 @@ protected:
     * magnetic_dipole leadfield for a magnetic dipole in an infinite medium.
     * The function has been compared with matlab magnetic_dipole and it gives same output.
     */
-    Eigen::MatrixXd magnetic_dipole(Eigen::MatrixXd pos, Eigen::MatrixXd pnt, Eigen::MatrixXd ori);
+    static Eigen::MatrixXd magnetic_dipole(const Eigen::MatrixXd& pos, const Eigen::MatrixXd& pnt, const Eigen::MatrixXd& ori);
+
+    //=========================================================================================================
+    /**
+    * magnetic_dipole_jacobian computes the magnetic_dipole leadfield and the derivative of the field of the
+    * dipole with the given moment with respect to the dipole position.
+    *
+    * @param[in] pos        The dipole position.
+    * @param[in] mom        The dipole moment.
+    * @param[in] pnt        The coil positions.
+    * @param[in] ori        The coil orientations.
+    * @param[out] lf        The leadfield (nchan x 3).
+    * @param[out] jacPos    The derivative of lf * mom with respect to pos (nchan x 3).
+    */
+    static void magnetic_dipole_jacobian(const Eigen::Vector3d& pos,
+                                         const Eigen::Vector3d& mom,
+                                         const Eigen::MatrixXd& pnt,
+                                         const Eigen::MatrixXd& ori,
+                                         Eigen::MatrixXd& lf,
+                                         Eigen::MatrixXd& jacPos);
 
     //=========================================================================================================
     /**
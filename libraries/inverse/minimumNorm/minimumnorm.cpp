@@ -50,6 +50,7 @@
 //=============================================================================================================
 
 #include <iostream>
+#include <type_traits>
 
 
 //*************************************************************************************************************
@@ -70,6 +71,162 @@ using namespace MNELIB;
 using namespace INVERSELIB;
 
 
+//*************************************************************************************************************
+//=============================================================================================================
+// STATIC DEFINITIONS
+//=============================================================================================================
+
+namespace
+{
+
+const int INVERSE_BLOCK_SIZE = 64;      /**< Number of samples processed at a time by applyKernel */
+
+//=============================================================================================================
+/**
+* Returns a block of the data in the precision of the kernel. If the precisions match the block refers to
+* the data, otherwise the data is converted into the block buffer.
+*/
+template<typename T>
+inline Block<const Matrix<T,Dynamic,Dynamic>,Dynamic,Dynamic,true> dataBlock(const Matrix<T,Dynamic,Dynamic>& matData,
+                                                                             Matrix<T,Dynamic,Dynamic>& /*matIn*/,
+                                                                             int t,
+                                                                             int n)
+{
+    return matData.middleCols(t, n);
+}
+
+template<typename T, typename TData>
+inline Block<Matrix<T,Dynamic,Dynamic>,Dynamic,Dynamic,true> dataBlock(const Matrix<TData,Dynamic,Dynamic>& matData,
+                                                                       Matrix<T,Dynamic,Dynamic>& matIn,
+                                                                       int t,
+                                                                       int n)
+{
+    matIn.leftCols(n) = matData.middleCols(t, n).template cast<T>();
+    return matIn.leftCols(n);
+}
+
+//=============================================================================================================
+/**
+* Returns the block the kernel writes to. If the precisions match this is the block of the result itself,
+* otherwise the block buffer which storeBlock converts to the result.
+*/
+template<typename T>
+inline Block<Matrix<T,Dynamic,Dynamic>,Dynamic,Dynamic,true> solBlock(Matrix<T,Dynamic,Dynamic>& matSol,
+                                                                      Matrix<T,Dynamic,Dynamic>& /*matOut*/,
+                                                                      int t,
+                                                                      int n)
+{
+    return matSol.middleCols(t, n);
+}
+
+template<typename T, typename TSol>
+inline Block<Matrix<T,Dynamic,Dynamic>,Dynamic,Dynamic,true> solBlock(Matrix<TSol,Dynamic,Dynamic>& /*matSol*/,
+                                                                      Matrix<T,Dynamic,Dynamic>& matOut,
+                                                                      int /*t*/,
+                                                                      int n)
+{
+    return matOut.leftCols(n);
+}
+
+template<typename T>
+inline void storeBlock(Matrix<T,Dynamic,Dynamic>& /*matSol*/,
+                       const Matrix<T,Dynamic,Dynamic>& /*matOut*/,
+                       int /*t*/,
+                       int /*n*/)
+{
+}
+
+template<typename T, typename TSol>
+inline void storeBlock(Matrix<TSol,Dynamic,Dynamic>& matSol,
+                       const Matrix<T,Dynamic,Dynamic>& matOut,
+                       int t,
+                       int n)
+{
+    matSol.middleCols(t, n) = matOut.leftCols(n).template cast<TSol>();
+}
+
+//=============================================================================================================
+/**
+* Applies the imaging kernel block by block. While a block is in cache the current components are
+* combined (free orientation) and the noise normalization is applied. A factored kernel is applied as
+* matK * (matTrans * data). Data or results stored in another precision than the kernel are converted block
+* by block, so there is no full size copy.
+*
+* @param[in] matK           The imaging kernel, or its source side factor if matTrans is given.
+* @param[in] matTrans       The sensor side factor of the kernel, empty if matK is the full kernel.
+* @param[in] vecNoiseNorm   The noise normalization factors, empty if there is none.
+* @param[in] bCombineXyz    Combine three consecutive current components to their norm.
+* @param[in] matData        The data (channels x samples).
+* @param[out] matSol        The source estimate, resized if necessary.
+*/
+template<typename T, typename TData, typename TSol>
+void applyKernel(const Matrix<T,Dynamic,Dynamic>& matK,
+                 const Matrix<T,Dynamic,Dynamic>& matTrans,
+                 const Matrix<T,Dynamic,1>& vecNoiseNorm,
+                 bool bCombineXyz,
+                 const Matrix<TData,Dynamic,Dynamic>& matData,
+                 Matrix<TSol,Dynamic,Dynamic>& matSol)
+{
+    const int nsource = bCombineXyz ? matK.rows()/3 : matK.rows();
+    const int nsamp = matData.cols();
+
+    if(matSol.rows() != nsource || matSol.cols() != nsamp) {
+        matSol.resize(nsource, nsamp);
+    }
+
+    const int iBlockSize = qMin(INVERSE_BLOCK_SIZE, nsamp);
+
+    Matrix<T,Dynamic,Dynamic> matWork, matProj, matIn, matOut;
+    if(bCombineXyz) {
+        matWork.resize(matK.rows(), iBlockSize);
+    }
+    if(matTrans.size() > 0) {
+        matProj.resize(matTrans.rows(), iBlockSize);
+    }
+    if(!std::is_same<T,TData>::value) {
+        matIn.resize(matData.rows(), iBlockSize);
+    }
+    if(!std::is_same<T,TSol>::value) {
+        matOut.resize(nsource, iBlockSize);
+    }
+
+    for(int t = 0; t < nsamp; t += INVERSE_BLOCK_SIZE) {
+        const int n = qMin(INVERSE_BLOCK_SIZE, nsamp - t);
+
+        auto in = dataBlock(matData, matIn, t, n);
+        auto out = solBlock(matSol, matOut, t, n);
+
+        if(matTrans.size() > 0) {
+            matProj.leftCols(n).noalias() = matTrans * in;
+            if(bCombineXyz) {
+                matWork.leftCols(n).noalias() = matK * matProj.leftCols(n);
+            } else {
+                out.noalias() = matK * matProj.leftCols(n);
+            }
+        } else {
+            if(bCombineXyz) {
+                matWork.leftCols(n).noalias() = matK * in;
+            } else {
+                out.noalias() = matK * in;
+            }
+        }
+
+        if(bCombineXyz) {
+            //The components of a source are consecutive, so are the sources of a column in the result
+            Map<Matrix<T,1,Dynamic> >(out.data(), nsource*n) = Map<const Matrix<T,3,Dynamic> >(matWork.data(), 3, nsource*n).colwise().norm();
+        }
+
+        if(vecNoiseNorm.size() == nsource) {
+            out.array().colwise() *= vecNoiseNorm.array();
+        }
+
+        storeBlock(matSol, matOut, t, n);
+    }
+}
+
+} // NAMESPACE
+
+
 //*************************************************************************************************************
 //=============================================================================================================
 // DEFINE MEMBER METHODS
@@ -78,6 +235,9 @@ using namespace INVERSELIB;
 MinimumNorm::MinimumNorm(const MNEInverseOperator &p_inverseOperator, float lambda, const QString method)
 : m_inverseOperator(p_inverseOperator)
 , inverseSetup(false)
+, m_bSinglePrecision(false)
+, m_bPickNormal(false)
+, m_bFactoredKernel(false)
 {
     this->setRegularization(lambda);
     this->setMethod(method);
@@ -88,6 +248,9 @@ MinimumNorm::MinimumNorm(const MNEInverseOperator &p_inverseOperator, float lamb
 MinimumNorm::MinimumNorm(const MNEInverseOperator &p_inverseOperator, float lambda, bool dSPM, bool sLORETA)
 : m_inverseOperator(p_inverseOperator)
 , inverseSetup(false)
+, m_bSinglePrecision(false)
+, m_bPickNormal(false)
+, m_bFactoredKernel(false)
 {
     this->setRegularization(lambda);
     this->setMethod(dSPM, sLORETA);
@@ -200,48 +363,21 @@ MNESourceEstimate MinimumNorm::calculateInverse(const MatrixXd &data, float tmin
         return MNESourceEstimate();
     }
 
-    if(K.cols() != data.rows()) {
-        qWarning() << "MinimumNorm::calculateInverse - Dimension mismatch between K.cols() and data.rows() -" << K.cols() << "and" << data.rows();
-        return MNESourceEstimate();
-    }
-
-    MatrixXd sol = K * data; //apply imaging kernel
+    MatrixXd sol;
 
-    if (inv.source_ori == FIFFV_MNE_FREE_ORI)
-    {
+    if (inv.source_ori == FIFFV_MNE_FREE_ORI && !m_bPickNormal)
         printf("combining the current components...");
-        MatrixXd sol1(sol.rows()/3,sol.cols());
-        for(qint32 i = 0; i < sol.cols(); ++i)
-        {
-            VectorXd* tmp = MNEMath::combine_xyz(sol.block(0,i,sol.rows(),1));
-            sol1.block(0,i,sol.rows()/3,1) = tmp->cwiseSqrt();
-            delete tmp;
-        }
-        sol.resize(sol1.rows(),sol1.cols());
-        sol = sol1;
-    }
-
     if (m_bdSPM)
-    {
         printf("(dSPM)...");
-        sol = inv.noisenorm*sol;
-    }
     else if (m_bsLORETA)
-    {
         printf("(sLORETA)...");
-        sol = inv.noisenorm*sol;
-    }
+
+    if(!applyInverse(data, sol))
+        return MNESourceEstimate();
     printf("[done]\n");
 
     //Results
-    VectorXi p_vecVertices(inv.src[0].vertno.size() + inv.src[1].vertno.size());
-    p_vecVertices << inv.src[0].vertno, inv.src[1].vertno;
-
-//    VectorXi p_vecVertices();
-//    for(qint32 h = 0; h < inv.src.size(); ++h)
-//        t_qListVertices.push_back(inv.src[h].vertno);
-
-    return MNESourceEstimate(sol, p_vecVertices, tmin, tstep);
+    return MNESourceEstimate(sol, getVertices(), tmin, tstep);
 
 }
 
@@ -256,14 +392,91 @@ void MinimumNorm::doInverseSetup(qint32 nave, bool pick_normal)
     inv = m_inverseOperator.prepare_inverse_operator(nave, m_fLambda, m_bdSPM, m_bsLORETA);
 
     printf("Computing inverse...");
-    inv.assemble_kernel(label, m_sMethod, pick_normal, K, noise_norm, vertno);
+    if(m_bFactoredKernel) {
+        //The dense kernel is never formed
+        K.resize(0,0);
+        inv.assemble_kernel_factors(label, m_sMethod, pick_normal, m_matLeads, m_matTrans, m_vecNoiseNorm, vertno);
 
-    std::cout << "K " << K.rows() << " x " << K.cols() << std::endl;
+        std::cout << "K " << m_matLeads.rows() << " x " << m_matLeads.cols() << " x " << m_matTrans.cols() << " (factored)" << std::endl;
+    } else {
+        m_matLeads.resize(0,0);
+        m_matTrans.resize(0,0);
+        inv.assemble_kernel(label, m_sMethod, pick_normal, K, noise_norm, vertno);
+
+        std::cout << "K " << K.rows() << " x " << K.cols() << std::endl;
+
+        if(noise_norm.rows() > 0)
+            m_vecNoiseNorm = noise_norm.diagonal();
+        else
+            m_vecNoiseNorm.resize(0);
+    }
+
+    m_bPickNormal = pick_normal;
+
+    if(m_bSinglePrecision) {
+        m_matKf = m_bFactoredKernel ? m_matLeads.cast<float>() : K.cast<float>();
+        m_matTransf = m_matTrans.cast<float>();
+        m_vecNoiseNormf = m_vecNoiseNorm.cast<float>();
+    } else {
+        m_matKf.resize(0,0);
+        m_matTransf.resize(0,0);
+        m_vecNoiseNormf.resize(0);
+    }
 
     inverseSetup = true;
 }
 
 
+//*************************************************************************************************************
+
+bool MinimumNorm::applyInverse(const MatrixXd &data, MatrixXd &sol) const
+{
+    if(!inverseSetup) {
+        qWarning("MinimumNorm::applyInverse - Inverse not setup -> call doInverseSetup first!");
+        return false;
+    }
+
+    const MatrixXd& matK = m_bFactoredKernel ? m_matLeads : K;
+    qint32 nchan = m_bFactoredKernel ? m_matTrans.cols() : K.cols();
+
+    if(nchan != data.rows()) {
+        qWarning() << "MinimumNorm::applyInverse - Dimension mismatch between K.cols() and data.rows() -" << nchan << "and" << data.rows();
+        return false;
+    }
+
+    if(m_matKf.size() > 0) {
+        //Single precision kernel, the data and the result are converted block by block
+        applyKernel<float>(m_matKf, m_matTransf, m_vecNoiseNormf, inv.source_ori == FIFFV_MNE_FREE_ORI && !m_bPickNormal, data, sol);
+    } else {
+        applyKernel<double>(matK, m_matTrans, m_vecNoiseNorm, inv.source_ori == FIFFV_MNE_FREE_ORI && !m_bPickNormal, data, sol);
+    }
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+bool MinimumNorm::applyInverse(const MatrixXf &data, MatrixXf &sol) const
+{
+    if(!inverseSetup || m_matKf.size() == 0) {
+        qWarning("MinimumNorm::applyInverse - Single precision inverse not setup -> call setSinglePrecision(true) and doInverseSetup first!");
+        return false;
+    }
+
+    qint32 nchan = m_bFactoredKernel ? m_matTransf.cols() : m_matKf.cols();
+
+    if(nchan != data.rows()) {
+        qWarning() << "MinimumNorm::applyInverse - Dimension mismatch between K.cols() and data.rows() -" << nchan << "and" << data.rows();
+        return false;
+    }
+
+    applyKernel<float>(m_matKf, m_matTransf, m_vecNoiseNormf, inv.source_ori == FIFFV_MNE_FREE_ORI && !m_bPickNormal, data, sol);
+
+    return true;
+}
+
+
 //*************************************************************************************************************
 
 const char* MinimumNorm::getName() const
@@ -279,6 +492,22 @@ const MNESourceSpace& MinimumNorm::getSourceSpace() const
     return m_inverseOperator.src;
 }
 
+//*************************************************************************************************************
+
+VectorXi MinimumNorm::getVertices() const
+{
+    if(vertno.size() < 2) {
+        qWarning("MinimumNorm::getVertices - Inverse not setup -> call doInverseSetup first!");
+        return VectorXi();
+    }
+
+    VectorXi vecVertices(vertno[0].size() + vertno[1].size());
+    vecVertices << vertno[0], vertno[1];
+
+    return vecVertices;
+}
+
+
 //*************************************************************************************************************
 
 void MinimumNorm::setMethod(QString method)
@@ -331,3 +560,27 @@ void MinimumNorm::setRegularization(float lambda)
 {
     m_fLambda = lambda;
 }
+
+
+//*************************************************************************************************************
+
+void MinimumNorm::setSinglePrecision(bool bSinglePrecision)
+{
+    m_bSinglePrecision = bSinglePrecision;
+}
+
+
+//*************************************************************************************************************
+
+void MinimumNorm::setFactoredKernel(bool bFactoredKernel)
+{
+    m_bFactoredKernel = bFactoredKernel;
+}
+
+
+//*************************************************************************************************************
+
+void MinimumNorm::setLabel(const Label &p_label)
+{
+    label = p_label;
+}
@@ -127,6 +127,34 @@ public:
 
     virtual MNESourceEstimate calculateInverse(const MatrixXd &data, float tmin, float tstep) const;
 
+    //=========================================================================================================
+    /**
+    * Applies the inverse to a block of data and writes the result to a buffer provided by the caller.
+    * The kernel product, the combination of the current components (free orientation) and the noise
+    * normalization are done in one pass over blocks of samples. The buffer is only resized if its dimensions
+    * do not match, so it can be reused from block to block.
+    * With setSinglePrecision(true) the single precision kernel is applied, the data and the result are
+    * converted block by block.
+    *
+    * @param[in] data       The data (channels x samples).
+    * @param[out] sol       The source estimate (sources x samples).
+    *
+    * @return true if successful, false otherwise.
+    */
+    bool applyInverse(const MatrixXd &data, MatrixXd &sol) const;
+
+    //=========================================================================================================
+    /**
+    * Applies the inverse in single precision, see applyInverse(const MatrixXd&, MatrixXd&).
+    * Requires setSinglePrecision(true) before the inverse setup.
+    *
+    * @param[in] data       The data (channels x samples).
+    * @param[out] sol       The source estimate (sources x samples).
+    *
+    * @return true if successful, false otherwise.
+    */
+    bool applyInverse(const MatrixXf &data, MatrixXf &sol) const;
+
     virtual void doInverseSetup(qint32 nave, bool pick_normal = false);
 
 
@@ -134,6 +162,15 @@ public:
 
     virtual const MNESourceSpace& getSourceSpace() const;
 
+    //=========================================================================================================
+    /**
+    * Get the vertices of the sources in the result of applyInverse, left hemisphere first.
+    * Requires doInverseSetup.
+    *
+    * @return the vertices of the sources
+    */
+    VectorXi getVertices() const;
+
     //=========================================================================================================
     /**
     * Get the prepared inverse operator.
@@ -167,6 +204,33 @@ public:
     */
     void setRegularization(float lambda);
 
+    //=========================================================================================================
+    /**
+    * Keep a single precision copy of the imaging kernel and apply the inverse in single precision.
+    * Takes effect with the next doInverseSetup.
+    *
+    * @param[in] bSinglePrecision   Whether to apply the inverse in single precision.
+    */
+    void setSinglePrecision(bool bSinglePrecision);
+
+    //=========================================================================================================
+    /**
+    * Keep the imaging kernel in factored form (see MNEInverseOperator::assemble_kernel_factors) and apply
+    * the two factors separately. The dense kernel is not formed, getKernel returns an empty matrix.
+    * Takes effect with the next doInverseSetup.
+    *
+    * @param[in] bFactoredKernel    Whether to use the factored kernel.
+    */
+    void setFactoredKernel(bool bFactoredKernel);
+
+    //=========================================================================================================
+    /**
+    * Restrict the inverse to the sources within a label. Takes effect with the next doInverseSetup.
+    *
+    * @param[in] p_label    The label, an empty label selects all sources.
+    */
+    void setLabel(const Label &p_label);
+
     inline MatrixXd& getKernel();
 
 private:
@@ -183,6 +247,17 @@ private:
     Label label;                            /**< The corresponding labels */
     MatrixXd K;                             /**< Imaging kernel */
 
+    bool m_bSinglePrecision;                /**< Apply the inverse in single precision */
+    bool m_bPickNormal;                     /**< Only the normal current components are in the kernel */
+    VectorXd m_vecNoiseNorm;                /**< The noise normalization factors (empty for MNE) */
+    MatrixXf m_matKf;                       /**< Imaging kernel (or its source side factor) in single precision */
+    VectorXf m_vecNoiseNormf;               /**< The noise normalization factors in single precision */
+
+    bool m_bFactoredKernel;                 /**< Keep the imaging kernel in factored form */
+    MatrixXd m_matLeads;                    /**< Source side factor of the imaging kernel */
+    MatrixXd m_matTrans;                    /**< Sensor side factor of the imaging kernel */
+    MatrixXf m_matTransf;                   /**< Sensor side factor in single precision */
+
 };
 
 //*************************************************************************************************************
@@ -194,16 +194,16 @@ MNESourceEstimate PwlRapMusic::calculateInverse(const MatrixXd& p_matMeasurement
         MatrixXT t_matU_B;
         useFullRank(t_svdProj_Phi_S.matrixU(), t_svdProj_Phi_S.singularValues().asDiagonal(), t_matU_B);
 
-        //Inits
-        VectorXT t_vecRoh(m_iNumLeadFieldCombinations,1);
-        t_vecRoh.setZero();
-
         //subcorr benchmark
         //Stop the time
         clock_t start_subcorr, end_subcorr;
         start_subcorr = clock();
 
-        double t_val_roh_k;
+        //Point factors shared by all combinations of the scanned rows
+        MatrixXT t_matQ, t_matSV, t_matC, t_matS_Diag;
+        calcPointFactors(t_matProj_LeadField, t_matU_B, t_matQ, t_matSV, t_matC, t_matS_Diag);
+
+        double t_val_roh_k = -1.0;
 
         //Powell
         int t_iCurrentRow = 2;
@@ -211,66 +211,24 @@ MNESourceEstimate PwlRapMusic::calculateInverse(const MatrixXd& p_matMeasurement
         int t_iIdx1 = -1;
         int t_iIdx2 = -1;
 
+        int t_iMaxIdx = -1;
         int t_iMaxIdx_old = -1;
 
         int t_iMaxFound = 0;
 
-        Eigen::VectorXi t_pVecIdxElements(m_iNumGridPoints);
-
-        PowellIdxVec(t_iCurrentRow, m_iNumGridPoints, t_pVecIdxElements);
-
-        int t_iNumVecElements = m_iNumGridPoints;
-
         while(t_iMaxFound == 0)
         {
+            //Scan all combinations of the current row; the maximum is kept over all scanned rows
+            int t_iRowMaxIdx;
+            double t_val_roh_row = calcMaxSubcorrRow(t_iCurrentRow, t_matQ, t_matSV, t_matC, t_matS_Diag, t_iRowMaxIdx);
 
-            //Multithreading correlation calculation
-            #ifdef _OPENMP
-            #pragma omp parallel num_threads(m_iMaxNumThreads)
-            #endif
+            if(t_val_roh_row > t_val_roh_k || (t_val_roh_row == t_val_roh_k && t_iRowMaxIdx < t_iMaxIdx))
             {
-            #ifdef _OPENMP
-            #pragma omp for
-            #endif
-                for(int i = 0; i < t_iNumVecElements; i++)
-                {
-                    int k = t_pVecIdxElements(i);
-                    //new Version: calculate matrix multiplication before
-                    //Create Lead Field combinations -> It would be better to use a pointer construction, to increase performance
-                    MatrixX6T t_matProj_G(t_matProj_LeadField.rows(),6);
-
-                    int idx1 = m_ppPairIdxCombinations[k]->x1;
-                    int idx2 = m_ppPairIdxCombinations[k]->x2;
-
-                    RapMusic::getGainMatrixPair(t_matProj_LeadField, t_matProj_G, idx1, idx2);
-
-                    t_vecRoh(k) = RapMusic::subcorr(t_matProj_G, t_matU_B);//t_vecRoh holds the correlations roh_k
-                }
+                t_val_roh_k = t_val_roh_row;
+                t_iMaxIdx = t_iRowMaxIdx;
             }
 
-    //         if(r==0)
-    //         {
-    //             std::fstream filestr;
-    //             std::stringstream filename;
-    //             filename << "Roh_gold.txt";
-    //
-    //             filestr.open ( filename.str().c_str(), std::fstream::out);
-    //             for(int i = 0; i < m_iNumLeadFieldCombinations; ++i)
-    //             {
-    //               filestr << t_vecRoh(i) << "\n";
-    //             }
-    //             filestr.close();
-    //
-    //             //exit(0);
-    //         }
-
-            //Find the maximum of correlation - can't put this in the for loop because it's running in different threads.
-
-            VectorXT::Index t_iMaxIdx;
-
-            t_val_roh_k = t_vecRoh.maxCoeff(&t_iMaxIdx);//p_vecCor = ^roh_k
-
-            if((int)t_iMaxIdx == t_iMaxIdx_old)
+            if(t_iMaxIdx == t_iMaxIdx_old)
             {
                 t_iMaxFound = 1;
                 break;
@@ -279,8 +237,7 @@ MNESourceEstimate PwlRapMusic::calculateInverse(const MatrixXd& p_matMeasurement
             {
                 t_iMaxIdx_old = t_iMaxIdx;
                 //get positions in sparsed leadfield from index combinations;
-                t_iIdx1 = m_ppPairIdxCombinations[t_iMaxIdx]->x1;
-                t_iIdx2 = m_ppPairIdxCombinations[t_iMaxIdx]->x2;
+                RapMusic::getPointPair(m_iNumGridPoints, t_iMaxIdx, t_iIdx1, t_iIdx2);
             }
 
 
@@ -289,8 +246,6 @@ MNESourceEstimate PwlRapMusic::calculateInverse(const MatrixXd& p_matMeasurement
                 t_iCurrentRow = t_iIdx2;
             else
                 t_iCurrentRow = t_iIdx1;
-
-            PowellIdxVec(t_iCurrentRow, m_iNumGridPoints, t_pVecIdxElements);
         }
 
         //subcorr benchmark
@@ -361,31 +316,3 @@ int PwlRapMusic::PowellOffset(int p_iRow, int p_iNumPoints)
     return p_iRow*p_iNumPoints - (( (p_iRow-1)*p_iRow) / 2); //triangular series 1 3 6 10 ... = (num_pairs*(num_pairs+1))/2
 
 }
-
-
-//*************************************************************************************************************
-
-void PwlRapMusic::PowellIdxVec(int p_iRow, int p_iNumPoints, Eigen::VectorXi& p_pVecElements)
-{
-
-    //     if(p_pVecElements != NULL)
-    //         delete[] p_pVecElements;
-    //
-    //     p_pVecElements = new int(p_iNumPoints);
-
-
-    //col combination index
-    for(int i = 0; i <= p_iRow; ++i)//=p_iNumPoints-1
-        p_pVecElements(i) = PwlRapMusic::PowellOffset(i+1,p_iNumPoints)-(p_iNumPoints-p_iRow);
-
-
-    //row combination index
-    int off = PwlRapMusic::PowellOffset(p_iRow,p_iNumPoints);
-    int length = p_iNumPoints - p_iRow;
-    int k=0;
-    for(int i = p_iRow; i < p_iRow+length; ++i)//=p_iNumPoints-1
-    {
-        p_pVecElements(i) = off+k;
-        k = k + 1;
-    }
-}
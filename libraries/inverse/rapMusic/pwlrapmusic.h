@@ -148,8 +148,6 @@ public:
 
     static int PowellOffset(int p_iRow, int p_iNumPoints);
 
-    static void PowellIdxVec(int p_iRow, int p_iNumPoints, Eigen::VectorXi& p_pVecElements);
-
     virtual const char* getName() const;
 
 };
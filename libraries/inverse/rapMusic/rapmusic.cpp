@@ -41,6 +41,8 @@
 
 #include <utils/mnemath.h>
 
+#include <algorithm>
+
 #ifdef _OPENMP
 #include <omp.h>
 #endif
@@ -65,7 +67,6 @@ RapMusic::RapMusic()
 , m_iNumGridPoints(0)
 , m_iNumChannels(0)
 , m_iNumLeadFieldCombinations(0)
-, m_ppPairIdxCombinations(NULL)
 , m_iMaxNumThreads(1)
 , m_bIsInit(false)
 , m_iSamplesStcWindow(-1)
@@ -82,7 +83,6 @@ RapMusic::RapMusic(MNEForwardSolution& p_pFwd, bool p_bSparsed, int p_iN, double
 , m_iNumGridPoints(0)
 , m_iNumChannels(0)
 , m_iNumLeadFieldCombinations(0)
-, m_ppPairIdxCombinations(NULL)
 , m_iMaxNumThreads(1)
 , m_bIsInit(false)
 , m_iSamplesStcWindow(-1)
@@ -97,8 +97,6 @@ RapMusic::RapMusic(MNEForwardSolution& p_pFwd, bool p_bSparsed, int p_iN, double
 
 RapMusic::~RapMusic()
 {
-    if(m_ppPairIdxCombinations != NULL)
-        free(m_ppPairIdxCombinations);
 }
 
 
@@ -153,20 +151,9 @@ bool RapMusic::init(MNEForwardSolution& p_pFwd, bool p_bSparsed, int p_iN, doubl
 
     m_ForwardSolution = p_pFwd;
 
-    //##### Calc lead field combination #####
-
-    std::cout << "Calculate gain matrix combinations. \n";
-
+    //Lead field combinations are decoded on the fly -> see getPointPair
     m_iNumLeadFieldCombinations = MNEMath::nchoose2(m_iNumGridPoints+1);
 
-    m_ppPairIdxCombinations = (Pair **)malloc(m_iNumLeadFieldCombinations * sizeof(Pair *));
-
-    calcPairCombinations(m_iNumGridPoints, m_iNumLeadFieldCombinations, m_ppPairIdxCombinations);
-
-    std::cout << "Gain matrix combinations calculated. \n\n";
-
-    //##### Calc lead field combination end #####
-
     std::cout << "Number of grid points: " << m_iNumGridPoints << "\n\n";
 
     std::cout << "Number of combinated points: " << m_iNumLeadFieldCombinations << "\n\n";
@@ -469,37 +456,17 @@ MNESourceEstimate RapMusic::calculateInverse(const MatrixXd& p_matMeasurement, Q
         MatrixXT t_matU_B;
         useFullRank(t_svdProj_Phi_S.matrixU(), t_svdProj_Phi_S.singularValues().asDiagonal(), t_matU_B);
 
-        //Inits
-        VectorXT t_vecRoh(m_iNumLeadFieldCombinations,1);
-        t_vecRoh.setZero();
-
         //subcorr benchmark
         //Stop the time
         clock_t start_subcorr, end_subcorr;
         start_subcorr = clock();
 
-        //Multithreading correlation calculation
-        #ifdef _OPENMP
-        #pragma omp parallel num_threads(m_iMaxNumThreads)
-        #endif
-        {
-        #ifdef _OPENMP
-        #pragma omp for
-        #endif
-            for(int i = 0; i < m_iNumLeadFieldCombinations; i++)
-            {
-                //new Version: calculate matrix multiplication before
-                //Create Lead Field combinations -> It would be better to use a pointer construction, to increase performance
-                MatrixX6T t_matProj_G(t_matProj_LeadField.rows(),6);
+        //Point factors shared by all combinations -> the pairs are evaluated tile by tile
+        MatrixXT t_matQ, t_matSV, t_matC, t_matS_Diag;
+        calcPointFactors(t_matProj_LeadField, t_matU_B, t_matQ, t_matSV, t_matC, t_matS_Diag);
 
-                int idx1 = m_ppPairIdxCombinations[i]->x1;
-                int idx2 = m_ppPairIdxCombinations[i]->x2;
-
-                RapMusic::getGainMatrixPair(t_matProj_LeadField, t_matProj_G, idx1, idx2);
-
-                t_vecRoh(i) = RapMusic::subcorr(t_matProj_G, t_matU_B);//t_vecRoh holds the correlations roh_k
-            }
-        }
+        int t_iMaxIdx;
+        double t_val_roh_k = calcMaxSubcorr(t_matQ, t_matSV, t_matC, t_matS_Diag, t_iMaxIdx);//p_vecCor = ^roh_k
 
 
 //         if(r==0)
@@ -524,16 +491,9 @@ MNESourceEstimate RapMusic::calculateInverse(const MatrixXd& p_matMeasurement, Q
         float t_fSubcorrElapsedTime = ( (float)(end_subcorr-start_subcorr) / (float)CLOCKS_PER_SEC ) * 1000.0f;
         std::cout << "Time Elapsed: " << t_fSubcorrElapsedTime << " ms" << std::endl;
 
-        //Find the maximum of correlation - can't put this in the for loop because it's running in different threads.
-        double t_val_roh_k;
-
-        VectorXT::Index t_iMaxIdx;
-
-        t_val_roh_k = t_vecRoh.maxCoeff(&t_iMaxIdx);//p_vecCor = ^roh_k
-
         //get positions in sparsed leadfield from index combinations;
-        int t_iIdx1 = m_ppPairIdxCombinations[t_iMaxIdx]->x1;
-        int t_iIdx2 = m_ppPairIdxCombinations[t_iMaxIdx]->x2;
+        int t_iIdx1, t_iIdx2;
+        RapMusic::getPointPair(m_iNumGridPoints, t_iMaxIdx, t_iIdx1, t_iIdx2);
 
         // (Idx+1) because of MATLAB positions -> starting with 1 not with 0
         std::cout << "Iteration: " << r+1 << " of " << t_iMaxSearch
@@ -751,6 +711,244 @@ double RapMusic::subcorr(MatrixX6T& p_matProj_G, const MatrixXT& p_matU_B, Vecto
 }
 
 
+//*************************************************************************************************************
+
+double RapMusic::subcorr(   const Matrix3T& p_matQ1_T_Q2,
+                            const Matrix3T& p_matS11,
+                            const Matrix3T& p_matS12,
+                            const Matrix3T& p_matS22,
+                            const Matrix3T& p_matSV1,
+                            const Matrix3T& p_matSV2)
+{
+    //Orthogonalize Q_2 against Q_1: R = Q_2 - Q_1*M with M = Q_1^T*Q_2 -> R^T*R = I - M^T*M
+    const Matrix3T& M = p_matQ1_T_Q2;
+    Matrix3T t_matH = Matrix3T::Identity() - M.transpose()*M;
+
+    //W = Lambda^-1/2 * E^T normalizes R -> the joint basis is Q_J = [Q_1, R*W^T]. Only directions of Q_2 which
+    //lie in the span of Q_1 up to the rounding errors of H are dropped, the truncation to the rank of the pair
+    //is done below on its singular values.
+    Eigen::SelfAdjointEigenSolver<Matrix3T> t_eigH(t_matH);
+    Matrix3T t_matW = Matrix3T::Zero();
+    for(int k = 0; k < 3; ++k)
+        if(t_eigH.eigenvalues()(k) > 1e-14)
+            t_matW.row(k) = t_eigH.eigenvectors().col(k).transpose() / sqrt(t_eigH.eigenvalues()(k));
+
+    //The pair G = [G_1, G_2] with G_i = Q_i*S_i*V_i^T in the joint basis: G = Q_J*B. B has the singular values
+    //of G and U_A = Q_J*U_B with the left singular vectors U_B of B.
+    Matrix6T t_matB = Matrix6T::Zero();
+    t_matB.block<3,3>(0,0) = p_matSV1;
+    t_matB.block<3,3>(0,3) = M*p_matSV2;
+    t_matB.block<3,3>(3,3) = t_matW*t_matH*p_matSV2;
+
+    Eigen::JacobiSVD<Matrix6T> t_svdB(t_matB, Eigen::ComputeFullU);
+
+    //lt. Mosher 1998: Only Retain those Components of U_A that correspond to nonzero singular values -> same
+    //threshold as getRank, which is applied to the singular values of the m x 6 pair by the SVD based subcorr
+    int t_iRank;
+    for(t_iRank = 5; t_iRank > 0; t_iRank--)
+        if(t_svdB.singularValues()(t_iRank) > 0.00001)
+            break;
+    t_iRank++;
+
+    Matrix6T t_matU_r = t_svdB.matrixU();
+    t_matU_r.rightCols(6-t_iRank).setZero();
+
+    //C*C^T of the correlation matrix Q_J^T*U_B = [C_1; W*(C_2 - M^T*C_1)] of the joint basis
+    Matrix3T t_matS11_M = p_matS11*M;
+    Matrix6T t_matCC;
+    t_matCC.block<3,3>(0,0) = p_matS11;
+    t_matCC.block<3,3>(0,3) = (p_matS12 - t_matS11_M)*t_matW.transpose();
+    t_matCC.block<3,3>(3,0) = t_matCC.block<3,3>(0,3).transpose();
+    t_matCC.block<3,3>(3,3) = t_matW*(p_matS22 - M.transpose()*p_matS12 - p_matS12.transpose()*M + M.transpose()*t_matS11_M)*t_matW.transpose();
+
+    //Step 3: largest singular value of U_A^T*U_B = square root of the largest eigenvalue of U_r^T*C*C^T*U_r
+    Matrix6T t_matCC_r = t_matU_r.transpose()*t_matCC*t_matU_r;
+    Eigen::SelfAdjointEigenSolver<Matrix6T> t_eigCC(t_matCC_r, Eigen::EigenvaluesOnly);
+    double t_dMaxEig = t_eigCC.eigenvalues()(5);
+
+    return t_dMaxEig > 0.0 ? sqrt(t_dMaxEig) : 0.0;
+}
+
+
+//*************************************************************************************************************
+
+void RapMusic::calcPointFactors(const MatrixXT& p_matProj_LeadField,
+                                const MatrixXT& p_matU_B,
+                                MatrixXT& p_matQ,
+                                MatrixXT& p_matSV,
+                                MatrixXT& p_matC,
+                                MatrixXT& p_matS_Diag) const
+{
+    p_matQ.resize(p_matProj_LeadField.rows(), p_matProj_LeadField.cols());
+    p_matSV.resize(3, p_matProj_LeadField.cols());
+
+    #ifdef _OPENMP
+    #pragma omp parallel for num_threads(m_iMaxNumThreads)
+    #endif
+    for(int i = 0; i < m_iNumGridPoints; ++i)
+    {
+        //G_i = Q_i*S_i*V_i^T, the full basis is kept -> the rank is determined for each pair, see subcorr
+        Eigen::JacobiSVD<MatrixXT> t_svdProj_G(p_matProj_LeadField.block(0, i*3, p_matProj_LeadField.rows(), 3), Eigen::ComputeThinU | Eigen::ComputeThinV);
+        p_matQ.block(0, i*3, p_matQ.rows(), 3) = t_svdProj_G.matrixU();
+        p_matSV.block<3,3>(0, i*3) = t_svdProj_G.singularValues().asDiagonal() * t_svdProj_G.matrixV().transpose();
+    }
+
+    p_matC = p_matQ.transpose()*p_matU_B;
+
+    p_matS_Diag.resize(3, p_matC.rows());
+    for(int i = 0; i < m_iNumGridPoints; ++i)
+        p_matS_Diag.block<3,3>(0, i*3) = p_matC.middleRows<3>(i*3)*p_matC.middleRows<3>(i*3).transpose();
+}
+
+
+//*************************************************************************************************************
+
+double RapMusic::calcMaxSubcorr(const MatrixXT& p_matQ,
+                                const MatrixXT& p_matSV,
+                                const MatrixXT& p_matC,
+                                const MatrixXT& p_matS_Diag,
+                                int& p_iCombIdx) const
+{
+    int t_iNumTiles = (m_iNumGridPoints + PAIR_TILE_SIZE - 1) / PAIR_TILE_SIZE;
+    int t_iNumTileCombinations = MNEMath::nchoose2(t_iNumTiles+1);
+
+    double t_dMaxCor = -1.0;
+    p_iCombIdx = 0;
+
+    //Multithreading correlation calculation
+    #ifdef _OPENMP
+    #pragma omp parallel num_threads(m_iMaxNumThreads)
+    #endif
+    {
+        double t_dThreadMaxCor = -1.0;
+        int t_iThreadCombIdx = 0;
+
+        MatrixXT t_matQ_T_Q, t_matS;
+
+    #ifdef _OPENMP
+    #pragma omp for schedule(dynamic)
+    #endif
+        for(int t = 0; t < t_iNumTileCombinations; ++t)
+        {
+            //Tiles are combined the same way as the grid points
+            int t_iTile1, t_iTile2;
+            RapMusic::getPointPair(t_iNumTiles, t, t_iTile1, t_iTile2);
+
+            int t_iStart1 = t_iTile1*PAIR_TILE_SIZE;
+            int t_iStart2 = t_iTile2*PAIR_TILE_SIZE;
+            int t_iSize1 = std::min(PAIR_TILE_SIZE, m_iNumGridPoints - t_iStart1);
+            int t_iSize2 = std::min(PAIR_TILE_SIZE, m_iNumGridPoints - t_iStart2);
+
+            //Cross products of all point factors of the tile at once
+            t_matQ_T_Q.noalias() = p_matQ.middleCols(t_iStart1*3, t_iSize1*3).transpose() * p_matQ.middleCols(t_iStart2*3, t_iSize2*3);
+            t_matS.noalias() = p_matC.middleRows(t_iStart1*3, t_iSize1*3) * p_matC.middleRows(t_iStart2*3, t_iSize2*3).transpose();
+
+            for(int i = 0; i < t_iSize1; ++i)
+            {
+                int idx1 = t_iStart1 + i;
+
+                for(int j = (t_iTile1 == t_iTile2) ? i : 0; j < t_iSize2; ++j)
+                {
+                    int idx2 = t_iStart2 + j;
+
+                    double t_dCor = RapMusic::subcorr(  t_matQ_T_Q.block<3,3>(i*3, j*3),
+                                                        p_matS_Diag.block<3,3>(0, idx1*3),
+                                                        t_matS.block<3,3>(i*3, j*3),
+                                                        p_matS_Diag.block<3,3>(0, idx2*3),
+                                                        p_matSV.block<3,3>(0, idx1*3),
+                                                        p_matSV.block<3,3>(0, idx2*3));
+
+                    int t_iCombIdx = RapMusic::getPairIndex(m_iNumGridPoints, idx1, idx2);
+
+                    //ties go to the smallest combination index, independent of the thread scheduling
+                    if(t_dCor > t_dThreadMaxCor || (t_dCor == t_dThreadMaxCor && t_iCombIdx < t_iThreadCombIdx))
+                    {
+                        t_dThreadMaxCor = t_dCor;
+                        t_iThreadCombIdx = t_iCombIdx;
+                    }
+                }
+            }
+        }
+
+        //Find the maximum of correlation
+    #ifdef _OPENMP
+    #pragma omp critical
+    #endif
+        {
+            if(t_dThreadMaxCor > t_dMaxCor || (t_dThreadMaxCor == t_dMaxCor && t_iThreadCombIdx < p_iCombIdx))
+            {
+                t_dMaxCor = t_dThreadMaxCor;
+                p_iCombIdx = t_iThreadCombIdx;
+            }
+        }
+    }
+
+    return t_dMaxCor;
+}
+
+
+//*************************************************************************************************************
+
+double RapMusic::calcMaxSubcorrRow( int p_iRow,
+                                    const MatrixXT& p_matQ,
+                                    const MatrixXT& p_matSV,
+                                    const MatrixXT& p_matC,
+                                    const MatrixXT& p_matS_Diag,
+                                    int& p_iCombIdx) const
+{
+    //Cross products of the row point with all points
+    MatrixXT t_matQ_T_Q = p_matQ.middleCols<3>(p_iRow*3).transpose() * p_matQ;
+    MatrixXT t_matS = p_matC.middleRows<3>(p_iRow*3) * p_matC.transpose();
+
+    double t_dMaxCor = -1.0;
+    p_iCombIdx = 0;
+
+    #ifdef _OPENMP
+    #pragma omp parallel num_threads(m_iMaxNumThreads)
+    #endif
+    {
+        double t_dThreadMaxCor = -1.0;
+        int t_iThreadCombIdx = 0;
+
+    #ifdef _OPENMP
+    #pragma omp for
+    #endif
+        for(int i = 0; i < m_iNumGridPoints; ++i)
+        {
+            //the subspace correlation does not depend on the order of the pair
+            double t_dCor = RapMusic::subcorr(  t_matQ_T_Q.block<3,3>(0, i*3),
+                                                p_matS_Diag.block<3,3>(0, p_iRow*3),
+                                                t_matS.block<3,3>(0, i*3),
+                                                p_matS_Diag.block<3,3>(0, i*3),
+                                                p_matSV.block<3,3>(0, p_iRow*3),
+                                                p_matSV.block<3,3>(0, i*3));
+
+            int t_iCombIdx = i < p_iRow ? RapMusic::getPairIndex(m_iNumGridPoints, i, p_iRow)
+                                        : RapMusic::getPairIndex(m_iNumGridPoints, p_iRow, i);
+
+            if(t_dCor > t_dThreadMaxCor || (t_dCor == t_dThreadMaxCor && t_iCombIdx < t_iThreadCombIdx))
+            {
+                t_dThreadMaxCor = t_dCor;
+                t_iThreadCombIdx = t_iCombIdx;
+            }
+        }
+
+    #ifdef _OPENMP
+    #pragma omp critical
+    #endif
+        {
+            if(t_dThreadMaxCor > t_dMaxCor || (t_dThreadMaxCor == t_dMaxCor && t_iThreadCombIdx < p_iCombIdx))
+            {
+                t_dMaxCor = t_dThreadMaxCor;
+                p_iCombIdx = t_iThreadCombIdx;
+            }
+        }
+    }
+
+    return t_dMaxCor;
+}
+
+
 //*************************************************************************************************************
 
 void RapMusic::calcA_k_1(   const MatrixX6T& p_matG_k_1,
@@ -810,47 +1008,24 @@ void RapMusic::calcOrthProj(const MatrixXT& p_matA_k_1, MatrixXT& p_matOrthProj)
 }
 
 
-//*************************************************************************************************************
-
-void RapMusic::calcPairCombinations(    const int p_iNumPoints,
-                                        const int p_iNumCombinations,
-                                        Pair** p_ppPairIdxCombinations) const
-{
-    int idx1 = 0;
-    int idx2 = 0;
-
-    //Process Code in {m_max_num_threads} threads -> When compile with Intel Compiler -> probably obsolete
-    #ifdef _OPENMP
-    #pragma omp parallel num_threads(m_iMaxNumThreads) private(idx1, idx2)
-    #endif
-    {
-    #ifdef _OPENMP
-    #pragma omp for
-    #endif
-        for (int i = 0; i < p_iNumCombinations; ++i)
-        {
-            RapMusic::getPointPair(p_iNumPoints, i, idx1, idx2);
-
-            Pair* t_pairCombination = new Pair();
-            t_pairCombination->x1 = idx1;
-            t_pairCombination->x2 = idx2;
-
-            p_ppPairIdxCombinations[i] = t_pairCombination;
-        }
-    }
-}
-
-
 //*************************************************************************************************************
 
 void RapMusic::getPointPair(const int p_iPoints, const int p_iCurIdx, int &p_iIdx1, int &p_iIdx2)
 {
-    int ii = p_iPoints*(p_iPoints+1)/2-1-p_iCurIdx;
-    int K = (int)floor((sqrt((double)(8*ii+1))-1)/2);
+    //64 bit intermediates, 8*ii+1 overflows int for a few ten thousand points
+    qint64 t_iNumComb = (qint64)p_iPoints*(p_iPoints+1)/2;
+    qint64 ii = t_iNumComb-1-p_iCurIdx;
+    qint64 K = (qint64)floor((sqrt((double)(8*ii+1))-1)/2);
+
+    //correct rounding of the square root for large indices
+    while((K+1)*(K+2)/2 <= ii)
+        ++K;
+    while(K*(K+1)/2 > ii)
+        --K;
 
-    p_iIdx1 = p_iPoints-1-K;
+    p_iIdx1 = (int)(p_iPoints-1-K);
 
-    p_iIdx2 = (p_iCurIdx-p_iPoints*(p_iPoints+1)/2 + (K+1)*(K+2)/2)+p_iIdx1;
+    p_iIdx2 = (int)((p_iCurIdx-t_iNumComb + (K+1)*(K+2)/2)+p_iIdx1);
 }
 
 
@@ -61,6 +61,7 @@
 #include <Eigen/Core>
 #include <Eigen/SVD>
 #include <Eigen/LU>
+#include <Eigen/Eigenvalues>
 
 
 //*************************************************************************************************************
@@ -86,17 +87,7 @@ using namespace MNELIB;
 
 #define NOT_TRANSPOSED   0  /**< Defines NOT_TRANSPOSED */
 #define IS_TRANSPOSED   1   /**< Defines IS_TRANSPOSED */
-
-
-//=============================================================================================================
-/**
-* Declares a pair structure for index combinations used in RAP MUSIC algorithm.
-*/
-typedef struct Pair
-{
-    int x1; /**< Index one of the pair. */
-    int x2; /**< Index two of the pair. */
-} Pair;
+#define PAIR_TILE_SIZE  32  /**< Number of grid points per tile of the blocked subspace correlation scan */
 
 
 
@@ -125,6 +116,8 @@ public:
                                                                              Eigen::Dynamic> as Matrix6XT type. */
     typedef Eigen::Matrix<double, 6, 6> Matrix6T;                            /**< Defines Eigen::Matrix<T, 6, 6>
                                                                              as Matrix6T type. */
+    typedef Eigen::Matrix<double, 3, 3> Matrix3T;                            /**< Defines Eigen::Matrix<T, 3, 3>
+                                                                             as Matrix3T type. */
     typedef Eigen::Matrix<double, Eigen::Dynamic, 1> VectorXT;               /**< Defines Eigen::Matrix<T, Eigen::Dynamic,
                                                                              1> as VectorXT type. */
     typedef Eigen::Matrix<double, 6, 1> Vector6T;                            /**< Defines Eigen::Matrix<T, 6, 1>
@@ -228,6 +221,88 @@ protected:
     */
     static double subcorr(MatrixX6T& p_matProj_G, const MatrixXT& p_matU_B, Vector6T& p_vec_phi_k_1);
 
+    //=========================================================================================================
+    /**
+    * Computes the subspace correlation of a Lead Field pair from the factors of its two points, without
+    * forming the m x 6 pair matrix. The orthonormal basis of the second point is orthogonalized against the
+    * first one, so only 3 x 3 and 6 x 6 blocks enter the computation. The pair is reduced to its rank with the
+    * threshold of getRank on its singular values, as subcorr(MatrixX6T&, const MatrixXT&) does.
+    *
+    * @param[in] p_matQ1_T_Q2   Cross product Q_1^T * Q_2 of the orthonormal point bases.
+    * @param[in] p_matS11       C_1 * C_1^T with C_1 = Q_1^T * U_B.
+    * @param[in] p_matS12       C_1 * C_2^T.
+    * @param[in] p_matS22       C_2 * C_2^T.
+    * @param[in] p_matSV1       S_1 * V_1^T of the first point, G_1 = Q_1 * S_1 * V_1^T.
+    * @param[in] p_matSV2       S_2 * V_2^T of the second point.
+    * @return   The maximal correlation c_1 of the subspace correlation of the Lead Field combination and the
+    *           projected measurement.
+    */
+    static double subcorr(  const Matrix3T& p_matQ1_T_Q2,
+                            const Matrix3T& p_matS11,
+                            const Matrix3T& p_matS12,
+                            const Matrix3T& p_matS22,
+                            const Matrix3T& p_matSV1,
+                            const Matrix3T& p_matSV2);
+
+    //=========================================================================================================
+    /**
+    * Computes the per point factors of the projected Lead Field which are shared by all pairs a point is part
+    * of: the SVD G_i = Q_i * S_i * V_i^T of the three projected point columns, the projection of the
+    * orthonormal basis onto the signal subspace C_i = Q_i^T * U_B and the Gram block C_i * C_i^T.
+    *
+    * @param[in] p_matProj_LeadField    The projected Lead Field (m x 3*grid points).
+    * @param[in] p_matU_B       The orthonormal basis of the projected signal subspace.
+    * @param[out] p_matQ        The orthonormal point bases Q_i (m x 3*grid points).
+    * @param[out] p_matSV       The blocks S_i * V_i^T side by side (3 x 3*grid points).
+    * @param[out] p_matC        The projected point bases C = Q^T * U_B (3*grid points x rank).
+    * @param[out] p_matS_Diag   The diagonal Gram blocks C_i * C_i^T side by side (3 x 3*grid points).
+    */
+    void calcPointFactors(  const MatrixXT& p_matProj_LeadField,
+                            const MatrixXT& p_matU_B,
+                            MatrixXT& p_matQ,
+                            MatrixXT& p_matSV,
+                            MatrixXT& p_matC,
+                            MatrixXT& p_matS_Diag) const;
+
+    //=========================================================================================================
+    /**
+    * Scans all Lead Field combinations for the maximal subspace correlation. The combinations are processed in
+    * tiles of PAIR_TILE_SIZE x PAIR_TILE_SIZE grid points, for which the cross products of the point factors
+    * are computed with two matrix products.
+    *
+    * @param[in] p_matQ         The orthonormal point bases, see calcPointFactors.
+    * @param[in] p_matSV        The blocks S_i * V_i^T, see calcPointFactors.
+    * @param[in] p_matC         The projected point bases, see calcPointFactors.
+    * @param[in] p_matS_Diag    The diagonal Gram blocks, see calcPointFactors.
+    * @param[out] p_iCombIdx    The combination index of the maximal correlated pair.
+    * @return   The maximal subspace correlation.
+    */
+    double calcMaxSubcorr(  const MatrixXT& p_matQ,
+                            const MatrixXT& p_matSV,
+                            const MatrixXT& p_matC,
+                            const MatrixXT& p_matS_Diag,
+                            int& p_iCombIdx) const;
+
+    //=========================================================================================================
+    /**
+    * Scans all Lead Field combinations which contain the given grid point (one row of the combination matrix)
+    * for the maximal subspace correlation.
+    *
+    * @param[in] p_iRow         The grid point which is combined with all others.
+    * @param[in] p_matQ         The orthonormal point bases, see calcPointFactors.
+    * @param[in] p_matSV        The blocks S_i * V_i^T, see calcPointFactors.
+    * @param[in] p_matC         The projected point bases, see calcPointFactors.
+    * @param[in] p_matS_Diag    The diagonal Gram blocks, see calcPointFactors.
+    * @param[out] p_iCombIdx    The combination index of the maximal correlated pair.
+    * @return   The maximal subspace correlation.
+    */
+    double calcMaxSubcorrRow(   int p_iRow,
+                                const MatrixXT& p_matQ,
+                                const MatrixXT& p_matSV,
+                                const MatrixXT& p_matC,
+                                const MatrixXT& p_matS_Diag,
+                                int& p_iCombIdx) const;
+
     //=========================================================================================================
     /**
     * Calculates the accumulated manifold vectors A_{k1}
@@ -252,21 +327,6 @@ protected:
     */
     void calcOrthProj(const MatrixXT& p_matA_k_1, MatrixXT& p_matOrthProj) const;
 
-    //=========================================================================================================
-    /**
-    * Pre-Calculates the gain matrix index combinations to search for a two dipole independent topography
-    * (IT = source).
-    *
-    * @param[in] p_iNumPoints   The number of Lead Field points -> for dimension check
-    * @param[in] p_iNumCombinations The number of pair index combinations.
-    * @param[out] p_ppPairIdxCombinations   The destination which contains pointer to pointer of index
-    *                                       combinations of Lead Field indices -> Number of pointers =
-    *                                       Combination (number of grid points over 2 = Num + 1 C 2)
-    */
-    void calcPairCombinations(  const int p_iNumPoints,
-                                const int p_iNumCombinations,
-                                Pair** p_ppPairIdxCombinations) const;
-
     //=========================================================================================================
     /**
     * Calculates the combination indices Idx1 and Idx2 of n points.\n
@@ -285,6 +345,17 @@ protected:
     */
     static void getPointPair(const int p_iPoints, const int p_iCurIdx, int &p_iIdx1, int &p_iIdx2);
 
+    //=========================================================================================================
+    /**
+    * Calculates the combination index of the point pair (Idx1, Idx2), the inverse of getPointPair.
+    *
+    * @param[in] p_iPoints  The number of points n which are combined with each other.
+    * @param[in] p_iIdx1    Index 1 of the pair.
+    * @param[in] p_iIdx2    Index 2 of the pair (p_iIdx2 >= p_iIdx1).
+    * @return   The combination index (between 0 and nchoosek(n+1,2)).
+    */
+    static inline int getPairIndex(const int p_iPoints, const int p_iIdx1, const int p_iIdx2);
+
     //=========================================================================================================
     /**
     * Returns a gain matrix pair for the given indices
@@ -322,9 +393,8 @@ protected:
 
     int m_iNumGridPoints;               /**< Number of Grid points. */
     int m_iNumChannels;                 /**< Number of channels */
-    int m_iNumLeadFieldCombinations;    /**< Number of Lead Filed combinations (grid points + 1 over 2)*/
-
-    Pair** m_ppPairIdxCombinations; /**< Index combination vector with grid pair indices. */
+    int m_iNumLeadFieldCombinations;    /**< Number of Lead Filed combinations (grid points + 1 over 2). The pairs
+                                             are not stored, their indices are decoded with getPointPair. */
 
     int m_iMaxNumThreads;   /**< Number of available CPU threads. */
 
@@ -407,6 +477,17 @@ inline int RapMusic::useFullRank(   const MatrixXT& p_Mat,
 }
 
 
+//*************************************************************************************************************
+
+inline int RapMusic::getPairIndex(const int p_iPoints, const int p_iIdx1, const int p_iIdx2)
+{
+    //Row Idx1 starts after the Idx1 preceding rows of length n, n-1, ...
+    qint64 t_iRowOffset = (qint64)p_iIdx1*p_iPoints - ((qint64)p_iIdx1*(p_iIdx1-1))/2;
+
+    return (int)(t_iRowOffset + (p_iIdx2 - p_iIdx1));
+}
+
+
 //*************************************************************************************************************
 
 inline RapMusic::MatrixXT RapMusic::makeSquareMat(const MatrixXT& p_matF)
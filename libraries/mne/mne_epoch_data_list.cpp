@@ -130,25 +130,28 @@ MNEEpochDataList MNEEpochDataList::readEpochs(const FiffRawData& raw,
 
     fiff_int_t event_samp, from, to;
     fiff_int_t dropCount = 0;
-    MatrixXd timesDummy;
-    MatrixXd times;
-
-    MNEEpochData* epoch = Q_NULLPTR;
 
+    //
+    // Read all data segments at once, overlapping raw buffers are read only once
+    //
+    QList<QPair<fiff_int_t,fiff_int_t> > lSegments;
     for (p = 0; p < count; ++p) {
-        // Read a data segment
         event_samp = events(selected(p),0);
         from = event_samp + tmin*raw.info.sfreq;
         to   = event_samp + floor(tmax*raw.info.sfreq + 0.5);
 
-        epoch = new MNEEpochData();
+        lSegments.append(QPair<fiff_int_t,fiff_int_t>(from, to));
+    }
 
-        if(raw.read_raw_segment(epoch->epoch, timesDummy, from, to, picksNew)) {
-            if (p == 0) {
-                times.resize(1, to-from+1);
-                for (qint32 i = 0; i < times.cols(); ++i)
-                    times(0, i) = ((float)(from-event_samp+i)) / raw.info.sfreq;
-            }
+    QList<MatrixXd> lEpochData;
+    raw.read_raw_segments(lEpochData, lSegments, picksNew);
+
+    MNEEpochData* epoch = Q_NULLPTR;
+
+    for (p = 0; p < count; ++p) {
+        if(lEpochData[p].size() > 0) {
+            epoch = new MNEEpochData();
+            epoch->epoch.swap(lEpochData[p]);
 
             epoch->event = event;
             epoch->tmin = tmin;
@@ -168,6 +171,8 @@ MNEEpochDataList MNEEpochDataList::readEpochs(const FiffRawData& raw,
             if(!data.isEmpty()) {
                 if(epoch->epoch.size() == data.last()->epoch.size()) {
                     data.append(MNEEpochData::SPtr(epoch));//List takes ownwership of the pointer - no delete need
+                } else {
+                    delete epoch;
                 }
             } else {
                 data.append(MNEEpochData::SPtr(epoch));//List takes ownwership of the pointer - no delete need
@@ -153,7 +153,7 @@ struct RegionData
         // Kmeans Reduction
         RegionDataOut p_RegionDataOut;
 
-        KMeans t_kMeans(t_sDistMeasure, QString("sample"), 5);
+        KMeans t_kMeans(t_sDistMeasure, QString("plus"), 5, QString("error"), true, 100, true, 0);
 
         if(bUseWhitened)
         {
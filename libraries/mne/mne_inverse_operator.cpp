@@ -185,30 +185,31 @@ bool MNEInverseOperator::assemble_kernel(const Label &label, QString method, boo
 
     if(!label.isEmpty())
     {
-        qDebug() << "ToDo: Label selection needs to be debugged - not done jet!";
         VectorXi src_sel;
         vertno = this->src.label_src_vertno_sel(label, src_sel);
 
-        if(method.compare("MNE") != 0)
+        if(method.compare("MNE") != 0 && noise_norm.rows() == this->nsource)
         {
+            //Position of each source within the selection, -1 if it is not selected
+            VectorXi sel_idx = VectorXi::Constant(noise_norm.rows(), -1);
+            for(qint32 i = 0; i < src_sel.size(); ++i)
+                sel_idx[src_sel[i]] = i;
+
             tripletList.clear();
-            tripletList.reserve(noise_norm.nonZeros());
+            tripletList.reserve(src_sel.size());
 
             for (qint32 k = 0; k < noise_norm.outerSize(); ++k)
             {
                 for (SparseMatrix<double>::InnerIterator it(noise_norm,k); it; ++it)
                 {
-                    //ToDo bad search - increase speed by using stl search
-                    qint32 row = -1;
-                    for(qint32 i = 0; i < src_sel.size(); ++i)
-                        if(src_sel[i] == it.row())
-                            row = i;
-                    if(row != -1)
-                        tripletList.push_back(T(it.row(), it.col(), it.value()));
+                    qint32 row = sel_idx[it.row()];
+                    qint32 col = sel_idx[it.col()];
+                    if(row != -1 && col != -1)
+                        tripletList.push_back(T(row, col, it.value()));
                 }
             }
 
-            noise_norm = SparseMatrix<double>(src_sel.size(),noise_norm.cols());
+            noise_norm = SparseMatrix<double>(src_sel.size(),src_sel.size());
             noise_norm.setFromTriplets(tripletList.begin(), tripletList.end());
         }
 
@@ -225,14 +226,15 @@ bool MNEInverseOperator::assemble_kernel(const Label &label, QString method, boo
             src_sel = src_sel_new;
         }
 
-
+        MatrixXd t_eigen_leads_sel(src_sel.size(), t_eigen_leads.cols());
+        MatrixXd t_source_cov_sel(src_sel.size(), t_source_cov.cols());
         for(qint32 i = 0; i < src_sel.size(); ++i)
         {
-            t_eigen_leads.row(i) = t_eigen_leads.row(src_sel[i]);
-            t_source_cov = t_source_cov.row(src_sel[i]);
+            t_eigen_leads_sel.row(i) = t_eigen_leads.row(src_sel[i]);
+            t_source_cov_sel.row(i) = t_source_cov.row(src_sel[i]);
         }
-        t_eigen_leads.conservativeResize(src_sel.size(), t_eigen_leads.cols());
-        t_source_cov.conservativeResize(src_sel.size(), t_source_cov.cols());
+        t_eigen_leads = t_eigen_leads_sel;
+        t_source_cov = t_source_cov_sel;
     }
 
     if(pick_normal)
@@ -315,6 +317,86 @@ bool MNEInverseOperator::assemble_kernel(const Label &label, QString method, boo
 }
 
 
+//*************************************************************************************************************
+
+bool MNEInverseOperator::assemble_kernel_factors(const Label &label, QString method, bool pick_normal, MatrixXd &leads, MatrixXd &trans, VectorXd &noise_norm, QList<VectorXi> &vertno) const
+{
+    qint32 nsource = this->nsource;
+    qint32 ncomp = this->source_ori == FIFFV_MNE_FREE_ORI ? 3 : 1;
+
+    if(pick_normal)
+    {
+        if(this->source_ori != FIFFV_MNE_FREE_ORI)
+        {
+            qWarning("Warning: Pick normal can only be used with a free orientation inverse operator.\n");
+            return false;
+        }
+
+        bool is_loose = ((0 < this->orient_prior->data(0,0)) && (this->orient_prior->data(0,0) < 1)) ? true : false;
+        if(!is_loose)
+        {
+            qWarning("The pick_normal parameter is only valid when working with loose orientations.\n");
+            return false;
+        }
+    }
+
+    //
+    //   The selected sources
+    //
+    VectorXi src_sel;
+    if(!label.isEmpty())
+        vertno = this->src.label_src_vertno_sel(label, src_sel);
+    else
+    {
+        vertno = this->src.get_vertno();
+        src_sel = VectorXi::LinSpaced(nsource, 0, nsource-1);
+    }
+
+    //
+    //   The rows of the eigenleads belonging to them
+    //
+    VectorXi row_sel;
+    if(ncomp == 3 && !pick_normal)
+    {
+        row_sel.resize(3*src_sel.size());
+        for(qint32 i = 0; i < src_sel.size(); ++i)
+            row_sel.segment(3*i,3) << 3*src_sel[i], 3*src_sel[i]+1, 3*src_sel[i]+2;
+    }
+    else if(ncomp == 3)
+        row_sel = 3*src_sel.array() + 2;
+    else
+        row_sel = src_sel;
+
+    leads.resize(row_sel.size(), this->eigen_leads->data.cols());
+    for(qint32 i = 0; i < row_sel.size(); ++i)
+    {
+        leads.row(i) = this->eigen_leads->data.row(row_sel[i]);
+        //
+        //   R^0.5 has to be factored in unless it has been already
+        //
+        if(!this->eigen_leads_weighted)
+            leads.row(i) *= sqrt(this->source_cov->data(row_sel[i],0));
+    }
+    leads = leads * this->reginv.asDiagonal();
+
+    trans = this->eigen_fields->data*this->whitener*this->proj;
+
+    //
+    //   The noise normalization is one factor per source location
+    //
+    noise_norm.resize(0);
+    if(method.compare("MNE") != 0 && this->noisenorm.rows() == nsource)
+    {
+        VectorXd diag = this->noisenorm.diagonal();
+        noise_norm.resize(src_sel.size());
+        for(qint32 i = 0; i < src_sel.size(); ++i)
+            noise_norm[i] = diag[src_sel[i]];
+    }
+
+    return true;
+}
+
+
 //*************************************************************************************************************
 
 bool MNEInverseOperator::check_ch_names(const FiffInfo &info) const
@@ -236,6 +236,24 @@ public:
     */
     bool assemble_kernel(const Label &label, QString method, bool pick_normal, MatrixXd &K, SparseMatrix<double> &noise_norm, QList<VectorXi> &vertno);
 
+    //=========================================================================================================
+    /**
+    * Assembles the imaging kernel in factored form K = leads * trans. The kernel has at most the rank of the
+    * number of channels, applying the two factors separately costs O((nsource + nchan) * rank) per sample
+    * instead of O(nsource * nchan). With a label only the rows of the selected sources are assembled.
+    *
+    * @param[in] label          Restrict the kernel to the sources within this label (empty = all sources).
+    * @param[in] method         The applied normals. ("MNE" | "dSPM" | "sLORETA")
+    * @param[in] pick_normal    Pick normals.
+    * @param[out] leads         The weighted eigenleads times the regularized inverse (nsource(*3) x rank).
+    * @param[out] trans         The eigenfields times the whitener and the projector (rank x nchan).
+    * @param[out] noise_norm    The noise normalization factors of the selected sources (empty for MNE).
+    * @param[out] vertno        Vertices of the hemispheres.
+    *
+    * @return true when successful, false otherwise
+    */
+    bool assemble_kernel_factors(const Label &label, QString method, bool pick_normal, MatrixXd &leads, MatrixXd &trans, VectorXd &noise_norm, QList<VectorXi> &vertno) const;
+
     //=========================================================================================================
     /**
     * Check that channels in inverse operator are measurements.
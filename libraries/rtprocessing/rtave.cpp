@@ -144,21 +144,12 @@ void RtAveWorker::setAverageNumber(qint32 numAve)
         return;
     }
 
-    if(numAve < m_iNumAverages) {
-        int iDiff = m_iNumAverages - numAve;
+    if(numAve != m_iNumAverages) {
+        //Resize the windows of each trigger type, reducing the number removes the oldest epochs from the running sums
+        QList<double> lTriggerTypes = m_mapStimAve.keys();
 
-        //Do averaging for each trigger type
-        QMutableMapIterator<double,QList<Eigen::MatrixXd> > idx(m_mapStimAve);
-
-        while(idx.hasNext()) {
-            idx.next();
-
-            if(idx.value().size() > iDiff) {
-                //Pop data from buffer
-                for(int i = 0; i < iDiff; ++i) {
-                    idx.value().pop_front();
-                }
-            }
+        for(int i = 0; i < lTriggerTypes.size(); ++i) {
+            resizeEpochWindow(numAve, lTriggerTypes.at(i));
         }
     }
 
@@ -379,7 +370,7 @@ void RtAveWorker::emitEvoked(double dTriggerType, QStringList& lResponsibleTrigg
     emit resultReady(m_stimEvokedSet, lResponsibleTriggerTypes);
 
 //    qDebug()<<"RtAveWorker::emitEvoked() - dTriggerType:" << dTriggerType;
-//    qDebug()<<"RtAveWorker::emitEvoked() - m_mapStimAve[dTriggerType].size():" << m_mapStimAve[dTriggerType].size();
+//    qDebug()<<"RtAveWorker::emitEvoked() - m_mapStimAve[dTriggerType].iCount:" << m_mapStimAve[dTriggerType].iCount;
 }
 
 
@@ -476,16 +467,79 @@ void RtAveWorker::mergeData(double dTriggerType)
     }
 
     if(!bArtifactDetected) {
-        //Add cut data to average buffer
-        m_mapStimAve[dTriggerType].append(mergedData);
-
-        //Pop data from buffer
-        int iDiff =  m_mapStimAve[dTriggerType].size() - m_iNumAverages;
-        if(iDiff > 0) {
-            for(int i = 0; i < iDiff; ++i) {
-                m_mapStimAve[dTriggerType].pop_front();
-            }
-        }
+        //Add cut data to the running sum
+        addEpoch(mergedData, dTriggerType);
+    }
+}
+
+
+//*************************************************************************************************************
+
+void RtAveWorker::addEpoch(const MatrixXd& matEpoch, double dTriggerType)
+{
+    EpochWindow& window = m_mapStimAve[dTriggerType];
+
+    if(window.matSum.rows() != matEpoch.rows() || window.matSum.cols() != matEpoch.cols()) {
+        window.vecEpochs = QVector<MatrixXd>(m_iNumAverages);
+        window.matSum = MatrixXd::Zero(matEpoch.rows(), matEpoch.cols());
+        window.matSumNext = MatrixXd::Zero(matEpoch.rows(), matEpoch.cols());
+        window.iFirst = 0;
+        window.iCount = 0;
+        window.iNumNext = 0;
+    }
+
+    int iNumSlots = window.vecEpochs.size();
+
+    if(window.iCount < iNumSlots) {
+        //The slot matrices are allocated when the window gets filled the first time
+        MatrixXd& matSlot = window.vecEpochs[(window.iFirst + window.iCount) % iNumSlots];
+        matSlot = matEpoch;
+        window.matSum += matSlot;
+        ++window.iCount;
+    } else {
+        //Replace the oldest epoch, the slot has the epoch size so that no allocation takes place
+        MatrixXd& matSlot = window.vecEpochs[window.iFirst];
+        window.matSum -= matSlot;
+        matSlot = matEpoch;
+        window.matSum += matSlot;
+        window.iFirst = (window.iFirst + 1) % iNumSlots;
+    }
+
+    //Once the second sum holds the last iNumSlots epochs it is exactly the sum of the window
+    window.matSumNext += matEpoch;
+
+    if(++window.iNumNext >= iNumSlots) {
+        window.matSum.swap(window.matSumNext);
+        window.matSumNext.setZero();
+        window.iNumNext = 0;
+    }
+}
+
+
+//*************************************************************************************************************
+
+void RtAveWorker::resizeEpochWindow(int iNumAverages, double dTriggerType)
+{
+    EpochWindow& window = m_mapStimAve[dTriggerType];
+
+    //Move the newest epochs to the front of the new ring, oldest first
+    int iNumKept = qMin(window.iCount, iNumAverages);
+    int iNumSlots = window.vecEpochs.size();
+    QVector<MatrixXd> vecEpochs(iNumAverages);
+
+    for(int i = 0; i < iNumKept; ++i) {
+        vecEpochs[i].swap(window.vecEpochs[(window.iFirst + window.iCount - iNumKept + i) % iNumSlots]);
+    }
+
+    window.vecEpochs.swap(vecEpochs);
+    window.iFirst = 0;
+    window.iCount = iNumKept;
+    window.iNumNext = 0;
+    window.matSum.setZero();
+    window.matSumNext.setZero(window.matSum.rows(), window.matSum.cols());
+
+    for(int i = 0; i < iNumKept; ++i) {
+        window.matSum += window.vecEpochs.at(i);
     }
 }
 
@@ -494,7 +548,9 @@ void RtAveWorker::mergeData(double dTriggerType)
 
 void RtAveWorker::generateEvoked(double dTriggerType)
 {
-    if(m_mapStimAve[dTriggerType].isEmpty()) {
+    const EpochWindow& window = m_mapStimAve[dTriggerType];
+
+    if(window.iCount == 0) {
         qDebug() << "RtAveWorker::generateEvoked - m_mapStimAve is empty for type" << dTriggerType << "Returning.";
         return;
     }
@@ -526,16 +582,8 @@ void RtAveWorker::generateEvoked(double dTriggerType)
         evoked.comment = QString::number(dTriggerType);
     }
 
-    // Generate final evoked
-    MatrixXd finalAverage = MatrixXd::Zero(m_mapStimAve[dTriggerType].first().rows(), m_iPreStimSamples+m_iPostStimSamples);
-
-    for(int i = 0; i < m_mapStimAve[dTriggerType].size(); ++i) {
-        finalAverage += m_mapStimAve[dTriggerType].at(i);
-    }
-
-    if(!m_mapStimAve[dTriggerType].isEmpty()) {
-        finalAverage = finalAverage/m_mapStimAve[dTriggerType].size();
-    }
+    // Generate final evoked from the running sum
+    MatrixXd finalAverage = window.matSum / window.iCount;
 
     if(m_bDoBaselineCorrection) {
         finalAverage = MNEMath::rescale(finalAverage, evoked.times, m_pairBaselineSec, QString("mean"));
@@ -543,7 +591,7 @@ void RtAveWorker::generateEvoked(double dTriggerType)
 
     evoked.data = finalAverage;
 
-    evoked.nave = m_mapStimAve[dTriggerType].size();
+    evoked.nave = window.iCount;
 
     //Add new data to evoked data set
     if(iEvokedIdx != -1) {
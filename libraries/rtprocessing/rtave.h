@@ -56,6 +56,7 @@
 #include <QThread>
 #include <QSharedPointer>
 #include <QObject>
+#include <QVector>
 
 
 //*************************************************************************************************************
@@ -205,6 +206,28 @@ public:
     void reset();
 
 protected:
+    /**
+    * The sliding window of the epochs of one trigger type. The epochs are kept in double precision in a ring
+    * buffer with m_iNumAverages slots. The slot matrices are allocated once and overwritten afterwards.
+    * Next to the running sum, a second sum only accumulates the incoming epochs. Once it holds a whole window
+    * it replaces the running sum, which drops the rounding errors of the subtractions at a constant cost per
+    * trigger.
+    */
+    struct EpochWindow {
+        EpochWindow()
+        : iFirst(0)
+        , iCount(0)
+        , iNumNext(0)
+        {}
+
+        QVector<Eigen::MatrixXd>    vecEpochs;          /**< The ring buffer slots. */
+        Eigen::MatrixXd             matSum;             /**< The running sum of the held epochs. */
+        Eigen::MatrixXd             matSumNext;         /**< The sum of the last iNumNext added epochs. */
+        int                         iFirst;             /**< The slot of the oldest epoch. */
+        int                         iCount;             /**< The number of held epochs. */
+        int                         iNumNext;           /**< The number of epochs in matSumNext. */
+    };
+
     //=========================================================================================================
     /**
     * do the actual averaging here.
@@ -233,7 +256,29 @@ protected:
 
     //=========================================================================================================
     /**
-    * Generates the final evoke variable.
+    * Adds an epoch to the running sum and the sliding window of a trigger type. If the window is full, the
+    * oldest epoch is removed from the sum and its slot is overwritten. Costs O(nchan*nsamp) on every trigger,
+    * independently of the number of averages. The running sum is replaced by the second sum once that holds a
+    * whole window, so that the rounding errors of the removals do not build up.
+    *
+    * @param[in] matEpoch       The new epoch.
+    * @param[in] dTriggerType   The trigger type.
+    */
+    void addEpoch(const Eigen::MatrixXd& matEpoch, double dTriggerType);
+
+    //=========================================================================================================
+    /**
+    * Changes the number of slots of the sliding window of a trigger type. The newest epochs which still fit
+    * are kept and the running sum is re-accumulated.
+    *
+    * @param[in] iNumAverages   The new number of slots.
+    * @param[in] dTriggerType   The trigger type.
+    */
+    void resizeEpochWindow(int iNumAverages, double dTriggerType);
+
+    //=========================================================================================================
+    /**
+    * Generates the final evoke variable from the running sum.
     */
     void generateEvoked(double dTriggerType);
 
@@ -267,7 +312,7 @@ protected:
     FIFFLIB::FiffEvokedSet                          m_stimEvokedSet;            /**< Holds the evoked information. */
 
     QMap<QString,double>                            m_mapThresholds;            /**< Holds the current thresholds for artifact rejection. */
-    QMap<double,QList<Eigen::MatrixXd> >            m_mapStimAve;               /**< the current stimulus average buffer. Holds m_iNumAverages vectors */
+    QMap<double,EpochWindow>                        m_mapStimAve;               /**< The sliding windows and running sums of the epochs. Each holds up to m_iNumAverages epochs. */
     QMap<double,Eigen::MatrixXd>                    m_mapDataPre;               /**< The matrix holding pre stim data. */
     QMap<double,Eigen::MatrixXd>                    m_mapDataPost;              /**< The matrix holding post stim data. */
     QMap<double,qint32>                             m_mapMatDataPostIdx;        /**< Current index inside of the matrix m_matDataPost */
@@ -111,6 +111,59 @@ void RtConnectivityWorker::doWork(const ConnectivitySettings &connectivitySettin
 }
 
 
+//*************************************************************************************************************
+
+void RtConnectivityWorker::doWorkIncremental(const ConnectivitySettings &connectivitySettings)
+{
+    if(this->thread()->isInterruptionRequested()) {
+        return;
+    }
+
+    if(connectivitySettings.getConnectivityMethods().isEmpty()) {
+        qDebug()<<"RtConnectivityWorker::doWorkIncremental() - Network methods are empty";
+        return;
+    }
+
+    // Restart the accumulation if the parameters or the data dimensions changed
+    if(!m_pIncrementalSettings ||
+       m_pIncrementalSettings->getConnectivityMethods() != connectivitySettings.getConnectivityMethods() ||
+       m_pIncrementalSettings->getSamplingFrequency() != connectivitySettings.getSamplingFrequency() ||
+       m_pIncrementalSettings->getNumberFFT() != connectivitySettings.getNumberFFT() ||
+       m_pIncrementalSettings->getWindowType() != connectivitySettings.getWindowType() ||
+       m_pIncrementalSettings->getFrequencyBand() != connectivitySettings.getFrequencyBand() ||
+       (!m_pIncrementalSettings->isEmpty() && !connectivitySettings.isEmpty() &&
+        (m_pIncrementalSettings->getNumberNodes() != connectivitySettings.getNumberNodes() ||
+         m_pIncrementalSettings->getNumberSamples() != connectivitySettings.getNumberSamples()))) {
+        m_pIncrementalSettings = ConnectivitySettings::SPtr(new ConnectivitySettings(connectivitySettings));
+        m_pIncrementalSettings->setStreamingMode(true);
+    }
+
+    m_pIncrementalSettings->setNodePositions(connectivitySettings.getNodePositions());
+
+    // Reduce the new trials, this frees them right away
+    const QList<ConnectivitySettings::IntermediateTrialData>& lTrialData = connectivitySettings.getTrialData();
+    QList<Eigen::MatrixXd> lData;
+
+    for(int i = 0; i < lTrialData.size(); ++i) {
+        lData.append(lTrialData.at(i).matData);
+    }
+
+    QElapsedTimer time;
+    qint64 iTime = 0;
+    time.start();
+
+    m_pIncrementalSettings->append(lData);
+
+    QList<Network> finalNetworks = Connectivity::calculate(*m_pIncrementalSettings);
+
+    iTime = time.elapsed();
+
+    qDebug()<<"------RtConnectivityWorker::doWorkIncremental() - New trials:"<< lData.size() << "Number trials:" << m_pIncrementalSettings->size() << "Total time:" << iTime << "ms";
+
+    emit resultReady(finalNetworks, *m_pIncrementalSettings);
+}
+
+
 //*************************************************************************************************************
 //=============================================================================================================
 // DEFINE MEMBER METHODS RtConnectivity
@@ -128,6 +181,9 @@ RtConnectivity::RtConnectivity(QObject *parent)
     connect(this, &RtConnectivity::operate,
             worker, &RtConnectivityWorker::doWork);
 
+    connect(this, &RtConnectivity::operateIncremental,
+            worker, &RtConnectivityWorker::doWorkIncremental);
+
     connect(worker, &RtConnectivityWorker::resultReady,
             this, &RtConnectivity::newConnectivityResultAvailable);
 
@@ -151,6 +207,14 @@ void RtConnectivity::append(const ConnectivitySettings& connectivitySettings)
 }
 
 
+//*************************************************************************************************************
+
+void RtConnectivity::appendIncremental(const ConnectivitySettings& connectivitySettings)
+{
+    emit operateIncremental(connectivitySettings);
+}
+
+
 //*************************************************************************************************************
 
 void RtConnectivity::restart()
@@ -166,6 +230,9 @@ void RtConnectivity::restart()
     connect(this, &RtConnectivity::operate,
             worker, &RtConnectivityWorker::doWork);
 
+    connect(this, &RtConnectivity::operateIncremental,
+            worker, &RtConnectivityWorker::doWorkIncremental);
+
     connect(worker, &RtConnectivityWorker::resultReady,
             this, &RtConnectivity::newConnectivityResultAvailable);
 
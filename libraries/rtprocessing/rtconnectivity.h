@@ -59,6 +59,7 @@
 
 #include <QObject>
 #include <QThread>
+#include <QSharedPointer>
 
 
 //*************************************************************************************************************
@@ -110,6 +111,19 @@ public:
     */
     void doWork(const CONNECTIVITYLIB::ConnectivitySettings& connectivitySettings);
 
+    //=========================================================================================================
+    /**
+    * Reduces the trials of the given settings into the running accumulators of this worker and estimates the
+    * connectivity over all trials received so far. The trials are freed right after the reduction. The
+    * accumulation restarts whenever the methods, spectral parameters or data dimensions change.
+    *
+    * @param[in] connectivitySettings           The connectivity settings holding the parameters and new trials.
+    */
+    void doWorkIncremental(const CONNECTIVITYLIB::ConnectivitySettings& connectivitySettings);
+
+protected:
+    QSharedPointer<CONNECTIVITYLIB::ConnectivitySettings>   m_pIncrementalSettings;     /**< The streaming mode settings holding the accumulated trials. */
+
 signals:
     void resultReady(const  QList<CONNECTIVITYLIB::Network>& connectivityResults, const CONNECTIVITYLIB::ConnectivitySettings& connectivitySettings);
 };
@@ -150,6 +164,15 @@ public:
     */
     void append(const CONNECTIVITYLIB::ConnectivitySettings& connectivitySettings);
 
+    //=========================================================================================================
+    /**
+    * Slot to receive incoming trials which are accumulated with all previously received trials. Only the new
+    * trials need to be passed, the memory use does not grow with the number of trials.
+    *
+    * @param[in] connectivitySettings   The connectivity settings holding the parameters and new trials.
+    */
+    void appendIncremental(const CONNECTIVITYLIB::ConnectivitySettings& connectivitySettings);
+
     //=========================================================================================================
     /**
     * Restarts the thread by interrupting its computation queue, quitting, waiting and then starting it again.
@@ -169,6 +192,7 @@ signals:
     void newConnectivityResultAvailable(const QList<CONNECTIVITYLIB::Network>& connectivityResults, const CONNECTIVITYLIB::ConnectivitySettings& connectivitySettings);
 
     void operate(const CONNECTIVITYLIB::ConnectivitySettings& connectivitySettings);
+    void operateIncremental(const CONNECTIVITYLIB::ConnectivitySettings& connectivitySettings);
 };
 
 //*************************************************************************************************************
@@ -45,6 +45,7 @@
 #include <fiff/fiff_cov.h>
 
 #include <iostream>
+#include <cmath>
 
 
 //*************************************************************************************************************
@@ -53,7 +54,6 @@
 //=============================================================================================================
 
 #include <QDebug>
-#include <QtConcurrent>
 
 
 //*************************************************************************************************************
@@ -70,90 +70,156 @@ using namespace FIFFLIB;
 // DEFINE MEMBER METHODS RtCovWorker
 //=============================================================================================================
 
+RtCovWorker::RtCovWorker()
+: m_dWeight(0.0)
+, m_iWindowSamples(0)
+, m_iRemovedSamples(0)
+, m_mode(Accumulate)
+{
+}
+
+
+//*************************************************************************************************************
+
 void RtCovWorker::doWork(const RtCovInput &inputData)
 {
     if(this->thread()->isInterruptionRequested()) {
         return;
     }
 
-    QFuture<RtCovComputeResult> result = QtConcurrent::mappedReduced(inputData.lData,
-                                                                     compute,
-                                                                     reduce);
+    const MatrixXd& matData = inputData.matData;
 
-    result.waitForFinished();
+    Mode mode = Accumulate;
+    if(inputData.dForgettingFactor < 1.0) {
+        mode = Forgetting;
+    } else if(inputData.iWindowSamples > 0) {
+        mode = Window;
+    }
 
-    RtCovComputeResult finalResult = result.result();
+    //The sums of another mode hold samples which do not belong to the new estimate, e.g. the decayed residue
+    //of the forgetting mode is not part of any window block and could never be removed again
+    if(matData.rows() != m_matSumXXt.rows() || mode != m_mode) {
+        reset(matData.rows());
+        m_mode = mode;
+    }
 
-    //Final computation
-    FiffCov computedCov;
-    computedCov.data = finalResult.matData;
+    if(mode == Forgetting) {
+        //
+        // Exponential forgetting: Weight the accumulated sums down by the forgetting factor of each new sample
+        //
+        double dDecay = std::pow(inputData.dForgettingFactor, (double)matData.cols());
+        m_matSumXXt.triangularView<Lower>() *= dDecay;
+        m_vecSumX *= dDecay;
+        m_dWeight *= dDecay;
+    }
 
-    QStringList exclude;
-    for(int i = 0; i<inputData.fiffInfo.chs.size(); i++) {
-        if(inputData.fiffInfo.chs.at(i).kind != FIFFV_MEG_CH &&
-           inputData.fiffInfo.chs.at(i).kind != FIFFV_EEG_CH) {
-            exclude << inputData.fiffInfo.chs.at(i).ch_name;
+    m_matSumXXt.selfadjointView<Lower>().rankUpdate(matData);
+    m_vecSumX += matData.rowwise().sum();
+    m_dWeight += matData.cols();
+
+    if(mode == Window) {
+        //
+        // Sliding window: Remove the oldest blocks from the sums as long as the window stays filled
+        //
+        m_lWindowData.append(matData);
+        m_iWindowSamples += matData.cols();
+
+        while(m_lWindowData.size() > 1 && m_iWindowSamples - m_lWindowData.first().cols() >= inputData.iWindowSamples) {
+            const MatrixXd& matOld = m_lWindowData.first();
+            m_matSumXXt.selfadjointView<Lower>().rankUpdate(matOld, -1.0);
+            m_vecSumX -= matOld.rowwise().sum();
+            m_dWeight -= matOld.cols();
+            m_iWindowSamples -= matOld.cols();
+            m_iRemovedSamples += matOld.cols();
+            m_lWindowData.removeFirst();
+        }
+
+        //The removal by subtraction accumulates cancellation errors. Once as many samples were removed as the
+        //window holds, the sums are accumulated again from the blocks inside the window. This costs as much as
+        //the updates since the last accumulation, so the cost per sample stays O(nchan^2).
+        if(m_iRemovedSamples >= m_iWindowSamples) {
+            accumulateWindow();
         }
     }
-    bool doProj = true;
 
-    if(inputData.iSamples > 0) {
-        finalResult.mu /= (float)inputData.iSamples;
-        computedCov.data.array() -= inputData.iSamples * (finalResult.mu * finalResult.mu.transpose()).array();
-        computedCov.data.array() /= (inputData.iSamples - 1);
+    if(inputData.bEstimate) {
+        if(inputData.pFiffInfo) {
+            estimate(*inputData.pFiffInfo);
+        }
+    }
+}
 
-        computedCov.kind = FIFFV_MNE_NOISE_COV;
-        computedCov.diag = false;
-        computedCov.dim = computedCov.data.rows();
 
-        //ToDo do picks
-        computedCov.names = inputData.fiffInfo.ch_names;
-        computedCov.projs = inputData.fiffInfo.projs;
-        computedCov.bads = inputData.fiffInfo.bads;
-        computedCov.nfree = inputData.iSamples;
+//*************************************************************************************************************
 
-        // regularize noise covariance
-        computedCov = computedCov.regularize(inputData.fiffInfo, 0.05, 0.05, 0.1, doProj, exclude);
+void RtCovWorker::reset(int iNumChannels)
+{
+    m_matSumXXt = MatrixXd::Zero(iNumChannels, iNumChannels);
+    m_vecSumX = VectorXd::Zero(iNumChannels);
+    m_dWeight = 0.0;
 
-//            qint32 samples = rawSegment.cols();
-//            VectorXf mu = rawSegment.rowwise().sum().array() / (float)samples;
+    m_lWindowData.clear();
+    m_iWindowSamples = 0;
+    m_iRemovedSamples = 0;
+}
 
-//            MatrixXf noise_covariance = rawSegment * rawSegment.transpose();// noise_covariance == raw_covariance
-//            noise_covariance.array() -= samples * (mu * mu.transpose()).array();
-//            noise_covariance.array() /= (samples - 1);
 
-//            std::cout << "Noise Covariance:\n" << noise_covariance.block(0,0,10,10) << std::endl;
+//*************************************************************************************************************
 
-//            printf("%d raw buffer (%d x %d) generated\r\n", count, tmp.rows(), tmp.cols());
-        emit resultReady(computedCov);
-    } else {
-        qDebug() << "RtCovWorker::doWork - Number of samples equals zero. Regularization not possible. Returning without result.";
+void RtCovWorker::accumulateWindow()
+{
+    m_matSumXXt.setZero();
+    m_vecSumX.setZero();
+    m_dWeight = 0.0;
+
+    for(int i = 0; i < m_lWindowData.size(); ++i) {
+        m_matSumXXt.selfadjointView<Lower>().rankUpdate(m_lWindowData.at(i));
+        m_vecSumX += m_lWindowData.at(i).rowwise().sum();
+        m_dWeight += m_lWindowData.at(i).cols();
     }
 
+    m_iRemovedSamples = 0;
 }
 
 
 //*************************************************************************************************************
 
-RtCovComputeResult RtCovWorker::compute(const MatrixXd &matData)
+void RtCovWorker::estimate(const FiffInfo &fiffInfo)
 {
-    RtCovComputeResult result;
-    result.mu = matData.rowwise().sum();
-    result.matData = matData * matData.transpose();
-    return result;
-}
+    //Final computation
+    FiffCov computedCov;
+    computedCov.data = m_matSumXXt.selfadjointView<Lower>();
+
+    QStringList exclude;
+    for(int i = 0; i<fiffInfo.chs.size(); i++) {
+        if(fiffInfo.chs.at(i).kind != FIFFV_MEG_CH &&
+           fiffInfo.chs.at(i).kind != FIFFV_EEG_CH) {
+            exclude << fiffInfo.chs.at(i).ch_name;
+        }
+    }
+    bool doProj = true;
 
+    if(m_dWeight > 1.0) {
+        VectorXd mu = m_vecSumX / m_dWeight;
+        computedCov.data.array() -= m_dWeight * (mu * mu.transpose()).array();
+        computedCov.data.array() /= (m_dWeight - 1.0);
 
-//*************************************************************************************************************
+        computedCov.kind = FIFFV_MNE_NOISE_COV;
+        computedCov.diag = false;
+        computedCov.dim = computedCov.data.rows();
 
-void RtCovWorker::reduce(RtCovComputeResult& finalResult, const RtCovComputeResult &tempResult)
-{
-    if(finalResult.matData.size() == 0 || finalResult.mu.size() == 0) {
-        finalResult.mu = tempResult.mu;
-        finalResult.matData = tempResult.matData;
+        //ToDo do picks
+        computedCov.names = fiffInfo.ch_names;
+        computedCov.projs = fiffInfo.projs;
+        computedCov.bads = fiffInfo.bads;
+        computedCov.nfree = (int)m_dWeight;
+
+        // regularize noise covariance
+        computedCov = computedCov.regularize(fiffInfo, 0.05, 0.05, 0.1, doProj, exclude);
+
+        emit resultReady(computedCov);
     } else {
-        finalResult.mu += tempResult.mu;
-        finalResult.matData += tempResult.matData;
+        qDebug() << "RtCovWorker::estimate - Number of samples too small. Regularization not possible. Returning without result.";
     }
 }
 
@@ -168,8 +234,10 @@ RtCov::RtCov(qint32 iMaxSamples,
              QObject *parent)
 : QObject(parent)
 , m_iMaxSamples(iMaxSamples)
-, m_pFiffInfo(pFiffInfo)
+, m_iWindowSamples(iMaxSamples)
+, m_dForgettingFactor(1.0)
 , m_iSamples(0)
+, m_pFiffInfo(pFiffInfo)
 {
     RtCovWorker *worker = new RtCovWorker;
     worker->moveToThread(&m_workerThread);
@@ -202,6 +270,36 @@ RtCov::~RtCov()
 void RtCov::setSamples(qint32 samples)
 {
     m_iMaxSamples = samples;
+    m_iWindowSamples = samples;
+}
+
+
+//*************************************************************************************************************
+
+void RtCov::setUpdateInterval(qint32 iSamples)
+{
+    m_iMaxSamples = iSamples;
+}
+
+
+//*************************************************************************************************************
+
+void RtCov::setWindowSamples(qint32 iSamples)
+{
+    m_iWindowSamples = iSamples;
+    m_dForgettingFactor = 1.0;
+}
+
+
+//*************************************************************************************************************
+
+void RtCov::setForgettingFactor(double dForgettingFactor)
+{
+    if(dForgettingFactor > 0.0 && dForgettingFactor <= 1.0) {
+        m_dForgettingFactor = dForgettingFactor;
+    } else {
+        qWarning() << "RtCov::setForgettingFactor - Forgetting factor has to be in (0,1]. Keeping" << m_dForgettingFactor;
+    }
 }
 
 
@@ -209,20 +307,22 @@ void RtCov::setSamples(qint32 samples)
 
 void RtCov::append(const MatrixXd &matDataSegment)
 {
-    m_lData.append(matDataSegment);
     m_iSamples += matDataSegment.cols();
 
-    if(m_iSamples >= m_iMaxSamples) {
-        RtCovInput inputData;
-        inputData.lData = m_lData;
-        inputData.fiffInfo = FiffInfo(*m_pFiffInfo);
-        inputData.iSamples = m_iSamples;
-
-        emit operate(inputData);
+    RtCovInput inputData;
+    inputData.matData = matDataSegment;
+    inputData.iWindowSamples = m_iWindowSamples;
+    inputData.dForgettingFactor = m_dForgettingFactor;
+    inputData.bEstimate = m_iSamples >= m_iMaxSamples;
 
+    if(inputData.bEstimate) {
+        //The worker reads the measurement information while this thread may already change it
+        m_pFiffInfoWorker = FiffInfo::SPtr(new FiffInfo(*m_pFiffInfo));
         m_iSamples = 0;
-        m_lData.clear();
     }
+    inputData.pFiffInfo = m_pFiffInfoWorker;
+
+    emit operate(inputData);
 }
 
 
@@ -87,15 +87,12 @@ namespace RTPROCESSINGLIB
 // RTPROCESSINGLIB FORWARD DECLARATIONS
 //=============================================================================================================
 
-struct RtCovComputeResult {
-    Eigen::VectorXd mu;
-    Eigen::MatrixXd matData;
-};
-
 struct RtCovInput {
-    QList<Eigen::MatrixXd>      lData;
-    FIFFLIB::FiffInfo           fiffInfo;
-    int                         iSamples;
+    Eigen::MatrixXd                     matData;            /**< The new data block. */
+    QSharedPointer<FIFFLIB::FiffInfo>   pFiffInfo;          /**< Snapshot of the measurement information, only read by the worker. */
+    int                                 iWindowSamples;     /**< Length of the sliding window in samples, 0 to accumulate all samples. */
+    double                              dForgettingFactor;  /**< Exponential forgetting factor per sample, 1 to disable forgetting. */
+    bool                                bEstimate;          /**< Whether a covariance should be estimated after adding the block. */
 };
 
 
@@ -112,31 +109,60 @@ class RTPROCESINGSHARED_EXPORT RtCovWorker : public QObject
 public:
     //=========================================================================================================
     /**
-    * Perform actual covariance estimation.
+    * Constructs a RtCovWorker.
+    */
+    RtCovWorker();
+
+    //=========================================================================================================
+    /**
+    * Adds a new data block to the accumulated sums with a rank-k update, which costs O(nchan^2) per sample and
+    * does not depend on the window length. Old samples are either forgotten exponentially or the oldest blocks
+    * are removed from the sums when they leave the sliding window. The window sums are accumulated again from
+    * the window blocks whenever a full window was removed, so cancellation errors do not build up. Switching
+    * between forgetting, sliding window and accumulating all samples clears the sums. If requested, the
+    * covariance is estimated from the accumulated sums.
     *
-    * @param[in] inputData  Data to estimate the covariance from.
+    * @param[in] inputData  The new data block and the estimation settings.
     */
     void doWork(const RtCovInput &inputData);
 
 protected:
+    enum Mode {
+        Accumulate,     /**< Accumulate all samples. */
+        Window,         /**< Sliding window. */
+        Forgetting      /**< Exponential forgetting. */
+    };
+
     //=========================================================================================================
     /**
-    * Computer multiplication with transposed.
-    *
-    * @param[in] matData  Data to self multiply with.
+    * Clears the accumulated sums.
     *
-    * @return   The multiplication result.
+    * @param[in] iNumChannels   Number of channels of the following data blocks.
     */
-    static RtCovComputeResult compute(const Eigen::MatrixXd &matData);
+    void reset(int iNumChannels);
 
     //=========================================================================================================
     /**
-    * Computer multiplication with transposed.
+    * Accumulates the sums again from the data blocks inside the sliding window.
+    */
+    void accumulateWindow();
+
+    //=========================================================================================================
+    /**
+    * Estimates, regularizes and emits the covariance from the accumulated sums.
     *
-    * @param[out]   finalResult     The final covariance estimation.
-    * @param[in]    tempResult      The intermediate result from the compute function
+    * @param[in] fiffInfo   The measurement information.
     */
-    static void reduce(RtCovComputeResult& finalResult, const RtCovComputeResult &tempResult);
+    void estimate(const FIFFLIB::FiffInfo &fiffInfo);
+
+    Eigen::MatrixXd         m_matSumXXt;        /**< Accumulated X*X^T, only the lower triangle is updated. */
+    Eigen::VectorXd         m_vecSumX;          /**< Accumulated row sums of X. */
+    double                  m_dWeight;          /**< Accumulated (effective) number of samples. */
+
+    QList<Eigen::MatrixXd>  m_lWindowData;      /**< The data blocks inside the sliding window. */
+    int                     m_iWindowSamples;   /**< The number of samples inside the sliding window. */
+    int                     m_iRemovedSamples;  /**< The number of samples removed from the sums since they were last accumulated from the window. */
+    Mode                    m_mode;             /**< The mode the sums were accumulated with. */
 
 signals:
     //=========================================================================================================
@@ -191,12 +217,37 @@ public:
 
     //=========================================================================================================
     /**
-    * Set number of estimation samples
+    * Set number of estimation samples. Sets the sliding window and the update interval to this number of samples.
     *
     * @param[in] samples    estimation samples to set
     */
     void setSamples(qint32 samples);
 
+    //=========================================================================================================
+    /**
+    * Sets the number of newly received samples after which a covariance is estimated from the accumulated sums.
+    *
+    * @param[in] iSamples   The update interval in samples.
+    */
+    void setUpdateInterval(qint32 iSamples);
+
+    //=========================================================================================================
+    /**
+    * Sets the length of the sliding window. Disables exponential forgetting.
+    *
+    * @param[in] iSamples   The window length in samples, 0 to accumulate all received samples.
+    */
+    void setWindowSamples(qint32 iSamples);
+
+    //=========================================================================================================
+    /**
+    * Sets the exponential forgetting factor per sample, which replaces the sliding window if it is smaller than 1.
+    * E.g. 1 - 1/(60*sfreq) lets samples which are older than roughly one minute fade out.
+    *
+    * @param[in] dForgettingFactor  The forgetting factor in (0,1], 1 to use the sliding window instead.
+    */
+    void setForgettingFactor(double dForgettingFactor);
+
     //=========================================================================================================
     /**
     * Restarts the thread by interrupting its computation queue, quitting, waiting and then starting it again.
@@ -218,13 +269,13 @@ protected:
 
     QThread                 m_workerThread;             /**< The worker thread. */
 
-    qint32                  m_iMaxSamples;              /**< Maximal amount of samples received, before covariance is estimated.*/
-    qint32                  m_iNewMaxSamples;           /**< New maximal amount of samples received, before covariance is estimated.*/
-    int                     m_iSamples;                 /**< The number of stored samples. */
-
-    QList<Eigen::MatrixXd>  m_lData;                    /**< The stored data blocks. */
+    qint32                  m_iMaxSamples;              /**< Amount of samples received, before covariance is estimated (update interval).*/
+    qint32                  m_iWindowSamples;           /**< Length of the sliding window in samples, 0 to accumulate all samples.*/
+    double                  m_dForgettingFactor;        /**< Exponential forgetting factor per sample, 1 to use the sliding window.*/
+    int                     m_iSamples;                 /**< The number of samples received since the last estimation. */
 
     QSharedPointer<FIFFLIB::FiffInfo>  m_pFiffInfo;     /**< Holds the fiff measurement information. */
+    QSharedPointer<FIFFLIB::FiffInfo>  m_pFiffInfoWorker;   /**< Snapshot of the fiff measurement information, which is passed to the worker. */
 
 signals:
     //=========================================================================================================
@@ -237,9 +288,9 @@ signals:
 
     //=========================================================================================================
     /**
-    * Emit this signal whenver the worker should process a new batch of stored data blocks.
+    * Emit this signal whenver the worker should process a new data block.
     *
-    * @param[in] inputData  The new batch of stored data.
+    * @param[in] inputData  The new data block.
     */
     void operate(const RtCovInput &inputData);
 
@@ -43,6 +43,7 @@
 #include "rtprocessing_global.h"
 
 #include <utils/filterTools/filterdata.h>
+#include <utils/filterTools/overlapsavefilter.h>
 #include <fiff/fiff_info.h>
 
 
@@ -107,11 +108,16 @@ public:
 
     //=========================================================================================================
     /**
-    * Calculates the filtered version of the raw input data
+    * Calculates the filtered version of the raw input data. The blocks are streamed through an overlap-save
+    * filter, which keeps the filter spectrum, the FFT plans and the history between calls. The filter is only
+    * reconfigured if the filters, the channel list or the number of channels change.
     *
-    * @param [in] matDataIn     data which is to be filtered
-    * @param [out] matDataOut    data which is to be filtered
-    * @param [in] iDataIndex    current position in the global data matrix
+    * @param [in] matDataIn             data which is to be filtered
+    * @param [in] iMaxFilterLength      the maximal filter length. Not used anymore, the filter length is derived from lFilterData.
+    * @param [in] lFilterChannelList    the indices of the channels to filter
+    * @param [in] lFilterData           the filters which are applied one after another
+    *
+    * @return the filtered data, delayed by half of the filter length. Channels which are not filtered are delayed by the same amount.
     */
     Eigen::MatrixXd filterChannelsConcurrently(const Eigen::MatrixXd& matDataIn,
                                                int iMaxFilterLength,
@@ -119,8 +125,9 @@ public:
                                                const QList<UTILSLIB::FilterData> &lFilterData);
 
 protected:
-    Eigen::MatrixXd                 m_matOverlap;                   /**< Last overlap block */
-    Eigen::MatrixXd                 m_matDelay;                     /**< Last delay block */
+    UTILSLIB::OverlapSaveFilter     m_overlapSaveFilter;            /**< The streaming overlap-save filter */
+    QList<Eigen::RowVectorXd>       m_lFilterCoeffs;                /**< The coefficients of the filters m_overlapSaveFilter was set up with */
+    QVector<int>                    m_lFilterChannelList;           /**< The channel list m_overlapSaveFilter was set up with */
 
 private:
 
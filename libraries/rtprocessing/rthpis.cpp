@@ -93,13 +93,17 @@ void RtHPISWorker::doWork(const Eigen::MatrixXd& matData,
     fitResult.devHeadTrans.from = 1;
     fitResult.devHeadTrans.to = 4;
 
-    HPIFit::fitHPI(matData,
-                    matProjectors,
-                    fitResult.devHeadTrans,
-                    vFreqs,
-                    fitResult.errorDistances,
-                    fitResult.fittedCoils,
-                    pFiffInfo);
+    if(!m_pHPIFit) {
+        m_pHPIFit = HPIFit::SPtr(new HPIFit());
+    }
+
+    m_pHPIFit->fit(matData,
+                   matProjectors,
+                   fitResult.devHeadTrans,
+                   vFreqs,
+                   fitResult.errorDistances,
+                   fitResult.fittedCoils,
+                   pFiffInfo);
 
     emit resultReady(fitResult);
 }
@@ -80,6 +80,10 @@ namespace FIFFLIB{
     class FiffInfo;
 }
 
+namespace INVERSELIB{
+    class HPIFit;
+}
+
 
 //*************************************************************************************************************
 //=============================================================================================================
@@ -105,7 +109,8 @@ struct FittingResult {
 
 //=============================================================================================================
 /**
-* Real-time HPI worker.
+* Real-time HPI worker. The worker keeps one HPIFit object, so the fit setup is cached and each fit is warm
+* started from the previously fitted coil positions.
 *
 * @brief Real-time HPI worker.
 */
@@ -128,6 +133,9 @@ public:
                 const QVector<int>& vFreqs,
                 QSharedPointer<FIFFLIB::FiffInfo> pFiffInfo);
 
+protected:
+    QSharedPointer<INVERSELIB::HPIFit>  m_pHPIFit;     /**< The persistent HPI fitter. */
+
 signals:
     void resultReady(const RTPROCESSINGLIB::FittingResult &fitResult);
 };
@@ -0,0 +1,349 @@
+//=============================================================================================================
+/**
+* @file     overlapsavefilter.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     October, 2018
+*
+* @section  LICENSE
+*
+* Copyright (C) 2018, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Definition of the OverlapSaveFilter Class
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "overlapsavefilter.h"
+#include "filterdata.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STL INCLUDES
+//=============================================================================================================
+
+#include <cstring>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Qt INCLUDES
+//=============================================================================================================
+
+#include <QDebug>
+#include <QThread>
+#include <QtConcurrent/QtConcurrent>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace UTILSLIB;
+using namespace Eigen;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE GLOBAL METHODS
+//=============================================================================================================
+
+namespace {
+
+const int MIN_ROWS_PER_BLOCK = 4;       /**< Minimum number of channels per concurrently filtered channel block. */
+
+int nextPowerOfTwo(int iValue)
+{
+    int iResult = 1;
+    while(iResult < iValue) {
+        iResult <<= 1;
+    }
+    return iResult;
+}
+
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+OverlapSaveFilter::OverlapSaveFilter()
+: m_iNumChannels(0)
+, m_iBlockSize(0)
+, m_iFFTLength(0)
+{
+}
+
+
+//*************************************************************************************************************
+
+OverlapSaveFilter::OverlapSaveFilter(const RowVectorXd& vecCoeff,
+                                     int iNumChannels)
+: m_iNumChannels(0)
+, m_iBlockSize(0)
+, m_iFFTLength(0)
+{
+    setCoefficients(vecCoeff);
+    setChannels(iNumChannels);
+}
+
+
+//*************************************************************************************************************
+
+void OverlapSaveFilter::setCoefficients(const RowVectorXd& vecCoeff)
+{
+    m_vecCoeff = vecCoeff;
+
+    //The history length changes, start a new stream
+    m_iBlockSize = 0;
+    m_matInput.resize(0,0);
+    m_matDelay.resize(0,0);
+}
+
+
+//*************************************************************************************************************
+
+void OverlapSaveFilter::setCoefficients(const QList<FilterData>& lFilterData)
+{
+    //A cascade of FIR filters is a single FIR filter with the convolved coefficients
+    RowVectorXd vecCoeff;
+
+    for(int i = 0; i < lFilterData.size(); ++i) {
+        const RowVectorXd& vecFilterCoeff = lFilterData.at(i).m_dCoeffA;
+
+        if(vecFilterCoeff.cols() == 0) {
+            continue;
+        }
+
+        if(vecCoeff.cols() == 0) {
+            vecCoeff = vecFilterCoeff;
+            continue;
+        }
+
+        RowVectorXd vecConv = RowVectorXd::Zero(vecCoeff.cols() + vecFilterCoeff.cols() - 1);
+        for(int j = 0; j < vecFilterCoeff.cols(); ++j) {
+            vecConv.segment(j, vecCoeff.cols()) += vecFilterCoeff(j) * vecCoeff;
+        }
+        vecCoeff = vecConv;
+    }
+
+    setCoefficients(vecCoeff);
+}
+
+
+//*************************************************************************************************************
+
+void OverlapSaveFilter::setChannels(int iNumChannels)
+{
+    QVector<int> vecFilterChannels;
+    for(int i = 0; i < iNumChannels; ++i) {
+        vecFilterChannels.append(i);
+    }
+
+    setChannels(iNumChannels, vecFilterChannels);
+}
+
+
+//*************************************************************************************************************
+
+void OverlapSaveFilter::setChannels(int iNumChannels,
+                                    const QVector<int>& vecFilterChannels)
+{
+    m_iNumChannels = qMax(0, iNumChannels);
+    m_vecFilterChannels.clear();
+    m_vecPassChannels.clear();
+
+    QVector<bool> vecIsFiltered(m_iNumChannels, false);
+    for(int i = 0; i < vecFilterChannels.size(); ++i) {
+        if(vecFilterChannels.at(i) >= 0 && vecFilterChannels.at(i) < m_iNumChannels) {
+            vecIsFiltered[vecFilterChannels.at(i)] = true;
+        }
+    }
+
+    for(int i = 0; i < m_iNumChannels; ++i) {
+        if(vecIsFiltered.at(i)) {
+            m_vecFilterChannels.append(i);
+        } else {
+            m_vecPassChannels.append(i);
+        }
+    }
+
+    //The buffer layout changes, start a new stream
+    m_iBlockSize = 0;
+    m_matInput.resize(0,0);
+    m_matDelay.resize(0,0);
+}
+
+
+//*************************************************************************************************************
+
+void OverlapSaveFilter::reset()
+{
+    m_matInput.setZero();
+    m_matDelay.setZero();
+}
+
+
+//*************************************************************************************************************
+
+bool OverlapSaveFilter::filter(MatrixXd& matData)
+{
+    if(matData.rows() != m_iNumChannels) {
+        qWarning() << "[OverlapSaveFilter::filter] Number of rows" << matData.rows() << "does not match the number of channels" << m_iNumChannels;
+        return false;
+    }
+
+    if(matData.cols() == 0 || m_vecCoeff.cols() == 0) {
+        return true;
+    }
+
+    prepare(matData.cols());
+
+    //Filter the channels
+    for(int i = 0; i < m_vecChannelBlocks.size(); ++i) {
+        m_vecChannelBlocks[i].pFilter = this;
+        m_vecChannelBlocks[i].pData = &matData;
+    }
+
+    if(m_vecChannelBlocks.size() == 1) {
+        filterChannelBlock(m_vecChannelBlocks[0]);
+    } else if(m_vecChannelBlocks.size() > 1) {
+        QtConcurrent::blockingMap(m_vecChannelBlocks, &OverlapSaveFilter::filterChannelBlock);
+    }
+
+    //Delay the channels which are not filtered
+    const int iDelay = delay();
+    const int iBlockSize = matData.cols();
+
+    if(iDelay > 0) {
+        RowVectorXd vecStream(iDelay + iBlockSize);
+
+        for(int i = 0; i < m_vecPassChannels.size(); ++i) {
+            vecStream << m_matDelay.row(i), matData.row(m_vecPassChannels.at(i));
+            matData.row(m_vecPassChannels.at(i)) = vecStream.head(iBlockSize);
+            m_matDelay.row(i) = vecStream.tail(iDelay);
+        }
+    }
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+void OverlapSaveFilter::prepare(int iBlockSize)
+{
+    if(iBlockSize == m_iBlockSize) {
+        return;
+    }
+
+    //The channel blocks create their FFTW plans concurrently on their first transform
+    #ifdef EIGEN_FFTW_DEFAULT
+        fftw_make_planner_thread_safe();
+    #endif
+
+    const int iHistory = m_vecCoeff.cols() - 1;
+    const int iNumRows = m_vecFilterChannels.size();
+
+    m_iBlockSize = iBlockSize;
+    m_iFFTLength = nextPowerOfTwo(iHistory + iBlockSize);
+
+    //Transform the filter once for this FFT length
+    RowVectorXd vecCoeffPadded = RowVectorXd::Zero(m_iFFTLength);
+    vecCoeffPadded.head(m_vecCoeff.cols()) = m_vecCoeff;
+
+    FFT<double> fft;
+    fft.SetFlag(FFT<double>::HalfSpectrum);
+    m_vecFilterSpectrum.resize(m_iFFTLength/2 + 1);
+    fft.fwd(m_vecFilterSpectrum.data(), vecCoeffPadded.data(), m_iFFTLength);
+
+    //Resize the input buffer, keep the history of a running stream
+    Matrix<double, Dynamic, Dynamic, RowMajor> matInput = Matrix<double, Dynamic, Dynamic, RowMajor>::Zero(iNumRows, m_iFFTLength);
+    if(m_matInput.rows() == iNumRows && m_matInput.cols() >= iHistory) {
+        matInput.leftCols(iHistory) = m_matInput.leftCols(iHistory);
+    }
+    m_matInput.swap(matInput);
+
+    if(m_matDelay.rows() != m_vecPassChannels.size() || m_matDelay.cols() != delay()) {
+        m_matDelay = MatrixXd::Zero(m_vecPassChannels.size(), delay());
+    }
+
+    //Split the channels into blocks which are filtered concurrently
+    int iNumBlocks = qMin(QThread::idealThreadCount(), iNumRows / MIN_ROWS_PER_BLOCK);
+    iNumBlocks = iNumRows > 0 ? qMax(1, iNumBlocks) : 0;
+
+    m_vecChannelBlocks.resize(iNumBlocks);
+
+    for(int i = 0; i < iNumBlocks; ++i) {
+        ChannelBlock& block = m_vecChannelBlocks[i];
+        block.pFilter = this;
+        block.pData = Q_NULLPTR;
+        block.iFirstRow = (i * iNumRows) / iNumBlocks;
+        block.iNumRows = ((i + 1) * iNumRows) / iNumBlocks - block.iFirstRow;
+        block.fft = FFT<double>();
+        block.fft.SetFlag(FFT<double>::HalfSpectrum);
+        block.vecSpectrum.resize(m_iFFTLength/2 + 1);
+        block.vecResult.resize(m_iFFTLength);
+    }
+}
+
+
+//*************************************************************************************************************
+
+void OverlapSaveFilter::filterChannelBlock(ChannelBlock& block)
+{
+    OverlapSaveFilter& filter = *block.pFilter;
+    MatrixXd& matData = *block.pData;
+
+    const int iHistory = filter.m_vecCoeff.cols() - 1;
+    const int iBlockSize = filter.m_iBlockSize;
+    const int iFFTLength = filter.m_iFFTLength;
+
+    for(int r = block.iFirstRow; r < block.iFirstRow + block.iNumRows; ++r) {
+        const int iChannel = filter.m_vecFilterChannels.at(r);
+        double* pInput = filter.m_matInput.row(r).data();
+
+        //Append the new samples to the history, the tail of the buffer stays zero
+        filter.m_matInput.row(r).segment(iHistory, iBlockSize) = matData.row(iChannel);
+
+        block.fft.fwd(block.vecSpectrum.data(), pInput, iFFTLength);
+        block.vecSpectrum.array() *= filter.m_vecFilterSpectrum.array();
+        block.fft.inv(block.vecResult.data(), block.vecSpectrum.data(), iFFTLength);
+
+        //The first iHistory samples are corrupted by the circular convolution, the following ones are valid
+        matData.row(iChannel) = block.vecResult.segment(iHistory, iBlockSize);
+
+        //Keep the last iHistory input samples for the next block
+        if(iHistory > 0) {
+            std::memmove(pInput, pInput + iBlockSize, iHistory * sizeof(double));
+        }
+    }
+}
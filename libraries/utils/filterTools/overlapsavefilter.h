@@ -0,0 +1,287 @@
+//=============================================================================================================
+/**
+* @file     overlapsavefilter.h
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     October, 2018
+*
+* @section  LICENSE
+*
+* Copyright (C) 2018, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Declaration of the OverlapSaveFilter Class
+*
+*/
+
+#ifndef OVERLAPSAVEFILTER_H
+#define OVERLAPSAVEFILTER_H
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "../utils_global.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+#include <unsupported/Eigen/FFT>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Qt INCLUDES
+//=============================================================================================================
+
+#include <QList>
+#include <QSharedPointer>
+#include <QVector>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE NAMESPACE UTILSLIB
+//=============================================================================================================
+
+namespace UTILSLIB
+{
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// FORWARD DECLARATIONS
+//=============================================================================================================
+
+class FilterData;
+
+
+//=============================================================================================================
+/**
+* Streams blocks of multichannel data through a FIR filter with the overlap-save method. The spectrum of the
+* filter and the FFT plans are computed once for a block length and reused for all following blocks. The last
+* (NumTaps-1) input samples of each filtered channel are kept in front of the next block inside one contiguous,
+* channel-major buffer, which is transformed in place. The channels are split into contiguous blocks, which are
+* filtered concurrently, each with its own FFT object.
+*
+* The output of each filtered channel is the causal convolution of the stream with the filter, i.e. it is delayed
+* by the group delay NumTaps/2 of the linear phase filter. Channels which are not filtered are delayed by the same
+* number of samples, so that all channels stay aligned.
+*
+* @brief Block-streaming multichannel overlap-save FIR filter
+*/
+class UTILSSHARED_EXPORT OverlapSaveFilter
+{
+
+public:
+    typedef QSharedPointer<OverlapSaveFilter> SPtr;             /**< Shared pointer type for OverlapSaveFilter. */
+    typedef QSharedPointer<const OverlapSaveFilter> ConstSPtr;  /**< Const shared pointer type for OverlapSaveFilter. */
+
+    //=========================================================================================================
+    /**
+    * Constructs an OverlapSaveFilter without filter coefficients, which passes all data through undelayed.
+    */
+    OverlapSaveFilter();
+
+    //=========================================================================================================
+    /**
+    * Constructs an OverlapSaveFilter.
+    *
+    * @param [in] vecCoeff          The FIR filter coefficients.
+    * @param [in] iNumChannels      The number of channels (rows) of the data blocks, all of which are filtered.
+    */
+    OverlapSaveFilter(const Eigen::RowVectorXd& vecCoeff,
+                      int iNumChannels);
+
+    //=========================================================================================================
+    /**
+    * Sets the FIR filter coefficients and resets the stream.
+    *
+    * @param [in] vecCoeff      The FIR filter coefficients.
+    */
+    void setCoefficients(const Eigen::RowVectorXd& vecCoeff);
+
+    //=========================================================================================================
+    /**
+    * Sets the filter coefficients of a cascade of filters, i.e. the convolution of the coefficients of all
+    * filters, and resets the stream.
+    *
+    * @param [in] lFilterData   The filters which are applied one after another.
+    */
+    void setCoefficients(const QList<FilterData>& lFilterData);
+
+    //=========================================================================================================
+    /**
+    * Sets the channels, all of which are filtered, and resets the stream.
+    *
+    * @param [in] iNumChannels          The number of channels (rows) of the data blocks.
+    */
+    void setChannels(int iNumChannels);
+
+    //=========================================================================================================
+    /**
+    * Sets the channels and resets the stream.
+    *
+    * @param [in] iNumChannels          The number of channels (rows) of the data blocks.
+    * @param [in] vecFilterChannels     The indices of the channels to filter. Invalid indices are ignored.
+    */
+    void setChannels(int iNumChannels,
+                     const QVector<int>& vecFilterChannels);
+
+    //=========================================================================================================
+    /**
+    * Clears the history of the stream, as if the next block was the first one.
+    */
+    void reset();
+
+    //=========================================================================================================
+    /**
+    * Filters the next block of the stream in place. The FFT length is only adapted if the number of samples of the
+    * block changes.
+    *
+    * @param [in, out] matData  The next block (channels x samples), replaced by the filtered block.
+    *
+    * @return false if the number of rows does not match the number of channels, the block is left unchanged.
+    */
+    bool filter(Eigen::MatrixXd& matData);
+
+    //=========================================================================================================
+    /**
+    * Returns the filter coefficients.
+    *
+    * @return the filter coefficients.
+    */
+    inline const Eigen::RowVectorXd& coefficients() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the number of channels.
+    *
+    * @return the number of channels.
+    */
+    inline int numChannels() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the indices of the filtered channels.
+    *
+    * @return the indices of the filtered channels.
+    */
+    inline const QVector<int>& filterChannels() const;
+
+    //=========================================================================================================
+    /**
+    * Returns the delay of the output in samples, the group delay of the filter.
+    *
+    * @return the delay in samples.
+    */
+    inline int delay() const;
+
+private:
+    //=========================================================================================================
+    /**
+    * A contiguous block of filtered channels with its own FFT object and scratch memory.
+    */
+    struct ChannelBlock {
+        OverlapSaveFilter*              pFilter;        /**< The filter this block belongs to. */
+        Eigen::MatrixXd*                pData;          /**< The data block to write the filtered samples to. */
+        int                             iFirstRow;      /**< First row of the block in the input buffer. */
+        int                             iNumRows;       /**< Number of rows of the block. */
+        Eigen::FFT<double>              fft;            /**< The FFT object, which caches the plans of this block. */
+        Eigen::RowVectorXcd             vecSpectrum;    /**< Scratch memory for the spectrum of one channel. */
+        Eigen::RowVectorXd              vecResult;      /**< Scratch memory for the filtered segment of one channel. */
+    };
+
+    //=========================================================================================================
+    /**
+    * Adapts the FFT length, the filter spectrum and the buffers to a new block length. Keeps the history.
+    *
+    * @param [in] iBlockSize    The number of samples per block.
+    */
+    void prepare(int iBlockSize);
+
+    //=========================================================================================================
+    /**
+    * Filters one block of channels. Called concurrently for different blocks.
+    *
+    * @param [in, out] block    The channel block.
+    */
+    static void filterChannelBlock(ChannelBlock& block);
+
+    Eigen::RowVectorXd          m_vecCoeff;             /**< The FIR filter coefficients. */
+    int                         m_iNumChannels;         /**< The number of channels. */
+    QVector<int>                m_vecFilterChannels;    /**< The indices of the filtered channels. */
+    QVector<int>                m_vecPassChannels;      /**< The indices of the channels which are only delayed. */
+
+    int                         m_iBlockSize;           /**< The number of samples per block the buffers are prepared for, 0 if not prepared. */
+    int                         m_iFFTLength;           /**< The FFT length. */
+    Eigen::RowVectorXcd         m_vecFilterSpectrum;    /**< The half spectrum of the zero padded filter coefficients. */
+
+    Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> m_matInput;  /**< History and current block of each filtered channel, one row per channel. */
+    Eigen::MatrixXd             m_matDelay;             /**< The last delay() samples of each channel which is only delayed. */
+    QVector<ChannelBlock>       m_vecChannelBlocks;     /**< The channel blocks, which are filtered concurrently. */
+};
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INLINE DEFINITIONS
+//=============================================================================================================
+
+inline const Eigen::RowVectorXd& OverlapSaveFilter::coefficients() const
+{
+    return m_vecCoeff;
+}
+
+
+//*************************************************************************************************************
+
+inline int OverlapSaveFilter::numChannels() const
+{
+    return m_iNumChannels;
+}
+
+
+//*************************************************************************************************************
+
+inline const QVector<int>& OverlapSaveFilter::filterChannels() const
+{
+    return m_vecFilterChannels;
+}
+
+
+//*************************************************************************************************************
+
+inline int OverlapSaveFilter::delay() const
+{
+    return m_vecCoeff.cols() / 2;
+}
+
+} // NAMESPACE UTILSLIB
+
+#endif // OVERLAPSAVEFILTER_H
@@ -0,0 +1,600 @@
+//=============================================================================================================
+/**
+* @file     lockfreecircularmatrixbuffer.h
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     October, 2018
+*
+* @section  LICENSE
+*
+* Copyright (C) 2018, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    LockFreeCircularMatrixBuffer class declaration
+*
+*/
+
+#ifndef LOCKFREECIRCULARMATRIXBUFFER_H
+#define LOCKFREECIRCULARMATRIXBUFFER_H
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include "../utils_global.h"
+#include "buffer.h"
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STL INCLUDES
+//=============================================================================================================
+
+#include <typeinfo>
+#include <string.h>
+#include <stdio.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Qt INCLUDES
+//=============================================================================================================
+
+#include <QAtomicInt>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QWaitCondition>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE NAMESPACE IOBUFFER
+//=============================================================================================================
+
+namespace IOBUFFER
+{
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace Eigen;
+
+
+//=============================================================================================================
+/**
+* Lock-free circular matrix buffer for exactly one producer and one consumer thread. In contrast to
+* CircularMatrixBuffer, matrices are copied as a whole into preallocated, cache line aligned slots and only the
+* slot indices are synchronized (one atomic operation per matrix). push and pop block while the buffer is full or
+* empty, tryPush and tryPop return immediately. A mutex is only taken on the slow path, when a thread has to sleep.
+*
+* @brief The lock-free single producer single consumer circular matrix buffer
+*/
+template<typename _Tp>
+class LockFreeCircularMatrixBuffer : public Buffer
+{
+public:
+    typedef QSharedPointer<LockFreeCircularMatrixBuffer> SPtr;              /**< Shared pointer type for LockFreeCircularMatrixBuffer. */
+    typedef QSharedPointer<const LockFreeCircularMatrixBuffer> ConstSPtr;   /**< Const shared pointer type for LockFreeCircularMatrixBuffer. */
+
+    //=========================================================================================================
+    /**
+    * Constructs a LockFreeCircularMatrixBuffer.
+    *
+    * @param [in] uiMaxNumMatrices  Number of matrix slots.
+    * @param [in] uiRows            Number of rows.
+    * @param [in] uiCols            Number of columns.
+    */
+    explicit LockFreeCircularMatrixBuffer(unsigned int uiMaxNumMatrices, unsigned int uiRows, unsigned int uiCols);
+
+    //=========================================================================================================
+    /**
+    * Destroys the LockFreeCircularMatrixBuffer.
+    */
+    ~LockFreeCircularMatrixBuffer();
+
+    //=========================================================================================================
+    /**
+    * Adds a whole matrix at the end of the buffer. Blocks while the buffer is full. Must only be called from the
+    * producer thread.
+    *
+    * @param [in] pMatrix pointer to a Matrix which should be appended to the end.
+    *
+    * @return true if the matrix was appended, false if it was skipped (paused, wrong dimensions, released).
+    */
+    inline bool push(const Matrix<_Tp, Dynamic, Dynamic>* pMatrix);
+
+    //=========================================================================================================
+    /**
+    * Adds a whole matrix at the end of the buffer if there is a free slot. Never blocks. Must only be called from
+    * the producer thread.
+    *
+    * @param [in] pMatrix pointer to a Matrix which should be appended to the end.
+    *
+    * @return true if the matrix was appended, false if the buffer is full or the matrix was skipped.
+    */
+    inline bool tryPush(const Matrix<_Tp, Dynamic, Dynamic>* pMatrix);
+
+    //=========================================================================================================
+    /**
+    * Returns the first matrix (first in first out). Blocks while the buffer is empty. Must only be called from the
+    * consumer thread.
+    *
+    * @return the first matrix, a zero matrix if the buffer is paused or was released.
+    */
+    inline Matrix<_Tp, Dynamic, Dynamic> pop();
+
+    //=========================================================================================================
+    /**
+    * Copies the first matrix (first in first out) into a caller owned matrix, which is only resized if its
+    * dimensions do not match. Blocks while the buffer is empty. Must only be called from the consumer thread.
+    *
+    * @param [out] matrix   the matrix to write to.
+    *
+    * @return true if a matrix was popped, false if a zero matrix was returned (paused or released).
+    */
+    inline bool pop(Matrix<_Tp, Dynamic, Dynamic>& matrix);
+
+    //=========================================================================================================
+    /**
+    * Copies the first matrix (first in first out) into a caller owned matrix if the buffer is not empty. Never
+    * blocks. Must only be called from the consumer thread.
+    *
+    * @param [out] matrix   the matrix to write to.
+    *
+    * @return true if a matrix was popped, false otherwise.
+    */
+    inline bool tryPop(Matrix<_Tp, Dynamic, Dynamic>& matrix);
+
+    //=========================================================================================================
+    /**
+    * Clears the buffer. A producer or consumer which was released before and is still waiting stays released.
+    */
+    void clear();
+
+    //=========================================================================================================
+    /**
+    * Size of the buffer.
+    */
+    inline quint32 size() const;
+
+    //=========================================================================================================
+    /**
+    * Number of matrices which are currently stored in the buffer.
+    */
+    inline quint32 count() const;
+
+    //=========================================================================================================
+    /**
+    * Rows of the stored matrices of the buffer.
+    */
+    inline quint32 rows() const;
+
+    //=========================================================================================================
+    /**
+    * Cols of the stored matrices of the buffer.
+    */
+    inline quint32 cols() const;
+
+    //=========================================================================================================
+    /**
+    * Pauses the buffer. Skips any incoming matrices and only pops zero matrices.
+    */
+    inline void pause(bool);
+
+    //=========================================================================================================
+    /**
+    * Releases a consumer which is blocked in pop(). The blocked pop returns a zero matrix.
+    * @param [out] bool returns true if the consumer had to be released because the buffer was empty, otherwise false.
+    */
+    inline bool releaseFromPop();
+
+    //=========================================================================================================
+    /**
+    * Releases a producer which is blocked in push(). The matrix of the blocked push is skipped.
+    * @param [out] bool returns true if the producer had to be released because the buffer was full, otherwise false.
+    */
+    inline bool releaseFromPush();
+
+private:
+    //=========================================================================================================
+    /**
+    * Returns the next index. Indices run from 0 to 2*m_uiMaxNumMatrices-1, which allows to distinguish between a
+    * full and an empty buffer without a separate counter.
+    *
+    * @param [in] index     the current index.
+    * @return the next index.
+    */
+    inline int nextIndex(int index) const;
+
+    //=========================================================================================================
+    /**
+    * Returns the pointer to the slot of the given index.
+    *
+    * @param [in] index     the index.
+    * @return the slot.
+    */
+    inline _Tp* slot(int index) const;
+
+    //=========================================================================================================
+    /**
+    * Returns the number of matrices between the given read and write index.
+    */
+    inline quint32 count(int iReadIndex, int iWriteIndex) const;
+
+    enum {
+        CacheLineSize = 64      /**< Assumed size of a cache line in bytes. */
+    };
+
+    unsigned int    m_uiMaxNumMatrices;         /**< Holds the maximal number of matrices.*/
+    unsigned int    m_uiRows;                   /**< Holds the number rows.*/
+    unsigned int    m_uiCols;                   /**< Holds the number cols.*/
+    unsigned int    m_uiSlotStride;             /**< Holds the distance between two slots in elements, a multiple of the cache line size.*/
+    char*           m_pMemory;                  /**< Holds the allocated memory.*/
+    _Tp*            m_pBuffer;                  /**< Holds the cache line aligned slots.*/
+    QMutex          m_mutex;                    /**< Only taken by a thread which has to wait, and to wake it.*/
+    QWaitCondition  m_condNotEmpty;             /**< Signals a waiting consumer that a matrix was pushed.*/
+    QWaitCondition  m_condNotFull;              /**< Signals a waiting producer that a matrix was popped.*/
+    QAtomicInt      m_iPause;                   /**< Whether the buffer is paused.*/
+
+    char            m_padRead[CacheLineSize];   /**< Keeps the read index on its own cache line.*/
+    QAtomicInt      m_iReadIndex;               /**< Holds the read index, only written by the consumer.*/
+    QAtomicInt      m_iWaitingConsumer;         /**< Whether the consumer waits for a matrix.*/
+    QAtomicInt      m_iReleasePop;              /**< Set to release a waiting consumer.*/
+
+    char            m_padWrite[CacheLineSize];  /**< Keeps the write index on its own cache line.*/
+    QAtomicInt      m_iWriteIndex;              /**< Holds the write index, only written by the producer.*/
+    QAtomicInt      m_iWaitingProducer;         /**< Whether the producer waits for a free slot.*/
+    QAtomicInt      m_iReleasePush;             /**< Set to release a waiting producer.*/
+
+    char            m_padEnd[CacheLineSize];    /**< Keeps the indices apart from following data.*/
+};
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// DEFINE MEMBER METHODS
+//=============================================================================================================
+
+template<typename _Tp>
+LockFreeCircularMatrixBuffer<_Tp>::LockFreeCircularMatrixBuffer(unsigned int uiMaxNumMatrices, unsigned int uiRows, unsigned int uiCols)
+: Buffer(typeid(_Tp).name())
+, m_uiMaxNumMatrices(uiMaxNumMatrices > 0 ? uiMaxNumMatrices : 1)
+, m_uiRows(uiRows)
+, m_uiCols(uiCols)
+, m_uiSlotStride(((m_uiRows*m_uiCols*sizeof(_Tp) + CacheLineSize - 1) / CacheLineSize) * CacheLineSize / sizeof(_Tp))
+, m_pMemory(new char[(size_t)m_uiMaxNumMatrices*m_uiSlotStride*sizeof(_Tp) + CacheLineSize])
+, m_pBuffer(reinterpret_cast<_Tp*>(m_pMemory + (CacheLineSize - reinterpret_cast<quintptr>(m_pMemory) % CacheLineSize) % CacheLineSize))
+, m_iPause(0)
+, m_iReadIndex(0)
+, m_iWaitingConsumer(0)
+, m_iReleasePop(0)
+, m_iWriteIndex(0)
+, m_iWaitingProducer(0)
+, m_iReleasePush(0)
+{
+
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+LockFreeCircularMatrixBuffer<_Tp>::~LockFreeCircularMatrixBuffer()
+{
+    delete [] m_pMemory;
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline bool LockFreeCircularMatrixBuffer<_Tp>::push(const Matrix<_Tp, Dynamic, Dynamic>* pMatrix)
+{
+    if(tryPush(pMatrix))
+        return true;
+
+    if(m_iPause.loadAcquire() || (unsigned int)pMatrix->rows() != m_uiRows || (unsigned int)pMatrix->cols() != m_uiCols)
+        return false;
+
+    //
+    // Slow path: wait for the consumer to free a slot
+    //
+    m_iWaitingProducer.fetchAndStoreOrdered(1);
+
+    m_mutex.lock();
+    while(count(m_iReadIndex.fetchAndAddOrdered(0), m_iWriteIndex.loadAcquire()) >= m_uiMaxNumMatrices) {
+        if(m_iReleasePush.fetchAndStoreOrdered(0)) {
+            m_mutex.unlock();
+            m_iWaitingProducer.fetchAndStoreOrdered(0);
+            return false;
+        }
+        m_condNotFull.wait(&m_mutex);
+    }
+    m_mutex.unlock();
+
+    m_iWaitingProducer.fetchAndStoreOrdered(0);
+
+    return tryPush(pMatrix);
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline bool LockFreeCircularMatrixBuffer<_Tp>::tryPush(const Matrix<_Tp, Dynamic, Dynamic>* pMatrix)
+{
+    if(m_iPause.loadAcquire())
+        return false;
+
+    if((unsigned int)pMatrix->rows() != m_uiRows || (unsigned int)pMatrix->cols() != m_uiCols) {
+        printf("Error: Matrix not appended to LockFreeCircularMatrixBuffer - wrong dimensions\n");
+        return false;
+    }
+
+    int iWriteIndex = m_iWriteIndex.loadAcquire();
+
+    if(count(m_iReadIndex.loadAcquire(), iWriteIndex) >= m_uiMaxNumMatrices)
+        return false;
+
+    memcpy(slot(iWriteIndex), pMatrix->data(), m_uiRows*m_uiCols*sizeof(_Tp));
+
+    //Publish the slot, the ordered store also orders it before the check for a waiting consumer
+    m_iWriteIndex.fetchAndStoreOrdered(nextIndex(iWriteIndex));
+
+    if(m_iWaitingConsumer.fetchAndAddOrdered(0)) {
+        m_mutex.lock();
+        m_condNotEmpty.wakeAll();
+        m_mutex.unlock();
+    }
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline Matrix<_Tp, Dynamic, Dynamic> LockFreeCircularMatrixBuffer<_Tp>::pop()
+{
+    Matrix<_Tp, Dynamic, Dynamic> matrix(m_uiRows, m_uiCols);
+
+    pop(matrix);
+
+    return matrix;
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline bool LockFreeCircularMatrixBuffer<_Tp>::pop(Matrix<_Tp, Dynamic, Dynamic>& matrix)
+{
+    if(m_iPause.loadAcquire()) {
+        matrix.setZero(m_uiRows, m_uiCols);
+        return false;
+    }
+
+    if(tryPop(matrix))
+        return true;
+
+    //
+    // Slow path: wait for the producer to push a matrix
+    //
+    m_iWaitingConsumer.fetchAndStoreOrdered(1);
+
+    m_mutex.lock();
+    while(count(m_iReadIndex.loadAcquire(), m_iWriteIndex.fetchAndAddOrdered(0)) == 0) {
+        if(m_iReleasePop.fetchAndStoreOrdered(0)) {
+            m_mutex.unlock();
+            m_iWaitingConsumer.fetchAndStoreOrdered(0);
+            matrix.setZero(m_uiRows, m_uiCols);
+            return false;
+        }
+        m_condNotEmpty.wait(&m_mutex);
+    }
+    m_mutex.unlock();
+
+    m_iWaitingConsumer.fetchAndStoreOrdered(0);
+
+    return tryPop(matrix);
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline bool LockFreeCircularMatrixBuffer<_Tp>::tryPop(Matrix<_Tp, Dynamic, Dynamic>& matrix)
+{
+    int iReadIndex = m_iReadIndex.loadAcquire();
+
+    if(count(iReadIndex, m_iWriteIndex.loadAcquire()) == 0)
+        return false;
+
+    if((unsigned int)matrix.rows() != m_uiRows || (unsigned int)matrix.cols() != m_uiCols)
+        matrix.resize(m_uiRows, m_uiCols);
+
+    memcpy(matrix.data(), slot(iReadIndex), m_uiRows*m_uiCols*sizeof(_Tp));
+
+    //Free the slot, the ordered store also orders it before the check for a waiting producer
+    m_iReadIndex.fetchAndStoreOrdered(nextIndex(iReadIndex));
+
+    if(m_iWaitingProducer.fetchAndAddOrdered(0)) {
+        m_mutex.lock();
+        m_condNotFull.wakeAll();
+        m_mutex.unlock();
+    }
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+void LockFreeCircularMatrixBuffer<_Tp>::clear()
+{
+    m_mutex.lock();
+    m_iReadIndex.fetchAndStoreOrdered(0);
+    m_iWriteIndex.fetchAndStoreOrdered(0);
+    //Keep pending releases of threads which did not leave their wait yet
+    if(!m_iWaitingConsumer.fetchAndAddOrdered(0))
+        m_iReleasePop.fetchAndStoreOrdered(0);
+    if(!m_iWaitingProducer.fetchAndAddOrdered(0))
+        m_iReleasePush.fetchAndStoreOrdered(0);
+    m_mutex.unlock();
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline quint32 LockFreeCircularMatrixBuffer<_Tp>::size() const
+{
+    return m_uiMaxNumMatrices;
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline quint32 LockFreeCircularMatrixBuffer<_Tp>::count() const
+{
+    return count(m_iReadIndex.loadAcquire(), m_iWriteIndex.loadAcquire());
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline quint32 LockFreeCircularMatrixBuffer<_Tp>::rows() const
+{
+    return m_uiRows;
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline quint32 LockFreeCircularMatrixBuffer<_Tp>::cols() const
+{
+    return m_uiCols;
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline void LockFreeCircularMatrixBuffer<_Tp>::pause(bool bPause)
+{
+    m_iPause.fetchAndStoreOrdered(bPause ? 1 : 0);
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline bool LockFreeCircularMatrixBuffer<_Tp>::releaseFromPop()
+{
+    if(count() == 0) {
+        m_mutex.lock();
+        m_iReleasePop.fetchAndStoreOrdered(1);
+        m_condNotEmpty.wakeAll();
+        m_mutex.unlock();
+
+        return true;
+    }
+
+    return false;
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline bool LockFreeCircularMatrixBuffer<_Tp>::releaseFromPush()
+{
+    if(count() >= m_uiMaxNumMatrices) {
+        m_mutex.lock();
+        m_iReleasePush.fetchAndStoreOrdered(1);
+        m_condNotFull.wakeAll();
+        m_mutex.unlock();
+
+        return true;
+    }
+
+    return false;
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline int LockFreeCircularMatrixBuffer<_Tp>::nextIndex(int index) const
+{
+    return (index + 1) % (2 * (int)m_uiMaxNumMatrices);
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline _Tp* LockFreeCircularMatrixBuffer<_Tp>::slot(int index) const
+{
+    return m_pBuffer + (size_t)(index % m_uiMaxNumMatrices) * m_uiSlotStride;
+}
+
+
+//*************************************************************************************************************
+
+template<typename _Tp>
+inline quint32 LockFreeCircularMatrixBuffer<_Tp>::count(int iReadIndex, int iWriteIndex) const
+{
+    return (quint32)((iWriteIndex - iReadIndex + 2 * (int)m_uiMaxNumMatrices) % (2 * (int)m_uiMaxNumMatrices));
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// TYPEDEF
+//=============================================================================================================
+
+typedef UTILSSHARED_EXPORT LockFreeCircularMatrixBuffer<int>       _int_LockFreeCircularMatrixBuffer;       /**< Defines LockFreeCircularMatrixBuffer of integer type.*/
+typedef UTILSSHARED_EXPORT LockFreeCircularMatrixBuffer<float>     _float_LockFreeCircularMatrixBuffer;     /**< Defines LockFreeCircularMatrixBuffer of float type.*/
+typedef UTILSSHARED_EXPORT LockFreeCircularMatrixBuffer<char>      _char_LockFreeCircularMatrixBuffer;      /**< Defines LockFreeCircularMatrixBuffer of char type.*/
+typedef UTILSSHARED_EXPORT LockFreeCircularMatrixBuffer<double>    _double_LockFreeCircularMatrixBuffer;    /**< Defines LockFreeCircularMatrixBuffer of double type.*/
+
+} // NAMESPACE
+
+#endif // LOCKFREECIRCULARMATRIXBUFFER_H
@@ -59,6 +59,7 @@
 //=============================================================================================================
 
 #include <QDebug>
+#include <QtConcurrent>
 
 
 //*************************************************************************************************************
@@ -74,13 +75,15 @@ using namespace UTILSLIB;
 // DEFINE MEMBER METHODS
 //=============================================================================================================
 
-KMeans::KMeans(QString distance, QString start, qint32 replicates, QString emptyact, bool online, qint32 maxit)
+KMeans::KMeans(QString distance, QString start, qint32 replicates, QString emptyact, bool online, qint32 maxit, bool accelerated, qint32 seed)
 : m_sDistance(distance)
 , m_sStart(start)
 , m_iReps(replicates)
 , m_sEmptyact(emptyact)
 , m_iMaxit(maxit)
 , m_bOnline(online)
+, m_bAccelerated(accelerated)
+, m_iSeed(seed)
 , emptyErrCnt(0)
 , iter(0)
 , k(0)
@@ -102,8 +105,11 @@ bool KMeans::calculate( MatrixXd X, qint32 kClusters, VectorXi& idx, MatrixXd& C
     if (kClusters < 1)
         return false;
 
+    if (m_bAccelerated && (m_sDistance.compare("sqeuclidean") == 0 || m_sDistance.compare("cityblock") == 0))
+        return calculateBounded(X, kClusters, idx, C, sumD, D);
+
     //Init random generator
-    srand ( time(NULL) );
+    srand ( m_iSeed >= 0 ? m_iSeed : time(NULL) );
 
 // n points in p dimensional space
     k = kClusters;
@@ -194,6 +200,11 @@ bool KMeans::calculate( MatrixXd X, qint32 kClusters, VectorXi& idx, MatrixXd& C
 //            C.block(1,0,1,p) = X.block(7, 0, 1, p);
 //            C.block(2,0,1,p) = X.block(17, 0, 1, p);
         }
+        else if (m_sStart.compare("plus") == 0)
+        {
+            std::mt19937 rng(rand());
+            C = initCentroids(X, rng);
+        }
     //    else if (start.compare("cluster") == 0)
     //    {
     //        Xsubset = X(randsample(n,floor(.1*n)),:);
@@ -327,6 +338,327 @@ bool KMeans::calculate( MatrixXd X, qint32 kClusters, VectorXi& idx, MatrixXd& C
 }
 
 
+//*************************************************************************************************************
+
+bool KMeans::calculateBounded(const MatrixXd& X, qint32 kClusters, VectorXi& idx, MatrixXd& C, VectorXd& sumD, MatrixXd& D)
+{
+    // n points in p dimensional space
+    k = kClusters;
+    n = X.rows();
+    p = X.cols();
+
+    if (m_sStart.compare("uniform") != 0 && m_sStart.compare("sample") != 0 && m_sStart.compare("plus") != 0)
+    {
+        printf("Error: Unknown start %s\n", m_sStart.toUtf8().constData());
+        return false;
+    }
+
+    // points and centroids are stored column wise, so each one is contiguous in memory
+    MatrixXd Xt = X.transpose();
+
+    quint32 seed = m_iSeed >= 0 ? m_iSeed : time(NULL);
+
+    QVector<VectorXi> idxReps(m_iReps);
+    QVector<MatrixXd> CReps(m_iReps);
+    VectorXd totsumDReps(m_iReps);
+    VectorXi convergedReps(m_iReps);
+
+    QList<qint32> reps;
+    for(qint32 rep = 0; rep < m_iReps; ++rep)
+        reps.append(rep);
+
+    QtConcurrent::blockingMap(reps, [&](qint32 rep)
+    {
+        std::mt19937 rng(seed + rep);
+
+        MatrixXd Ct = initCentroids(X, rng).transpose();
+        VectorXi idxRep;
+
+        convergedReps[rep] = boundedUpdate(Xt, Ct, idxRep) ? 1 : 0;
+
+        // Total sum of distances
+        double totsumDRep = 0;
+        for(qint32 i = 0; i < n; ++i)
+        {
+            if (m_sDistance.compare("cityblock") == 0)
+                totsumDRep += (Xt.col(i) - Ct.col(idxRep[i])).cwiseAbs().sum();
+            else
+                totsumDRep += (Xt.col(i) - Ct.col(idxRep[i])).squaredNorm();
+        }
+
+        idxReps[rep] = idxRep;
+        CReps[rep] = Ct.transpose();
+        totsumDReps[rep] = totsumDRep;
+    });
+
+    // Select the best solution in the order of the replicates
+    qint32 best = 0;
+    for(qint32 rep = 0; rep < m_iReps; ++rep)
+    {
+        if (!convergedReps[rep])
+            printf("Failed To Converge during replicate %d\n", rep);
+
+        if (totsumDReps[rep] < totsumDReps[best])
+            best = rep;
+    }
+
+    idx = idxReps[best];
+    C = CReps[best];
+    totsumD = totsumDReps[best];
+
+    // Distances of every point to each cluster centroid and cluster-wise sums of distances
+    D = distfun(X, C);
+
+    sumD = VectorXd::Zero(k);
+    for(qint32 i = 0; i < n; ++i)
+        sumD[idx[i]] += D(i, idx[i]);
+
+    return true;
+}
+
+
+//*************************************************************************************************************
+
+bool KMeans::boundedUpdate(const MatrixXd& Xt, MatrixXd& Ct, VectorXi& idx) const
+{
+    const bool bCityblock = m_sDistance.compare("cityblock") == 0;
+    const qint32 nPoints = Xt.cols();
+    const qint32 kClusters = Ct.cols();
+
+    // Metric distances, the triangle inequality does not hold for the squared euclidean distance
+    auto pointDist = [&](qint32 i, qint32 j) -> double {
+        return bCityblock ? (Xt.col(i) - Ct.col(j)).cwiseAbs().sum() : (Xt.col(i) - Ct.col(j)).norm();
+    };
+    auto centroidDist = [&](const MatrixXd& A, qint32 i, const MatrixXd& B, qint32 j) -> double {
+        return bCityblock ? (A.col(i) - B.col(j)).cwiseAbs().sum() : (A.col(i) - B.col(j)).norm();
+    };
+
+    // Blocks of points are assigned in parallel
+    const qint32 blockSize = 64;
+    QList<qint32> blockStarts;
+    for(qint32 i = 0; i < nPoints; i += blockSize)
+        blockStarts.append(i);
+
+    // Initial assignment: upper bound u is the distance to the own centroid, lower bounds L to all others
+    MatrixXd L(nPoints, kClusters);
+    VectorXd u(nPoints);
+    idx = VectorXi::Zero(nPoints);
+
+    QtConcurrent::blockingMap(blockStarts, [&](qint32 blockStart)
+    {
+        for(qint32 i = blockStart; i < blockStart + blockSize && i < nPoints; ++i)
+        {
+            for(qint32 j = 0; j < kClusters; ++j)
+                L(i,j) = pointDist(i, j);
+            u[i] = L.row(i).minCoeff(&idx[i]);
+        }
+    });
+
+    std::vector<std::vector<qint32> > members(kClusters);
+    VectorXi changes = VectorXi::Zero(blockStarts.size());
+    MatrixXd CC(kClusters, kClusters);
+    VectorXd s(kClusters);
+
+    qint32 iterRep = 0;
+    bool converged = false;
+    while(true)
+    {
+        ++iterRep;
+
+        // Calculate the new cluster centroids, empty clusters keep their centroid
+        for(qint32 j = 0; j < kClusters; ++j)
+            members[j].clear();
+        for(qint32 i = 0; i < nPoints; ++i)
+            members[idx[i]].push_back(i);
+
+        MatrixXd Ct_new = Ct;
+
+        QList<qint32> clusters;
+        for(qint32 j = 0; j < kClusters; ++j)
+            if(!members[j].empty())
+                clusters.append(j);
+
+        QtConcurrent::blockingMap(clusters, [&](qint32 j)
+        {
+            const std::vector<qint32>& mbrs = members[j];
+            qint32 count = mbrs.size();
+
+            if (bCityblock)
+            {
+                // Component-wise median
+                MatrixXd Xsorted(count, Xt.rows());
+                for(qint32 c = 0; c < count; ++c)
+                    Xsorted.row(c) = Xt.col(mbrs[c]).transpose();
+
+                for(qint32 h = 0; h < Xsorted.cols(); ++h)
+                    std::sort(Xsorted.col(h).data(),Xsorted.col(h).data()+Xsorted.rows());
+
+                qint32 nn = floor(0.5*count)-1;
+                if (count % 2 == 0)
+                    Ct_new.col(j) = .5 * (Xsorted.row(nn) + Xsorted.row(nn+1)).transpose();
+                else
+                    Ct_new.col(j) = Xsorted.row(nn+1).transpose();
+            }
+            else
+            {
+                Ct_new.col(j).setZero();
+                for(qint32 c = 0; c < count; ++c)
+                    Ct_new.col(j) += Xt.col(mbrs[c]);
+                Ct_new.col(j) /= count;
+            }
+        });
+
+        // Move the bounds by the centroid shifts
+        VectorXd delta(kClusters);
+        for(qint32 j = 0; j < kClusters; ++j)
+            delta[j] = centroidDist(Ct, j, Ct_new, j);
+
+        Ct = Ct_new;
+
+        for(qint32 i = 0; i < nPoints; ++i)
+        {
+            L.row(i) = (L.row(i) - delta.transpose()).cwiseMax(0);
+            u[i] += delta[idx[i]];
+        }
+
+        if (iterRep >= m_iMaxit)
+            break;
+
+        // Half of the distance of each centroid to its closest other centroid
+        for(qint32 j = 0; j < kClusters; ++j)
+        {
+            s[j] = std::numeric_limits<double>::max();
+            for(qint32 h = 0; h < kClusters; ++h)
+            {
+                CC(j,h) = centroidDist(Ct, j, Ct, h);
+                if (h != j && 0.5 * CC(j,h) < s[j])
+                    s[j] = 0.5 * CC(j,h);
+            }
+        }
+
+        // Determine closest cluster for each point, resolve ties in favor of not moving
+        QtConcurrent::blockingMap(blockStarts, [&](qint32 blockStart)
+        {
+            qint32 b = blockStart / blockSize;
+            changes[b] = 0;
+
+            for(qint32 i = blockStart; i < blockStart + blockSize && i < nPoints; ++i)
+            {
+                qint32 c = idx[i];
+                if (u[i] <= s[c])
+                    continue;
+
+                bool tight = false;
+                for(qint32 j = 0; j < kClusters; ++j)
+                {
+                    if (j == c || u[i] <= L(i,j) || u[i] <= 0.5 * CC(c,j))
+                        continue;
+
+                    if (!tight)
+                    {
+                        u[i] = pointDist(i, c);
+                        L(i,c) = u[i];
+                        tight = true;
+
+                        if (u[i] <= L(i,j) || u[i] <= 0.5 * CC(c,j))
+                            continue;
+                    }
+
+                    L(i,j) = pointDist(i, j);
+                    if (L(i,j) < u[i])
+                    {
+                        c = j;
+                        u[i] = L(i,j);
+                    }
+                }
+
+                if (c != idx[i])
+                {
+                    idx[i] = c;
+                    ++changes[b];
+                }
+            }
+        });
+
+        if (changes.sum() == 0)
+        {
+            converged = true;
+            break;
+        }
+    }
+
+    return converged;
+}
+
+
+//*************************************************************************************************************
+
+MatrixXd KMeans::initCentroids(const MatrixXd& X, std::mt19937& rng)
+{
+    MatrixXd C = MatrixXd::Zero(k,p);
+
+    if (m_sStart.compare("uniform") == 0)
+    {
+        RowVectorXd Xmins = X.colwise().minCoeff();
+        RowVectorXd Xmaxs = X.colwise().maxCoeff();
+        for(qint32 i = 0; i < k; ++i)
+            for(qint32 j = 0; j < p; ++j)
+                C(i,j) = Xmins[j] + (Xmaxs[j] - Xmins[j]) * (rng() / 4294967296.0);
+    }
+    else if (m_sStart.compare("sample") == 0)
+    {
+        for(qint32 i = 0; i < k; ++i)
+            C.row(i) = X.row(rng() % n);
+    }
+    else if (m_sStart.compare("plus") == 0)
+    {
+        // k-means++: draw each further centroid with a probability proportional to the distance to the closest one so far
+        // distfun returns the similarity for 'cosine' and 'correlation', which is turned into the distance 1 - similarity
+        bool bSimilarity = m_sDistance.compare("cosine") == 0 || m_sDistance.compare("correlation") == 0;
+
+        C.row(0) = X.row(rng() % n);
+
+        MatrixXd C_i = C.row(0);
+        VectorXd minD = distfun(X, C_i);
+        if (bSimilarity)
+            minD = (1.0 - minD.array()).cwiseMax(0.0);
+
+        for(qint32 i = 1; i < k; ++i)
+        {
+            double totD = minD.sum();
+            qint32 pick = n - 1;
+
+            if (totD > 0)
+            {
+                double r = totD * (rng() / 4294967296.0);
+                double cumD = 0;
+                for(qint32 j = 0; j < n; ++j)
+                {
+                    cumD += minD[j];
+                    if (r < cumD)
+                    {
+                        pick = j;
+                        break;
+                    }
+                }
+            }
+            else
+                pick = rng() % n;
+
+            C.row(i) = X.row(pick);
+
+            C_i = C.row(i);
+            VectorXd D_i = distfun(X, C_i);
+            if (bSimilarity)
+                D_i = (1.0 - D_i.array()).cwiseMax(0.0);
+            minD = minD.cwiseMin(D_i);
+        }
+    }
+
+    return C;
+}
+
+
 //*************************************************************************************************************
 
 bool KMeans::batchUpdate(const MatrixXd& X, MatrixXd& C, VectorXi& idx)
@@ -61,6 +61,14 @@
 #include <Eigen/Core>
 
 
+//*************************************************************************************************************
+//=============================================================================================================
+// STL INCLUDES
+//=============================================================================================================
+
+#include <random>
+
+
 //*************************************************************************************************************
 //=============================================================================================================
 // DEFINE NAMESPACE MNELIB
@@ -90,7 +98,7 @@ public:
     typedef QSharedPointer<const KMeans> ConstSPtr; /**< Const shared pointer type for KMeans. */
 
     //distance {'sqeuclidean','cityblock','cosine','correlation','hamming'};
-    //startNames = {'uniform','sample','cluster'};
+    //startNames = {'uniform','sample','plus','cluster'};
     //emptyactNames = {'error','drop','singleton'};
 
     //=========================================================================================================
@@ -98,13 +106,16 @@ public:
     * Constructs a KMeans algorithm object.
     *
     * @param[in] distance   (optional) K-Means distance measure: "sqeuclidean" (default), "cityblock" , "cosine", "correlation", "hamming"
-    * @param[in] start      (optional) Cluster initialization: "sample" (default), "uniform", "cluster"
+    * @param[in] start      (optional) Cluster initialization: "sample" (default), "uniform", "plus" (k-means++), "cluster"
     * @param[in] replicates (optional) Number of K-Means replicates, which are generated. Best is returned.
     * @param[in] emptyact   (optional) What happens if a cluster wents empty: "error" (default), "drop", "singleton"
     * @param[in] online     (optional) If centroids should be updated during iterations: true (default), false
     * @param[in] maxit      (optional) maximal number of iterations per replicate; 100 by default
+    * @param[in] accelerated (optional) If the triangle inequality bounded batch algorithm should be used for "sqeuclidean" and
+    *                       "cityblock", see calculateBounded; false by default
+    * @param[in] seed       (optional) Seed of the random generator, the current time is used if negative; -1 by default
     */
-    explicit KMeans(QString distance = QString("sqeuclidean") , QString start = QString("sample"), qint32 replicates = 1, QString emptyact = QString("error"), bool online = true, qint32 maxit = 100);
+    explicit KMeans(QString distance = QString("sqeuclidean") , QString start = QString("sample"), qint32 replicates = 1, QString emptyact = QString("error"), bool online = true, qint32 maxit = 100, bool accelerated = false, qint32 seed = -1);
 
     //=========================================================================================================
     /**
@@ -121,6 +132,47 @@ public:
 
 
 private:
+    //=========================================================================================================
+    /**
+    * Clusters input data X with batch reassignments only, bounded by the triangle inequality (Elkan). Point to
+    * centroid distances are only computed when the bounds can not exclude a reassignment. The replicates and
+    * the assignments of the points are computed in parallel. Each replicate draws from its own generator seeded
+    * with seed + replicate, so the result only depends on the seed. Empty clusters keep their centroid.
+    *
+    * @param[in] X          Input data (rows = points; cols = p dimensional space)
+    * @param[in] kClusters  Number of k clusters
+    * @param[out] idx       The cluster indeces to which cluster the input points belong to
+    * @param[out] C         Cluster centroids k x p
+    * @param[out] sumD      Summation of the distances to the centroid within one cluster
+    * @param[out] D         Cluster distances to the centroid
+    *
+    * @return true if successful, false otherwise
+    */
+    bool calculateBounded(const MatrixXd& X, qint32 kClusters, VectorXi& idx, MatrixXd& C, VectorXd& sumD, MatrixXd& D);
+
+    //=========================================================================================================
+    /**
+    * Batch reassignments of one replicate, bounded by the triangle inequality.
+    *
+    * @param[in] Xt         Transposed input data (cols = points)
+    * @param[in, out] Ct    Transposed cluster centroids (cols = centroids)
+    * @param[out] idx       The cluster indeces to which cluster the input points belong to
+    *
+    * @return true if converged, false otherwise
+    */
+    bool boundedUpdate(const MatrixXd& Xt, MatrixXd& Ct, VectorXi& idx) const;
+
+    //=========================================================================================================
+    /**
+    * Initial cluster centroids, drawn with the given start method: "sample", "uniform" or "plus" (k-means++).
+    *
+    * @param[in] X          Input data (rows = points; cols = p dimensional space)
+    * @param[in] rng        The random generator
+    *
+    * @return Cluster centroids k x p
+    */
+    MatrixXd initCentroids(const MatrixXd& X, std::mt19937& rng);
+
     //=========================================================================================================
     /**
     * Calculate point to cluster centroid distances.
@@ -188,6 +240,8 @@ private:
     QString m_sEmptyact;    /**< What should be done if a cluster wents empty: "error" (default), "drop", "singleton" */
     qint32 m_iMaxit;        /**< Maximal number of iterations per replicate */
     bool m_bOnline;         /**< If online update should be performed */
+    bool m_bAccelerated;    /**< If the triangle inequality bounded batch algorithm should be used */
+    qint32 m_iSeed;         /**< Seed of the random generator, the current time is used if negative */
 
     qint32 emptyErrCnt;     /**< Counts the occurence of empty errors */
 
@@ -95,6 +95,7 @@ AdaptiveMp::AdaptiveMp()
 , fix_phase(0)
 , epsilon(0)
 , max_iterations(0)
+, grid_sample_count(-1)
 {
 
 }
@@ -113,7 +114,6 @@ QList<QList<GaborAtom> > AdaptiveMp::matching_pursuit(MatrixXd signal, qint32 ma
     std::cout << "\nAdaptive Matching Pursuit Algorithm started...\n";
 
     max_it = max_iterations;
-    Eigen::FFT<double> fft;
     MatrixXd residuum = signal; //residuum initialised with signal
     qint32 sample_count = signal.rows();
     qint32 channel_count = signal.cols();
@@ -133,153 +133,219 @@ QList<QList<GaborAtom> > AdaptiveMp::matching_pursuit(MatrixXd signal, qint32 ma
     }
     std::cout << "absolute energy of signal: " << residuum_energy << "\n";
 
+    //the dyadic scale and modulation grid and the gauss envelopes are kept between iterations
+    calc_search_grid(sample_count);
+
     while(it < max_iterations && (energy_threshold < residuum_energy) && sample_count > 1)
     {
         channel_count = channel_count * (boost / 100.0); //reducing the number of observed channels in the algorithm to increase speed performance
         if(boost == 0 || channel_count == 0)
             channel_count = 1;
 
-        //variables for dyadic sampling
-        qreal s = 1;                             //scale
-        qint32 j = 1;
         VectorXd max_scalar_product = VectorXd::Zero(channel_count);            //inner product for choosing the best matching atom
-        qreal k = 0;                             //for modulation 2*pi*k/N
-        qint32 p = floor(sample_count / 2);      //translation
         GaborAtom *gabor_Atom = new GaborAtom();
         gabor_Atom->sample_count = sample_count;
         gabor_Atom->energy = 0;
-        qreal phase = 0;
 
-        while(s < sample_count)
-        {
-            k = 0;                               //for modulation 2*pi*k/N
-            p = floor(sample_count / 2);         //translation
-            VectorXd envelope = GaborAtom::gauss_function(sample_count, s, p);
-            VectorXcd fft_envelope = RowVectorXcd::Zero(sample_count);
-            fft.fwd(fft_envelope, envelope);
+        //split the scale and modulation grid into tiles of modulations, which are searched in parallel
+        const qint32 tile_size = 32;
+        QList<QPair<qint32, qint32> > tiles;    //scale index, first modulation index
+        for(qint32 i = 0; i < scale_grid.length(); i++)
+            for(qint32 m = 0; m < modulation_grid.at(i).length(); m += tile_size)
+                tiles.append(QPair<qint32, qint32>(i, m));
+
+        //best parameters (scale, translation, modulation, phase, scalarproduct) of each tile per channel and over all channels
+        MatrixXd tile_chn_params = MatrixXd::Zero(5 * tiles.length(), channel_count);
+        MatrixXd tile_params = MatrixXd::Zero(6, tiles.length());
 
-            while(k < sample_count/2)
+        QList<qint32> tile_indices;
+        for(qint32 t = 0; t < tiles.length(); t++)
+            tile_indices.append(t);
+
+        QtConcurrent::blockingMap(tile_indices, [&](qint32 t)
+        {
+            qint32 i = tiles.at(t).first;
+            const QList<qreal>& modulations = modulation_grid.at(i);
+            const VectorXcd& conj_fft_envelope = envelope_spectra.at(i);
+            qint32 half_count = conj_fft_envelope.rows();
+
+            Eigen::FFT<double> fft;
+            VectorXd cos_modulation(sample_count);
+            VectorXd sin_modulation(sample_count);
+            VectorXcd modulation(sample_count);
+            VectorXcd modulated_resid(sample_count);
+            VectorXcd fft_modulated_resid(sample_count);
+            VectorXcd fft_m_e_resid = VectorXcd::Zero(sample_count);
+            VectorXd corr_coeffs(sample_count);
+
+            VectorXd tile_chn_max = VectorXd::Constant(channel_count, -1);
+            qreal tile_max = -1;
+
+            for(qint32 m = tiles.at(t).second; m < tiles.at(t).second + tile_size && m < modulations.length(); m++)
             {
-                p = floor(sample_count/2);
-                VectorXcd modulation = modulation_function(sample_count, k);
-                VectorXcd modulated_resid = VectorXcd::Zero(sample_count);
-                VectorXcd fft_modulated_resid = VectorXcd::Zero(sample_count);
-                VectorXcd fft_m_e_resid = VectorXcd::Zero(sample_count);
-                VectorXd corr_coeffs = VectorXd::Zero(sample_count);
+                qreal k = modulations.at(m);     //for modulation 2*pi*k/N
+
+                for(qint32 n = 0; n < sample_count; n++)
+                {
+                    cos_modulation[n] = cos(2 * PI * k / qreal(sample_count) * qreal(n));
+                    sin_modulation[n] = sin(2 * PI * k / qreal(sample_count) * qreal(n));
+                    modulation[n] = std::complex<double>(1 / sqrt(qreal(sample_count)) * cos_modulation[n], 1 / sqrt(qreal(sample_count)) * sin_modulation[n]);
+                }
 
                 //iteration for multichannel, depending on boost setting
                 for(qint32 chn = 0; chn < channel_count; chn++)
                 {
-                    qint32 max_index = 0;
-                    qreal maximum = 0;
-                    phase = 0;
-                    p = floor(sample_count/2);//here is difference to dr. gratkowski´s code (he didn´t reset parameter p)
+                    qint32 p = floor(sample_count/2);//here is difference to dr. gratkowski´s code (he didn´t reset parameter p)
 
-                    //complex correlation of signal and sinus-modulated gaussfunction
-                    for(qint32 l = 0; l< sample_count; l++)
+                    //complex correlation of signal and sinus-modulated gaussfunction, for all translations at once
+                    for(qint32 l = 0; l < sample_count; l++)
                         modulated_resid[l] = residuum(l, chn) * modulation[l];
 
                     fft.fwd(fft_modulated_resid, modulated_resid);
 
-                    for( qint32 m = 0; m < sample_count; m++)
-                        fft_m_e_resid[m] = fft_modulated_resid[m] * conj(fft_envelope[m]);
-
-                    fft.inv(corr_coeffs, fft_m_e_resid);
-                    maximum = corr_coeffs[0];
+                    //the real inverse transform only reads the first half of the spectrum
+                    fft_m_e_resid.head(half_count) = fft_modulated_resid.head(half_count).cwiseProduct(conj_fft_envelope);
+                    fft.inv(corr_coeffs.data(), fft_m_e_resid.data(), sample_count);
 
                     //find index of maximum correlation-coefficient to use in translation
-                    for(qint32 i = 1; i < corr_coeffs.rows(); i++)
-                        if(maximum < corr_coeffs[i])
-                        {
-                            maximum = corr_coeffs[i];
-                            max_index = i;
-                        }
+                    std::ptrdiff_t max_index;
+                    corr_coeffs.maxCoeff(&max_index);
 
                     //adapting translation p to create atomtranslation correctly
                     if(max_index >= p) p = max_index - p + 1;
                     else p = max_index + p;
 
-                    VectorXd atom_parameters = calculate_atom(sample_count, s, p, k, chn, residuum, RETURNPARAMETERS, fix_phase);
-                    qreal temp_scalar_product = 0;
-                    if(trial_separation) temp_scalar_product = max_scalar_product[chn];
-                    else temp_scalar_product = max_scalar_product[0];
+                    VectorXd atom_parameters = calc_atom_parameters(residuum, chn, scale_grid.at(i), p, k, cos_modulation, sin_modulation,
+                                                                    envelope_tables.at(i), fix_phase);
+
+                    //keep the last of equally good atoms, as the sequential search did
+                    if(std::fabs(atom_parameters[4]) >= tile_chn_max[chn])
+                    {
+                        tile_chn_max[chn] = std::fabs(atom_parameters[4]);
+                        tile_chn_params.block(5 * t, chn, 5, 1) = atom_parameters;
+                    }
+
+                    if(std::fabs(atom_parameters[4]) >= tile_max)
+                    {
+                        tile_max = std::fabs(atom_parameters[4]);
+                        tile_params.block(0, t, 5, 1) = atom_parameters;
+                        tile_params(5, t) = chn;
+                    }
+                }
+            }
+        });
 
-                    if(std::fabs(atom_parameters[4]) >= std::fabs(temp_scalar_product))
+        //merge the tiles in the order of the grid
+        for(qint32 t = 0; t < tiles.length(); t++)
+        {
+            if(trial_separation)
+            {
+                for(qint32 chn = 0; chn < channel_count; chn++)
+                {
+                    if(std::fabs(tile_chn_params(5 * t + 4, chn)) >= std::fabs(max_scalar_product[chn]))
                     {
                         //set highest scalarproduct, in comparison to best matching atom
-                        gabor_Atom->scale              = atom_parameters[0];
-                        gabor_Atom->translation        = atom_parameters[1];
-                        gabor_Atom->modulation         = atom_parameters[2];
-                        gabor_Atom->phase              = atom_parameters[3];
-                        gabor_Atom->max_scalar_product = atom_parameters[4];
+                        gabor_Atom->scale              = tile_chn_params(5 * t, chn);
+                        gabor_Atom->translation        = tile_chn_params(5 * t + 1, chn);
+                        gabor_Atom->modulation         = tile_chn_params(5 * t + 2, chn);
+                        gabor_Atom->phase              = tile_chn_params(5 * t + 3, chn);
+                        gabor_Atom->max_scalar_product = tile_chn_params(5 * t + 4, chn);
                         gabor_Atom->bm_channel         = chn;
 
-                        if(trial_separation)
-                        {
-                            max_scalar_product[chn]    = atom_parameters[4];
+                        max_scalar_product[chn]        = tile_chn_params(5 * t + 4, chn);
 
-                            if(atoms_in_chns.length() < channel_count)
-                                atoms_in_chns.append(*gabor_Atom);
-                            else
-                                atoms_in_chns.replace(chn, *gabor_Atom);
-                        }
+                        if(atoms_in_chns.length() < channel_count)
+                            atoms_in_chns.append(*gabor_Atom);
                         else
-                            max_scalar_product[0]      = atom_parameters[4];
-
+                            atoms_in_chns.replace(chn, *gabor_Atom);
                     }
-
                 }
-                k += pow(2.0,(-j))*sample_count/2;
-
             }
-            j++;
-            s = pow(2.0,j);
+            else if(std::fabs(tile_params(4, t)) >= std::fabs(max_scalar_product[0]))
+            {
+                //set highest scalarproduct, in comparison to best matching atom
+                gabor_Atom->scale              = tile_params(0, t);
+                gabor_Atom->translation        = tile_params(1, t);
+                gabor_Atom->modulation         = tile_params(2, t);
+                gabor_Atom->phase              = tile_params(3, t);
+                gabor_Atom->max_scalar_product = tile_params(4, t);
+                gabor_Atom->bm_channel         = qint32(tile_params(5, t));
+
+                max_scalar_product[0]          = tile_params(4, t);
+            }
         }
         std::cout << "\n" << "===============" << " found parameters " << it + 1 << "===============" << ":\n\n"<<
                      "scale: " << gabor_Atom->scale << " trans: " << gabor_Atom->translation <<
                      " modu: " << gabor_Atom->modulation << " phase: " << gabor_Atom->phase << " sclr_prdct: " << gabor_Atom->max_scalar_product << "\n";
 
         //replace atoms with s==N and p = floor(N/2) by such atoms that do not have an envelope
-        k = 0;
-        s = sample_count;
-        p = floor(sample_count / 2);
-        j = floor(log10(sample_count)/log10(2));//log(sample_count) / log(2));
-        phase = 0;
+        qreal s = sample_count;
+        qint32 p = floor(sample_count / 2);
+        qint32 j = floor(log10(sample_count)/log10(2));//log(sample_count) / log(2));
 
-        //iteration for multichannel, depending on boost setting
-        for(qint32 chn = 0; chn < channel_count; chn++)
+        QList<qreal> modulations;
+        for(qreal k = 0; k < sample_count / 2; k += pow(2.0,(-j))*sample_count/2)
+            modulations.append(k);
+
+        //phase and scalarproduct of all modulations x channels, computed in parallel
+        MatrixXd phases_no_envelope = MatrixXd::Zero(modulations.length(), channel_count);
+        MatrixXd products_no_envelope = MatrixXd::Zero(modulations.length(), channel_count);
+
+        QList<qint32> modulation_starts;
+        for(qint32 m = 0; m < modulations.length(); m += tile_size)
+            modulation_starts.append(m);
+
+        QtConcurrent::blockingMap(modulation_starts, [&](qint32 modulation_start)
         {
-            k = 0;
+            VectorXd cos_modulation(sample_count);
+            VectorXd sin_modulation(sample_count);
 
-            while(k < sample_count / 2)
+            for(qint32 m = modulation_start; m < modulation_start + tile_size && m < modulations.length(); m++)
             {
-                VectorXd parameters_no_envelope = calculate_atom(sample_count, s, p, k, chn, residuum, RETURNPARAMETERS, fix_phase);
+                for(qint32 n = 0; n < sample_count; n++)
+                {
+                    cos_modulation[n] = cos(2 * PI * modulations.at(m) / qreal(sample_count) * qreal(n));
+                    sin_modulation[n] = sin(2 * PI * modulations.at(m) / qreal(sample_count) * qreal(n));
+                }
+
+                for(qint32 chn = 0; chn < channel_count; chn++)
+                {
+                    VectorXd parameters_no_envelope = calc_atom_parameters(residuum, chn, s, p, modulations.at(m), cos_modulation, sin_modulation,
+                                                                           VectorXd(), fix_phase);
+                    phases_no_envelope(m, chn) = parameters_no_envelope[3];
+                    products_no_envelope(m, chn) = parameters_no_envelope[4];
+                }
+            }
+        });
 
+        //iteration for multichannel, depending on boost setting
+        for(qint32 chn = 0; chn < channel_count; chn++)
+        {
+            for(qint32 m = 0; m < modulations.length(); m++)
+            {
                 qreal temp_scalar_product = 0;
                 if(trial_separation) temp_scalar_product = max_scalar_product[chn];
                 else temp_scalar_product = max_scalar_product[0];
-                if(std::fabs(parameters_no_envelope[4]) > std::fabs(temp_scalar_product))
+                if(std::fabs(products_no_envelope(m, chn)) > std::fabs(temp_scalar_product))
                 {
                     //set highest scalarproduct, in comparison to best matching atom
 
-                    gabor_Atom->scale              = parameters_no_envelope[0];
-                    gabor_Atom->translation        = parameters_no_envelope[1];
-                    gabor_Atom->modulation         = parameters_no_envelope[2];
-                    gabor_Atom->phase              = parameters_no_envelope[3];
-                    gabor_Atom->max_scalar_product = parameters_no_envelope[4];
+                    gabor_Atom->scale              = s;
+                    gabor_Atom->translation        = p;
+                    gabor_Atom->modulation         = modulations.at(m);
+                    gabor_Atom->phase              = phases_no_envelope(m, chn);
+                    gabor_Atom->max_scalar_product = products_no_envelope(m, chn);
                     gabor_Atom->bm_channel         = chn;
 
                     if(trial_separation)
                     {
-                        max_scalar_product[chn]    = parameters_no_envelope[4];
+                        max_scalar_product[chn]    = products_no_envelope(m, chn);
                         atoms_in_chns.replace(chn, *gabor_Atom);
                     }
                     else
-                        max_scalar_product[0]      = parameters_no_envelope[4];
+                        max_scalar_product[0]      = products_no_envelope(m, chn);
 
                 }
-                k += pow(2.0,(-j))*sample_count/2;
-
             }
 
         }
@@ -290,13 +356,22 @@ QList<QList<GaborAtom> > AdaptiveMp::matching_pursuit(MatrixXd signal, qint32 ma
 
         if(trial_separation && simplex_it != 0)
         {
-            for(qint32 chn = 0; chn < atoms_in_chns.length(); chn++)
+            //the channels are optimised independently of each other
+            QVector<GaborAtom> optimised_atoms = atoms_in_chns.toVector();
+
+            QList<qint32> channels;
+            for(qint32 chn = 0; chn < optimised_atoms.size(); chn++)
+                channels.append(chn);
+
+            GaborAtom* optimised_data = optimised_atoms.data();
+            QtConcurrent::blockingMap(channels, [&](qint32 chn)
             {
-                *gabor_Atom = atoms_in_chns.at(chn);
                 simplex_maximisation(simplex_it, simplex_reflection, simplex_expansion, simplex_contraction, simplex_full_contraction,
-                                     gabor_Atom, max_scalar_product, sample_count, fix_phase, residuum, trial_separation, chn);
+                                     &optimised_data[chn], max_scalar_product, sample_count, fix_phase, residuum, trial_separation, chn);
+            });
 
-            }
+            atoms_in_chns = optimised_atoms.toList();
+            *gabor_Atom = atoms_in_chns.last();
         }
         else if(simplex_it != 0)
             simplex_maximisation(simplex_it, simplex_reflection, simplex_expansion, simplex_contraction, simplex_full_contraction,
@@ -403,7 +478,7 @@ VectorXcd AdaptiveMp::modulation_function(qint32 N, qreal k)
 
 //*************************************************************************************************************
 
-VectorXd AdaptiveMp::calculate_atom(qint32 sample_count, qreal scale, qint32 translation, qreal modulation, qint32 channel, MatrixXd residuum, ReturnValue return_value = RETURNATOM, bool fix_phase = false)
+VectorXd AdaptiveMp::calculate_atom(qint32 sample_count, qreal scale, qint32 translation, qreal modulation, qint32 channel, const MatrixXd& residuum, ReturnValue return_value = RETURNATOM, bool fix_phase = false)
 {
     GaborAtom *gabor_Atom = new GaborAtom();
     qreal phase = 0;
@@ -466,8 +541,118 @@ VectorXd AdaptiveMp::calculate_atom(qint32 sample_count, qreal scale, qint32 tra
 
 //*************************************************************************************************************
 
+VectorXd AdaptiveMp::calc_atom_parameters(const MatrixXd& residuum, qint32 channel, qreal scale, qint32 translation, qreal modulation,
+                                          const VectorXd& cos_modulation, const VectorXd& sin_modulation, const VectorXd& envelope_table,
+                                          bool fix_phase)
+{
+    qint32 sample_count = residuum.rows();
+
+    //an empty envelope table stands for an atom without envelope
+    bool has_envelope = envelope_table.rows() != 0;
+    qint32 envelope_offset = sample_count - 1 - translation;
+
+    //calculate Inner Product with the complex atom: preparation to find the parameter phase, the normalization does not change the phase
+    std::complex<double> inner_product(0, 0);
+
+    qint32 first_chn = fix_phase ? 0 : channel;
+    qint32 end_chn = fix_phase ? residuum.cols() : channel + 1;
+
+    for(qint32 chn = first_chn; chn < end_chn; chn++)
+    {
+        VectorXd weighted_resid = residuum.col(chn);
+        if(has_envelope)
+            weighted_resid = weighted_resid.cwiseProduct(envelope_table.segment(envelope_offset, sample_count));
+
+        inner_product += std::complex<double>(weighted_resid.dot(cos_modulation), -weighted_resid.dot(sin_modulation));
+    }
+
+    if(fix_phase && residuum.cols() != 0)
+        inner_product /= residuum.cols();
+
+    //calculate phase to create realGaborAtoms
+    qreal phase = std::arg(inner_product);
+    if (phase < 0) phase = 2 * PI - phase;
+
+    VectorXd real_gabor_atom = cos(phase) * cos_modulation - sin(phase) * sin_modulation;
+    if(has_envelope)
+        real_gabor_atom = real_gabor_atom.cwiseProduct(envelope_table.segment(envelope_offset, sample_count));
+
+    qreal norm = real_gabor_atom.norm();
+    qreal scalar_product = real_gabor_atom.dot(residuum.col(channel));
+    if(norm != 0) scalar_product /= norm;
+
+    VectorXd atom_parameters = VectorXd::Zero(5);
+
+    atom_parameters[0] = scale;
+    atom_parameters[1] = translation;
+    atom_parameters[2] = modulation;
+    atom_parameters[3] = phase;
+    atom_parameters[4] = scalar_product;
+
+    return atom_parameters;
+}
+
+//*************************************************************************************************************
+
+void AdaptiveMp::calc_search_grid(qint32 sample_count)
+{
+    if(grid_sample_count == sample_count)
+        return;
+
+    #ifdef EIGEN_FFTW_DEFAULT
+        fftw_make_planner_thread_safe();
+    #endif
+
+    scale_grid.clear();
+    modulation_grid.clear();
+
+    //dyadic sampling of scale and modulation
+    qreal s = 1;
+    qint32 j = 1;
+
+    while(s < sample_count)
+    {
+        QList<qreal> modulations;
+        for(qreal k = 0; k < sample_count/2; k += pow(2.0,(-j))*sample_count/2)
+            modulations.append(k);
+
+        scale_grid.append(s);
+        modulation_grid.append(modulations);
+
+        j++;
+        s = pow(2.0,j);
+    }
+
+    QVector<VectorXcd> spectra(scale_grid.length());
+    QVector<VectorXd> tables(scale_grid.length());
+
+    QList<qint32> scale_indices;
+    for(qint32 i = 0; i < scale_grid.length(); i++)
+        scale_indices.append(i);
+
+    QtConcurrent::blockingMap(scale_indices, [&](qint32 i)
+    {
+        //envelope translated to the middle of the signal, used to correlate all translations at once
+        VectorXd envelope = GaborAtom::gauss_function(sample_count, scale_grid.at(i), floor(sample_count / 2));
+
+        Eigen::FFT<double> fft;
+        VectorXcd fft_envelope = VectorXcd::Zero(sample_count);
+        fft.fwd(fft_envelope, envelope);
+        spectra[i] = fft_envelope.head(sample_count / 2 + 1).conjugate();
+
+        //envelope at all offsets between sample and translation
+        tables[i] = GaborAtom::gauss_function(2 * sample_count - 1, scale_grid.at(i), sample_count - 1);
+    });
+
+    envelope_spectra = spectra.toList();
+    envelope_tables = tables.toList();
+    grid_sample_count = sample_count;
+}
+
+//*************************************************************************************************************
+
 void AdaptiveMp::simplex_maximisation(qint32 simplex_it, qreal simplex_reflection, qreal simplex_expansion, qreal simplex_contraction, qreal simplex_full_contraction,
-                                      GaborAtom *gabor_Atom, VectorXd max_scalar_product, qint32 sample_count, bool fix_phase, MatrixXd residuum, bool trial_separation, qint32 chn)
+                                      GaborAtom *gabor_Atom, const VectorXd& max_scalar_product, qint32 sample_count, bool fix_phase, const MatrixXd& residuum, bool trial_separation, qint32 chn)
 {
     //Maximisation Simplex Algorithm implemented by Botao Jia, adapted to the MP Algorithm by Martin Henfling. Copyright (C) 2010 Botao Jia
     //ToDo: change to clean use of EIGEN, @present its mixed with Namespace std and <vector>
@@ -680,9 +865,6 @@ void AdaptiveMp::simplex_maximisation(qint32 simplex_it, qreal simplex_reflectio
             gabor_Atom->modulation         = atom_fxc_params[2];
             gabor_Atom->phase              = atom_fxc_params[3];
             gabor_Atom->max_scalar_product = atom_fxc_params[4];
-
-            if(trial_separation)
-                atoms_in_chns.replace(chn, *gabor_Atom);
         }
 
         if(cnt==iterations)//max number of iteration achieves before tol is satisfied
@@ -144,6 +144,12 @@ public:
     QList<GaborAtom> atoms_in_chns;
     QList<FixDictAtom> fix_dict_list;
 
+    QList<qreal> scale_grid;                    /**< Dyadic scales searched by the algorithm. */
+    QList<QList<qreal> > modulation_grid;       /**< Modulations searched at each scale of the scale grid. */
+    QList<VectorXcd> envelope_spectra;          /**< Conjugated half spectra of the centered envelopes of the scale grid. */
+    QList<VectorXd> envelope_tables;            /**< Envelopes of the scale grid at the offsets -(N-1)..(N-1) from the translation. */
+    qint32 grid_sample_count;                   /**< Signal length the search grid was computed for, -1 if not computed. */
+
     //=========================================================================================================
     /*
     * adaptiveMP_matching_pursuit
@@ -193,7 +199,37 @@ public:
     *
     * @return depending on returnValue returning the real atom calculated or the manipulated parameters: scale, translation, modulation, phase, scalarproduct
     */
-    static VectorXd calculate_atom(qint32 sample_count, qreal scale, qint32 translation, qreal modulation, qint32 channel, MatrixXd residuum, ReturnValue return_value, bool fix_phase);
+    static VectorXd calculate_atom(qint32 sample_count, qreal scale, qint32 translation, qreal modulation, qint32 channel, const MatrixXd& residuum, ReturnValue return_value, bool fix_phase);
+
+    //=========================================================================================================
+    /**
+    * Calculates the parameters of a real gabor atom like calculate_atom with RETURNPARAMETERS, but with the
+    * modulation and the envelope given as precomputed samples, so no transcendental functions are evaluated.
+    *
+    * @param[in] residuum           the signalresiduum (samples x channels)
+    * @param[in] channel            the channel the scalarproduct is calculated for
+    * @param[in] scale              scale of atom
+    * @param[in] translation        translation of atom
+    * @param[in] modulation         modulation of atom
+    * @param[in] cos_modulation     cos(2*pi*modulation/N*n) for all samples n
+    * @param[in] sin_modulation     sin(2*pi*modulation/N*n) for all samples n
+    * @param[in] envelope_table     the envelope of the scale at the offsets -(N-1)..(N-1), empty for atoms without envelope
+    * @param[in] fix_phase          whether the phase is determined over all channels
+    *
+    * @return the parameters: scale, translation, modulation, phase, scalarproduct
+    */
+    static VectorXd calc_atom_parameters(const MatrixXd& residuum, qint32 channel, qreal scale, qint32 translation, qreal modulation,
+                                         const VectorXd& cos_modulation, const VectorXd& sin_modulation, const VectorXd& envelope_table,
+                                         bool fix_phase);
+
+    //=========================================================================================================
+    /**
+    * Computes the dyadic scale and modulation grid and the envelopes of its scales for a signal length. The grid
+    * is only recomputed when the signal length changes.
+    *
+    * @param[in] sample_count   number of samples of the signal
+    */
+    void calc_search_grid(qint32 sample_count);
 
     //=========================================================================================================
     /**
@@ -217,7 +253,7 @@ public:
     * @return depending on returnValue returning the real atom calculated or the manipulated parameters: scale, translation, modulation, phase, scalarproduct
     */
     void simplex_maximisation(qint32 simplex_it, qreal simplex_reflection, qreal simplex_expansion, qreal simplex_contraction, qreal simplex_full_contraction,
-                              GaborAtom *gabor_Atom, VectorXd max_scalar_product, qint32 sample_count, bool fix_phase, MatrixXd residuum, bool trial_separation, qint32 chn);
+                              GaborAtom *gabor_Atom, const VectorXd& max_scalar_product, qint32 sample_count, bool fix_phase, const MatrixXd& residuum, bool trial_separation, qint32 chn);
 
     //=========================================================================================================
 
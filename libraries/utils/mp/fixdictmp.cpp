@@ -112,6 +112,7 @@ FixDictMp::~FixDictMp()
 Dictionary::Dictionary()
 : type(GABORATOM)
 , sample_count(0)
+, spectra_sample_count(-1)
 {
 
 }
@@ -147,6 +148,10 @@ void FixDictMp::matching_pursuit(MatrixXd signal, qint32 max_iterations, qreal e
     this->residuum = signal;
     parsed_dicts = parse_xml_dict(path);
 
+    //the atom spectra only depend on the dictionary -> compute them once for all iterations
+    for(qint32 i = 0; i < parsed_dicts.length(); i++)
+        parsed_dicts[i].calc_atom_spectra(sample_count);
+
     //calculate signal_energy
     for(qint32 channel = 0; channel < channel_count; channel++)
     {
@@ -163,28 +168,18 @@ void FixDictMp::matching_pursuit(MatrixXd signal, qint32 max_iterations, qreal e
     {
         FixDictAtom global_best_matching;
 
-        QList<find_best_matching> list_of_best;
+        //the residuum doesn't change within one correlation pass -> transform it once for all dictionaries
+        MatrixXcd resid_spectra = calc_residuum_spectra(this->residuum, boost);
+
         for(qint32 i = 0; i < parsed_dicts.length(); i++)
         {
-            find_best_matching current_best_matching;
-            current_best_matching.pdict = parsed_dicts.at(i);
-            current_best_matching.current_resid = this->residuum;
-            current_best_matching.boost = boost;
-            list_of_best.append(current_best_matching);
-        }
+            FixDictAtom current_best_matching = correlation(parsed_dicts.at(i), resid_spectra, sample_count);
 
-        QFuture<FixDictAtom> mapped_best_matchings = QtConcurrent::mapped(list_of_best, &find_best_matching::parallel_correlation);// parse_threads;
-        mapped_best_matchings.waitForFinished();
-
-        QFuture<FixDictAtom>::const_iterator i;
-        for (i = mapped_best_matchings.constBegin(); i != mapped_best_matchings.constEnd(); i++)
-        {
-            //FixDictAtom current_best_matching = correlation(parsed_dicts.at(i));
-            if(i == mapped_best_matchings.constBegin())
-                global_best_matching = *i;
+            if(i == 0)
+                global_best_matching = current_best_matching;
 
-            else if(std::fabs(i->max_scalar_product) > std::fabs(global_best_matching.max_scalar_product))
-                global_best_matching = *i;
+            else if(std::fabs(current_best_matching.max_scalar_product) > std::fabs(global_best_matching.max_scalar_product))
+                global_best_matching = current_best_matching;
         }
 
         global_best_matching.display_text = create_display_text(global_best_matching);
@@ -285,91 +280,88 @@ void FixDictMp::matching_pursuit(MatrixXd signal, qint32 max_iterations, qreal e
 //*************************************************************************************************************
 
 // calc scalarproduct of Atom and Signal
-FixDictAtom FixDictMp::correlation(Dictionary current_pdict, MatrixXd current_resid, qint32 boost)
+FixDictAtom FixDictMp::correlation(Dictionary& current_pdict, const MatrixXd& current_resid, qint32 boost)
 {
-    #ifdef EIGEN_FFTW_DEFAULT
-        fftw_make_planner_thread_safe();
-    #endif
+    current_pdict.calc_atom_spectra(current_resid.rows());
 
-    qint32 channel_count = current_resid.cols() * (boost / 100.0); //reducing the number of observed channels in the algorithm to increase speed performance
-    if(boost == 0 || channel_count == 0)
-        channel_count = 1;
+    return correlation(current_pdict, calc_residuum_spectra(current_resid, boost), current_resid.rows());
+}
 
-    Eigen::FFT<double> fft;
-    std::ptrdiff_t max_index;
-    VectorXcd fft_atom = VectorXcd::Zero(current_resid.rows());
 
-    FixDictAtom best_matching;
-    qreal max_scalar_product = 0;
+//*************************************************************************************************************
 
-    for(qint32 i = 0; i < current_pdict.atoms.length(); i++)
-    {
-        VectorXd fitted_atom = VectorXd::Zero(current_resid.rows());
-        qint32 p = floor(current_resid.rows() / 2);//translation
+FixDictAtom FixDictMp::correlation(const Dictionary& current_pdict, const MatrixXcd& resid_spectra, qint32 sample_count)
+{
+    #ifdef EIGEN_FFTW_DEFAULT
+        fftw_make_planner_thread_safe();
+    #endif
 
-        VectorXd resized_atom = VectorXd::Zero(current_resid.rows());
+    qint32 atom_count = current_pdict.atom_spectra.length();
+    qint32 channel_count = resid_spectra.cols();
 
-        if(current_pdict.atoms.at(i).atom_samples.rows() > current_resid.rows())
-            for(qint32 k = 0; k < current_resid.rows(); k++)
-                resized_atom[k] = current_pdict.atoms.at(i).atom_samples[k + floor(current_pdict.atoms.at(i).atom_samples.rows() / 2) - floor(current_resid.rows() / 2)];
-        else resized_atom = current_pdict.atoms.at(i).atom_samples;
+    //maximal correlation-coefficient and its index for all atoms x channels
+    MatrixXd max_scalar_products = MatrixXd::Zero(atom_count, channel_count);
+    MatrixXi max_indices = MatrixXi::Zero(atom_count, channel_count);
 
-        if(resized_atom.rows() < current_resid.rows())
-            for(qint32 k = 0; k < resized_atom.rows(); k++)
-                fitted_atom[(k + p - floor(resized_atom.rows() / 2))] = resized_atom[k];
-        else fitted_atom = resized_atom;
+    //blocks of atoms share one fft object
+    const qint32 block_size = 32;
+    QList<qint32> block_starts;
+    for(qint32 i = 0; i < atom_count; i += block_size)
+        block_starts.append(i);
 
-        //normalization
-        qreal norm = 0;
-        norm = fitted_atom.norm();
-        if(norm != 0) fitted_atom /= norm;
+    QtConcurrent::blockingMap(block_starts, [&](qint32 block_start)
+    {
+        Eigen::FFT<double> fft;
+        fft.SetFlag(Eigen::FFT<double>::HalfSpectrum);
 
-        fft.fwd(fft_atom, fitted_atom);
+        VectorXd corr_coeffs = VectorXd::Zero(sample_count);
+        VectorXcd fft_sig_atom(resid_spectra.rows());
 
-        for(qint32 chn = 0; chn < channel_count; chn++)
+        for(qint32 i = block_start; i < block_start + block_size && i < atom_count; i++)
         {
-            p = floor(current_resid.rows() / 2);//translation
-            VectorXd corr_coeffs = VectorXd::Zero(current_resid.rows());
-            VectorXcd fft_signal = VectorXcd::Zero(current_resid.rows());
-            VectorXcd fft_sig_atom = VectorXcd::Zero(current_resid.rows());
-
-            fft.fwd(fft_signal, current_resid.col(chn));
+            for(qint32 chn = 0; chn < channel_count; chn++)
+            {
+                fft_sig_atom = resid_spectra.col(chn).cwiseProduct(current_pdict.atom_spectra.at(i).conjugate());
 
-            for( qint32 m = 0; m < current_resid.rows(); m++)
-                fft_sig_atom[m] = fft_signal[m] * conj(fft_atom[m]);
+                fft.inv(corr_coeffs, fft_sig_atom, sample_count);
 
-            fft.inv(corr_coeffs, fft_sig_atom);
+                //find index of maximum correlation-coefficient to use in translation
+                std::ptrdiff_t max_index;
+                max_scalar_products(i, chn) = corr_coeffs.maxCoeff(&max_index);
+                max_indices(i, chn) = max_index;
+            }
+        }
+    });
 
-            //find index of maximum correlation-coefficient to use in translation
-            max_scalar_product = corr_coeffs.maxCoeff(&max_index);
+    //select the best matching in the order atoms x channels
+    FixDictAtom best_matching;
+    qint32 best_atom = -1;
+    qint32 best_chn = 0;
 
-            if(i == 0)
+    for(qint32 i = 0; i < atom_count; i++)
+        for(qint32 chn = 0; chn < channel_count; chn++)
+            if(i == 0 || std::fabs(max_scalar_products(i, chn)) > std::fabs(max_scalar_products(best_atom, best_chn)))
             {
-                best_matching = current_pdict.atoms.at(i);
-                best_matching.max_scalar_product = max_scalar_product;
-
-                //adapting translation p to create atomtranslation correctly
-                if(max_index >= p && current_resid.rows() % (2) == 0) p = max_index - p;
-                else if(max_index >= p && current_resid.rows() % (2) != 0) p = max_index - p - 1;
-                else p = max_index + p;
-
-                best_matching.translation = p;
+                best_atom = i;
+                best_chn = chn;
             }
 
-            else if(std::fabs(max_scalar_product) > std::fabs(best_matching.max_scalar_product))
-            {
-                best_matching = current_pdict.atoms.at(i);
-                best_matching.max_scalar_product = max_scalar_product;
+    if(best_atom >= 0)
+    {
+        best_matching = current_pdict.atoms.at(best_atom);
+        best_matching.max_scalar_product = max_scalar_products(best_atom, best_chn);
 
-                //adapting translation p to create atomtranslation correctly
-                if(max_index >= p && current_resid.rows() % (2) == 0) p = max_index - p;
-                else if(max_index >= p && current_resid.rows() % (2) != 0) p = max_index - p - 1;
-                else p = max_index + p;
+        //adapting translation p to create atomtranslation correctly
+        qint32 p = floor(sample_count / 2);//translation
+        qint32 max_index = max_indices(best_atom, best_chn);
 
-                best_matching.translation = p;
-            }
-        }
+        if(max_index >= p && sample_count % (2) == 0) p = max_index - p;
+        else if(max_index >= p && sample_count % (2) != 0) p = max_index - p - 1;
+        else p = max_index + p;
+
+        best_matching.translation = p;
     }
+
     best_matching.atom_formula = current_pdict.atom_formula;
     best_matching.dict_source = current_pdict.source;
     best_matching.type = current_pdict.type;
@@ -379,6 +371,38 @@ FixDictAtom FixDictMp::correlation(Dictionary current_pdict, MatrixXd current_re
 }
 
 
+//*************************************************************************************************************
+
+MatrixXcd FixDictMp::calc_residuum_spectra(const MatrixXd& current_resid, qint32 boost)
+{
+    #ifdef EIGEN_FFTW_DEFAULT
+        fftw_make_planner_thread_safe();
+    #endif
+
+    qint32 channel_count = current_resid.cols() * (boost / 100.0); //reducing the number of observed channels in the algorithm to increase speed performance
+    if(boost == 0 || channel_count == 0)
+        channel_count = 1;
+
+    MatrixXcd resid_spectra(current_resid.rows() / 2 + 1, channel_count);
+
+    QList<qint32> channels;
+    for(qint32 chn = 0; chn < channel_count; chn++)
+        channels.append(chn);
+
+    QtConcurrent::blockingMap(channels, [&](qint32 chn)
+    {
+        Eigen::FFT<double> fft;
+        fft.SetFlag(Eigen::FFT<double>::HalfSpectrum);
+
+        VectorXcd fft_signal;
+        fft.fwd(fft_signal, current_resid.col(chn));
+        resid_spectra.col(chn) = fft_signal;
+    });
+
+    return resid_spectra;
+}
+
+
 //*************************************************************************************************************
 
 QList<Dictionary> FixDictMp::parse_xml_dict(QString path)
@@ -592,9 +616,62 @@ qint32 Dictionary::atom_count()
      this->atom_formula = "";
      this->sample_count = 0;
      this->source = "";
+     this->atom_spectra.clear();
+     this->spectra_sample_count = -1;
  }
 
 
+ //*************************************************************************************************************
+
+void Dictionary::calc_atom_spectra(qint32 signal_sample_count)
+{
+    if(spectra_sample_count == signal_sample_count && atom_spectra.length() == atoms.length())
+        return;
+
+    #ifdef EIGEN_FFTW_DEFAULT
+        fftw_make_planner_thread_safe();
+    #endif
+
+    QVector<VectorXcd> spectra(atoms.length());
+
+    QList<qint32> atom_indices;
+    for(qint32 i = 0; i < atoms.length(); i++)
+        atom_indices.append(i);
+
+    QtConcurrent::blockingMap(atom_indices, [&](qint32 i)
+    {
+        const VectorXd& atom_samples = atoms.at(i).atom_samples;
+
+        VectorXd fitted_atom = VectorXd::Zero(signal_sample_count);
+        qint32 p = floor(signal_sample_count / 2);//translation
+
+        VectorXd resized_atom = VectorXd::Zero(signal_sample_count);
+
+        if(atom_samples.rows() > signal_sample_count)
+            for(qint32 k = 0; k < signal_sample_count; k++)
+                resized_atom[k] = atom_samples[k + floor(atom_samples.rows() / 2) - floor(signal_sample_count / 2)];
+        else resized_atom = atom_samples;
+
+        if(resized_atom.rows() < signal_sample_count)
+            for(qint32 k = 0; k < resized_atom.rows(); k++)
+                fitted_atom[(k + p - floor(resized_atom.rows() / 2))] = resized_atom[k];
+        else fitted_atom = resized_atom;
+
+        //normalization
+        qreal norm = 0;
+        norm = fitted_atom.norm();
+        if(norm != 0) fitted_atom /= norm;
+
+        Eigen::FFT<double> fft;
+        fft.SetFlag(Eigen::FFT<double>::HalfSpectrum);
+        fft.fwd(spectra[i], fitted_atom);
+    });
+
+    atom_spectra = spectra.toList();
+    spectra_sample_count = signal_sample_count;
+}
+
+
  //*************************************************************************************************************
 
 /*
@@ -121,10 +121,22 @@ public:
     QString atom_formula;
     qint32 sample_count;
 
+    QList<VectorXcd> atom_spectra;      /**< Half spectra of the centered and normalized atoms. */
+    qint32 spectra_sample_count;        /**< Signal length the atom spectra were computed for, -1 if not computed. */
+
     qint32 atom_count();
 
     void clear();
 
+    //=========================================================================================================
+    /**
+    * Computes the half spectra of all atoms, fitted (cut or zero padded and centered) to the signal length and
+    * normalized. The spectra are only recomputed when the signal length changes.
+    *
+    * @param[in] signal_sample_count    The number of samples of the signal.
+    */
+    void calc_atom_spectra(qint32 signal_sample_count);
+
 };//class
 
 
@@ -180,7 +192,31 @@ public:
 
     //=========================================================================================================
 
-    FixDictAtom correlation(Dictionary current_pdict, MatrixXd current_resid, qint32 boost);
+    FixDictAtom correlation(Dictionary& current_pdict, const MatrixXd& current_resid, qint32 boost);
+
+    //=========================================================================================================
+    /**
+    * Finds the best matching atom of a dictionary for precomputed residual spectra. All atoms x channels
+    * correlations are computed in parallel with the cached atom spectra, see Dictionary::calc_atom_spectra.
+    *
+    * @param[in] current_pdict      The dictionary, its atom spectra have to be computed for sample_count.
+    * @param[in] resid_spectra      The half spectra of the observed residual channels (one column per channel).
+    * @param[in] sample_count       The number of samples of the residual.
+    *
+    * @return The best matching atom.
+    */
+    static FixDictAtom correlation(const Dictionary& current_pdict, const MatrixXcd& resid_spectra, qint32 sample_count);
+
+    //=========================================================================================================
+    /**
+    * Computes the half spectra of the observed residual channels, the number of channels is reduced by boost.
+    *
+    * @param[in] current_resid      The residual (samples x channels).
+    * @param[in] boost              The percentage of observed channels.
+    *
+    * @return The half spectra (one column per observed channel).
+    */
+    static MatrixXcd calc_residuum_spectra(const MatrixXd& current_resid, qint32 boost);
 
     //=========================================================================================================
 
@@ -192,21 +228,6 @@ public:
 
     //=========================================================================================================
 
-    struct find_best_matching
-    {
-        Dictionary pdict;
-        MatrixXd current_resid;
-        qint32 boost;
-
-        FixDictAtom parallel_correlation() const
-        {
-            FixDictAtom best_matching;
-            FixDictMp fix_dict_mp;
-            best_matching = fix_dict_mp.correlation(this->pdict, this->current_resid, this->boost);
-            return best_matching;
-        }
-    };
-
     QList<Dictionary> parse_xml_dict(QString path);
 
     //=========================================================================================================
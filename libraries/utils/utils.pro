@@ -74,6 +74,7 @@ SOURCES += \
     filterTools/parksmcclellan.cpp \
     filterTools/filterdata.cpp \
     filterTools/filterio.cpp \
+    filterTools/overlapsavefilter.cpp \
     detecttrigger.cpp \
     spectrogram.cpp \
     warp.cpp \
@@ -82,6 +83,7 @@ SOURCES += \
     generics/buffer.cpp \
     generics/circularbuffer.cpp \
     generics/circularmatrixbuffer.cpp \
+    generics/lockfreecircularmatrixbuffer.cpp \
     generics/observerpattern.cpp \
     spectral.cpp
 
@@ -101,6 +103,7 @@ HEADERS += \
     filterTools/parksmcclellan.h \
     filterTools/filterdata.h \
     filterTools/filterio.h \
+    filterTools/overlapsavefilter.h \
     detecttrigger.h \
     spectrogram.h \
     warp.h \
@@ -112,6 +115,7 @@ HEADERS += \
     generics/circularbuffer_old.h \
     generics/circularmatrixbuffer.h \
     generics/circularmultichannelbuffer_old.h \
+    generics/lockfreecircularmatrixbuffer.h \
     generics/commandpattern.h \
     generics/observerpattern.h \
     generics/typename_old.h \
@@ -0,0 +1,328 @@
+//=============================================================================================================
+/**
+* @file     test_adaptive_mp.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     October, 2018
+*
+* @section  LICENSE
+*
+* Copyright (C) 2018, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Verifies the accelerated adaptive matching pursuit search and benchmarks it against the sequential search
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <utils/mp/adaptivemp.h>
+#include <utils/mp/atom.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <unsupported/Eigen/FFT>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtTest>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace UTILSLIB;
+using namespace Eigen;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STATIC DEFINITIONS
+//=============================================================================================================
+
+namespace
+{
+
+//=============================================================================================================
+/**
+* The sequential dyadic search over the observed channels, as AdaptiveMp::matching_pursuit did it before the
+* search was split into parallel tiles: one correlation and one calculate_atom per scale, modulation and channel.
+*
+* @param [in] residuum  the residuum (samples x channels).
+* @param [in] boost     the percentage of channels which are observed, 0 observes the first channel only.
+*
+* @return the parameters of the best matching atom: scale, translation, modulation, phase, scalarproduct, channel.
+*/
+VectorXd sequentialSearch(const MatrixXd& residuum, qint32 boost = 0)
+{
+    AdaptiveMp adaptiveMp;
+    Eigen::FFT<double> fft;
+    qint32 sample_count = residuum.rows();
+    qint32 channel_count = residuum.cols() * (boost / 100.0);
+    if(boost == 0 || channel_count == 0)
+        channel_count = 1;
+
+    VectorXd best_parameters = VectorXd::Zero(6);
+    qreal s = 1;
+    qint32 j = 1;
+
+    while(s < sample_count)
+    {
+        VectorXd envelope = GaborAtom::gauss_function(sample_count, s, floor(sample_count / 2));
+        VectorXcd fft_envelope = RowVectorXcd::Zero(sample_count);
+        fft.fwd(fft_envelope, envelope);
+
+        qreal k = 0;
+        while(k < sample_count/2)
+        {
+            VectorXcd modulation = adaptiveMp.modulation_function(sample_count, k);
+            VectorXcd modulated_resid = VectorXcd::Zero(sample_count);
+            VectorXcd fft_modulated_resid = VectorXcd::Zero(sample_count);
+            VectorXcd fft_m_e_resid = VectorXcd::Zero(sample_count);
+            VectorXd corr_coeffs = VectorXd::Zero(sample_count);
+
+            for(qint32 chn = 0; chn < channel_count; chn++)
+            {
+                qint32 p = floor(sample_count/2);
+
+                for(qint32 l = 0; l < sample_count; l++)
+                    modulated_resid[l] = residuum(l, chn) * modulation[l];
+
+                fft.fwd(fft_modulated_resid, modulated_resid);
+
+                for(qint32 m = 0; m < sample_count; m++)
+                    fft_m_e_resid[m] = fft_modulated_resid[m] * conj(fft_envelope[m]);
+
+                fft.inv(corr_coeffs, fft_m_e_resid);
+
+                std::ptrdiff_t max_index;
+                corr_coeffs.maxCoeff(&max_index);
+
+                if(max_index >= p) p = max_index - p + 1;
+                else p = max_index + p;
+
+                VectorXd atom_parameters = AdaptiveMp::calculate_atom(sample_count, s, p, k, chn, residuum, RETURNPARAMETERS, false);
+                if(std::fabs(atom_parameters[4]) >= std::fabs(best_parameters[4]))
+                {
+                    best_parameters.head(5) = atom_parameters;
+                    best_parameters[5] = chn;
+                }
+            }
+
+            k += pow(2.0,(-j))*sample_count/2;
+        }
+        j++;
+        s = pow(2.0,j);
+    }
+
+    //atoms without envelope
+    j = floor(log10(sample_count)/log10(2));
+    for(qint32 chn = 0; chn < channel_count; chn++)
+    {
+        for(qreal k = 0; k < sample_count / 2; k += pow(2.0,(-j))*sample_count/2)
+        {
+            VectorXd atom_parameters = AdaptiveMp::calculate_atom(sample_count, sample_count, floor(sample_count / 2), k, chn, residuum, RETURNPARAMETERS, false);
+            if(std::fabs(atom_parameters[4]) > std::fabs(best_parameters[4]))
+            {
+                best_parameters.head(5) = atom_parameters;
+                best_parameters[5] = chn;
+            }
+        }
+    }
+
+    return best_parameters;
+}
+
+} // NAMESPACE
+
+
+//=============================================================================================================
+/**
+* DECLARE CLASS TestAdaptiveMp
+*
+* @brief The TestAdaptiveMp class compares the parallel adaptive matching pursuit search to the sequential search
+*        and benchmarks both on a 60 channel, 10 s signal.
+*
+*/
+class TestAdaptiveMp: public QObject
+{
+    Q_OBJECT
+
+public:
+    TestAdaptiveMp();
+
+private slots:
+    void initTestCase();
+    void compareSequentialSearch();
+    void checkTrialSeparation();
+    void benchmarkSequentialSearch();
+    void benchmarkAdaptiveMp();
+    void cleanupTestCase();
+
+private:
+    double epsilon;
+    MatrixXd m_matSignal;       /**< The test signal (samples x channels). */
+};
+
+
+//*************************************************************************************************************
+
+TestAdaptiveMp::TestAdaptiveMp()
+: epsilon(1e-10)
+{
+}
+
+
+//*************************************************************************************************************
+
+void TestAdaptiveMp::initTestCase()
+{
+    //60 channels, 10 s at 250 Hz: two gabor atoms with channel dependent amplitudes in noise
+    const int iNumChannels = 60;
+    const int iNumSamples = 2500;
+
+    GaborAtom gaborAtom;
+    VectorXd vecAtomA = gaborAtom.create_real(iNumSamples, 256, 900, 250, 0.7);
+    VectorXd vecAtomB = gaborAtom.create_real(iNumSamples, 64, 1800, 600, 1.3);
+
+    srand(0);
+    m_matSignal = 0.05 * MatrixXd::Random(iNumSamples, iNumChannels);
+    for(int i = 0; i < iNumChannels; ++i) {
+        m_matSignal.col(i) += (1.0 + 0.1 * i) * vecAtomA + (2.0 - 0.02 * i) * vecAtomB;
+    }
+}
+
+
+//*************************************************************************************************************
+
+void TestAdaptiveMp::compareSequentialSearch()
+{
+    VectorXd vecReference = sequentialSearch(m_matSignal);
+
+    //one iteration without simplex optimisation, only the first channel is searched
+    AdaptiveMp adaptiveMp;
+    QList<QList<GaborAtom> > lAtoms = adaptiveMp.matching_pursuit(m_matSignal, 1, 0, false, 0, 0, 1.0, 0.2, 0.5, 0.5, false);
+
+    QVERIFY( lAtoms.size() == 1 && lAtoms.first().size() == 1 );
+    const GaborAtom& atom = lAtoms.first().first();
+
+    QVERIFY( atom.scale == vecReference[0] );
+    QVERIFY( atom.translation == vecReference[1] );
+    QVERIFY( atom.modulation == vecReference[2] );
+    QVERIFY( std::fabs(atom.phase - vecReference[3]) < epsilon );
+    QVERIFY( std::fabs(atom.max_scalar_product - vecReference[4]) < epsilon );
+    QVERIFY( atom.bm_channel == 0 );
+
+    //the found atom lies within the envelope of the stronger atom of the test signal
+    QVERIFY( qAbs(atom.translation - 1800) < 64 );
+
+    //all channels observed, the best matching channel has to match as well
+    MatrixXd matSignal = m_matSignal.leftCols(8);
+    vecReference = sequentialSearch(matSignal, 100);
+
+    AdaptiveMp adaptiveMpMultichannel;
+    QList<QList<GaborAtom> > lAtomsMultichannel = adaptiveMpMultichannel.matching_pursuit(matSignal, 1, 0, false, 100, 0, 1.0, 0.2, 0.5, 0.5, false);
+
+    QVERIFY( lAtomsMultichannel.size() == 1 && lAtomsMultichannel.first().size() == 1 );
+    const GaborAtom& atomMultichannel = lAtomsMultichannel.first().first();
+
+    QVERIFY( atomMultichannel.scale == vecReference[0] );
+    QVERIFY( atomMultichannel.translation == vecReference[1] );
+    QVERIFY( atomMultichannel.modulation == vecReference[2] );
+    QVERIFY( std::fabs(atomMultichannel.phase - vecReference[3]) < epsilon );
+    QVERIFY( std::fabs(atomMultichannel.max_scalar_product - vecReference[4]) < epsilon );
+    QVERIFY( atomMultichannel.bm_channel == vecReference[5] );
+}
+
+
+//*************************************************************************************************************
+
+void TestAdaptiveMp::checkTrialSeparation()
+{
+    //with trial separation every channel gets its own atom, the first channel matches the sequential search
+    MatrixXd matSignal = m_matSignal.leftCols(4);
+    VectorXd vecReference = sequentialSearch(matSignal);
+
+    AdaptiveMp adaptiveMp;
+    QList<QList<GaborAtom> > lAtoms = adaptiveMp.matching_pursuit(matSignal, 1, 0, false, 100, 0, 1.0, 0.2, 0.5, 0.5, true);
+
+    QVERIFY( lAtoms.size() == 1 && lAtoms.first().size() == 4 );
+    const GaborAtom& atom = lAtoms.first().first();
+
+    QVERIFY( atom.scale == vecReference[0] );
+    QVERIFY( atom.translation == vecReference[1] );
+    QVERIFY( atom.modulation == vecReference[2] );
+    QVERIFY( std::fabs(atom.phase - vecReference[3]) < epsilon );
+    QVERIFY( std::fabs(atom.max_scalar_product - vecReference[4]) < epsilon );
+}
+
+
+//*************************************************************************************************************
+
+void TestAdaptiveMp::benchmarkSequentialSearch()
+{
+    //all 60 channels are observed
+    QBENCHMARK {
+        sequentialSearch(m_matSignal, 100);
+    }
+}
+
+
+//*************************************************************************************************************
+
+void TestAdaptiveMp::benchmarkAdaptiveMp()
+{
+    //all 60 channels are observed
+    QBENCHMARK {
+        AdaptiveMp adaptiveMp;
+        adaptiveMp.matching_pursuit(m_matSignal, 1, 0, false, 100, 0, 1.0, 0.2, 0.5, 0.5, false);
+    }
+}
+
+
+//*************************************************************************************************************
+
+void TestAdaptiveMp::cleanupTestCase()
+{
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+QTEST_APPLESS_MAIN(TestAdaptiveMp)
+#include "test_adaptive_mp.moc"
@@ -0,0 +1,318 @@
+//=============================================================================================================
+/**
+* @file     test_bem_solution.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     October, 2018
+*
+* @section  LICENSE
+*
+* Copyright (C) 2018, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Verifies the BEM solution and times its assembly and inversion
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <fwd/fwd_bem_model.h>
+#include <mne/c/mne_surface_old.h>
+#include <mne/c/mne_triangle.h>
+
+#include <stdlib.h>
+
+#define _USE_MATH_DEFINES
+#include <math.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtTest>
+#include <QTemporaryDir>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace FWDLIB;
+using namespace MNELIB;
+using namespace Eigen;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STATIC DEFINITIONS
+//=============================================================================================================
+
+namespace
+{
+
+//=============================================================================================================
+/**
+* Copies a matrix allocated by the forward library to Eigen and frees it.
+*
+* @param [in] mat   the matrix, allocated contiguously.
+* @param [in] nrow  number of rows.
+* @param [in] ncol  number of columns.
+*
+* @return the matrix.
+*/
+MatrixXf takeMatrix(float **mat, int nrow, int ncol)
+{
+    MatrixXf matResult = Map<Matrix<float,Dynamic,Dynamic,RowMajor> >(mat[0], nrow, ncol);
+    free(mat[0]);
+    free(mat);
+    return matResult;
+}
+
+} // NAMESPACE
+
+
+//=============================================================================================================
+/**
+* DECLARE CLASS TestBemSolution
+*
+* @brief The TestBemSolution class verifies the assembly, the inversion and the cache of the BEM collocation matrices
+*        of the 5120 triangle sample BEM and reports the time of each step.
+*
+*/
+class TestBemSolution: public QObject
+{
+    Q_OBJECT
+
+public:
+    TestBemSolution();
+
+private slots:
+    void initTestCase();
+    void compareSolidAngles();
+    void checkLinearSolution();
+    void checkSolutionCache();
+    void benchmarkSolidAngles();
+    void benchmarkLinPotCoeff();
+    void benchmarkConstantSolution();
+    void benchmarkLinearSolution();
+    void cleanupTestCase();
+
+private:
+    double epsilon;
+
+    FwdBemModel* m_pBemModel;
+};
+
+
+//*************************************************************************************************************
+
+TestBemSolution::TestBemSolution()
+: epsilon(0.001)
+, m_pBemModel(Q_NULLPTR)
+{
+}
+
+
+//*************************************************************************************************************
+
+void TestBemSolution::initTestCase()
+{
+    QFile testFile(QDir::currentPath()+"/mne-cpp-test-data/subjects/sample/bem/sample-5120-bem.fif");
+    QVERIFY( testFile.exists() );
+
+    m_pBemModel = FwdBemModel::fwd_bem_load_homog_surface(testFile.fileName());
+    QVERIFY( m_pBemModel != Q_NULLPTR );
+    QVERIFY( m_pBemModel->nsurf == 1 );
+}
+
+
+//*************************************************************************************************************
+
+void TestBemSolution::compareSolidAngles()
+{
+    MneSurfaceOld* surf = m_pBemModel->surfs[0];
+
+    float **solids = FwdBemModel::fwd_bem_solid_angles(m_pBemModel->surfs);
+    QVERIFY( solids != NULL );
+    MatrixXf matSolids = takeMatrix(solids, surf->ntri, surf->ntri);
+
+    //
+    //   The vectorized rows match the solid angles of single triangles
+    //
+    for(int j = 0; j < surf->ntri; j += 97) {
+        for(int k = 0; k < surf->ntri; ++k) {
+            double dSolid = j == k ? 0.0 : MneSurfaceOrVolume::solid_angle(surf->tris[j].cent, surf->tris + k);
+            QVERIFY( std::fabs(matSolids(j,k) - dSolid) < 1e-5 );
+        }
+    }
+}
+
+
+//*************************************************************************************************************
+
+void TestBemSolution::checkLinearSolution()
+{
+    MneSurfaceOld* surf = m_pBemModel->surfs[0];
+    int np = surf->np;
+
+    float **coeff = FwdBemModel::fwd_bem_lin_pot_coeff(m_pBemModel->surfs);
+    QVERIFY( coeff != NULL );
+
+    //
+    //   The system matrix of the homogeneous model as set up by fwd_bem_multi_solution
+    //
+    MatrixXf matSystem = MatrixXf::Identity(np, np) + MatrixXf::Constant(np, np, 1.0f/np)
+                         - Map<Matrix<float,Dynamic,Dynamic,RowMajor> >(coeff[0], np, np) / (2.0f*M_PI);
+
+    float **solution = FwdBemModel::fwd_bem_homog_solution(coeff, np);
+    QVERIFY( solution != NULL );
+    MatrixXf matSolution = takeMatrix(solution, np, np);
+
+    //
+    //   The solution is the inverse of the system matrix
+    //
+    const int iNumCols = 64;
+    MatrixXf matResidual = matSystem * matSolution.leftCols(iNumCols) - MatrixXf::Identity(np, iNumCols);
+    QVERIFY( matResidual.cwiseAbs().maxCoeff() < epsilon );
+}
+
+
+//*************************************************************************************************************
+
+void TestBemSolution::checkSolutionCache()
+{
+    QTemporaryDir tempDir;
+    QVERIFY( tempDir.isValid() );
+
+    //
+    //   The cache is on by default
+    //
+    QVERIFY( m_pBemModel->use_solution_cache );
+
+    //
+    //   There is no solution in the model file, the computed solution is cached next to it
+    //
+    QString sModelName = tempDir.path() + "/sample-5120-bem.fif";
+    QString sCacheName = FwdBemModel::fwd_bem_solution_cache_name(sModelName, m_pBemModel, FWD_BEM_LINEAR_COLL);
+    QVERIFY( !QFile::exists(sCacheName) );
+
+    QVERIFY( FwdBemModel::fwd_bem_load_recompute_solution(sModelName, FWD_BEM_LINEAR_COLL, false, m_pBemModel) == 0 );
+    QVERIFY( QFile::exists(sCacheName) );
+    int nsol = m_pBemModel->nsol;
+    MatrixXf matComputed = Map<Matrix<float,Dynamic,Dynamic,RowMajor> >(m_pBemModel->solution[0], nsol, nsol);
+
+    //
+    //   The second request hits the cache
+    //
+    QVERIFY( FwdBemModel::fwd_bem_load_recompute_solution(sModelName, FWD_BEM_LINEAR_COLL, false, m_pBemModel) == 0 );
+    QVERIFY( m_pBemModel->sol_name == sCacheName );
+    QVERIFY( m_pBemModel->nsol == nsol );
+    QVERIFY( Map<Matrix<float,Dynamic,Dynamic,RowMajor> >(m_pBemModel->solution[0], nsol, nsol) == matComputed );
+
+    //
+    //   Another conductivity or method is another entry
+    //
+    float fSigma = m_pBemModel->sigma[0];
+    m_pBemModel->sigma[0] = 2.0f*fSigma;
+    QVERIFY( FwdBemModel::fwd_bem_solution_cache_name(sModelName, m_pBemModel, FWD_BEM_LINEAR_COLL) != sCacheName );
+    m_pBemModel->sigma[0] = fSigma;
+    QVERIFY( FwdBemModel::fwd_bem_solution_cache_name(sModelName, m_pBemModel, FWD_BEM_CONSTANT_COLL) != sCacheName );
+}
+
+
+//*************************************************************************************************************
+
+void TestBemSolution::benchmarkSolidAngles()
+{
+    MneSurfaceOld* surf = m_pBemModel->surfs[0];
+
+    QBENCHMARK_ONCE {
+        float **solids = FwdBemModel::fwd_bem_solid_angles(m_pBemModel->surfs);
+        QVERIFY( solids != NULL );
+        takeMatrix(solids, surf->ntri, surf->ntri);
+    }
+}
+
+
+//*************************************************************************************************************
+
+void TestBemSolution::benchmarkLinPotCoeff()
+{
+    MneSurfaceOld* surf = m_pBemModel->surfs[0];
+
+    QBENCHMARK_ONCE {
+        float **coeff = FwdBemModel::fwd_bem_lin_pot_coeff(m_pBemModel->surfs);
+        QVERIFY( coeff != NULL );
+        takeMatrix(coeff, surf->np, surf->np);
+    }
+}
+
+
+//*************************************************************************************************************
+
+void TestBemSolution::benchmarkConstantSolution()
+{
+    QBENCHMARK_ONCE {
+        QVERIFY( FwdBemModel::fwd_bem_compute_solution(m_pBemModel, FWD_BEM_CONSTANT_COLL) == 0 );
+    }
+}
+
+
+//*************************************************************************************************************
+
+void TestBemSolution::benchmarkLinearSolution()
+{
+    QBENCHMARK_ONCE {
+        QVERIFY( FwdBemModel::fwd_bem_compute_solution(m_pBemModel, FWD_BEM_LINEAR_COLL) == 0 );
+    }
+}
+
+
+//*************************************************************************************************************
+
+void TestBemSolution::cleanupTestCase()
+{
+    delete m_pBemModel;
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+QTEST_APPLESS_MAIN(TestBemSolution)
+#include "test_bem_solution.moc"
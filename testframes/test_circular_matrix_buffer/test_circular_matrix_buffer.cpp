@@ -0,0 +1,355 @@
+//=============================================================================================================
+/**
+* @file     test_circular_matrix_buffer.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     October, 2018
+*
+* @section  LICENSE
+*
+* Copyright (C) 2018, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Compares the lock-free and the semaphore based circular matrix buffer
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <utils/generics/circularmatrixbuffer.h>
+#include <utils/generics/lockfreecircularmatrixbuffer.h>
+
+#include <algorithm>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtTest>
+#include <QtConcurrent>
+#include <QElapsedTimer>
+#include <QVector>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace IOBUFFER;
+using namespace Eigen;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STATIC DEFINITIONS
+//=============================================================================================================
+
+namespace
+{
+
+const unsigned int BUFFER_SIZE = 64;        /**< Number of matrices per buffer, as used by the mne_scan plugins. */
+const unsigned int BLOCK_ROWS = 306;        /**< Channels per block. */
+const unsigned int BLOCK_COLS = 10;         /**< Samples per block. */
+
+inline void popBlock(CircularMatrixBuffer<double>& buffer, MatrixXd& matBlock)
+{
+    matBlock = buffer.pop();
+}
+
+inline void popBlock(LockFreeCircularMatrixBuffer<double>& buffer, MatrixXd& matBlock)
+{
+    buffer.pop(matBlock);
+}
+
+//=============================================================================================================
+/**
+* Streams blocks from a producer thread through the buffer. The producer stamps each block with its index and the
+* time it was pushed, the consumer checks the order and records the latency of each block.
+*
+* @param [in] buffer        the buffer to stream through.
+* @param [in] iNumBlocks    number of blocks to stream.
+* @param [in] iBlockRate    number of blocks per second, 0 to push as fast as possible.
+* @param [out] vecLatency   latency of each block in nanoseconds.
+*
+* @return number of blocks which were received out of order.
+*/
+template<typename BufferType>
+int streamBlocks(BufferType& buffer, int iNumBlocks, int iBlockRate, QVector<qint64>& vecLatency)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    qint64 iPeriod = iBlockRate > 0 ? 1000000000LL / iBlockRate : 0;
+
+    QFuture<void> future = QtConcurrent::run([&buffer, &timer, iNumBlocks, iPeriod]() {
+        MatrixXd matBlock = MatrixXd::Zero(BLOCK_ROWS, BLOCK_COLS);
+        for(int i = 0; i < iNumBlocks; ++i) {
+            //Busy wait, sleeping is too coarse for the 20 kHz block rate
+            while(timer.nsecsElapsed() < i * iPeriod) {
+            }
+            matBlock(0,0) = i;
+            matBlock(0,1) = timer.nsecsElapsed();
+            buffer.push(&matBlock);
+        }
+    });
+
+    vecLatency.resize(iNumBlocks);
+
+    int iErrors = 0;
+    MatrixXd matBlock(BLOCK_ROWS, BLOCK_COLS);
+    for(int i = 0; i < iNumBlocks; ++i) {
+        popBlock(buffer, matBlock);
+        vecLatency[i] = timer.nsecsElapsed() - (qint64)matBlock(0,1);
+        if(matBlock(0,0) != i) {
+            ++iErrors;
+        }
+    }
+
+    future.waitForFinished();
+
+    return iErrors;
+}
+
+//=============================================================================================================
+/**
+* Prints the median, the 99th percentile and the maximum of the latencies.
+*/
+void printLatency(const QString& sName, QVector<qint64> vecLatency)
+{
+    std::sort(vecLatency.begin(), vecLatency.end());
+
+    qDebug() << sName.toLatin1().constData()
+             << "latency [us] - p50:" << vecLatency[vecLatency.size()/2] / 1000.0
+             << "p99:" << vecLatency[(vecLatency.size()*99)/100] / 1000.0
+             << "max:" << vecLatency.last() / 1000.0;
+}
+
+} // NAMESPACE
+
+
+//=============================================================================================================
+/**
+* DECLARE CLASS TestCircularMatrixBuffer
+*
+* @brief The TestCircularMatrixBuffer class verifies the LockFreeCircularMatrixBuffer and compares its throughput
+*        and tail latency to the semaphore based CircularMatrixBuffer at 1 kHz and 20 kHz block rates.
+*
+*/
+class TestCircularMatrixBuffer: public QObject
+{
+    Q_OBJECT
+
+public:
+    TestCircularMatrixBuffer();
+
+private slots:
+    void initTestCase();
+    void compareOrder();
+    void checkNonBlocking();
+    void checkRelease();
+    void benchmarkThroughputSemaphore();
+    void benchmarkThroughputLockFree();
+    void compareLatency_data();
+    void compareLatency();
+    void cleanupTestCase();
+
+private:
+    int iNumBlocks;
+};
+
+
+//*************************************************************************************************************
+
+TestCircularMatrixBuffer::TestCircularMatrixBuffer()
+: iNumBlocks(1000)
+{
+}
+
+
+//*************************************************************************************************************
+
+void TestCircularMatrixBuffer::initTestCase()
+{
+    //The producer runs in the global thread pool
+    QThreadPool::globalInstance()->setMaxThreadCount(qMax(QThreadPool::globalInstance()->maxThreadCount(), 2));
+}
+
+
+//*************************************************************************************************************
+
+void TestCircularMatrixBuffer::compareOrder()
+{
+    //
+    //   A small buffer makes the producer and the consumer run into the full and the empty state
+    //
+    LockFreeCircularMatrixBuffer<double> buffer(4, BLOCK_ROWS, BLOCK_COLS);
+    QVector<qint64> vecLatency;
+
+    QVERIFY( streamBlocks(buffer, 20 * iNumBlocks, 0, vecLatency) == 0 );
+    QVERIFY( buffer.count() == 0 );
+}
+
+
+//*************************************************************************************************************
+
+void TestCircularMatrixBuffer::checkNonBlocking()
+{
+    LockFreeCircularMatrixBuffer<double> buffer(4, BLOCK_ROWS, BLOCK_COLS);
+    MatrixXd matBlock = MatrixXd::Random(BLOCK_ROWS, BLOCK_COLS);
+    MatrixXd matOut;
+
+    QVERIFY( !buffer.tryPop(matOut) );
+
+    for(unsigned int i = 0; i < buffer.size(); ++i) {
+        QVERIFY( buffer.tryPush(&matBlock) );
+    }
+    QVERIFY( !buffer.tryPush(&matBlock) );
+    QVERIFY( buffer.count() == buffer.size() );
+
+    //
+    //   Matrices of the wrong dimension are skipped
+    //
+    buffer.clear();
+    MatrixXd matWrong(BLOCK_ROWS + 1, BLOCK_COLS);
+    QVERIFY( !buffer.tryPush(&matWrong) );
+    QVERIFY( buffer.count() == 0 );
+
+    QVERIFY( buffer.tryPush(&matBlock) );
+    QVERIFY( buffer.tryPop(matOut) );
+    QVERIFY( matOut == matBlock );
+    QVERIFY( !buffer.tryPop(matOut) );
+}
+
+
+//*************************************************************************************************************
+
+void TestCircularMatrixBuffer::checkRelease()
+{
+    LockFreeCircularMatrixBuffer<double> buffer(4, BLOCK_ROWS, BLOCK_COLS);
+
+    //
+    //   A consumer waiting on the empty buffer returns a zero matrix once released
+    //
+    QFuture<bool> futurePop = QtConcurrent::run([&buffer]() {
+        MatrixXd matOut;
+        return !buffer.pop(matOut) && matOut.isZero();
+    });
+    while(!futurePop.isFinished() && !buffer.releaseFromPop()) {
+    }
+    QVERIFY( futurePop.result() );
+
+    //
+    //   A producer waiting on the full buffer skips its matrix once released
+    //
+    buffer.clear();
+    MatrixXd matBlock = MatrixXd::Ones(BLOCK_ROWS, BLOCK_COLS);
+    for(unsigned int i = 0; i < buffer.size(); ++i) {
+        QVERIFY( buffer.tryPush(&matBlock) );
+    }
+    QFuture<bool> futurePush = QtConcurrent::run([&buffer, &matBlock]() {
+        return !buffer.push(&matBlock);
+    });
+    QVERIFY( buffer.releaseFromPush() );
+    QVERIFY( futurePush.result() );
+    QVERIFY( buffer.count() == buffer.size() );
+}
+
+
+//*************************************************************************************************************
+
+void TestCircularMatrixBuffer::benchmarkThroughputSemaphore()
+{
+    QVector<qint64> vecLatency;
+
+    QBENCHMARK {
+        CircularMatrixBuffer<double> buffer(BUFFER_SIZE, BLOCK_ROWS, BLOCK_COLS);
+        streamBlocks(buffer, iNumBlocks, 0, vecLatency);
+    }
+}
+
+
+//*************************************************************************************************************
+
+void TestCircularMatrixBuffer::benchmarkThroughputLockFree()
+{
+    QVector<qint64> vecLatency;
+
+    QBENCHMARK {
+        LockFreeCircularMatrixBuffer<double> buffer(BUFFER_SIZE, BLOCK_ROWS, BLOCK_COLS);
+        streamBlocks(buffer, iNumBlocks, 0, vecLatency);
+    }
+}
+
+
+//*************************************************************************************************************
+
+void TestCircularMatrixBuffer::compareLatency_data()
+{
+    QTest::addColumn<int>("iBlockRate");
+
+    QTest::newRow("1 kHz") << 1000;
+    QTest::newRow("20 kHz") << 20000;
+}
+
+
+//*************************************************************************************************************
+
+void TestCircularMatrixBuffer::compareLatency()
+{
+    QFETCH(int, iBlockRate);
+
+    //
+    //   Stream one second of blocks at the given block rate through both buffers
+    //
+    QVector<qint64> vecLatencySemaphore, vecLatencyLockFree;
+
+    CircularMatrixBuffer<double> bufferSemaphore(BUFFER_SIZE, BLOCK_ROWS, BLOCK_COLS);
+    QVERIFY( streamBlocks(bufferSemaphore, iBlockRate, iBlockRate, vecLatencySemaphore) == 0 );
+
+    LockFreeCircularMatrixBuffer<double> bufferLockFree(BUFFER_SIZE, BLOCK_ROWS, BLOCK_COLS);
+    QVERIFY( streamBlocks(bufferLockFree, iBlockRate, iBlockRate, vecLatencyLockFree) == 0 );
+
+    printLatency("CircularMatrixBuffer", vecLatencySemaphore);
+    printLatency("LockFreeCircularMatrixBuffer", vecLatencyLockFree);
+}
+
+
+//*************************************************************************************************************
+
+void TestCircularMatrixBuffer::cleanupTestCase()
+{
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+QTEST_APPLESS_MAIN(TestCircularMatrixBuffer)
+#include "test_circular_matrix_buffer.moc"
@@ -77,6 +77,8 @@ private slots:
     void initTestCase();
     void dipoleFitSimple();
     void dipoleFitAdvanced();
+    void dipoleFitCoarseGrid();
+    void benchmarkCoarseGrid();
     void cleanupTestCase();
 
 private:
@@ -273,6 +275,131 @@ void TestDipoleFit::dipoleFitAdvanced()
 }
 
 
+//*************************************************************************************************************
+
+void TestDipoleFit::dipoleFitCoarseGrid()
+{
+    QString refFileName(QDir::currentPath()+"/mne-cpp-test-data/Result/ref_dip_fit.dat");
+    QFile testFile;
+
+    //*********************************************************************************************************
+    // Dipole Fit Settings
+    //*********************************************************************************************************
+
+    printf(">>>>>>>>>>>>>>>>>>>>>>>>> Dipole Fit Settings >>>>>>>>>>>>>>>>>>>>>>>>>\n");
+
+    //Following is equivalent to: --meas ./mne-cpp-test-data/MEG/sample/sample_audvis-ave.fif --set 1 --meg --eeg --tmin 32 --tmax 148 --bmin -100 --bmax 0 --coarsegrid 20 --dip ./mne-cpp-test-data/Result/dip_fit_coarse.dat
+    DipoleFitSettings settings;
+    testFile.setFileName(QDir::currentPath()+"/mne-cpp-test-data/MEG/sample/sample_audvis-ave.fif"); QVERIFY( testFile.exists() );
+    settings.measname = testFile.fileName();
+    settings.is_raw = false;
+    settings.setno = 1;
+    settings.include_meg = true;
+    settings.include_eeg = true;
+    settings.tmin = 32.0f/1000.0f;
+    settings.tmax = 148.0f/1000.0f;
+    settings.bmin = -100.0f/1000.0f;
+    settings.bmax = 0.0f/1000.0f;
+    settings.guess_coarse_grid = 20.0f/1000.0f;
+    settings.dipname = QDir::currentPath()+"/mne-cpp-test-data/Result/dip_fit_coarse.dat";
+
+    settings.checkIntegrity();
+
+    printf("<<<<<<<<<<<<<<<<<<<<<<<<< Dipole Fit Settings Finished <<<<<<<<<<<<<<<<<<<<<<<<<\n");
+
+
+    //*********************************************************************************************************
+    // Compute Dipole Fit
+    //*********************************************************************************************************
+
+    printf(">>>>>>>>>>>>>>>>>>>>>>>>> Compute Dipole Fit >>>>>>>>>>>>>>>>>>>>>>>>>\n");
+
+    DipoleFit dipFit(&settings);
+    ECDSet set = dipFit.calculateFit();
+
+    printf("<<<<<<<<<<<<<<<<<<<<<<<<< Compute Dipole Fit Finished <<<<<<<<<<<<<<<<<<<<<<<<<\n");
+
+
+    //*********************************************************************************************************
+    // Write Read Dipole Fit
+    //*********************************************************************************************************
+
+    printf(">>>>>>>>>>>>>>>>>>>>>>>>> Write Read Dipole Fit >>>>>>>>>>>>>>>>>>>>>>>>>\n");
+
+    set.save_dipoles_dip(settings.dipname);
+    m_ECDSet = ECDSet::read_dipoles_dip(settings.dipname);
+
+    printf("<<<<<<<<<<<<<<<<<<<<<<<<< Write Read Dipole Fit Finished <<<<<<<<<<<<<<<<<<<<<<<<<\n");
+
+
+    //*********************************************************************************************************
+    // Load reference Dipole Set
+    //*********************************************************************************************************
+
+    printf(">>>>>>>>>>>>>>>>>>>>>>>>> Load Dipole Fit Reference Set >>>>>>>>>>>>>>>>>>>>>>>>>\n");
+    m_refECDSet = ECDSet::read_dipoles_dip(refFileName);
+
+    printf("<<<<<<<<<<<<<<<<<<<<<<<<< Dipole Fit Reference Set Loaded <<<<<<<<<<<<<<<<<<<<<<<<<\n");
+
+
+    //*********************************************************************************************************
+    // Compare Fit
+    //*********************************************************************************************************
+
+    compareFit();
+}
+
+
+//*************************************************************************************************************
+
+void TestDipoleFit::benchmarkCoarseGrid()
+{
+    //
+    //   Fit the simple test data on a 5 mm guess grid, once with the exhaustive scan and once with a 20 mm coarse
+    //   grid. The coarse grid computes the fields of far fewer guesses, the fitted dipoles have to be the same.
+    //
+    QList<float> lCoarseGrids;
+    lCoarseGrids << 0.0f << 20.0f/1000.0f;
+    QList<ECDSet> lSets;
+
+    for(int i = 0; i < lCoarseGrids.size(); ++i) {
+        DipoleFitSettings settings;
+        QFile testFile(QDir::currentPath()+"/mne-cpp-test-data/MEG/sample/sample_audvis-ave.fif"); QVERIFY( testFile.exists() );
+        settings.measname = testFile.fileName();
+        settings.is_raw = false;
+        settings.setno = 1;
+        settings.include_meg = true;
+        settings.include_eeg = true;
+        settings.tmin = 32.0f/1000.0f;
+        settings.tmax = 148.0f/1000.0f;
+        settings.bmin = -100.0f/1000.0f;
+        settings.bmax = 0.0f/1000.0f;
+        settings.guess_grid = 5.0f/1000.0f;
+        settings.guess_coarse_grid = lCoarseGrids[i];
+
+        settings.checkIntegrity();
+
+        QElapsedTimer timer;
+        timer.start();
+
+        DipoleFit dipFit(&settings);
+        lSets.append(dipFit.calculateFit());
+
+        printf("Guess grid 5 mm, coarse grid %4.1f mm: %d dipoles fitted in %lld ms\n",
+               1000*lCoarseGrids[i], lSets.last().size(), timer.elapsed());
+    }
+
+    QVERIFY( lSets[0].size() > 0 );
+    QVERIFY( lSets[0].size() == lSets[1].size() );
+
+    for(int i = 0; i < lSets[0].size(); ++i) {
+        QVERIFY( lSets[1][i].rd == lSets[0][i].rd );
+        QVERIFY( lSets[1][i].Q == lSets[0][i].Q );
+        QVERIFY( lSets[1][i].neval == lSets[0][i].neval );
+    }
+}
+
+
 //*************************************************************************************************************
 
 void TestDipoleFit::compareFit()
@@ -0,0 +1,295 @@
+//=============================================================================================================
+/**
+* @file     test_eeg_sphere_pot_table.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     October, 2018
+*
+* @section  LICENSE
+*
+* Copyright (C) 2018, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Compares the interpolated EEG sphere model potentials with the series expansion
+*
+*/
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <fwd/fwd_eeg_sphere_model.h>
+#include <fwd/fwd_eeg_sphere_pot_table.h>
+
+#include <math.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtTest>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// Eigen INCLUDES
+//=============================================================================================================
+
+#include <Eigen/Core>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace FWDLIB;
+using namespace Eigen;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STATIC DEFINITIONS
+//=============================================================================================================
+
+namespace {
+
+typedef Matrix<float,Dynamic,3,RowMajor> MatrixX3fRowMajor;
+
+Vector3f randomDirection()
+{
+    Vector3f vecDir = Vector3f::Random();
+    while(vecDir.norm() < 1e-3f) {
+        vecDir = Vector3f::Random();
+    }
+    return vecDir.normalized();
+}
+
+VectorXf spherePotentials(FwdEegSphereModel* pModel, Vector3f rd, Vector3f Q, MatrixX3fRowMajor& matEl)
+{
+    QVector<float*> el(matEl.rows());
+    for(int k = 0; k < matEl.rows(); ++k) {
+        el[k] = matEl.row(k).data();
+    }
+
+    VectorXf vecV(matEl.rows());
+    FwdEegSphereModel::fwd_eeg_multi_spherepot(rd.data(), Q.data(), el.data(), matEl.rows(), vecV.data(), pModel);
+    return vecV;
+}
+
+} // NAMESPACE
+
+
+//=============================================================================================================
+/**
+* DECLARE CLASS TestEegSpherePotTable
+*
+* @brief The TestEegSpherePotTable class compares the potentials of the default four-layer sphere model computed
+*        from the interpolation table (--eegtable) with the ones computed from the series expansion.
+*
+*/
+class TestEegSpherePotTable: public QObject
+{
+    Q_OBJECT
+
+public:
+    TestEegSpherePotTable();
+
+private slots:
+    void initTestCase();
+    void compareScalpPotentials();
+    void compareSeriesFallback();
+    void comparePoleLimit();
+    void cleanupTestCase();
+
+private:
+    double epsilon;
+    float m_fRad;                           /**< The scalp radius. */
+    FwdEegSphereModel* m_pModelSeries;      /**< The default model, summing the series. */
+    FwdEegSphereModel* m_pModelTable;       /**< The default model, interpolating the table. */
+};
+
+
+//*************************************************************************************************************
+
+TestEegSpherePotTable::TestEegSpherePotTable()
+: epsilon(1e-4)
+, m_fRad(0.09f)
+, m_pModelSeries(NULL)
+, m_pModelTable(NULL)
+{
+}
+
+
+//*************************************************************************************************************
+
+void TestEegSpherePotTable::initTestCase()
+{
+    //
+    //   The default four-layer model of mne_forward_solution
+    //
+    VectorXf vecRads(4);
+    vecRads << 0.90f,0.92f,0.97f,1.0f;
+    VectorXf vecSigmas(4);
+    vecSigmas << 0.33f,1.0f,0.4e-2f,0.33f;
+
+    m_pModelSeries = FwdEegSphereModel::fwd_create_eeg_sphere_model("Default",4,vecRads,vecSigmas);
+    QVERIFY( m_pModelSeries->fwd_setup_eeg_sphere_model(m_fRad,false,0) );
+
+    m_pModelTable = new FwdEegSphereModel(*m_pModelSeries);
+    QVERIFY( m_pModelTable->fwd_eeg_setup_pot_table() );
+    QVERIFY( m_pModelTable->pot_table->betaMax() == m_pModelTable->layers[0].rel_rad );
+
+    srand(0);
+}
+
+
+//*************************************************************************************************************
+
+void TestEegSpherePotTable::compareScalpPotentials()
+{
+    //
+    //   Random dipoles inside the innermost sphere, some of them right below it, and random scalp electrodes
+    //   including the ones above and opposite of the dipole
+    //
+    int iNumDipoles = 100;
+    int iNumElectrodes = 202;
+    float fMaxDipoleRad = 0.999f*m_pModelSeries->layers[0].rad;
+    MatrixX3fRowMajor matEl(iNumElectrodes,3);
+
+    for(int i = 0; i < iNumDipoles; ++i) {
+        Vector3f rd = randomDirection();
+        rd *= (i % 10 == 0) ? fMaxDipoleRad : fMaxDipoleRad*(0.55f + 0.45f*Vector2f::Random()[0]);
+        Vector3f Q = randomDirection();
+
+        matEl.row(0) = m_fRad*rd.normalized().transpose();
+        matEl.row(1) = -m_fRad*rd.normalized().transpose();
+        for(int k = 2; k < iNumElectrodes; ++k) {
+            matEl.row(k) = m_fRad*randomDirection().transpose();
+        }
+
+        VectorXf vecSeries = spherePotentials(m_pModelSeries,rd,Q,matEl);
+        VectorXf vecTable = spherePotentials(m_pModelTable,rd,Q,matEl);
+
+        QVERIFY( (vecSeries - vecTable).cwiseAbs().maxCoeff() < epsilon*vecSeries.cwiseAbs().maxCoeff() );
+    }
+}
+
+
+//*************************************************************************************************************
+
+void TestEegSpherePotTable::compareSeriesFallback()
+{
+    //
+    //   Electrodes inside the scalp, where the radius ratio exceeds the tabulated range, are computed with the
+    //   series. They alternate with scalp electrodes, which are interpolated.
+    //
+    int iNumDipoles = 20;
+    int iNumElectrodes = 100;
+    MatrixX3fRowMajor matEl(iNumElectrodes,3);
+
+    for(int i = 0; i < iNumDipoles; ++i) {
+        Vector3f rd = (0.95f*m_pModelSeries->layers[0].rad)*randomDirection();
+        Vector3f Q = randomDirection();
+
+        for(int k = 0; k < iNumElectrodes; ++k) {
+            matEl.row(k) = (k % 2 == 0 ? m_fRad : rd.norm()/0.95f)*randomDirection().transpose();
+        }
+
+        VectorXf vecSeries = spherePotentials(m_pModelSeries,rd,Q,matEl);
+        VectorXf vecTable = spherePotentials(m_pModelTable,rd,Q,matEl);
+
+        float fMaxScalp = 0.0f;
+        float fMaxScalpDiff = 0.0f;
+
+        for(int k = 0; k < iNumElectrodes; ++k) {
+            if(k % 2 == 0) {
+                fMaxScalp = qMax(fMaxScalp,fabsf(vecSeries[k]));
+                fMaxScalpDiff = qMax(fMaxScalpDiff,fabsf(vecSeries[k] - vecTable[k]));
+            } else {
+                QVERIFY( vecTable[k] == vecSeries[k] );
+            }
+        }
+
+        QVERIFY( fMaxScalpDiff < epsilon*fMaxScalp );
+    }
+}
+
+
+//*************************************************************************************************************
+
+void TestEegSpherePotTable::comparePoleLimit()
+{
+    //
+    //   The grid nodes at gamma = 0 and gamma = pi hold the limit of the tangential component divided by
+    //   sin(gamma). Close to the poles the interpolation mostly weighs these nodes.
+    //
+    int iNumAngles = 1024;
+    FwdEegSpherePotTable potTable(m_pModelTable->fn,m_pModelTable->layers[0].rel_rad,256,iNumAngles);
+
+    QList<double> lBeta = QList<double>() << 0.3 << 0.6 << 0.85 << 0.899;
+    QList<double> lFrac = QList<double>() << 0.25 << 0.5;
+
+    for(int i = 0; i < lBeta.size(); ++i) {
+        for(int j = 0; j < lFrac.size(); ++j) {
+            for(int iPole = 0; iPole < 2; ++iPole) {
+                // Uniform grid in sin(gamma/2), a fraction of the first interval away from the pole
+                double s = (iPole == 0) ? lFrac.at(j)/iNumAngles : 1.0 - lFrac.at(j)/iNumAngles;
+                double cos_gamma = 1.0 - 2.0*s*s;
+                double sin_gamma = sqrt(1.0 - cos_gamma*cos_gamma);
+
+                double Vr,Vt;
+                FwdEegSphereModel::calc_pot_components(lBeta.at(i),cos_gamma,&Vr,&Vt,m_pModelTable->fn,m_pModelTable->nterms);
+
+                ArrayXf vecBeta(1),vecCosGamma(1),vecVr,vecVt;
+                vecBeta << lBeta.at(i);
+                vecCosGamma << cos_gamma;
+                potTable.interpolate(vecBeta,vecCosGamma,vecVr,vecVt);
+
+                QVERIFY( fabs(vecVr[0] - Vr) < 1e-3*fabs(Vr) );
+                QVERIFY( fabs(vecVt[0]/sin_gamma - Vt/sin_gamma) < 1e-3*fabs(Vt/sin_gamma) );
+            }
+        }
+    }
+}
+
+
+//*************************************************************************************************************
+
+void TestEegSpherePotTable::cleanupTestCase()
+{
+    delete m_pModelTable;
+    delete m_pModelSeries;
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+QTEST_APPLESS_MAIN(TestEegSpherePotTable)
+#include "test_eeg_sphere_pot_table.moc"
@@ -0,0 +1,295 @@
+//=============================================================================================================
+/**
+* @file     test_fiff_raw_read_operator.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     October, 2018
+*
+* @section  LICENSE
+*
+* Copyright (C) 2018, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Test and benchmark for the cached read operator of FiffRawData::read_raw_segment
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <fiff/fiff.h>
+
+#include <iostream>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtTest>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace FIFFLIB;
+
+
+//=============================================================================================================
+/**
+* DECLARE CLASS TestFiffRawReadOperator
+*
+* @brief The TestFiffRawReadOperator class verifies the read operator cache and the memory mapped reading of
+*        FiffRawData and benchmarks the per epoch reading cost with and without the cache.
+*
+*/
+class TestFiffRawReadOperator: public QObject
+{
+    Q_OBJECT
+
+public:
+    TestFiffRawReadOperator();
+
+private slots:
+    void initTestCase();
+    void compareCachedUncached();
+    void checkInvalidation();
+    void compareMappedTagRead();
+    void compareSegmentsBatchSingle();
+    void benchmarkEpochUncached();
+    void benchmarkEpochCached();
+    void cleanupTestCase();
+
+private:
+    double epsilon;
+
+    QFile fileIn;
+    FiffRawData raw;
+
+    RowVectorXi picks;
+
+    fiff_int_t epochFrom;
+    fiff_int_t epochTo;
+};
+
+
+//*************************************************************************************************************
+
+TestFiffRawReadOperator::TestFiffRawReadOperator()
+: epsilon(0.000001)
+, fileIn("./mne-cpp-test-data/MEG/sample/sample_audvis_raw_short.fif")
+{
+}
+
+
+//*************************************************************************************************************
+
+void TestFiffRawReadOperator::initTestCase()
+{
+    raw = FiffRawData(fileIn);
+
+    //
+    //   Activate the projection items and create the projector
+    //
+    for (qint32 k = 0; k < raw.info.projs.size(); ++k) {
+        raw.info.projs[k].active = true;
+    }
+    raw.info.make_projector(raw.proj);
+
+    //
+    //   Pick MEG and EEG channels without bad channels
+    //
+    picks = raw.info.pick_types(true, true, false, QStringList(), raw.info.bads);
+
+    //
+    //   Short epoch of 0.7 s as used when averaging evoked responses
+    //
+    epochFrom = raw.first_samp + (fiff_int_t)raw.info.sfreq;
+    epochTo = epochFrom + (fiff_int_t)(0.7*raw.info.sfreq);
+}
+
+
+//*************************************************************************************************************
+
+void TestFiffRawReadOperator::compareCachedUncached()
+{
+    MatrixXd dataCached, dataUncached, times;
+
+    raw.read_raw_segment(dataCached, times, epochFrom, epochTo, picks);
+    raw.read_raw_segment(dataCached, times, epochFrom, epochTo, picks);
+
+    raw.clear_read_operators();
+    raw.read_raw_segment(dataUncached, times, epochFrom, epochTo, picks);
+
+    QVERIFY( dataCached.rows() == dataUncached.rows() );
+    QVERIFY( dataCached.cols() == dataUncached.cols() );
+    QVERIFY( (dataCached - dataUncached).cwiseAbs().maxCoeff() < epsilon );
+}
+
+
+//*************************************************************************************************************
+
+void TestFiffRawReadOperator::checkInvalidation()
+{
+    MatrixXd data, dataProj, times;
+
+    //
+    //   Reading again without any changes must not invalidate the cache
+    //
+    raw.read_raw_segment(data, times, epochFrom, epochTo, picks);
+    qint32 version = raw.read_operator_version();
+    raw.read_raw_segment(data, times, epochFrom, epochTo, picks);
+    QVERIFY( raw.read_operator_version() == version );
+
+    //
+    //   Changing the projector has to invalidate the cache and the result has to follow the new projector
+    //
+    MatrixXd projOrig = raw.proj;
+    raw.proj = MatrixXd();
+    raw.read_raw_segment(data, times, epochFrom, epochTo, picks);
+    QVERIFY( raw.read_operator_version() == version + 1 );
+
+    raw.proj = projOrig;
+    raw.read_raw_segment(dataProj, times, epochFrom, epochTo, picks);
+    QVERIFY( raw.read_operator_version() == version + 2 );
+
+    if(raw.info.projs.size() > 0) {
+        QVERIFY( (data - dataProj).cwiseAbs().maxCoeff() > epsilon );
+    }
+}
+
+
+//*************************************************************************************************************
+
+void TestFiffRawReadOperator::compareMappedTagRead()
+{
+    //
+    //   A buffer device can not be mapped, the raw buffers are then read as tags
+    //
+    QFile t_file(fileIn.fileName());
+    QVERIFY( t_file.open(QIODevice::ReadOnly) );
+    QBuffer t_buffer;
+    t_buffer.setData(t_file.readAll());
+    t_file.close();
+
+    FiffRawData rawTag(t_buffer);
+    rawTag.proj = raw.proj;
+
+    QVERIFY( raw.map_raw_buffer(0) != Q_NULLPTR );
+    QVERIFY( rawTag.map_raw_buffer(0) == Q_NULLPTR );
+
+    MatrixXd dataMapped, dataTag, times;
+
+    //
+    //   With projector and channel selection
+    //
+    raw.read_raw_segment(dataMapped, times, epochFrom, epochTo, picks);
+    rawTag.read_raw_segment(dataTag, times, epochFrom, epochTo, picks);
+    QVERIFY( (dataMapped - dataTag).cwiseAbs().maxCoeff() < epsilon );
+
+    //
+    //   With projector, all channels
+    //
+    raw.read_raw_segment(dataMapped, times, epochFrom, epochTo);
+    rawTag.read_raw_segment(dataTag, times, epochFrom, epochTo);
+    QVERIFY( (dataMapped - dataTag).cwiseAbs().maxCoeff() < epsilon );
+}
+
+
+//*************************************************************************************************************
+
+void TestFiffRawReadOperator::compareSegmentsBatchSingle()
+{
+    //
+    //   Unsorted and overlapping segments, one of them outside of the data
+    //
+    fiff_int_t iEpochLength = epochTo - epochFrom;
+
+    QList<QPair<fiff_int_t,fiff_int_t> > lSegments;
+    for(qint32 i = 0; i < 20; ++i) {
+        fiff_int_t from = epochFrom + ((i * 7) % 20) * iEpochLength / 3;
+        lSegments.append(QPair<fiff_int_t,fiff_int_t>(from, from + iEpochLength));
+    }
+    lSegments.append(QPair<fiff_int_t,fiff_int_t>(raw.last_samp + 10, raw.last_samp + 10 + iEpochLength));
+
+    QList<MatrixXd> lData;
+    QVERIFY( !raw.read_raw_segments(lData, lSegments, picks) );
+    QVERIFY( lData.size() == lSegments.size() );
+    QVERIFY( lData.last().size() == 0 );
+
+    MatrixXd data, times;
+    for(qint32 i = 0; i < lSegments.size() - 1; ++i) {
+        raw.read_raw_segment(data, times, lSegments[i].first, lSegments[i].second, picks);
+
+        QVERIFY( lData[i].rows() == data.rows() );
+        QVERIFY( lData[i].cols() == data.cols() );
+        QVERIFY( (lData[i] - data).cwiseAbs().maxCoeff() < epsilon );
+    }
+}
+
+
+//*************************************************************************************************************
+
+void TestFiffRawReadOperator::benchmarkEpochUncached()
+{
+    MatrixXd data, times;
+
+    QBENCHMARK {
+        raw.clear_read_operators();
+        raw.read_raw_segment(data, times, epochFrom, epochTo, picks);
+    }
+}
+
+
+//*************************************************************************************************************
+
+void TestFiffRawReadOperator::benchmarkEpochCached()
+{
+    MatrixXd data, times;
+
+    raw.read_raw_segment(data, times, epochFrom, epochTo, picks);
+
+    QBENCHMARK {
+        raw.read_raw_segment(data, times, epochFrom, epochTo, picks);
+    }
+}
+
+
+//*************************************************************************************************************
+
+void TestFiffRawReadOperator::cleanupTestCase()
+{
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+QTEST_APPLESS_MAIN(TestFiffRawReadOperator)
+#include "test_fiff_raw_read_operator.moc"
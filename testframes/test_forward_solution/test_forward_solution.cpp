@@ -50,6 +50,7 @@
 //=============================================================================================================
 
 #include <QtTest>
+#include <QThreadPool>
 
 
 //*************************************************************************************************************
@@ -78,9 +79,12 @@ public:
 private slots:
     void initTestCase();
     void computeForward();
+    void benchmarkThreadScaling_data();
+    void benchmarkThreadScaling();
     void cleanupTestCase();
 
 private:
+    void setupSampleSettings(ComputeFwdSettings& settings);
     void compareForward();
 
     double epsilon;
@@ -114,23 +118,8 @@ void TestForwardSolution::computeForward()
 
     printf(">>>>>>>>>>>>>>>>>>>>>>>>> Forward Solution Settings >>>>>>>>>>>>>>>>>>>>>>>>>\n");
 
-    //Following is equivalent to: --meg --accurate --src ./MNE-sample-data/subjects/sample/bem/sample-oct-6-src.fif
-    // --meas ./MNE-sample-data/MEG/sample/sample_audvis_raw.fif
-    // --mri ./MNE-sample-data/subjects/sample/mri/brain-neuromag/sets/COR.fif
-    // --bem ./MNE-sample-data/subjects/sample/bem/sample-5120-5120-5120-bem.fif
-    // --mindist 5 --fwd ./MNE-sample-data/Result/sample_audvis-meg-oct-6-fwd.fif
     ComputeFwdSettings settings;
-
-    settings.include_meg = true;
-    settings.accurate = true;
-    settings.srcname = QDir::currentPath()+QCoreApplication::applicationDirPath() + "/MNE-sample-data/subjects/sample/bem/sample-oct-6-src.fif";
-    settings.measname = QDir::currentPath()+QCoreApplication::applicationDirPath() + "/MNE-sample-data/MEG/sample/sample_audvis_raw.fif";
-    settings.mriname = QDir::currentPath()+QCoreApplication::applicationDirPath() + "/MNE-sample-data/subjects/sample/mri/brain-neuromag/sets/COR.fif";
-    settings.mri_head_ident = false;
-    settings.transname.clear();
-    settings.bemname = QDir::currentPath()+QCoreApplication::applicationDirPath() + "/MNE-sample-data/subjects/sample/bem/sample-5120-5120-5120-bem.fif";
-    settings.mindist = 5.0f/1000.0f;
-    settings.solname = QDir::currentPath()+"./mne-cpp-test-data/Result/sample_audvis-meg-oct-6-fwd.fif";
+    setupSampleSettings(settings);
 
     settings.checkIntegrity();
 
@@ -166,6 +155,71 @@ void TestForwardSolution::computeForward()
 }
 
 
+//*************************************************************************************************************
+
+void TestForwardSolution::setupSampleSettings(ComputeFwdSettings& settings)
+{
+    //Following is equivalent to: --meg --accurate --src ./MNE-sample-data/subjects/sample/bem/sample-oct-6-src.fif
+    // --meas ./MNE-sample-data/MEG/sample/sample_audvis_raw.fif
+    // --mri ./MNE-sample-data/subjects/sample/mri/brain-neuromag/sets/COR.fif
+    // --bem ./MNE-sample-data/subjects/sample/bem/sample-5120-5120-5120-bem.fif
+    // --mindist 5 --fwd ./MNE-sample-data/Result/sample_audvis-meg-oct-6-fwd.fif
+    settings.include_meg = true;
+    settings.accurate = true;
+    settings.srcname = QDir::currentPath()+QCoreApplication::applicationDirPath() + "/MNE-sample-data/subjects/sample/bem/sample-oct-6-src.fif";
+    settings.measname = QDir::currentPath()+QCoreApplication::applicationDirPath() + "/MNE-sample-data/MEG/sample/sample_audvis_raw.fif";
+    settings.mriname = QDir::currentPath()+QCoreApplication::applicationDirPath() + "/MNE-sample-data/subjects/sample/mri/brain-neuromag/sets/COR.fif";
+    settings.mri_head_ident = false;
+    settings.transname.clear();
+    settings.bemname = QDir::currentPath()+QCoreApplication::applicationDirPath() + "/MNE-sample-data/subjects/sample/bem/sample-5120-5120-5120-bem.fif";
+    settings.mindist = 5.0f/1000.0f;
+    settings.solname = QDir::currentPath()+"./mne-cpp-test-data/Result/sample_audvis-meg-oct-6-fwd.fif";
+
+}
+
+
+//*************************************************************************************************************
+
+void TestForwardSolution::benchmarkThreadScaling_data()
+{
+    QTest::addColumn<int>("iNumThreads");
+
+    QTest::newRow("1 thread") << 1;
+    QTest::newRow("2 threads") << 2;
+    QTest::newRow("4 threads") << 4;
+    QTest::newRow("8 threads") << 8;
+    QTest::newRow("16 threads") << 16;
+    QTest::newRow("32 threads") << 32;
+    QTest::newRow("64 threads") << 64;
+}
+
+
+//*************************************************************************************************************
+
+void TestForwardSolution::benchmarkThreadScaling()
+{
+    QFETCH(int, iNumThreads);
+
+    //The source points are scheduled on the global thread pool, limit it to the requested number of threads
+    int iMaxThreadCount = QThreadPool::globalInstance()->maxThreadCount();
+    QThreadPool::globalInstance()->setMaxThreadCount(iNumThreads);
+
+    ComputeFwdSettings settings;
+    setupSampleSettings(settings);
+    settings.solname = QDir::tempPath() + "/test_forward_solution_scaling-fwd.fif";
+    settings.checkIntegrity();
+
+    ComputeFwd cmpFwd(&settings);
+
+    QBENCHMARK_ONCE {
+        cmpFwd.calculateFwd();
+    }
+
+    QFile::remove(settings.solname);
+    QThreadPool::globalInstance()->setMaxThreadCount(iMaxThreadCount);
+}
+
+
 //*************************************************************************************************************
 
 void TestForwardSolution::compareForward()
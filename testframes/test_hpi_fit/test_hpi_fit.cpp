@@ -0,0 +1,349 @@
+//=============================================================================================================
+/**
+* @file     test_hpi_fit.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     October, 2018
+*
+* @section  LICENSE
+*
+* Copyright (C) 2018, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Verifies the continuous HPI fit on simulated coil data
+*
+*/
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <fiff/fiff_raw_data.h>
+#include <fiff/fiff_info.h>
+#include <fiff/fiff_coord_trans.h>
+#include <fiff/fiff_dig_point_set.h>
+#include <inverse/hpiFit/hpifit.h>
+#include <inverse/hpiFit/hpifitdata.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtTest>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace FIFFLIB;
+using namespace INVERSELIB;
+using namespace Eigen;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STATIC DEFINITIONS
+//=============================================================================================================
+
+namespace
+{
+
+//=============================================================================================================
+/**
+* Gives the simulation access to the inner layer sensor geometry the fits use.
+*/
+class HPIFitSensors : public HPIFit
+{
+public:
+    static void get(FiffInfo::SPtr pFiffInfo, QVector<int>& innerind, SensorInfo& sensors)
+    {
+        getSensors(pFiffInfo, innerind, sensors);
+    }
+};
+
+
+//=============================================================================================================
+/**
+* Gives the simulation access to the magnetic dipole lead field the fits use.
+*/
+class HPIFitDipole : public HPIFitData
+{
+public:
+    static MatrixXd leadfield(const MatrixXd& pos, const MatrixXd& pnt, const MatrixXd& ori)
+    {
+        return magnetic_dipole(pos, pnt, ori);
+    }
+};
+
+
+//=============================================================================================================
+/**
+* Simulates the signals of magnetic dipoles at the coil positions, each one oscillating with its coil
+* frequency, plus white noise.
+*
+* @param [in] pFiffInfo     the measurement info.
+* @param [in] coilPos       the coil positions in device coordinates (coils x 3).
+* @param [in] vFreqs        the coil frequencies.
+* @param [in] iNumSamples   the number of samples.
+*
+* @return the simulated data (channels x samples).
+*/
+MatrixXd simulateCoils(FiffInfo::SPtr pFiffInfo, const MatrixXd& coilPos, const QVector<int>& vFreqs, int iNumSamples)
+{
+    QVector<int> innerind;
+    SensorInfo sensors;
+    HPIFitSensors::get(pFiffInfo, innerind, sensors);
+
+    MatrixXd matData = MatrixXd::Zero(pFiffInfo->nchan, iNumSamples);
+
+    for(int i = 0; i < coilPos.rows(); ++i) {
+        //moment pointing outwards
+        Vector3d mom = coilPos.row(i).transpose().normalized();
+        VectorXd topo = HPIFitDipole::leadfield(coilPos.row(i), sensors.coilpos, sensors.coilori) * mom;
+
+        for(int t = 0; t < iNumSamples; ++t) {
+            double dSig = sin(2*M_PI*vFreqs[i]*t/pFiffInfo->sfreq);
+            for(int j = 0; j < innerind.size(); ++j) {
+                matData(innerind[j], t) += topo[j] * dSig;
+            }
+        }
+    }
+
+    srand(0);
+    matData += 1e-3 * matData.cwiseAbs().maxCoeff() * MatrixXd::Random(matData.rows(), matData.cols());
+
+    return matData;
+}
+
+} // NAMESPACE
+
+
+//=============================================================================================================
+/**
+* DECLARE CLASS TestHpiFit
+*
+* @brief The TestHpiFit class compares the continuous Levenberg-Marquardt HPI fit with the static Nelder-Mead fit
+*        and checks the warm start and the update of the digitized coil positions on simulated coil data.
+*
+*/
+class TestHpiFit: public QObject
+{
+    Q_OBJECT
+
+public:
+    TestHpiFit();
+
+private slots:
+    void initTestCase();
+    void compareFitHPI();
+    void checkWarmStart();
+    void checkDigitizerUpdate();
+    void cleanupTestCase();
+
+private:
+    MatrixXd fittedPositions(const FiffDigPointSet& fittedPointSet) const;
+
+    double epsilon;
+    FiffInfo::SPtr m_pFiffInfo;     /**< The measurement info of the sample data. */
+    MatrixXd m_matCoilPos;          /**< The simulated coil positions in device coordinates. */
+    MatrixXd m_matProjectors;       /**< The projector (identity). */
+    MatrixXd m_matData;             /**< The simulated coil data. */
+    QVector<int> m_vFreqs;          /**< The coil frequencies. */
+    int m_iNumSamples;              /**< The number of samples per fit. */
+};
+
+
+//*************************************************************************************************************
+
+TestHpiFit::TestHpiFit()
+: epsilon(5e-4)
+, m_iNumSamples(1000)
+{
+}
+
+
+//*************************************************************************************************************
+
+void TestHpiFit::initTestCase()
+{
+    QFile t_fileRaw(QDir::currentPath()+"/mne-cpp-test-data/MEG/sample/sample_audvis_raw_short.fif");
+    FiffRawData raw(t_fileRaw);
+
+    m_pFiffInfo = FiffInfo::SPtr(new FiffInfo(raw.info));
+    m_pFiffInfo->sfreq = 1000;
+
+    //The coils sit at the digitized positions, transformed into device coordinates
+    QList<int> lHPIIdx;
+    for(int i = 0; i < m_pFiffInfo->dig.size(); ++i) {
+        if(m_pFiffInfo->dig[i].kind == FIFFV_POINT_HPI) {
+            lHPIIdx.append(i);
+        }
+    }
+    QVERIFY( lHPIIdx.size() >= 3 );
+
+    Matrix4d matHeadDev = m_pFiffInfo->dev_head_t.trans.cast<double>().inverse();
+    m_matCoilPos.resize(lHPIIdx.size(), 3);
+    for(int i = 0; i < lHPIIdx.size(); ++i) {
+        const FiffDigPoint& point = m_pFiffInfo->dig[lHPIIdx[i]];
+        Vector4d head(point.r[0], point.r[1], point.r[2], 1.0);
+        m_matCoilPos.row(i) = (matHeadDev * head).head(3).transpose();
+    }
+
+    m_vFreqs << 154 << 158 << 161 << 166 << 172;
+    m_vFreqs.resize(lHPIIdx.size());
+
+    m_matProjectors = MatrixXd::Identity(m_pFiffInfo->nchan, m_pFiffInfo->nchan);
+    m_matData = simulateCoils(m_pFiffInfo, m_matCoilPos, m_vFreqs, m_iNumSamples);
+}
+
+
+//*************************************************************************************************************
+
+void TestHpiFit::compareFitHPI()
+{
+    FiffCoordTrans transRef;
+    QVector<double> vGofRef;
+    FiffDigPointSet fittedRef;
+    HPIFit::fitHPI(m_matData, m_matProjectors, transRef, m_vFreqs, vGofRef, fittedRef, m_pFiffInfo);
+
+    FiffCoordTrans trans;
+    QVector<double> vGof;
+    FiffDigPointSet fitted;
+    HPIFit hpiFit;
+    hpiFit.fit(m_matData, m_matProjectors, trans, m_vFreqs, vGof, fitted, m_pFiffInfo);
+
+    MatrixXd matPosRef = fittedPositions(fittedRef);
+    MatrixXd matPos = fittedPositions(fitted);
+    QVERIFY( matPos.rows() == m_matCoilPos.rows() && matPosRef.rows() == m_matCoilPos.rows() );
+
+    //both find the simulated coils and agree with each other
+    for(int i = 0; i < m_matCoilPos.rows(); ++i) {
+        QVERIFY( (matPos.row(i) - m_matCoilPos.row(i)).norm() < epsilon );
+        QVERIFY( (matPosRef.row(i) - m_matCoilPos.row(i)).norm() < 4 * epsilon );
+        QVERIFY( (matPos.row(i) - matPosRef.row(i)).norm() < 4 * epsilon );
+        QVERIFY( vGof[i] < epsilon );
+    }
+
+    //the dev head transformation is recovered
+    QVERIFY( (trans.trans - m_pFiffInfo->dev_head_t.trans).block(0,3,3,1).norm() < epsilon );
+}
+
+
+//*************************************************************************************************************
+
+void TestHpiFit::checkWarmStart()
+{
+    HPIFit hpiFit;
+    FiffCoordTrans trans;
+    QVector<double> vGof;
+    FiffDigPointSet fitted;
+    hpiFit.fit(m_matData, m_matProjectors, trans, m_vFreqs, vGof, fitted, m_pFiffInfo);
+
+    //the head moves by 3 mm, the next fit starts from the previous coil positions
+    MatrixXd matCoilPosMoved = m_matCoilPos;
+    matCoilPosMoved.col(0).array() += 0.003;
+    MatrixXd matDataMoved = simulateCoils(m_pFiffInfo, matCoilPosMoved, m_vFreqs, m_iNumSamples);
+
+    FiffDigPointSet fittedWarm;
+    hpiFit.fit(matDataMoved, m_matProjectors, trans, m_vFreqs, vGof, fittedWarm, m_pFiffInfo);
+
+    //a cold fit of the same data
+    HPIFit hpiFitCold;
+    FiffDigPointSet fittedCold;
+    hpiFitCold.fit(matDataMoved, m_matProjectors, trans, m_vFreqs, vGof, fittedCold, m_pFiffInfo);
+
+    MatrixXd matPosWarm = fittedPositions(fittedWarm);
+    MatrixXd matPosCold = fittedPositions(fittedCold);
+
+    for(int i = 0; i < matCoilPosMoved.rows(); ++i) {
+        QVERIFY( (matPosWarm.row(i) - matCoilPosMoved.row(i)).norm() < epsilon );
+        QVERIFY( (matPosWarm.row(i) - matPosCold.row(i)).norm() < 1e-6 );
+    }
+}
+
+
+//*************************************************************************************************************
+
+void TestHpiFit::checkDigitizerUpdate()
+{
+    FiffInfo::SPtr pFiffInfo(new FiffInfo(*m_pFiffInfo));
+
+    HPIFit hpiFit;
+    FiffCoordTrans trans;
+    QVector<double> vGof;
+    FiffDigPointSet fitted;
+    hpiFit.fit(m_matData, m_matProjectors, trans, m_vFreqs, vGof, fitted, pFiffInfo);
+
+    //new digitized coil positions in the same info object, shifted by 1 cm along z
+    for(int i = 0; i < pFiffInfo->dig.size(); ++i) {
+        if(pFiffInfo->dig[i].kind == FIFFV_POINT_HPI) {
+            pFiffInfo->dig[i].r[2] += 0.01f;
+        }
+    }
+
+    FiffCoordTrans transShifted;
+    FiffDigPointSet fittedShifted;
+    hpiFit.fit(m_matData, m_matProjectors, transShifted, m_vFreqs, vGof, fittedShifted, pFiffInfo);
+
+    Vector3f vecShift = (transShifted.trans - trans.trans).block(0,3,3,1);
+    QVERIFY( (vecShift - Vector3f(0, 0, 0.01f)).norm() < 1e-5 );
+
+    for(int i = 0; i < vGof.size(); ++i) {
+        QVERIFY( vGof[i] < epsilon );
+    }
+}
+
+
+//*************************************************************************************************************
+
+void TestHpiFit::cleanupTestCase()
+{
+}
+
+
+//*************************************************************************************************************
+
+MatrixXd TestHpiFit::fittedPositions(const FiffDigPointSet& fittedPointSet) const
+{
+    MatrixXd matPos(fittedPointSet.size(), 3);
+    for(int i = 0; i < fittedPointSet.size(); ++i) {
+        matPos(i,0) = fittedPointSet[i].r[0];
+        matPos(i,1) = fittedPointSet[i].r[1];
+        matPos(i,2) = fittedPointSet[i].r[2];
+    }
+    return matPos;
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+QTEST_APPLESS_MAIN(TestHpiFit)
+#include "test_hpi_fit.moc"
@@ -0,0 +1,274 @@
+//=============================================================================================================
+/**
+* @file     test_kmeans.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     October, 2018
+*
+* @section  LICENSE
+*
+* Copyright (C) 2018, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Verifies the accelerated k-means clustering and benchmarks it against the legacy algorithm
+*
+*/
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <utils/kmeans.h>
+#include <mne/mne_forwardsolution.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtTest>
+#include <QThreadPool>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace UTILSLIB;
+using namespace MNELIB;
+using namespace Eigen;
+
+
+//=============================================================================================================
+/**
+* DECLARE CLASS TestKMeans
+*
+* @brief The TestKMeans class verifies the accelerated k-means on a region of the sample forward solution and
+*        benchmarks it against the legacy algorithm.
+*
+*/
+class TestKMeans: public QObject
+{
+    Q_OBJECT
+
+public:
+    TestKMeans();
+
+private slots:
+    void initTestCase();
+    void checkFixedPoint_data();
+    void checkFixedPoint();
+    void checkDeterminism();
+    void benchmarkKMeans_data();
+    void benchmarkKMeans();
+    void cleanupTestCase();
+
+private:
+    double epsilon;
+    MatrixXd m_matRoiG;     /**< Gain of a region of the forward solution (rows = sources; cols = 3 x sensors). */
+    qint32 m_iClusters;     /**< Number of clusters, one per 20 sources as in cluster_forward_solution. */
+};
+
+
+//*************************************************************************************************************
+
+TestKMeans::TestKMeans()
+: epsilon(1e-10)
+, m_iClusters(0)
+{
+}
+
+
+//*************************************************************************************************************
+
+void TestKMeans::initTestCase()
+{
+    QFile t_fileFwd(QDir::currentPath()+"/mne-cpp-test-data/Result/sample_audvis-meg-oct-6-fwd.fif");
+    MNEForwardSolution t_Fwd(t_fileFwd);
+    QVERIFY( !t_Fwd.isEmpty() );
+
+    //the first 600 sources of the left hemisphere arranged like the region data of cluster_forward_solution
+    const MatrixXd& t_G = t_Fwd.sol->data;
+    qint32 nSens = t_G.rows();
+    qint32 nSources = qMin(600, t_Fwd.src[0].nuse);
+
+    m_matRoiG = MatrixXd(nSources, 3*nSens);
+    for(qint32 j = 0; j < nSens; ++j)
+        for(qint32 k = 0; k < nSources; ++k)
+            m_matRoiG.block(k,j*3,1,3) = t_G.block(j,k*3,1,3);
+
+    m_iClusters = ceil((double)nSources/20.0);
+}
+
+
+//*************************************************************************************************************
+
+void TestKMeans::checkFixedPoint_data()
+{
+    QTest::addColumn<QString>("distance");
+
+    QTest::newRow("cityblock") << QString("cityblock");
+    QTest::newRow("sqeuclidean") << QString("sqeuclidean");
+}
+
+
+//*************************************************************************************************************
+
+void TestKMeans::checkFixedPoint()
+{
+    QFETCH(QString, distance);
+
+    KMeans t_kMeans(distance, QString("plus"), 5, QString("error"), true, 100, true, 0);
+
+    VectorXi idx;
+    MatrixXd C;
+    VectorXd sumD;
+    MatrixXd D;
+    QVERIFY( t_kMeans.calculate(m_matRoiG, m_iClusters, idx, C, sumD, D) );
+
+    QVERIFY( idx.size() == m_matRoiG.rows() );
+    QVERIFY( C.rows() == m_iClusters && C.cols() == m_matRoiG.cols() );
+    QVERIFY( D.rows() == m_matRoiG.rows() && D.cols() == m_iClusters );
+
+    //every point lies in its nearest cluster
+    for(qint32 i = 0; i < idx.size(); ++i)
+        QVERIFY( D(i, idx[i]) <= D.row(i).minCoeff() * (1.0 + epsilon) );
+
+    //every non-empty centroid is the mean (sqeuclidean) or the median (cityblock) of its points
+    VectorXd sumDRef = VectorXd::Zero(m_iClusters);
+    for(qint32 c = 0; c < m_iClusters; ++c)
+    {
+        QList<qint32> members;
+        for(qint32 i = 0; i < idx.size(); ++i)
+        {
+            if(idx[i] == c)
+            {
+                members.append(i);
+                sumDRef[c] += D(i, c);
+            }
+        }
+
+        if(members.isEmpty())
+            continue;
+
+        MatrixXd matMembers(members.size(), m_matRoiG.cols());
+        for(qint32 i = 0; i < members.size(); ++i)
+            matMembers.row(i) = m_matRoiG.row(members[i]);
+
+        RowVectorXd vecRef(m_matRoiG.cols());
+        if(distance == "cityblock")
+        {
+            for(qint32 h = 0; h < matMembers.cols(); ++h)
+            {
+                VectorXd vecSorted = matMembers.col(h);
+                std::sort(vecSorted.data(), vecSorted.data() + vecSorted.size());
+                qint32 nn = members.size() / 2;
+                vecRef[h] = members.size() % 2 == 0 ? 0.5 * (vecSorted[nn-1] + vecSorted[nn]) : vecSorted[nn];
+            }
+        }
+        else
+            vecRef = matMembers.colwise().mean();
+
+        QVERIFY( (C.row(c) - vecRef).cwiseAbs().maxCoeff() <= epsilon * (1.0 + vecRef.cwiseAbs().maxCoeff()) );
+    }
+
+    QVERIFY( (sumD - sumDRef).cwiseAbs().maxCoeff() <= epsilon * (1.0 + sumDRef.cwiseAbs().maxCoeff()) );
+}
+
+
+//*************************************************************************************************************
+
+void TestKMeans::checkDeterminism()
+{
+    //the result only depends on the seed, not on the number of threads
+    KMeans t_kMeans(QString("cityblock"), QString("plus"), 5, QString("error"), true, 100, true, 42);
+
+    VectorXi idx, idxSingle;
+    MatrixXd C, CSingle;
+    VectorXd sumD, sumDSingle;
+    MatrixXd D, DSingle;
+    QVERIFY( t_kMeans.calculate(m_matRoiG, m_iClusters, idx, C, sumD, D) );
+
+    qint32 iMaxThreadCount = QThreadPool::globalInstance()->maxThreadCount();
+    QThreadPool::globalInstance()->setMaxThreadCount(1);
+    bool bSuccess = t_kMeans.calculate(m_matRoiG, m_iClusters, idxSingle, CSingle, sumDSingle, DSingle);
+    QThreadPool::globalInstance()->setMaxThreadCount(iMaxThreadCount);
+
+    QVERIFY( bSuccess );
+    QVERIFY( idx == idxSingle );
+    QVERIFY( C == CSingle );
+    QVERIFY( sumD == sumDSingle );
+}
+
+
+//*************************************************************************************************************
+
+void TestKMeans::benchmarkKMeans_data()
+{
+    QTest::addColumn<bool>("accelerated");
+    QTest::addColumn<QString>("start");
+
+    //the same start for both algorithms, so that the rows only differ in the iterations
+    QTest::newRow("legacy sample") << false << QString("sample");
+    QTest::newRow("accelerated sample") << true << QString("sample");
+    QTest::newRow("legacy plus") << false << QString("plus");
+    QTest::newRow("accelerated plus") << true << QString("plus");
+}
+
+
+//*************************************************************************************************************
+
+void TestKMeans::benchmarkKMeans()
+{
+    QFETCH(bool, accelerated);
+    QFETCH(QString, start);
+
+    VectorXi idx;
+    MatrixXd C;
+    VectorXd sumD;
+    MatrixXd D;
+
+    QBENCHMARK {
+        KMeans t_kMeans(QString("cityblock"), start, 5, QString("error"), true, 100, accelerated, 0);
+        t_kMeans.calculate(m_matRoiG, m_iClusters, idx, C, sumD, D);
+    }
+}
+
+
+//*************************************************************************************************************
+
+void TestKMeans::cleanupTestCase()
+{
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+QTEST_APPLESS_MAIN(TestKMeans)
+#include "test_kmeans.moc"
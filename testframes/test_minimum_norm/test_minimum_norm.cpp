@@ -0,0 +1,295 @@
+//=============================================================================================================
+/**
+* @file     test_minimum_norm.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     October, 2018
+*
+* @section  LICENSE
+*
+* Copyright (C) 2018, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Verifies the label restricted imaging kernels of the minimum norm inverse
+*
+*/
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <fiff/fiff_evoked.h>
+#include <fiff/fiff_cov.h>
+#include <fs/label.h>
+#include <mne/mne_forwardsolution.h>
+#include <mne/mne_inverse_operator.h>
+#include <mne/mne_sourceestimate.h>
+#include <inverse/minimumNorm/minimumnorm.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtTest>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace FIFFLIB;
+using namespace FSLIB;
+using namespace MNELIB;
+using namespace INVERSELIB;
+using namespace Eigen;
+
+
+//=============================================================================================================
+/**
+* DECLARE CLASS TestMinimumNorm
+*
+* @brief The TestMinimumNorm class compares label restricted imaging kernels and source estimates with the
+*        matching rows of the full ones, and the block wise applyInverse with the product of the kernel and
+*        the data.
+*
+*/
+class TestMinimumNorm: public QObject
+{
+    Q_OBJECT
+
+public:
+    TestMinimumNorm();
+
+private slots:
+    void initTestCase();
+    void compareLabelKernel_data();
+    void compareLabelKernel();
+    void compareApplyInverse_data();
+    void compareApplyInverse();
+    void cleanupTestCase();
+
+private:
+    double epsilon;
+    MNEInverseOperator m_invOp;     /**< Free orientation inverse operator of the sample MEG forward solution. */
+    MatrixXd m_matData;             /**< Random sensor data (channels x samples). */
+};
+
+
+//*************************************************************************************************************
+
+TestMinimumNorm::TestMinimumNorm()
+: epsilon(1e-8)
+{
+}
+
+
+//*************************************************************************************************************
+
+void TestMinimumNorm::initTestCase()
+{
+    QFile t_fileFwd(QDir::currentPath()+"/mne-cpp-test-data/Result/sample_audvis-meg-oct-6-fwd.fif");
+    QFile t_fileCov(QDir::currentPath()+"/mne-cpp-test-data/MEG/sample/sample_audvis-cov.fif");
+    QFile t_fileEvoked(QDir::currentPath()+"/mne-cpp-test-data/MEG/sample/sample_audvis-ave.fif");
+
+    QPair<QVariant, QVariant> baseline(QVariant(), 0);
+    FiffEvoked evoked(t_fileEvoked, 0, baseline);
+    QVERIFY( !evoked.isEmpty() );
+
+    MNEForwardSolution t_Fwd(t_fileFwd, false, true);
+    QVERIFY( !t_Fwd.isEmpty() );
+
+    FiffCov noise_cov(t_fileCov);
+    noise_cov = noise_cov.regularize(evoked.info, 0.05, 0.05, 0.1, true);
+
+    m_invOp = MNEInverseOperator(evoked.info, t_Fwd, noise_cov, 0.2f, 0.8f);
+
+    srand(0);
+    m_matData = MatrixXd::Random(m_invOp.eigen_fields->data.cols(), 20);
+}
+
+
+//*************************************************************************************************************
+
+void TestMinimumNorm::compareLabelKernel_data()
+{
+    QTest::addColumn<QString>("method");
+    QTest::addColumn<int>("hemi");
+    QTest::addColumn<bool>("factored");
+
+    QStringList methods;
+    methods << "MNE" << "dSPM" << "sLORETA";
+
+    for(int i = 0; i < methods.size(); ++i) {
+        for(int hemi = 0; hemi < 2; ++hemi) {
+            QTest::newRow(QString("%1 %2 dense").arg(methods[i]).arg(hemi ? "rh" : "lh").toUtf8().constData()) << methods[i] << hemi << false;
+            QTest::newRow(QString("%1 %2 factored").arg(methods[i]).arg(hemi ? "rh" : "lh").toUtf8().constData()) << methods[i] << hemi << true;
+        }
+    }
+}
+
+
+//*************************************************************************************************************
+
+void TestMinimumNorm::compareLabelKernel()
+{
+    QFETCH(QString, method);
+    QFETCH(int, hemi);
+    QFETCH(bool, factored);
+
+    float lambda2 = 1.0f / 9.0f;
+
+    //every third source of the hemisphere
+    const VectorXi& vertno = m_invOp.src[hemi].vertno;
+    qint32 nSel = vertno.size() / 3;
+    VectorXi vecVertices(nSel);
+    VectorXi vecSrcSel(nSel);
+    for(qint32 i = 0; i < nSel; ++i) {
+        vecVertices[i] = vertno[3*i];
+        vecSrcSel[i] = 3*i + (hemi ? m_invOp.src[0].nuse : 0);
+    }
+    Label label(vecVertices, MatrixX3f::Zero(nSel, 3), VectorXd::Ones(nSel), hemi, QString("test"));
+
+    //full kernel
+    MinimumNorm minimumNormFull(m_invOp, lambda2, method);
+    minimumNormFull.doInverseSetup(1, false);
+    MatrixXd matKFull = minimumNormFull.getKernel();
+    MNESourceEstimate stcFull = minimumNormFull.calculateInverse(m_matData, 0.0f, 0.001f);
+    QVERIFY( !stcFull.isEmpty() );
+
+    //label restricted kernel
+    MinimumNorm minimumNormLabel(m_invOp, lambda2, method);
+    minimumNormLabel.setFactoredKernel(factored);
+    minimumNormLabel.setLabel(label);
+    minimumNormLabel.doInverseSetup(1, false);
+    MNESourceEstimate stcLabel = minimumNormLabel.calculateInverse(m_matData, 0.0f, 0.001f);
+    QVERIFY( !stcLabel.isEmpty() );
+
+    QVERIFY( stcLabel.data.rows() == nSel );
+    QVERIFY( stcLabel.vertices == vecVertices );
+
+    double dScale = stcFull.data.cwiseAbs().maxCoeff();
+    for(qint32 i = 0; i < nSel; ++i)
+        QVERIFY( (stcLabel.data.row(i) - stcFull.data.row(vecSrcSel[i])).cwiseAbs().maxCoeff() <= epsilon * dScale );
+
+    //the dense kernel rows, three current components per source
+    if(!factored) {
+        const MatrixXd& matKLabel = minimumNormLabel.getKernel();
+        QVERIFY( matKLabel.rows() == 3*nSel && matKLabel.cols() == matKFull.cols() );
+
+        double dScaleK = matKFull.cwiseAbs().maxCoeff();
+        for(qint32 i = 0; i < nSel; ++i)
+            QVERIFY( (matKLabel.block(3*i, 0, 3, matKLabel.cols()) - matKFull.block(3*vecSrcSel[i], 0, 3, matKFull.cols())).cwiseAbs().maxCoeff() <= epsilon * dScaleK );
+    }
+}
+
+
+//*************************************************************************************************************
+
+void TestMinimumNorm::compareApplyInverse_data()
+{
+    QTest::addColumn<QString>("method");
+    QTest::addColumn<bool>("factored");
+    QTest::addColumn<bool>("single");
+
+    QStringList methods;
+    methods << "MNE" << "dSPM" << "sLORETA";
+
+    for(int i = 0; i < methods.size(); ++i) {
+        QTest::newRow(QString("%1 dense").arg(methods[i]).toUtf8().constData()) << methods[i] << false << false;
+        QTest::newRow(QString("%1 factored").arg(methods[i]).toUtf8().constData()) << methods[i] << true << false;
+        QTest::newRow(QString("%1 dense single").arg(methods[i]).toUtf8().constData()) << methods[i] << false << true;
+    }
+}
+
+
+//*************************************************************************************************************
+
+void TestMinimumNorm::compareApplyInverse()
+{
+    QFETCH(QString, method);
+    QFETCH(bool, factored);
+    QFETCH(bool, single);
+
+    float lambda2 = 1.0f / 9.0f;
+
+    //more samples than one block, the last block is incomplete
+    MatrixXd matData = MatrixXd::Random(m_invOp.eigen_fields->data.cols(), 150);
+
+    MinimumNorm minimumNorm(m_invOp, lambda2, method);
+    minimumNorm.setFactoredKernel(factored);
+    minimumNorm.setSinglePrecision(single);
+    minimumNorm.doInverseSetup(1, false);
+
+    //reference: K * data, combined current components, noise normalization
+    MNEInverseOperator inv = minimumNorm.getPreparedInverseOperator();
+    MatrixXd matK;
+    SparseMatrix<double> noise_norm;
+    QList<VectorXi> vertno;
+    QVERIFY( inv.assemble_kernel(Label(), method, false, matK, noise_norm, vertno) );
+
+    MatrixXd matKData = matK * matData;
+    MatrixXd matRef(matKData.rows() / 3, matKData.cols());
+    for(qint32 i = 0; i < matRef.rows(); ++i)
+        matRef.row(i) = matKData.middleRows(3*i, 3).colwise().norm();
+    if(noise_norm.rows() > 0)
+        matRef = noise_norm * matRef;
+
+    MatrixXd matSol;
+    QVERIFY( minimumNorm.applyInverse(matData, matSol) );
+    QVERIFY( matSol.rows() == matRef.rows() && matSol.cols() == matRef.cols() );
+
+    double dTol = single ? 1e-4 : epsilon;
+    QVERIFY( (matSol - matRef).cwiseAbs().maxCoeff() <= dTol * matRef.cwiseAbs().maxCoeff() );
+
+    //the result buffer is reused
+    const double* pBuffer = matSol.data();
+    QVERIFY( minimumNorm.applyInverse(matData, matSol) );
+    QVERIFY( matSol.data() == pBuffer );
+    QVERIFY( (matSol - matRef).cwiseAbs().maxCoeff() <= dTol * matRef.cwiseAbs().maxCoeff() );
+
+    if(single) {
+        MatrixXf matSolf;
+        QVERIFY( minimumNorm.applyInverse(MatrixXf(matData.cast<float>()), matSolf) );
+        QVERIFY( (matSolf.cast<double>() - matRef).cwiseAbs().maxCoeff() <= dTol * matRef.cwiseAbs().maxCoeff() );
+    }
+}
+
+
+//*************************************************************************************************************
+
+void TestMinimumNorm::cleanupTestCase()
+{
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+QTEST_APPLESS_MAIN(TestMinimumNorm)
+#include "test_minimum_norm.moc"
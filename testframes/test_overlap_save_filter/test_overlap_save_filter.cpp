@@ -0,0 +1,290 @@
+//=============================================================================================================
+/**
+* @file     test_overlap_save_filter.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     October, 2018
+*
+* @section  LICENSE
+*
+* Copyright (C) 2018, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Verifies the OverlapSaveFilter and benchmarks it at mne_scan block sizes
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <utils/filterTools/overlapsavefilter.h>
+#include <utils/filterTools/filterdata.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtTest>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace UTILSLIB;
+using namespace Eigen;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STATIC DEFINITIONS
+//=============================================================================================================
+
+namespace
+{
+
+//=============================================================================================================
+/**
+* Causal direct-form convolution of each row with the filter coefficients.
+*
+* @param [in] matData   the data (channels x samples).
+* @param [in] vecCoeff  the filter coefficients.
+*
+* @return the filtered data.
+*/
+MatrixXd convolve(const MatrixXd& matData, const RowVectorXd& vecCoeff)
+{
+    MatrixXd matResult = MatrixXd::Zero(matData.rows(), matData.cols());
+    for(int n = 0; n < matData.cols(); ++n) {
+        for(int k = 0; k < vecCoeff.cols() && k <= n; ++k) {
+            matResult.col(n) += vecCoeff(k) * matData.col(n - k);
+        }
+    }
+    return matResult;
+}
+
+} // NAMESPACE
+
+
+//=============================================================================================================
+/**
+* DECLARE CLASS TestOverlapSaveFilter
+*
+* @brief The TestOverlapSaveFilter class compares the OverlapSaveFilter to a direct convolution and benchmarks it
+*        for 400 channels at 5 kHz.
+*
+*/
+class TestOverlapSaveFilter: public QObject
+{
+    Q_OBJECT
+
+public:
+    TestOverlapSaveFilter();
+
+private slots:
+    void initTestCase();
+    void compareConvolution();
+    void compareCascade();
+    void checkReset();
+    void benchmarkRealTime_data();
+    void benchmarkRealTime();
+    void cleanupTestCase();
+
+private:
+    double epsilon;
+};
+
+
+//*************************************************************************************************************
+
+TestOverlapSaveFilter::TestOverlapSaveFilter()
+: epsilon(1e-10)
+{
+}
+
+
+//*************************************************************************************************************
+
+void TestOverlapSaveFilter::initTestCase()
+{
+}
+
+
+//*************************************************************************************************************
+
+void TestOverlapSaveFilter::compareConvolution()
+{
+    const int iNumChannels = 20;
+    const int iNumSamples = 2000;
+
+    MatrixXd matData = MatrixXd::Random(iNumChannels, iNumSamples);
+    RowVectorXd vecCoeff = RowVectorXd::Random(81);
+
+    QVector<int> vecFilterChannels;
+    for(int i = 0; i < iNumChannels; i += 2) {
+        vecFilterChannels.append(i);
+    }
+
+    OverlapSaveFilter filter;
+    filter.setCoefficients(vecCoeff);
+    filter.setChannels(iNumChannels, vecFilterChannels);
+
+    //
+    //   Stream blocks of changing length through the filter
+    //
+    const int vecBlockSizes[] = {100, 7, 256, 1, 500, 33};
+    MatrixXd matResult(iNumChannels, iNumSamples);
+    int iPos = 0;
+    for(int i = 0; iPos < iNumSamples; ++i) {
+        int iBlockSize = qMin(vecBlockSizes[i % 6], iNumSamples - iPos);
+        MatrixXd matBlock = matData.middleCols(iPos, iBlockSize);
+        QVERIFY( filter.filter(matBlock) );
+        matResult.middleCols(iPos, iBlockSize) = matBlock;
+        iPos += iBlockSize;
+    }
+
+    //
+    //   Filtered channels match the direct convolution, all other channels are delayed
+    //
+    MatrixXd matReference = convolve(matData, vecCoeff);
+    const int iDelay = filter.delay();
+    QVERIFY( iDelay == vecCoeff.cols() / 2 );
+
+    for(int i = 0; i < iNumChannels; ++i) {
+        if(i % 2 == 0) {
+            QVERIFY( (matResult.row(i) - matReference.row(i)).cwiseAbs().maxCoeff() < epsilon );
+        } else {
+            QVERIFY( matResult.row(i).head(iDelay).isZero() );
+            QVERIFY( matResult.row(i).tail(iNumSamples - iDelay) == matData.row(i).head(iNumSamples - iDelay) );
+        }
+    }
+
+    //
+    //   Blocks with the wrong number of channels are rejected
+    //
+    MatrixXd matWrong = MatrixXd::Random(iNumChannels + 1, 10);
+    MatrixXd matWrongCopy = matWrong;
+    QVERIFY( !filter.filter(matWrong) );
+    QVERIFY( matWrong == matWrongCopy );
+}
+
+
+//*************************************************************************************************************
+
+void TestOverlapSaveFilter::compareCascade()
+{
+    FilterData filterA;
+    filterA.m_dCoeffA = RowVectorXd::Random(31);
+    FilterData filterB;
+    filterB.m_dCoeffA = RowVectorXd::Random(20);
+
+    QList<FilterData> lFilterData;
+    lFilterData << filterA << filterB;
+
+    OverlapSaveFilter filter;
+    filter.setCoefficients(lFilterData);
+    filter.setChannels(8);
+
+    QVERIFY( filter.coefficients().cols() == 50 );
+
+    MatrixXd matData = MatrixXd::Random(8, 500);
+    MatrixXd matResult = matData;
+    QVERIFY( filter.filter(matResult) );
+
+    MatrixXd matReference = convolve(convolve(matData, filterA.m_dCoeffA), filterB.m_dCoeffA);
+    QVERIFY( (matResult - matReference).cwiseAbs().maxCoeff() < epsilon );
+}
+
+
+//*************************************************************************************************************
+
+void TestOverlapSaveFilter::checkReset()
+{
+    OverlapSaveFilter filter(RowVectorXd::Random(64), 4);
+
+    MatrixXd matData = MatrixXd::Random(4, 200);
+    MatrixXd matFirst = matData;
+    QVERIFY( filter.filter(matFirst) );
+
+    MatrixXd matSecond = matData;
+    filter.reset();
+    QVERIFY( filter.filter(matSecond) );
+
+    QVERIFY( (matFirst - matSecond).cwiseAbs().maxCoeff() < epsilon );
+}
+
+
+//*************************************************************************************************************
+
+void TestOverlapSaveFilter::benchmarkRealTime_data()
+{
+    QTest::addColumn<int>("iBlockSize");
+    QTest::addColumn<int>("iNumTaps");
+
+    //400 channels at 5 kHz, blocks of 20 ms and 100 ms
+    QTest::newRow("block 100, 512 taps") << 100 << 512;
+    QTest::newRow("block 500, 512 taps") << 500 << 512;
+    QTest::newRow("block 100, 2048 taps") << 100 << 2048;
+}
+
+
+//*************************************************************************************************************
+
+void TestOverlapSaveFilter::benchmarkRealTime()
+{
+    QFETCH(int, iBlockSize);
+    QFETCH(int, iNumTaps);
+
+    const int iNumChannels = 400;
+
+    OverlapSaveFilter filter(RowVectorXd::Random(iNumTaps), iNumChannels);
+
+    MatrixXd matData = MatrixXd::Random(iNumChannels, iBlockSize);
+    MatrixXd matBlock = matData;
+    filter.filter(matBlock);
+
+    QBENCHMARK {
+        matBlock = matData;
+        filter.filter(matBlock);
+    }
+}
+
+
+//*************************************************************************************************************
+
+void TestOverlapSaveFilter::cleanupTestCase()
+{
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+QTEST_APPLESS_MAIN(TestOverlapSaveFilter)
+#include "test_overlap_save_filter.moc"
@@ -0,0 +1,240 @@
+//=============================================================================================================
+/**
+* @file     test_rap_music.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     October, 2018
+*
+* @section  LICENSE
+*
+* Copyright (C) 2018, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Compares the factored RAP MUSIC subspace correlation with the SVD based one
+*
+*/
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <inverse/rapMusic/rapmusic.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtTest>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace INVERSELIB;
+using namespace Eigen;
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// STATIC DEFINITIONS
+//=============================================================================================================
+
+namespace
+{
+
+//=============================================================================================================
+/**
+* Gives access to the subspace correlation scan of RapMusic for a given projected Lead Field.
+*/
+class RapMusicScan : public RapMusic
+{
+public:
+    RapMusicScan(int iNumGridPoints)
+    {
+        m_iNumGridPoints = iNumGridPoints;
+        m_iMaxNumThreads = 1;
+    }
+
+    using RapMusic::subcorr;
+    using RapMusic::useFullRank;
+    using RapMusic::calcPointFactors;
+    using RapMusic::calcMaxSubcorr;
+    using RapMusic::getPointPair;
+};
+
+} // NAMESPACE
+
+
+//=============================================================================================================
+/**
+* DECLARE CLASS TestRapMusic
+*
+* @brief The TestRapMusic class compares the subspace correlation computed from the per point factors with the
+*        SVD of the m x 6 Lead Field pair on random Lead Fields, including rank deficient and nearly rank
+*        deficient points.
+*
+*/
+class TestRapMusic: public QObject
+{
+    Q_OBJECT
+
+public:
+    TestRapMusic();
+
+private slots:
+    void initTestCase();
+    void compareSubcorr_data();
+    void compareSubcorr();
+    void cleanupTestCase();
+
+private:
+    double epsilon;
+    int iNumChannels;
+    int iNumGridPoints;
+};
+
+
+//*************************************************************************************************************
+
+TestRapMusic::TestRapMusic()
+: epsilon(1e-12)
+, iNumChannels(60)
+, iNumGridPoints(40)
+{
+}
+
+
+//*************************************************************************************************************
+
+void TestRapMusic::initTestCase()
+{
+    srand(0);
+}
+
+
+//*************************************************************************************************************
+
+void TestRapMusic::compareSubcorr_data()
+{
+    //The singular values of the pairs are far above, close to and below the rank threshold of getRank
+    QTest::addColumn<double>("scale");
+
+    QTest::newRow("scale 1") << 1.0;
+    QTest::newRow("scale 1e-3") << 1e-3;
+    QTest::newRow("scale 3e-6") << 3e-6;
+}
+
+
+//*************************************************************************************************************
+
+void TestRapMusic::compareSubcorr()
+{
+    QFETCH(double, scale);
+
+    //
+    //   Random Lead Field with special points
+    //
+    MatrixXd matLeadField = MatrixXd::Random(iNumChannels, 3*iNumGridPoints) * scale;
+    matLeadField.col(3*1+2) = 0.5*matLeadField.col(3*1) + matLeadField.col(3*1+1);                         //rank 2
+    matLeadField.col(3*2+2) = matLeadField.col(3*2) + 1e-7*scale*VectorXd::Random(iNumChannels);          //nearly rank 2
+    matLeadField.middleCols(3*3, 3) = matLeadField.middleCols(3*4, 3);                                      //identical points
+    matLeadField.col(3*5) = matLeadField.col(3*6+1);                                                        //shared direction
+
+    //
+    //   Project out two found sources, random signal subspace of rank 4
+    //
+    MatrixXd matA = MatrixXd::Random(iNumChannels, 2);
+    MatrixXd matOrthProj = MatrixXd::Identity(iNumChannels, iNumChannels) - matA*(matA.transpose()*matA).inverse()*matA.transpose();
+
+    MatrixXd matProj_LeadField = matOrthProj*matLeadField;
+    MatrixXd matProj_Phi_s = matOrthProj*MatrixXd::Random(iNumChannels, 4);
+
+    JacobiSVD<MatrixXd> svdProj_Phi_s(matProj_Phi_s, ComputeThinU);
+    MatrixXd matU_B;
+    RapMusicScan::useFullRank(svdProj_Phi_s.matrixU(), svdProj_Phi_s.singularValues().asDiagonal(), matU_B);
+
+    RapMusicScan rapMusic(iNumGridPoints);
+    MatrixXd matQ, matSV, matC, matS_Diag;
+    rapMusic.calcPointFactors(matProj_LeadField, matU_B, matQ, matSV, matC, matS_Diag);
+
+    //
+    //   Every pair against the SVD based subcorr
+    //
+    double dMaxCor = -1.0;
+
+    RapMusic::MatrixX6T matProj_G(iNumChannels, 6);
+    for(int i = 0; i < iNumGridPoints; ++i) {
+        for(int j = i; j < iNumGridPoints; ++j) {
+            matProj_G.leftCols(3) = matProj_LeadField.middleCols(3*i, 3);
+            matProj_G.rightCols(3) = matProj_LeadField.middleCols(3*j, 3);
+            double dCorSvd = RapMusicScan::subcorr(matProj_G, matU_B);
+
+            RapMusic::Matrix3T matQ1_T_Q2 = matQ.middleCols(3*i, 3).transpose()*matQ.middleCols(3*j, 3);
+            RapMusic::Matrix3T matS12 = matC.middleRows(3*i, 3)*matC.middleRows(3*j, 3).transpose();
+            double dCor = RapMusicScan::subcorr(matQ1_T_Q2,
+                                                matS_Diag.block<3,3>(0, 3*i),
+                                                matS12,
+                                                matS_Diag.block<3,3>(0, 3*j),
+                                                matSV.block<3,3>(0, 3*i),
+                                                matSV.block<3,3>(0, 3*j));
+
+            QVERIFY2( std::fabs(dCor - dCorSvd) < epsilon, QString("Pair %1 %2: %3 != %4").arg(i).arg(j).arg(dCor, 0, 'g', 17).arg(dCorSvd, 0, 'g', 17).toUtf8().constData() );
+
+            dMaxCor = std::max(dMaxCor, dCorSvd);
+        }
+    }
+
+    //
+    //   The tiled scan finds the maximum, identical points may give another pair of the same correlation
+    //
+    int iCombIdx, iIdx1, iIdx2;
+    double dCor = rapMusic.calcMaxSubcorr(matQ, matSV, matC, matS_Diag, iCombIdx);
+    RapMusicScan::getPointPair(iNumGridPoints, iCombIdx, iIdx1, iIdx2);
+
+    matProj_G.leftCols(3) = matProj_LeadField.middleCols(3*iIdx1, 3);
+    matProj_G.rightCols(3) = matProj_LeadField.middleCols(3*iIdx2, 3);
+
+    QVERIFY( std::fabs(dCor - dMaxCor) < epsilon );
+    QVERIFY( std::fabs(RapMusicScan::subcorr(matProj_G, matU_B) - dMaxCor) < epsilon );
+}
+
+
+//*************************************************************************************************************
+
+void TestRapMusic::cleanupTestCase()
+{
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+QTEST_APPLESS_MAIN(TestRapMusic)
+#include "test_rap_music.moc"
@@ -0,0 +1,355 @@
+//=============================================================================================================
+/**
+* @file     test_rtave.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     October, 2018
+*
+* @section  LICENSE
+*
+* Copyright (C) 2018, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Verifies the running sum averaging of RtAveWorker and benchmarks its per trigger cost
+*
+*/
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <rtprocessing/rtave.h>
+
+#include <fiff/fiff_info.h>
+#include <fiff/fiff_evoked_set.h>
+#include <fiff/fiff_constants.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtTest>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace RTPROCESSINGLIB;
+using namespace FIFFLIB;
+using namespace Eigen;
+
+
+//=============================================================================================================
+/**
+* DECLARE CLASS TestRtAve
+*
+* @brief The TestRtAve class verifies the running sum averaging of RtAveWorker against the directly computed
+*        average, benchmarks the per trigger latency at 10, 100 and 1000 averages and measures the worst per
+*        trigger latency at 306 channels.
+*
+*/
+class TestRtAve: public QObject
+{
+    Q_OBJECT
+
+public:
+    TestRtAve();
+
+private slots:
+    void initTestCase();
+    void compareRunningAverage();
+    void compareDoublePrecision();
+    void benchmarkTrigger_data();
+    void benchmarkTrigger();
+    void benchmarkWorstTrigger_data();
+    void benchmarkWorstTrigger();
+    void cleanupTestCase();
+
+private:
+    FiffInfo::SPtr createFiffInfo(int iChannels);
+    MatrixXd createBlock(double dValue, int iChannels);
+
+    double epsilon;
+
+    int iNumChannels;
+    int iNumChannelsWorst;
+    int iPreStimSamples;
+    int iPostStimSamples;
+    int iTriggerPos;
+
+    FiffInfo::SPtr pFiffInfo;
+    FiffInfo::SPtr pFiffInfoWorst;
+
+    FiffEvokedSet lastEvokedSet;
+};
+
+
+//*************************************************************************************************************
+
+TestRtAve::TestRtAve()
+: epsilon(0.000001)
+, iNumChannels(64)
+, iNumChannelsWorst(306)
+, iPreStimSamples(200)
+, iPostStimSamples(800)
+, iTriggerPos(300)
+{
+}
+
+
+//*************************************************************************************************************
+
+void TestRtAve::initTestCase()
+{
+    pFiffInfo = createFiffInfo(iNumChannels);
+    pFiffInfoWorst = createFiffInfo(iNumChannelsWorst);
+}
+
+
+//*************************************************************************************************************
+
+FiffInfo::SPtr TestRtAve::createFiffInfo(int iChannels)
+{
+    //
+    //   Measurement info with iChannels MEG channels followed by one stimulus channel
+    //
+    FiffInfo::SPtr pInfo(new FiffInfo);
+    pInfo->sfreq = 1000.0;
+
+    for(int i = 0; i <= iChannels; ++i) {
+        FiffChInfo chInfo;
+        chInfo.scanNo = i + 1;
+        chInfo.logNo = i + 1;
+        chInfo.kind = i < iChannels ? FIFFV_MEG_CH : FIFFV_STIM_CH;
+        chInfo.ch_name = i < iChannels ? QString("MEG %1").arg(i + 1) : QString("STI 014");
+        chInfo.cal = 1.0f;
+        chInfo.range = 1.0f;
+
+        pInfo->chs.append(chInfo);
+        pInfo->ch_names.append(chInfo.ch_name);
+    }
+    pInfo->nchan = pInfo->chs.size();
+
+    return pInfo;
+}
+
+
+//*************************************************************************************************************
+
+MatrixXd TestRtAve::createBlock(double dValue, int iChannels)
+{
+    //
+    //   One block holds a whole epoch around a single trigger
+    //
+    MatrixXd matBlock = MatrixXd::Constant(iChannels + 1, iTriggerPos + iPostStimSamples + 100, dValue);
+    matBlock.row(iChannels).setZero();
+    matBlock.block(iChannels, iTriggerPos, 1, 5).setOnes();
+
+    return matBlock;
+}
+
+
+//*************************************************************************************************************
+
+void TestRtAve::compareRunningAverage()
+{
+    int iNumAverages = 10;
+    int iNumTriggers = 25;
+
+    RtAveWorker worker(iNumAverages, iPreStimSamples, iPostStimSamples, 0, 0, iNumChannels, pFiffInfo);
+    connect(&worker, &RtAveWorker::resultReady, [this](const FiffEvokedSet& evokedSet, const QStringList&) {
+        lastEvokedSet = evokedSet;
+    });
+
+    for(int i = 0; i < iNumTriggers; ++i) {
+        worker.doWork(createBlock(i, iNumChannels));
+    }
+
+    //
+    //   The average has to be the mean of the last iNumAverages epochs
+    //
+    double dExpected = (iNumTriggers - 1) - (iNumAverages - 1) / 2.0;
+
+    QVERIFY( lastEvokedSet.evoked.size() == 1 );
+    QVERIFY( lastEvokedSet.evoked[0].nave == iNumAverages );
+    QVERIFY( lastEvokedSet.evoked[0].data.cols() == iPreStimSamples + iPostStimSamples );
+    QVERIFY( (lastEvokedSet.evoked[0].data.topRows(iNumChannels).array() - dExpected).abs().maxCoeff() < epsilon );
+
+    //
+    //   Reducing the number of averages removes the oldest epochs from the running sum
+    //
+    iNumAverages = 4;
+    worker.setAverageNumber(iNumAverages);
+    worker.doWork(createBlock(iNumTriggers, iNumChannels));
+
+    dExpected = iNumTriggers - (iNumAverages - 1) / 2.0;
+
+    QVERIFY( lastEvokedSet.evoked[0].nave == iNumAverages );
+    QVERIFY( (lastEvokedSet.evoked[0].data.topRows(iNumChannels).array() - dExpected).abs().maxCoeff() < epsilon );
+
+    //
+    //   Increasing the number of averages keeps the held epochs and fills the new slots
+    //
+    iNumAverages = 6;
+    worker.setAverageNumber(iNumAverages);
+    worker.doWork(createBlock(iNumTriggers + 1, iNumChannels));
+    worker.doWork(createBlock(iNumTriggers + 2, iNumChannels));
+
+    dExpected = (iNumTriggers + 2) - (iNumAverages - 1) / 2.0;
+
+    QVERIFY( lastEvokedSet.evoked[0].nave == iNumAverages );
+    QVERIFY( (lastEvokedSet.evoked[0].data.topRows(iNumChannels).array() - dExpected).abs().maxCoeff() < epsilon );
+}
+
+
+//*************************************************************************************************************
+
+void TestRtAve::compareDoublePrecision()
+{
+    int iNumAverages = 10;
+    int iNumTriggers = 45;
+    double dOffset = 1000.0;
+    double dStep = 1e-7;
+
+    RtAveWorker worker(iNumAverages, iPreStimSamples, iPostStimSamples, 0, 0, iNumChannels, pFiffInfo);
+    connect(&worker, &RtAveWorker::resultReady, [this](const FiffEvokedSet& evokedSet, const QStringList&) {
+        lastEvokedSet = evokedSet;
+    });
+
+    //
+    //   The steps are far below the single precision resolution of the offset. The window gets replaced several
+    //   times, so that the running sum is replaced in between.
+    //
+    for(int i = 0; i < iNumTriggers; ++i) {
+        worker.doWork(createBlock(dOffset + i * dStep, iNumChannels));
+    }
+
+    double dExpected = dOffset + ((iNumTriggers - 1) - (iNumAverages - 1) / 2.0) * dStep;
+
+    QVERIFY( lastEvokedSet.evoked[0].nave == iNumAverages );
+    QVERIFY( (lastEvokedSet.evoked[0].data.topRows(iNumChannels).array() - dExpected).abs().maxCoeff() < 1e-10 );
+}
+
+
+//*************************************************************************************************************
+
+void TestRtAve::benchmarkTrigger_data()
+{
+    QTest::addColumn<int>("iNumAverages");
+
+    QTest::newRow("10 averages") << 10;
+    QTest::newRow("100 averages") << 100;
+    QTest::newRow("1000 averages") << 1000;
+}
+
+
+//*************************************************************************************************************
+
+void TestRtAve::benchmarkTrigger()
+{
+    QFETCH(int, iNumAverages);
+
+    RtAveWorker worker(iNumAverages, iPreStimSamples, iPostStimSamples, 0, 0, iNumChannels, pFiffInfo);
+
+    //
+    //   Fill the sliding window, then measure one trigger
+    //
+    MatrixXd matBlock = createBlock(1.0, iNumChannels);
+
+    for(int i = 0; i < iNumAverages; ++i) {
+        worker.doWork(matBlock);
+    }
+
+    QBENCHMARK {
+        worker.doWork(matBlock);
+    }
+}
+
+
+//*************************************************************************************************************
+
+void TestRtAve::benchmarkWorstTrigger_data()
+{
+    QTest::addColumn<int>("iNumAverages");
+
+    QTest::newRow("10 averages") << 10;
+    QTest::newRow("100 averages") << 100;
+}
+
+
+//*************************************************************************************************************
+
+void TestRtAve::benchmarkWorstTrigger()
+{
+    QFETCH(int, iNumAverages);
+
+    RtAveWorker worker(iNumAverages, iPreStimSamples, iPostStimSamples, 0, 0, iNumChannelsWorst, pFiffInfoWorst);
+
+    //
+    //   Fill the sliding window, then measure every trigger of three more windows. A periodic cost, e.g.
+    //   re-accumulating the whole window, shows up in the maximum but is averaged away by QBENCHMARK.
+    //
+    MatrixXd matBlock = createBlock(1.0, iNumChannelsWorst);
+
+    for(int i = 0; i < iNumAverages; ++i) {
+        worker.doWork(matBlock);
+    }
+
+    QElapsedTimer timer;
+    qint64 iWorstNSecs = 0;
+    qint64 iTotalNSecs = 0;
+    int iNumTriggers = 3 * iNumAverages;
+
+    for(int i = 0; i < iNumTriggers; ++i) {
+        timer.start();
+        worker.doWork(matBlock);
+        qint64 iNSecs = timer.nsecsElapsed();
+
+        iWorstNSecs = qMax(iWorstNSecs, iNSecs);
+        iTotalNSecs += iNSecs;
+    }
+
+    qDebug() << "TestRtAve::benchmarkWorstTrigger - mean" << iTotalNSecs / iNumTriggers / 1e6 << "ms, worst" << iWorstNSecs / 1e6 << "ms";
+
+    QTest::setBenchmarkResult(iWorstNSecs / 1e6, QTest::WalltimeMilliseconds);
+}
+
+
+//*************************************************************************************************************
+
+void TestRtAve::cleanupTestCase()
+{
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+QTEST_APPLESS_MAIN(TestRtAve)
+#include "test_rtave.moc"
@@ -0,0 +1,327 @@
+//=============================================================================================================
+/**
+* @file     test_rtcov.cpp
+* @author   Christoph Dinh <chdinh@nmr.mgh.harvard.edu>;
+*           Matti Hamalainen <msh@nmr.mgh.harvard.edu>
+* @version  1.0
+* @date     October, 2018
+*
+* @section  LICENSE
+*
+* Copyright (C) 2018, Christoph Dinh and Matti Hamalainen. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that
+* the following conditions are met:
+*     * Redistributions of source code must retain the above copyright notice, this list of conditions and the
+*       following disclaimer.
+*     * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and
+*       the following disclaimer in the documentation and/or other materials provided with the distribution.
+*     * Neither the name of MNE-CPP authors nor the names of its contributors may be used
+*       to endorse or promote products derived from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+* HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*
+*
+* @brief    Compares the sliding window and the exponential forgetting of RtCovWorker with batch covariances
+*
+*/
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// INCLUDES
+//=============================================================================================================
+
+#include <rtprocessing/rtcov.h>
+
+#include <fiff/fiff_info.h>
+#include <fiff/fiff_cov.h>
+#include <fiff/fiff_constants.h>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// QT INCLUDES
+//=============================================================================================================
+
+#include <QtTest>
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// USED NAMESPACES
+//=============================================================================================================
+
+using namespace RTPROCESSINGLIB;
+using namespace FIFFLIB;
+using namespace Eigen;
+
+
+//=============================================================================================================
+/**
+* DECLARE CLASS TestRtCov
+*
+* @brief The TestRtCov class compares the covariances of RtCovWorker with batch covariances of the same
+*        samples, for the sliding window, the exponential forgetting and after switching between them.
+*
+*/
+class TestRtCov: public QObject
+{
+    Q_OBJECT
+
+public:
+    TestRtCov();
+
+private slots:
+    void initTestCase();
+    void compareWindow();
+    void compareForgetting();
+    void compareModeSwitch();
+    void cleanupTestCase();
+
+private:
+    RtCovInput createInput(double dAmplitude, int iWindowSamples, double dForgettingFactor);
+    FiffCov batchCov(const QList<MatrixXd>& lBlocks, double dForgettingFactor);
+    bool compareCov(const FiffCov& cov, const FiffCov& covRef);
+
+    double epsilon;
+
+    int iNumChannels;
+    int iBlockSamples;
+
+    FiffInfo::SPtr pFiffInfo;
+
+    FiffCov lastCov;
+};
+
+
+//*************************************************************************************************************
+
+TestRtCov::TestRtCov()
+: epsilon(1e-9)
+, iNumChannels(20)
+, iBlockSamples(100)
+{
+}
+
+
+//*************************************************************************************************************
+
+void TestRtCov::initTestCase()
+{
+    //
+    //   Measurement info with iNumChannels MEG channels
+    //
+    pFiffInfo = FiffInfo::SPtr(new FiffInfo);
+    pFiffInfo->sfreq = 1000.0;
+
+    for(int i = 0; i < iNumChannels; ++i) {
+        FiffChInfo chInfo;
+        chInfo.scanNo = i + 1;
+        chInfo.logNo = i + 1;
+        chInfo.kind = FIFFV_MEG_CH;
+        chInfo.ch_name = QString("MEG %1").arg(i + 1);
+        chInfo.cal = 1.0f;
+        chInfo.range = 1.0f;
+
+        pFiffInfo->chs.append(chInfo);
+        pFiffInfo->ch_names.append(chInfo.ch_name);
+    }
+    pFiffInfo->nchan = pFiffInfo->chs.size();
+
+    srand(0);
+}
+
+
+//*************************************************************************************************************
+
+RtCovInput TestRtCov::createInput(double dAmplitude, int iWindowSamples, double dForgettingFactor)
+{
+    //
+    //   Random data with an offset
+    //
+    RtCovInput inputData;
+    inputData.matData = (dAmplitude * MatrixXd::Random(iNumChannels, iBlockSamples)).array() + 10.0;
+    inputData.pFiffInfo = pFiffInfo;
+    inputData.iWindowSamples = iWindowSamples;
+    inputData.dForgettingFactor = dForgettingFactor;
+    inputData.bEstimate = true;
+
+    return inputData;
+}
+
+
+//*************************************************************************************************************
+
+FiffCov TestRtCov::batchCov(const QList<MatrixXd>& lBlocks, double dForgettingFactor)
+{
+    //
+    //   The samples of a block are weighted by the forgetting factor of each sample received after the block
+    //
+    int iNumSamples = 0;
+    for(int i = 0; i < lBlocks.size(); ++i) {
+        iNumSamples += lBlocks[i].cols();
+    }
+
+    MatrixXd matData(iNumChannels, iNumSamples);
+    VectorXd vecWeights(iNumSamples);
+
+    int iSamplesAfter = iNumSamples;
+    for(int i = 0; i < lBlocks.size(); ++i) {
+        iSamplesAfter -= lBlocks[i].cols();
+        matData.middleCols(iNumSamples - iSamplesAfter - lBlocks[i].cols(), lBlocks[i].cols()) = lBlocks[i];
+        vecWeights.segment(iNumSamples - iSamplesAfter - lBlocks[i].cols(), lBlocks[i].cols()).setConstant(std::pow(dForgettingFactor, (double)iSamplesAfter));
+    }
+
+    double dWeight = vecWeights.sum();
+    VectorXd mu = matData * vecWeights / dWeight;
+    MatrixXd matCentered = matData.colwise() - mu;
+
+    FiffCov cov;
+    cov.data = matCentered * vecWeights.asDiagonal() * matCentered.transpose() / (dWeight - 1.0);
+    cov.kind = FIFFV_MNE_NOISE_COV;
+    cov.diag = false;
+    cov.dim = cov.data.rows();
+    cov.names = pFiffInfo->ch_names;
+    cov.projs = pFiffInfo->projs;
+    cov.bads = pFiffInfo->bads;
+    cov.nfree = (int)dWeight;
+
+    return cov.regularize(*pFiffInfo, 0.05, 0.05, 0.1, true, QStringList());
+}
+
+
+//*************************************************************************************************************
+
+bool TestRtCov::compareCov(const FiffCov& cov, const FiffCov& covRef)
+{
+    if(cov.data.rows() != covRef.data.rows() || cov.data.cols() != covRef.data.cols()) {
+        return false;
+    }
+
+    return (cov.data - covRef.data).cwiseAbs().maxCoeff() <= epsilon * covRef.data.cwiseAbs().maxCoeff();
+}
+
+
+//*************************************************************************************************************
+
+void TestRtCov::compareWindow()
+{
+    int iWindowSamples = 10 * iBlockSamples;
+
+    RtCovWorker worker;
+    connect(&worker, &RtCovWorker::resultReady, [this](const FiffCov& computedCov) {
+        lastCov = computedCov;
+    });
+
+    //
+    //   An artifact of large amplitude passes the window. Subtracting its blocks from long-lived sums would
+    //   leave cancellation errors of the artifact's magnitude in the estimates of the following quiet data.
+    //
+    QList<MatrixXd> lBlocks;
+    for(int i = 0; i < 60; ++i) {
+        RtCovInput inputData = createInput(i >= 10 && i < 20 ? 1e4 : 1.0, iWindowSamples, 1.0);
+        lBlocks.append(inputData.matData);
+        worker.doWork(inputData);
+
+        if(i == 5 || i == 15 || i == 25 || i == 59) {
+            QList<MatrixXd> lWindow = lBlocks.mid(qMax(0, lBlocks.size() - 10));
+            QVERIFY( compareCov(lastCov, batchCov(lWindow, 1.0)) );
+        }
+    }
+}
+
+
+//*************************************************************************************************************
+
+void TestRtCov::compareForgetting()
+{
+    double dForgettingFactor = 0.999;
+
+    RtCovWorker worker;
+    connect(&worker, &RtCovWorker::resultReady, [this](const FiffCov& computedCov) {
+        lastCov = computedCov;
+    });
+
+    QList<MatrixXd> lBlocks;
+    for(int i = 0; i < 30; ++i) {
+        RtCovInput inputData = createInput(1.0, 0, dForgettingFactor);
+        lBlocks.append(inputData.matData);
+        worker.doWork(inputData);
+    }
+
+    QVERIFY( compareCov(lastCov, batchCov(lBlocks, dForgettingFactor)) );
+}
+
+
+//*************************************************************************************************************
+
+void TestRtCov::compareModeSwitch()
+{
+    int iWindowSamples = 10 * iBlockSamples;
+    double dForgettingFactor = 0.999;
+
+    RtCovWorker worker;
+    connect(&worker, &RtCovWorker::resultReady, [this](const FiffCov& computedCov) {
+        lastCov = computedCov;
+    });
+
+    //
+    //   Forgetting -> window: The decayed residue must not stay in the window sums
+    //
+    for(int i = 0; i < 20; ++i) {
+        worker.doWork(createInput(1.0, 0, dForgettingFactor));
+    }
+
+    QList<MatrixXd> lBlocks;
+    for(int i = 0; i < 5; ++i) {
+        RtCovInput inputData = createInput(1.0, iWindowSamples, 1.0);
+        lBlocks.append(inputData.matData);
+        worker.doWork(inputData);
+    }
+
+    QVERIFY( compareCov(lastCov, batchCov(lBlocks, 1.0)) );
+
+    for(int i = 5; i < 25; ++i) {
+        RtCovInput inputData = createInput(1.0, iWindowSamples, 1.0);
+        lBlocks.append(inputData.matData);
+        worker.doWork(inputData);
+    }
+
+    QVERIFY( compareCov(lastCov, batchCov(lBlocks.mid(lBlocks.size() - 10), 1.0)) );
+
+    //
+    //   Window -> forgetting: The estimate starts from the new samples
+    //
+    lBlocks.clear();
+    for(int i = 0; i < 5; ++i) {
+        RtCovInput inputData = createInput(1.0, 0, dForgettingFactor);
+        lBlocks.append(inputData.matData);
+        worker.doWork(inputData);
+    }
+
+    QVERIFY( compareCov(lastCov, batchCov(lBlocks, dForgettingFactor)) );
+}
+
+
+//*************************************************************************************************************
+
+void TestRtCov::cleanupTestCase()
+{
+}
+
+
+//*************************************************************************************************************
+//=============================================================================================================
+// MAIN
+//=============================================================================================================
+
+QTEST_APPLESS_MAIN(TestRtCov)
+#include "test_rtcov.moc"
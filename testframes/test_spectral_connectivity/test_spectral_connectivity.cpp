@@ -41,6 +41,7 @@
 //=============================================================================================================
 
 #include <utils/ioutils.h>
+#include <connectivity/connectivity.h>
 #include <connectivity/metrics/coherency.h>
 #include <connectivity/metrics/coherence.h>
 #include <connectivity/metrics/imagcoherence.h>
@@ -52,6 +53,7 @@
 #include <connectivity/metrics/crosscorrelation.h>
 #include <connectivity/connectivitysettings.h>
 #include <connectivity/network/network.h>
+#include <connectivity/network/networkedge.h>
 
 
 //*************************************************************************************************************
@@ -80,6 +82,39 @@ using namespace CONNECTIVITYLIB;
 using namespace UTILSLIB;
 
 
+//*************************************************************************************************************
+//=============================================================================================================
+// STATIC DEFINITIONS
+//=============================================================================================================
+
+namespace {
+
+double maxDifference(const Network& networkA, const Network& networkB)
+{
+    MatrixXd matA = networkA.getFullConnectivityMatrix();
+    MatrixXd matB = networkB.getFullConnectivityMatrix();
+
+    if(matA.rows() != matB.rows() || matA.cols() != matB.cols() || matA.size() == 0) {
+        return std::numeric_limits<double>::max();
+    }
+
+    return (matA - matB).cwiseAbs().maxCoeff();
+}
+
+bool hasTaperedSpectra(ConnectivitySettings& connectivitySettings)
+{
+    for(int i = 0; i < connectivitySettings.size(); ++i) {
+        if(!connectivitySettings.at(i).vecTapSpectra.isEmpty()) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+} // NAMESPACE
+
+
 //=============================================================================================================
 /**
 * DECLARE CLASS TestSpectralConnectivity
@@ -104,6 +139,11 @@ private slots:
     void spectralConnectivityCoherence();
     void spectralConnectivityImagCoherence();
     void spectralConnectivityXCOR();
+    void spectralConnectivityStreamingBand();
+    void spectralConnectivitySharedCache();
+    void spectralConnectivitySpectraMemoryBudget();
+    void spectralConnectivityBand();
+    void spectralConnectivityStreaming();
     void cleanupTestCase();
 
 private:
@@ -363,6 +403,259 @@ void TestSpectralConnectivity::spectralConnectivityXCOR()
 }
 
 
+//*************************************************************************************************************
+
+void TestSpectralConnectivity::spectralConnectivityStreamingBand()
+{
+    //*********************************************************************************************************
+    // Compute Connectivity Over A Frequency Band With All Trials Held And In Streaming Mode
+    //*********************************************************************************************************
+
+    // The FFT length exceeds the signal length and gets clamped, also after the streamed trials were freed
+    QList<MatrixXd> matDataList = readConnectivityData();
+
+    ConnectivitySettings settingsBatch;
+    settingsBatch.setSamplingFrequency(1000);
+    settingsBatch.setNumberFFT(2 * matDataList.at(0).cols());
+    settingsBatch.setWindowType("hanning");
+    settingsBatch.setFrequencyBand(8.0f, 30.0f);
+    settingsBatch.append(matDataList);
+
+    ConnectivitySettings settingsStreaming;
+    settingsStreaming.setStreamingMode(true);
+    settingsStreaming.setConnectivityMethods(QStringList() << "COH");
+    settingsStreaming.setSamplingFrequency(1000);
+    settingsStreaming.setNumberFFT(2 * matDataList.at(0).cols());
+    settingsStreaming.setWindowType("hanning");
+    settingsStreaming.setFrequencyBand(8.0f, 30.0f);
+    settingsStreaming.append(matDataList);
+
+    QVERIFY( settingsStreaming.getTrialData().isEmpty() );
+    QVERIFY( settingsStreaming.getFrequencyBins() == settingsBatch.getFrequencyBins() );
+    QVERIFY( settingsBatch.getFrequencyBins().first > 0 );
+
+    Network networkBatch = Coherence::calculate(settingsBatch);
+    Network networkStreaming = Coherence::calculate(settingsStreaming);
+
+    //*********************************************************************************************************
+    // Compare Connectivity
+    //*********************************************************************************************************
+
+    QVERIFY( networkStreaming.getFrequencyBinOffset() == networkBatch.getFrequencyBinOffset() );
+
+    MatrixXd matBatch = networkBatch.getFullConnectivityMatrix();
+    MatrixXd matStreaming = networkStreaming.getFullConnectivityMatrix();
+
+    QVERIFY( matBatch.rows() == matStreaming.rows() && matBatch.cols() == matStreaming.cols() );
+    QVERIFY( (matBatch - matStreaming).cwiseAbs().maxCoeff() < epsilon );
+}
+
+
+//*************************************************************************************************************
+
+void TestSpectralConnectivity::spectralConnectivitySharedCache()
+{
+    //*********************************************************************************************************
+    // Compute Several Metrics From One Shared Spectral Cache And Each Metric On Its Own
+    //*********************************************************************************************************
+
+    QList<MatrixXd> matDataList = readConnectivityData();
+    QStringList lMethods = QStringList() << "COH" << "IMAGCOH" << "PLV" << "PLI" << "USPLI" << "WPLI" << "DSWPLI" << "XCOR";
+
+    ConnectivitySettings settingsShared;
+    settingsShared.setConnectivityMethods(lMethods);
+    settingsShared.setNumberFFT(matDataList.at(0).cols());
+    settingsShared.setWindowType("hanning");
+    settingsShared.append(matDataList);
+
+    QList<Network> lNetworksShared = Connectivity::calculate(settingsShared);
+    QVERIFY( lNetworksShared.size() == lMethods.size() );
+
+    //*********************************************************************************************************
+    // Compare Connectivity
+    //*********************************************************************************************************
+
+    for(int i = 0; i < lNetworksShared.size(); ++i) {
+        ConnectivitySettings settingsSingle;
+        settingsSingle.setConnectivityMethods(QStringList() << lNetworksShared.at(i).getConnectivityMethod());
+        settingsSingle.setNumberFFT(matDataList.at(0).cols());
+        settingsSingle.setWindowType("hanning");
+        settingsSingle.append(matDataList);
+
+        QList<Network> lNetworksSingle = Connectivity::calculate(settingsSingle);
+        QVERIFY( lNetworksSingle.size() == 1 );
+        QVERIFY( maxDifference(lNetworksShared.at(i), lNetworksSingle.first()) < epsilon );
+    }
+}
+
+
+//*************************************************************************************************************
+
+void TestSpectralConnectivity::spectralConnectivitySpectraMemoryBudget()
+{
+    //*********************************************************************************************************
+    // Compute Connectivity Without And With A Spectra Memory Budget
+    //*********************************************************************************************************
+
+    QList<MatrixXd> matDataList = readConnectivityData();
+    QStringList lMethods = QStringList() << "COH" << "PLV" << "WPLI";
+
+    ConnectivitySettings settingsUnbounded;
+    settingsUnbounded.setConnectivityMethods(lMethods);
+    settingsUnbounded.setNumberFFT(matDataList.at(0).cols());
+    settingsUnbounded.setWindowType("hanning");
+    settingsUnbounded.append(matDataList);
+
+    ConnectivitySettings settingsBudget;
+    settingsBudget.setConnectivityMethods(lMethods);
+    settingsBudget.setSpectraMemoryBudget(0);
+    settingsBudget.setNumberFFT(matDataList.at(0).cols());
+    settingsBudget.setWindowType("hanning");
+    settingsBudget.append(matDataList);
+
+    // Spectra which are only needed for the CSD are freed while the trials are processed
+    settingsBudget.computeSpectralCache(settingsBudget.getSpectralContent());
+    QVERIFY( !hasTaperedSpectra(settingsBudget) );
+
+    QList<Network> lNetworksUnbounded = Connectivity::calculate(settingsUnbounded);
+    QList<Network> lNetworksBudget = Connectivity::calculate(settingsBudget);
+
+    QVERIFY( hasTaperedSpectra(settingsUnbounded) );
+    QVERIFY( !hasTaperedSpectra(settingsBudget) );
+    QVERIFY( lNetworksBudget.size() == lNetworksUnbounded.size() );
+
+    for(int i = 0; i < lNetworksBudget.size(); ++i) {
+        QVERIFY( maxDifference(lNetworksBudget.at(i), lNetworksUnbounded.at(i)) < epsilon );
+    }
+
+    //*********************************************************************************************************
+    // The Cross Correlation Consumes The Spectra Last And Frees Them Afterwards
+    //*********************************************************************************************************
+
+    ConnectivitySettings settingsXcor;
+    settingsXcor.setConnectivityMethods(QStringList() << "COH" << "XCOR");
+    settingsXcor.setSpectraMemoryBudget(0);
+    settingsXcor.setNumberFFT(matDataList.at(0).cols());
+    settingsXcor.setWindowType("hanning");
+    settingsXcor.append(matDataList);
+
+    QList<Network> lNetworksXcor = Connectivity::calculate(settingsXcor);
+    QVERIFY( !hasTaperedSpectra(settingsXcor) );
+    QVERIFY( lNetworksXcor.size() == 2 );
+
+    Network networkXcor = CrossCorrelation::calculate(m_connectivitySettings);
+    Network networkCoh = Coherence::calculate(m_connectivitySettings);
+
+    for(int i = 0; i < lNetworksXcor.size(); ++i) {
+        if(lNetworksXcor.at(i).getConnectivityMethod() == "XCOR") {
+            QVERIFY( maxDifference(lNetworksXcor.at(i), networkXcor) < epsilon );
+        } else {
+            QVERIFY( maxDifference(lNetworksXcor.at(i), networkCoh) < epsilon );
+        }
+    }
+}
+
+
+//*************************************************************************************************************
+
+void TestSpectralConnectivity::spectralConnectivityBand()
+{
+    //*********************************************************************************************************
+    // Compute Connectivity Over The Full Spectrum And Over A Frequency Band Only
+    //*********************************************************************************************************
+
+    QList<MatrixXd> matDataList = readConnectivityData();
+    QStringList lMethods = QStringList() << "COH" << "IMAGCOH" << "PLV" << "PLI" << "USPLI" << "WPLI" << "DSWPLI";
+
+    ConnectivitySettings settingsFull;
+    settingsFull.setConnectivityMethods(lMethods);
+    settingsFull.setSamplingFrequency(1000);
+    settingsFull.setNumberFFT(matDataList.at(0).cols());
+    settingsFull.setWindowType("hanning");
+    settingsFull.append(matDataList);
+
+    ConnectivitySettings settingsBand;
+    settingsBand.setConnectivityMethods(lMethods);
+    settingsBand.setSamplingFrequency(1000);
+    settingsBand.setNumberFFT(matDataList.at(0).cols());
+    settingsBand.setWindowType("hanning");
+    settingsBand.setFrequencyBand(8.0f, 30.0f);
+    settingsBand.append(matDataList);
+
+    QPair<int,int> freqBins = settingsBand.getFrequencyBins();
+    QVERIFY( freqBins.first > 0 && freqBins.second > freqBins.first );
+
+    QList<Network> lNetworksFull = Connectivity::calculate(settingsFull);
+    QList<Network> lNetworksBand = Connectivity::calculate(settingsBand);
+    QVERIFY( lNetworksBand.size() == lNetworksFull.size() );
+
+    //*********************************************************************************************************
+    // Compare The Band Weights To The Band Bins Of The Full Spectrum Weights
+    //*********************************************************************************************************
+
+    for(int i = 0; i < lNetworksBand.size(); ++i) {
+        QVERIFY( lNetworksBand.at(i).getConnectivityMethod() == lNetworksFull.at(i).getConnectivityMethod() );
+        QVERIFY( lNetworksBand.at(i).getFrequencyBinOffset() == freqBins.first );
+
+        const QList<QSharedPointer<NetworkEdge> >& lEdgesFull = lNetworksFull.at(i).getFullEdges();
+        const QList<QSharedPointer<NetworkEdge> >& lEdgesBand = lNetworksBand.at(i).getFullEdges();
+        QVERIFY( lEdgesBand.size() == lEdgesFull.size() );
+
+        for(int j = 0; j < lEdgesBand.size(); ++j) {
+            // The upper bin is exclusive when averaging
+            lEdgesFull.at(j)->setFrequencyBins(QPair<int,int>(freqBins.first, freqBins.second + 1));
+            QVERIFY( fabs(lEdgesBand.at(j)->getWeight() - lEdgesFull.at(j)->getWeight()) < epsilon );
+        }
+    }
+}
+
+
+//*************************************************************************************************************
+
+void TestSpectralConnectivity::spectralConnectivityStreaming()
+{
+    //*********************************************************************************************************
+    // Compute Connectivity With All Trials Held And With Trials Reduced One By One In Streaming Mode
+    //*********************************************************************************************************
+
+    QList<MatrixXd> matDataList = readConnectivityData();
+    QStringList lMethods = QStringList() << "COH" << "IMAGCOH" << "PLV" << "PLI" << "USPLI" << "WPLI" << "DSWPLI";
+
+    ConnectivitySettings settingsBatch;
+    settingsBatch.setConnectivityMethods(lMethods);
+    settingsBatch.setNumberFFT(matDataList.at(0).cols());
+    settingsBatch.setWindowType("hanning");
+    settingsBatch.append(matDataList);
+
+    ConnectivitySettings settingsStreaming;
+    settingsStreaming.setStreamingMode(true);
+    settingsStreaming.setConnectivityMethods(lMethods);
+    settingsStreaming.setNumberFFT(matDataList.at(0).cols());
+    settingsStreaming.setWindowType("hanning");
+
+    for(int i = 0; i < matDataList.size(); ++i) {
+        settingsStreaming.append(matDataList.at(i));
+        QVERIFY( settingsStreaming.getTrialData().isEmpty() );
+    }
+
+    QVERIFY( settingsStreaming.size() == settingsBatch.size() );
+
+    QList<Network> lNetworksBatch = Connectivity::calculate(settingsBatch);
+    QList<Network> lNetworksStreaming = Connectivity::calculate(settingsStreaming);
+
+    //*********************************************************************************************************
+    // Compare Connectivity
+    //*********************************************************************************************************
+
+    QVERIFY( lNetworksStreaming.size() == lNetworksBatch.size() );
+
+    for(int i = 0; i < lNetworksStreaming.size(); ++i) {
+        QVERIFY( lNetworksStreaming.at(i).getConnectivityMethod() == lNetworksBatch.at(i).getConnectivityMethod() );
+        QVERIFY( maxDifference(lNetworksStreaming.at(i), lNetworksBatch.at(i)) < epsilon );
+    }
+}
+
+
 //*************************************************************************************************************
 
 QList<MatrixXd> TestSpectralConnectivity::readConnectivityData()
@@ -40,14 +40,28 @@ TEMPLATE = subdirs
 SUBDIRS += \
     test_codecov \
     test_dipole_fit \
+    test_bem_solution \
     test_fiff_rwr \
+    test_fiff_raw_read_operator \
+    test_circular_matrix_buffer \
+    test_overlap_save_filter \
     test_fiff_mne_types_io \
     test_forward_solution \
     test_fiff_cov \
     test_fiff_digitizer \
     test_mne_msh_display_surface_set \
+    test_adaptive_mp \
+    test_kmeans \
+    test_minimum_norm \
+    test_rap_music \
+    test_hpi_fit \
+    test_eeg_sphere_pot_table \
 
 !contains(MNECPP_CONFIG, minimalVersion) {
+    SUBDIRS += \
+        test_rtave \
+        test_rtcov \
+
     qtHaveModule(charts) {
         SUBDIRS += \
             test_interpolation \
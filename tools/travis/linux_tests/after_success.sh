@@ -9,7 +9,7 @@ git clone https://github.com/mne-tools/mne-cpp-test-data.git mne-cpp-test-data
 MNECPP_ROOT=$(pwd)
 
 # Tests to run - TODO: find required tests automatically with grep
-tests=( test_codecov test_fiff_rwr test_dipole_fit test_fiff_mne_types_io test_fiff_cov test_fiff_digitizer test_mne_msh_display_surface_set test_geometryinfo test_interpolation test_spectral_connectivity)
+tests=( test_codecov test_fiff_rwr test_fiff_raw_read_operator test_circular_matrix_buffer test_overlap_save_filter test_rtave test_rtcov test_dipole_fit test_bem_solution test_fiff_mne_types_io test_fiff_cov test_fiff_digitizer test_mne_msh_display_surface_set test_adaptive_mp test_kmeans test_minimum_norm test_rap_music test_hpi_fit test_eeg_sphere_pot_table test_geometryinfo test_interpolation test_spectral_connectivity)
 
 for test in ${tests[*]};
 do